@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_CORE_BATCH_PROJECTION_HPP
+#define GISKARD_CORE_BATCH_PROJECTION_HPP
+
+#include <giskard_core/qp_controller_projection.hpp>
+#include <giskard_core/work_stealing_pool.hpp>
+#include <boost/shared_ptr.hpp>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace giskard_core
+{
+  class BatchProjectionResult
+  {
+    public:
+      BatchProjectionResult() :
+        completed_(false), converged_(false), termination_reason_(QPControllerProjection::NotRun) {}
+
+      // completed_ is false for jobs skipped after cancellation, and for jobs
+      // that threw; the latter also carry an error_ message
+      bool completed_, converged_;
+      QPControllerProjection::TerminationReason termination_reason_;
+      std::string error_;
+      // one row per trajectory point, one column per controllable
+      Eigen::MatrixXd position_trajectories_, velocity_trajectories_;
+      Eigen::VectorXd time_trajectory_;
+  };
+
+  /**
+   * Projects many start states, e.g. different goal inputs for the same
+   * robot state, in parallel.
+   *
+   * Every worker owns one QPControllerProjection, and with it one fork of
+   * the controller, see QPController::fork(). Jobs are distributed over a
+   * WorkStealingPool, and each job fills the result with the same index.
+   *
+   * run() stops starting new jobs once required_successes jobs converged, or
+   * once cancel() was called from another thread. Jobs that are already
+   * running finish normally.
+   */
+  class BatchProjection
+  {
+    public:
+      typedef std::map<std::string, double> Job;
+
+      BatchProjection(const QPController& controller, const QPControllerProjectionParams& params,
+          size_t num_threads) :
+        pool_(num_threads), params_(params), cancelled_(false), num_successes_(0)
+      {
+        size_t num_projections = std::max(num_threads, static_cast<size_t>(1));
+        for (size_t i=0; i<num_projections; ++i)
+          projections_.push_back(QPControllerProjectionPtr(
+              new QPControllerProjection(controller, params)));
+      }
+
+      std::vector<BatchProjectionResult> run(const std::vector<Job>& jobs, size_t required_successes = 0)
+      {
+        std::vector<BatchProjectionResult> results(jobs.size());
+        cancelled_ = false;
+        num_successes_ = 0;
+
+        pool_.run(jobs.size(), [this, &jobs, &results, required_successes] (size_t task, size_t worker)
+            {
+              if (cancelled_)
+                return;
+
+              project(*(projections_[worker]), jobs[task], results[task]);
+
+              if (results[task].converged_ && required_successes > 0 &&
+                  ++num_successes_ >= required_successes)
+                cancel();
+            });
+
+        return results;
+      }
+
+      // may be called from any thread while run() is executing
+      void cancel()
+      {
+        cancelled_ = true;
+      }
+
+      size_t num_threads() const
+      {
+        return pool_.num_threads();
+      }
+
+      const QPControllerProjectionParams& get_params() const
+      {
+        return params_;
+      }
+
+    private:
+      typedef typename boost::shared_ptr<QPControllerProjection> QPControllerProjectionPtr;
+
+      WorkStealingPool pool_;
+      QPControllerProjectionParams params_;
+      std::vector<QPControllerProjectionPtr> projections_;
+      std::atomic<bool> cancelled_;
+      std::atomic<size_t> num_successes_;
+
+      static void project(QPControllerProjection& projection, const Job& job,
+          BatchProjectionResult& result)
+      {
+        try
+        {
+          projection.run(job);
+        }
+        catch (const std::exception& e)
+        {
+          result.error_ = e.what();
+          return;
+        }
+        catch (...)
+        {
+          result.error_ = "Unknown error during projection.";
+          return;
+        }
+
+        result.completed_ = true;
+        result.converged_ = projection.converged();
+        result.termination_reason_ = projection.get_termination_reason();
+        result.position_trajectories_ = projection.get_position_trajectories();
+        result.velocity_trajectories_ = projection.get_velocity_trajectories();
+        result.time_trajectory_ = projection.get_time_trajectory();
+      }
+  };
+}
+
+#endif // GISKARD_CORE_BATCH_PROJECTION_HPP
@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_CORE_CONTROLLER_EXCHANGE_HPP
+#define GISKARD_CORE_CONTROLLER_EXCHANGE_HPP
+
+#include <giskard_core/triple_buffer.hpp>
+#include <boost/shared_ptr.hpp>
+#include <Eigen/Core>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace giskard_core
+{
+  /**
+   * Hands observables from several writer threads to one controller thread.
+   *
+   * Every writer owns a slice of the observables vector, e.g. the joint states
+   * or the goal inputs of one task. Each slice is exchanged through its own
+   * TripleBuffer, so publishing and fetching are wait-free. fetch() assembles
+   * the latest published value of every slice into one vector.
+   *
+   * Slices have to be added before the writer and reader threads start.
+   */
+  class ObservablesExchange
+  {
+    public:
+      ObservablesExchange() {}
+
+      explicit ObservablesExchange(size_t num_observables) :
+        observables_(Eigen::VectorXd::Zero(num_observables)) {}
+
+      explicit ObservablesExchange(const Eigen::VectorXd& initial_observables) :
+        observables_(initial_observables) {}
+
+      size_t add_slice(size_t start, size_t size)
+      {
+        if (size == 0)
+          throw std::invalid_argument("Cannot add observable slice of size 0.");
+
+        if (start + size > num_observables())
+          throw std::length_error("Observable slice [" + std::to_string(start) + ", " +
+              std::to_string(start + size) + ") exceeds the " + std::to_string(num_observables()) +
+              " observables of the exchange.");
+
+        for (size_t i=0; i<slices_.size(); ++i)
+          if (start < slices_[i]->start_ + slices_[i]->size_ && slices_[i]->start_ < start + size)
+            throw std::invalid_argument("Observable slice starting at " + std::to_string(start) +
+                " overlaps with slice " + std::to_string(i) + ".");
+
+        SlicePtr slice(new Slice());
+        slice->start_ = start;
+        slice->size_ = size;
+        slice->buffer_.reset(observables_.segment(start, size));
+        slices_.push_back(slice);
+
+        return slices_.size() - 1;
+      }
+
+      // writer side, one thread per slice
+      Eigen::VectorXd& get_write_buffer(size_t slice)
+      {
+        return get_slice(slice).buffer_.get_write_buffer();
+      }
+
+      void publish(size_t slice)
+      {
+        get_slice(slice).buffer_.publish();
+      }
+
+      void publish(size_t slice, const Eigen::VectorXd& values)
+      {
+        Slice& s = get_slice(slice);
+        if (values.rows() != static_cast<int>(s.size_))
+          throw std::length_error("Published " + std::to_string(values.rows()) +
+              " values to observable slice " + std::to_string(slice) + " of size " +
+              std::to_string(s.size_) + ".");
+
+        s.buffer_.get_write_buffer() = values;
+        s.buffer_.publish();
+      }
+
+      // reader side, one thread only
+      const Eigen::VectorXd& fetch()
+      {
+        for (size_t i=0; i<slices_.size(); ++i)
+          if (slices_[i]->buffer_.fetch())
+            observables_.segment(slices_[i]->start_, slices_[i]->size_) =
+              slices_[i]->buffer_.get_read_buffer();
+
+        return observables_;
+      }
+
+      const Eigen::VectorXd& get_observables() const
+      {
+        return observables_;
+      }
+
+      size_t num_observables() const
+      {
+        return observables_.rows();
+      }
+
+      size_t num_slices() const
+      {
+        return slices_.size();
+      }
+
+    private:
+      struct Slice
+      {
+        size_t start_, size_;
+        TripleBuffer<Eigen::VectorXd> buffer_;
+      };
+      typedef typename boost::shared_ptr<Slice> SlicePtr;
+
+      std::vector<SlicePtr> slices_;
+      Eigen::VectorXd observables_;
+
+      Slice& get_slice(size_t slice)
+      {
+        if (slice >= slices_.size())
+          throw std::out_of_range("Observable exchange has no slice " + std::to_string(slice) + ".");
+
+        return *(slices_[slice]);
+      }
+  };
+
+  /**
+   * Hands the command and slack vectors of one controller thread to one
+   * consumer thread, wait-free and without allocation.
+   */
+  class CommandExchange
+  {
+    public:
+      CommandExchange() {}
+
+      CommandExchange(size_t num_controllables, size_t num_soft_constraints)
+      {
+        Command initial;
+        initial.command_ = Eigen::VectorXd::Zero(num_controllables);
+        initial.slack_ = Eigen::VectorXd::Zero(num_soft_constraints);
+        buffer_.reset(initial);
+      }
+
+      // controller side
+      void publish(const Eigen::VectorXd& command, const Eigen::VectorXd& slack)
+      {
+        Command& c = buffer_.get_write_buffer();
+        c.command_ = command;
+        c.slack_ = slack;
+        buffer_.publish();
+      }
+
+      // consumer side
+      bool fetch()
+      {
+        return buffer_.fetch();
+      }
+
+      const Eigen::VectorXd& get_command() const
+      {
+        return buffer_.get_read_buffer().command_;
+      }
+
+      const Eigen::VectorXd& get_slack() const
+      {
+        return buffer_.get_read_buffer().slack_;
+      }
+
+    private:
+      struct Command
+      {
+        Eigen::VectorXd command_, slack_;
+      };
+
+      TripleBuffer<Command> buffer_;
+  };
+}
+
+#endif // GISKARD_CORE_CONTROLLER_EXCHANGE_HPP
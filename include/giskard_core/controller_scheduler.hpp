@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_CORE_CONTROLLER_SCHEDULER_HPP
+#define GISKARD_CORE_CONTROLLER_SCHEDULER_HPP
+
+#include <giskard_core/qp_controller.hpp>
+#include <giskard_core/work_stealing_pool.hpp>
+#include <boost/shared_ptr.hpp>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace giskard_core
+{
+  class ControllerStatistics
+  {
+    public:
+      ControllerStatistics() :
+        num_updates_(0), num_failures_(0), num_deadline_misses_(0),
+        last_duration_(0.0), max_duration_(0.0), total_duration_(0.0)
+      {}
+
+      double mean_duration() const
+      {
+        return num_updates_ == 0 ? 0.0 : total_duration_ / num_updates_;
+      }
+
+      // durations are given in seconds
+      size_t num_updates_, num_failures_, num_deadline_misses_;
+      double last_duration_, max_duration_, total_duration_;
+  };
+
+  /**
+   * Updates a set of independent QPControllers once per cycle.
+   *
+   * Every controller comes with an observable source that fills its
+   * observables at the beginning of its update, a deadline in seconds, and its
+   * own nWSR. The first cycle starts the controllers, all later cycles update
+   * them. In Realtime mode, the controllers are distributed over a
+   * WorkStealingPool and updates exceeding their deadline are counted as
+   * misses. In Simulation mode, the controllers are updated one after the
+   * other in the order they were added, on the calling thread, and deadlines
+   * are not checked because wall-clock time is meaningless there.
+   *
+   * Controllers are updated concurrently, so they must not share expression
+   * graphs, i.e. each of them has to come from its own call to generate().
+   */
+  class ControllerScheduler
+  {
+    public:
+      enum Mode { Realtime, Simulation };
+      typedef std::function<void(Eigen::VectorXd& observables)> ObservableSource;
+
+      ControllerScheduler(size_t num_threads, Mode mode=Realtime) :
+        pool_(mode == Simulation ? 0 : num_threads), mode_(mode) {}
+
+      size_t add_controller(const std::string& name, const QPController& controller,
+          const ObservableSource& source, double deadline, int nWSR)
+      {
+        if (deadline <= 0.0)
+          throw std::invalid_argument("Deadline of controller '" + name + "' is not positive.");
+
+        if (!source)
+          throw std::invalid_argument("Controller '" + name + "' has no observable source.");
+
+        EntryPtr entry(new Entry());
+        entry->name_ = name;
+        entry->controller_ = controller;
+        entry->source_ = source;
+        entry->observables_ = Eigen::VectorXd::Zero(controller.num_observables());
+        entry->deadline_ = deadline;
+        entry->nWSR_ = nWSR;
+        entry->started_ = false;
+        entry->succeeded_ = false;
+        entries_.push_back(entry);
+
+        return entries_.size() - 1;
+      }
+
+      // returns true if all controllers could be updated
+      bool update()
+      {
+        pool_.run(entries_.size(), [this] (size_t task, size_t worker)
+            { update_entry(*(entries_[task])); });
+
+        for (size_t i=0; i<entries_.size(); ++i)
+          if (!entries_[i]->succeeded_)
+            return false;
+
+        return true;
+      }
+
+      void reset_statistics()
+      {
+        for (size_t i=0; i<entries_.size(); ++i)
+          entries_[i]->statistics_ = ControllerStatistics();
+      }
+
+      size_t num_controllers() const
+      {
+        return entries_.size();
+      }
+
+      size_t num_threads() const
+      {
+        return pool_.num_threads();
+      }
+
+      Mode get_mode() const
+      {
+        return mode_;
+      }
+
+      const std::string& get_name(size_t index) const
+      {
+        return get_entry(index).name_;
+      }
+
+      const QPController& get_controller(size_t index) const
+      {
+        return get_entry(index).controller_;
+      }
+
+      const ControllerStatistics& get_statistics(size_t index) const
+      {
+        return get_entry(index).statistics_;
+      }
+
+    private:
+      struct Entry
+      {
+        std::string name_;
+        QPController controller_;
+        ObservableSource source_;
+        Eigen::VectorXd observables_;
+        double deadline_;
+        int nWSR_;
+        bool started_, succeeded_;
+        ControllerStatistics statistics_;
+      };
+      typedef typename boost::shared_ptr<Entry> EntryPtr;
+
+      std::vector<EntryPtr> entries_;
+      WorkStealingPool pool_;
+      Mode mode_;
+
+      const Entry& get_entry(size_t index) const
+      {
+        if (index >= entries_.size())
+          throw std::out_of_range("Scheduler has no controller with index " +
+              std::to_string(index) + ".");
+
+        return *(entries_[index]);
+      }
+
+      void update_entry(Entry& entry)
+      {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        entry.source_(entry.observables_);
+        if (entry.started_)
+          entry.succeeded_ = entry.controller_.update(entry.observables_, entry.nWSR_);
+        else
+          entry.succeeded_ = entry.started_ = entry.controller_.start(entry.observables_, entry.nWSR_);
+
+        double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        ControllerStatistics& stats = entry.statistics_;
+        stats.num_updates_++;
+        if (!entry.succeeded_)
+          stats.num_failures_++;
+        if (mode_ == Realtime && duration > entry.deadline_)
+          stats.num_deadline_misses_++;
+        stats.last_duration_ = duration;
+        stats.max_duration_ = std::max(stats.max_duration_, duration);
+        stats.total_duration_ += duration;
+      }
+  };
+}
+
+#endif // GISKARD_CORE_CONTROLLER_SCHEDULER_HPP
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_CORE_EVENT_TRIGGER_HPP
+#define GISKARD_CORE_EVENT_TRIGGER_HPP
+
+#include <Eigen/Core>
+#include <stdexcept>
+#include <string>
+
+namespace giskard_core
+{
+  /**
+   * Parameters of the event-triggered update mode of QPController.
+   *
+   * An update is skipped, and the previous command reused, as long as the
+   * observables stay close to the observables of the last solve: either every
+   * observable changed by at most its entry in thresholds_, or, if no
+   * per-observable thresholds are given, the norm of the change is at most
+   * norm_threshold_. After max_hold_ticks_ consecutive skips, the controller
+   * solves again regardless of the change.
+   */
+  class EventTriggerParams
+  {
+    public:
+      EventTriggerParams() :
+        norm_threshold_(0.0), max_hold_ticks_(0) {}
+
+      EventTriggerParams(double norm_threshold, size_t max_hold_ticks) :
+        norm_threshold_(norm_threshold), max_hold_ticks_(max_hold_ticks) {}
+
+      EventTriggerParams(const Eigen::VectorXd& thresholds, size_t max_hold_ticks) :
+        thresholds_(thresholds), norm_threshold_(0.0), max_hold_ticks_(max_hold_ticks) {}
+
+      void verify_sanity() const
+      {
+        if (norm_threshold_ < 0.0)
+          throw std::invalid_argument("Norm threshold of event trigger is negative.");
+
+        if ((thresholds_.array() < 0.0).any())
+          throw std::invalid_argument("Event trigger has negative observable threshold.");
+      }
+
+      bool is_active() const
+      {
+        return max_hold_ticks_ > 0;
+      }
+
+      // evaluated lazily by Eigen, i.e. without allocating the difference
+      bool is_below_threshold(const Eigen::VectorXd& observables, const Eigen::VectorXd& reference) const
+      {
+        if (thresholds_.rows() == 0)
+          return (observables - reference).norm() <= norm_threshold_;
+
+        if (thresholds_.rows() != observables.rows())
+          throw std::length_error("Event trigger has " + std::to_string(thresholds_.rows()) +
+              " observable thresholds, but received " + std::to_string(observables.rows()) + " observables.");
+
+        return ((observables - reference).array().abs() <= thresholds_.array()).all();
+      }
+
+      Eigen::VectorXd thresholds_;
+      double norm_threshold_;
+      size_t max_hold_ticks_;
+  };
+}
+
+#endif // GISKARD_CORE_EVENT_TRIGGER_HPP
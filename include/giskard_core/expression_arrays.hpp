@@ -107,16 +107,42 @@ namespace KDL
         copy_results();
       }
 
+      // Accepts expressions like segments of a larger vector without creating
+      // a temporary Eigen::VectorXd.
+      template<typename Derived>
+      void update(const Eigen::MatrixBase<Derived>& inputs)
+      {
+        inputs_ = inputs;
+        optimizer_.setInputValues(inputs_);
+        copy_results();
+      }
+
       const Eigen::Matrix<ResultType, Eigen::Dynamic, 1>& get_values() const
       {
         return values_;
       }
 
-      const Eigen::Matrix<DerivType, Eigen::Dynamic, Eigen::Dynamic> get_derivatives() const
+      const Eigen::Matrix<DerivType, Eigen::Dynamic, Eigen::Dynamic>& get_derivatives() const
       {
         return derivatives_;
       }
 
+      /**
+       * Returns an array of clones of the expressions, which evaluate
+       * independently of these ones. Subexpressions shared between several
+       * expressions are cloned once per expression.
+       */
+      ExpressionArray<ResultType> clone() const
+      {
+        std::vector< ExpressionTypePtr > expressions;
+        for(size_t i=0; i<expressions_.size(); ++i)
+          expressions.push_back(expressions_[i]->clone());
+
+        ExpressionArray<ResultType> result;
+        result.set_expressions(expressions);
+        return result;
+      }
+
       std::vector<DerivExpressionTypePtr> get_derivative_expressions(size_t expression_index) const
       {
         std::vector<DerivExpressionTypePtr> result;
@@ -128,6 +154,7 @@ namespace KDL
     private:
       Eigen::Matrix<ResultType, Eigen::Dynamic, 1> values_;
       Eigen::Matrix<DerivType, Eigen::Dynamic, Eigen::Dynamic> derivatives_;
+      Eigen::VectorXd inputs_;
       std::vector< ExpressionTypePtr > expressions_;
       // TODO: Each ExpressionArray has its own optimizer. That is not ideal w.r.t. runtime. One could try to speed
       //       up the runtime of QPController by having all ExpressionArray share one ExpressionOptimizer object.
@@ -159,6 +186,7 @@ namespace KDL
       {
         values_.resize(num_expressions(), 1);
         derivatives_.resize(num_expressions(), num_inputs());        
+        inputs_.resize(num_inputs());
       }
 
       void copy_results()
@@ -25,58 +25,98 @@
 #include <giskard_core/scope.hpp>
 #include <giskard_core/qp_controller.hpp>
 #include <giskard_core/specifications.hpp>
+#include <giskard_core/spec_traversal.hpp>
 
 namespace giskard_core
 {
 
-  inline giskard_core::Scope generate(const giskard_core::ScopeSpec& scope_spec)
+  // Adds the expression of one scope entry to a scope, dispatching on the type of its spec.
+  class ScopeEntryGenerator : public giskard_core::SpecVisitor
   {
-    giskard_core::Scope scope;
+    public:
+      using giskard_core::SpecVisitor::visit;
 
-    for(size_t i=0; i<scope_spec.size(); ++i)
-    {
-      std::string name = scope_spec[i].name;
-      giskard_core::SpecPtr spec = scope_spec[i].spec;
-
-      if(boost::dynamic_pointer_cast<giskard_core::DoubleSpec>(spec).get())
-        scope.add_double_expression(name,
-            boost::dynamic_pointer_cast<giskard_core::DoubleSpec>(spec)->get_expression(scope));
-      else if(boost::dynamic_pointer_cast<giskard_core::VectorSpec>(spec).get())
-        scope.add_vector_expression(name,
-            boost::dynamic_pointer_cast<giskard_core::VectorSpec>(spec)->get_expression(scope));
-      else if(boost::dynamic_pointer_cast<giskard_core::FrameSpec>(spec).get())
-        scope.add_frame_expression(name,
-            boost::dynamic_pointer_cast<giskard_core::FrameSpec>(spec)->get_expression(scope));
-      else if(boost::dynamic_pointer_cast<giskard_core::RotationSpec>(spec).get())
-        scope.add_rotation_expression(name,
-            boost::dynamic_pointer_cast<giskard_core::RotationSpec>(spec)->get_expression(scope));
-      else if(boost::dynamic_pointer_cast<giskard_core::AliasReferenceSpec>(spec).get())
+      ScopeEntryGenerator(const std::string& name, giskard_core::Scope& scope) :
+        name_( name ), scope_( scope ) {}
+
+      virtual void visit(giskard_core::Spec& spec)
+      {
+        throw std::domain_error("Scope generation: found entry of non-supported type.");
+      }
+
+      virtual void visit(giskard_core::DoubleSpec& spec)
+      {
+        scope_.add_double_expression(name_, spec.get_expression(scope_));
+      }
+
+      virtual void visit(giskard_core::VectorSpec& spec)
+      {
+        scope_.add_vector_expression(name_, spec.get_expression(scope_));
+      }
+
+      virtual void visit(giskard_core::RotationSpec& spec)
+      {
+        scope_.add_rotation_expression(name_, spec.get_expression(scope_));
+      }
+
+      virtual void visit(giskard_core::FrameSpec& spec)
+      {
+        scope_.add_frame_expression(name_, spec.get_expression(scope_));
+      }
+
+      virtual void visit(giskard_core::AliasReferenceSpec& spec)
       {
         // generation of alias references is extraordinarily convoluted;
         // it is a feature that was added relatively late... sorry!
-        KDL::ExpressionBase::Ptr exp =
-          boost::dynamic_pointer_cast<giskard_core::AliasReferenceSpec>(spec)->get_expression(scope);
+        KDL::ExpressionBase::Ptr exp = spec.get_expression(scope_);
         if (boost::dynamic_pointer_cast<KDL::Expression<double>>(exp).get())
-          scope.add_double_expression(name, boost::dynamic_pointer_cast<KDL::Expression<double>>(exp));
+          scope_.add_double_expression(name_, boost::dynamic_pointer_cast<KDL::Expression<double>>(exp));
         else if (boost::dynamic_pointer_cast<KDL::Expression<KDL::Vector>>(exp).get())
-          scope.add_vector_expression(name, boost::dynamic_pointer_cast<KDL::Expression<KDL::Vector>>(exp));
+          scope_.add_vector_expression(name_, boost::dynamic_pointer_cast<KDL::Expression<KDL::Vector>>(exp));
         else if (boost::dynamic_pointer_cast<KDL::Expression<KDL::Rotation>>(exp).get())
-          scope.add_rotation_expression(name, boost::dynamic_pointer_cast<KDL::Expression<KDL::Rotation>>(exp));
+          scope_.add_rotation_expression(name_, boost::dynamic_pointer_cast<KDL::Expression<KDL::Rotation>>(exp));
         else if (boost::dynamic_pointer_cast<KDL::Expression<KDL::Frame>>(exp).get())
-          scope.add_frame_expression(name, boost::dynamic_pointer_cast<KDL::Expression<KDL::Frame>>(exp));
+          scope_.add_frame_expression(name_, boost::dynamic_pointer_cast<KDL::Expression<KDL::Frame>>(exp));
         else
           throw std::domain_error("Error during generation of alias reference! Could not cast into any existing expression type. This is an giskard-internal error that should not happen.");
       }
-      else
+
+    private:
+      const std::string& name_;
+      giskard_core::Scope& scope_;
+  };
+
+  // Adds the expressions of all entries to scope, sharing nodes through the memo of scope if set.
+  inline void generate(const giskard_core::ScopeSpec& scope_spec, giskard_core::Scope& scope)
+  {
+    for(size_t i=0; i<scope_spec.size(); ++i)
+    {
+      if(!scope_spec[i].spec)
         throw std::domain_error("Scope generation: found entry of non-supported type.");
+
+      ScopeEntryGenerator generator(scope_spec[i].name, scope);
+      scope_spec[i].spec->accept(generator);
     }
+  }
+
+  inline giskard_core::Scope generate(const giskard_core::ScopeSpec& scope_spec)
+  {
+    giskard_core::Scope scope;
+    giskard_core::ExpressionMemoGuard guard(
+        giskard_core::create_expression_memo(scope_spec, std::vector<giskard_core::SpecPtr>()));
+    generate(scope_spec, scope);
 
     return scope;
   }
 
-  inline giskard_core::QPController generate(const giskard_core::QPControllerSpec& spec)
+  // Controller of spec, but without its fingerprint and generator, see generate().
+  inline giskard_core::QPController generate_expressions(const giskard_core::QPControllerSpec& spec)
   {
-    giskard_core::Scope scope = generate(spec.scope_);
+    // spec nodes shared between the scope and the constraints become shared expressions
+    giskard_core::Scope scope;
+    giskard_core::ExpressionMemoGuard guard(
+        giskard_core::create_expression_memo(spec.scope_, giskard_core::get_constraint_specs(spec)));
+    generate(spec.scope_, scope);
 
     // generate controllable constraints
     std::vector< KDL::Expression<double>::Ptr > controllable_lower, controllable_upper,
@@ -126,7 +166,24 @@ namespace giskard_core
                            soft_weight, soft_name, hard_exp, hard_lower, hard_upper)))
       throw std::runtime_error("QPController generation: Init of controller failed.");
 
-    controller.set_scope(scope);
+    // entries no constraint depends on are only evaluated when read
+    std::vector<giskard_core::Scope::Handle> feedback;
+    for (auto const & key: giskard_core::find_feedback_scope_entries(spec))
+      feedback.push_back(scope.resolve(key.first, key.second));
+    controller.set_scope(scope, feedback);
+
+    return controller;
+  }
+
+  inline giskard_core::QPController generate(const giskard_core::QPControllerSpec& spec)
+  {
+    giskard_core::QPController controller = generate_expressions(spec);
+    controller.set_spec_fingerprint(giskard_core::fingerprint(spec));
+
+    // forks regenerate from a copy, so later changes to spec do not reach them
+    boost::shared_ptr<const giskard_core::QPControllerSpec> copy(
+        new giskard_core::QPControllerSpec(giskard_core::copy_nodes(spec)));
+    controller.set_generator([copy] () { return generate_expressions(*copy); });
 
     return controller;
   }
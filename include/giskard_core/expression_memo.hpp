@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_CORE_EXPRESSION_MEMO_HPP
+#define GISKARD_CORE_EXPRESSION_MEMO_HPP
+
+#include <boost/shared_ptr.hpp>
+#include <unordered_map>
+#include <unordered_set>
+#include <giskard_core/expressiontree.hpp>
+
+namespace giskard_core
+{
+  /**
+   * Maps spec nodes to the expressions generated from them, so that a spec
+   * node shared by several parents becomes one shared expression node.
+   *
+   * The fan-out of a spec node is the number of its parents, counting
+   * references into the scope as parents of the referenced entry. Spec
+   * nodes with a fan-out above one get generated as cached expressions,
+   * i.e. they are evaluated once per update instead of once per parent.
+   * Nodes marked as uncached are never wrapped: they are needed during
+   * generation, e.g. the denominator of fmod, already cached explicitly, or
+   * too cheap to be worth a cache.
+   *
+   * The keys are the addresses of spec nodes not owned by the memo. Hence,
+   * a memo must only live for the duration of one generate() call, which
+   * makes it the current memo of its thread through an ExpressionMemoGuard.
+   */
+  class ExpressionMemo
+  {
+    public:
+      ExpressionMemo() : num_hits_(0) {}
+
+      bool find(const void* spec, KDL::ExpressionBase::Ptr& expression)
+      {
+        std::unordered_map<const void*, KDL::ExpressionBase::Ptr>::const_iterator it = expressions_.find(spec);
+        if (it == expressions_.end())
+          return false;
+
+        ++num_hits_;
+        expression = it->second;
+        return true;
+      }
+
+      void insert(const void* spec, const KDL::ExpressionBase::Ptr& expression)
+      {
+        expressions_[spec] = expression;
+      }
+
+      void add_parent(const void* spec)
+      {
+        ++fan_outs_[spec];
+      }
+
+      size_t get_fan_out(const void* spec) const
+      {
+        std::unordered_map<const void*, size_t>::const_iterator it = fan_outs_.find(spec);
+        return it == fan_outs_.end() ? 0 : it->second;
+      }
+
+      void set_uncached(const void* spec)
+      {
+        uncached_.insert(spec);
+      }
+
+      bool is_cached(const void* spec) const
+      {
+        return get_fan_out(spec) > 1 && uncached_.count(spec) == 0;
+      }
+
+      size_t size() const
+      {
+        return expressions_.size();
+      }
+
+      // number of generations saved by sharing
+      size_t num_hits() const
+      {
+        return num_hits_;
+      }
+
+      // memo that spec nodes generate their expressions with in this thread, if any
+      static ExpressionMemo*& current()
+      {
+        static thread_local ExpressionMemo* memo = 0;
+        return memo;
+      }
+
+    private:
+      std::unordered_map<const void*, KDL::ExpressionBase::Ptr> expressions_;
+      std::unordered_map<const void*, size_t> fan_outs_;
+      std::unordered_set<const void*> uncached_;
+      size_t num_hits_;
+  };
+
+  typedef typename boost::shared_ptr<ExpressionMemo> ExpressionMemoPtr;
+
+  // Makes memo the current memo of this thread, until the guard goes out of scope.
+  class ExpressionMemoGuard
+  {
+    public:
+      ExpressionMemoGuard(const ExpressionMemoPtr& memo) :
+        memo_( memo ), previous_( ExpressionMemo::current() )
+      {
+        ExpressionMemo::current() = memo_.get();
+      }
+
+      ~ExpressionMemoGuard()
+      {
+        ExpressionMemo::current() = previous_;
+      }
+
+    private:
+      ExpressionMemoPtr memo_;
+      ExpressionMemo* previous_;
+
+      ExpressionMemoGuard(const ExpressionMemoGuard& other);
+      ExpressionMemoGuard& operator=(const ExpressionMemoGuard& other);
+  };
+}
+
+#endif // GISKARD_CORE_EXPRESSION_MEMO_HPP
@@ -21,15 +21,33 @@
 #ifndef GISKARD_CORE_GISKARD_CORE_HPP
 #define GISKARD_CORE_GISKARD_CORE_HPP
 
+#include <giskard_core/batch_projection.hpp>
+#include <giskard_core/controller_exchange.hpp>
+#include <giskard_core/controller_scheduler.hpp>
+#include <giskard_core/event_trigger.hpp>
 #include <giskard_core/expression_generation.hpp>
+#include <giskard_core/expression_memo.hpp>
 #include <giskard_core/expression_extraction.hpp>
 #include <giskard_core/expressiontree.hpp>
+#include <giskard_core/hashing.hpp>
+#include <giskard_core/projection_cache.hpp>
 #include <giskard_core/qp_controller.hpp>
 #include <giskard_core/qp_controller_projection.hpp>
 #include <giskard_core/qp_problem_builder.hpp>
 #include <giskard_core/robot.hpp>
 #include <giskard_core/scope.hpp>
+#include <giskard_core/scope_snapshot.hpp>
+#include <giskard_core/spec_analysis.hpp>
+#include <giskard_core/spec_arena.hpp>
+#include <giskard_core/spec_binary.hpp>
+#include <giskard_core/spec_cost.hpp>
+#include <giskard_core/spec_interner.hpp>
+#include <giskard_core/spec_simplification.hpp>
+#include <giskard_core/spec_traversal.hpp>
 #include <giskard_core/specifications.hpp>
+#include <giskard_core/triple_buffer.hpp>
+#include <giskard_core/warm_start.hpp>
+#include <giskard_core/work_stealing_pool.hpp>
 #include <giskard_core/qp_controller_spec_generator.hpp>
 #include <giskard_core/yaml_parser.hpp>
 
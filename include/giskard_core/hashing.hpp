@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_CORE_HASHING_HPP
+#define GISKARD_CORE_HASHING_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace giskard_core
+{
+  // Hashes that end up in files or caches have to be stable across processes
+  // and platforms, so we do not rely on std::hash and use 64-bit FNV-1a.
+  typedef std::uint64_t HashValue;
+
+  inline HashValue hash_bytes(const void* data, size_t size, HashValue seed=14695981039346656037ULL)
+  {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    HashValue result = seed;
+    for (size_t i=0; i<size; ++i)
+    {
+      result ^= bytes[i];
+      result *= 1099511628211ULL;
+    }
+    return result;
+  }
+
+  inline HashValue hash_value(const std::string& value)
+  {
+    return hash_bytes(value.data(), value.size());
+  }
+
+  inline HashValue hash_value(std::uint64_t value)
+  {
+    unsigned char bytes[8];
+    for (size_t i=0; i<8; ++i)
+      bytes[i] = static_cast<unsigned char>(value >> (8*i));
+    return hash_bytes(bytes, 8);
+  }
+
+  inline HashValue hash_value(double value)
+  {
+    // make 0.0 and -0.0 hash the same
+    if (value == 0.0)
+      value = 0.0;
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return hash_value(bits);
+  }
+
+  inline void hash_combine(HashValue& seed, HashValue value)
+  {
+    seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+  }
+}
+
+#endif // GISKARD_CORE_HASHING_HPP
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_CORE_PROJECTION_CACHE_HPP
+#define GISKARD_CORE_PROJECTION_CACHE_HPP
+
+#include <giskard_core/hashing.hpp>
+#include <boost/shared_ptr.hpp>
+#include <Eigen/Core>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace giskard_core
+{
+  class ProjectionCacheEntry
+  {
+    public:
+      typedef std::vector<std::int64_t> Key;
+
+      ProjectionCacheEntry() :
+        seed_(0), termination_reason_(0), task_error_(0.0) {}
+
+      size_t num_bytes() const
+      {
+        return sizeof(ProjectionCacheEntry) + key_.size() * sizeof(std::int64_t) +
+          (position_trajectories_.size() + velocity_trajectories_.size() + time_trajectory_.size()) * sizeof(double);
+      }
+
+      // controller and params that produced the entry, and the quantized start
+      // observables; both are compared on lookup to rule out hash collisions
+      HashValue seed_;
+      Key key_;
+      Eigen::MatrixXd position_trajectories_, velocity_trajectories_;
+      Eigen::VectorXd time_trajectory_;
+      // QPControllerProjection::TerminationReason
+      int termination_reason_;
+      double task_error_;
+  };
+
+  typedef typename boost::shared_ptr<const ProjectionCacheEntry> ProjectionCacheEntryConstPtr;
+
+  /**
+   * Least-recently-used cache of projection results, bounded by the number of
+   * entries and by the memory held by the trajectories.
+   *
+   * The cache only stores and looks up entries. Computing the hash and the
+   * quantized key of a start state is up to QPControllerProjection. Entries
+   * are immutable once inserted, so one cache may be shared between several
+   * projections, also across threads.
+   */
+  class ProjectionCache
+  {
+    public:
+      ProjectionCache(size_t max_entries, size_t max_bytes) :
+        max_entries_(max_entries), max_bytes_(max_bytes), num_bytes_(0),
+        num_hits_(0), num_misses_(0), num_evictions_(0) {}
+
+      // Returns an empty pointer on a miss.
+      ProjectionCacheEntryConstPtr find(HashValue hash, HashValue seed, const ProjectionCacheEntry::Key& key)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Index::iterator it = index_.find(hash);
+        if (it == index_.end() || it->second->entry_->seed_ != seed || it->second->entry_->key_ != key)
+        {
+          ++num_misses_;
+          return ProjectionCacheEntryConstPtr();
+        }
+
+        ++num_hits_;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return it->second->entry_;
+      }
+
+      void insert(HashValue hash, const ProjectionCacheEntryConstPtr& entry)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Index::iterator it = index_.find(hash);
+        if (it != index_.end())
+          erase(it);
+
+        if (max_entries_ == 0 || entry->num_bytes() > max_bytes_)
+          return;
+
+        Item item;
+        item.hash_ = hash;
+        item.entry_ = entry;
+        entries_.push_front(item);
+        index_[hash] = entries_.begin();
+        num_bytes_ += entry->num_bytes();
+
+        while (entries_.size() > max_entries_ || num_bytes_ > max_bytes_)
+        {
+          erase(index_.find(entries_.back().hash_));
+          ++num_evictions_;
+        }
+      }
+
+      void clear()
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+        index_.clear();
+        num_bytes_ = 0;
+      }
+
+      void reset_statistics()
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        num_hits_ = 0;
+        num_misses_ = 0;
+        num_evictions_ = 0;
+      }
+
+      size_t size() const
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_.size();
+      }
+
+      size_t num_bytes() const
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return num_bytes_;
+      }
+
+      size_t num_hits() const
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return num_hits_;
+      }
+
+      size_t num_misses() const
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return num_misses_;
+      }
+
+      size_t num_evictions() const
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return num_evictions_;
+      }
+
+      double hit_rate() const
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t num_lookups = num_hits_ + num_misses_;
+        return num_lookups == 0 ? 0.0 : static_cast<double>(num_hits_) / num_lookups;
+      }
+
+      size_t max_entries() const
+      {
+        return max_entries_;
+      }
+
+      size_t max_bytes() const
+      {
+        return max_bytes_;
+      }
+
+    private:
+      struct Item
+      {
+        HashValue hash_;
+        ProjectionCacheEntryConstPtr entry_;
+      };
+      typedef std::list<Item> Entries;
+      typedef std::unordered_map<HashValue, Entries::iterator> Index;
+
+      size_t max_entries_, max_bytes_, num_bytes_;
+      size_t num_hits_, num_misses_, num_evictions_;
+      // most recently used entry first
+      Entries entries_;
+      Index index_;
+      mutable std::mutex mutex_;
+
+      void erase(Index::iterator it)
+      {
+        num_bytes_ -= it->second->entry_->num_bytes();
+        entries_.erase(it->second);
+        index_.erase(it);
+      }
+  };
+
+  typedef typename boost::shared_ptr<ProjectionCache> ProjectionCachePtr;
+}
+
+#endif // GISKARD_CORE_PROJECTION_CACHE_HPP
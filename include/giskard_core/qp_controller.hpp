@@ -23,8 +23,15 @@
 
 #include <giskard_core/qp_problem_builder.hpp>
 #include <giskard_core/scope.hpp>
+#include <giskard_core/scope_snapshot.hpp>
+#include <giskard_core/controller_exchange.hpp>
+#include <giskard_core/event_trigger.hpp>
+#include <giskard_core/hashing.hpp>
+#include <giskard_core/warm_start.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
 #include <qpOASES.hpp>
+#include <functional>
 
 namespace giskard_core
 {
@@ -33,6 +40,7 @@ namespace giskard_core
     public:
       typedef typename std::vector< KDL::Expression<double>::Ptr > DoubleExpressionVector;
       typedef typename std::vector< std::string> StringVector;
+      typedef std::function<QPController()> Generator;
       
       bool init(const DoubleExpressionVector& controllable_lower_bounds,
           const DoubleExpressionVector& controllable_upper_bounds, const DoubleExpressionVector& controllable_weights,
@@ -47,78 +55,108 @@ namespace giskard_core
             soft_upper_bounds, soft_weights, hard_expressions,
             hard_lower_bounds, hard_upper_bounds);
 
-        qp_problem_ = qpOASES::SQProblem(qp_builder_.num_weights(), qp_builder_.num_constraints());
-        qpOASES::Options options;
-        // NOTE: In the past, I was using setting "reliable", and found a curious
-        //       bug: One trying to solve an already solved problem, the solver
-        //       would never finish and run out of working set iterations. The
-        //       corresponding test-case is broken flying cup. Switching to
-        //       "default" solved this on qpOASES 3.1.
-        // NOTE: Even earlier, I was using setting "MPC" that left to weird behavior
-        //       for orientation control. It seemed as if the solver returned 
-        //       inaccurate solutions. We (Alexis and Georg) decided to swith
-        //       away from "MPC" to improve this behavior. That was also for
-        //       qpOASES 3.1. However, now I cannot reproduce that problem.
-        options.setToDefault();
-        options.printLevel = qpOASES::PL_NONE;
-        qp_problem_.setOptions(options);
-
-        xdot_full_.resize(qp_builder_.num_weights());
-
-        xdot_control_.resize(qp_builder_.num_controllables());
-
-        xdot_slack_.resize(qp_builder_.num_soft_constraints());
+        create_solver();
 
         if( controllable_names.size() != qp_builder_.num_controllables() )
-          throw std::runtime_error("Received " + boost::lexical_cast<std::string>(controllable_names_.size()) + 
+          throw std::runtime_error("Received " + boost::lexical_cast<std::string>(controllable_names.size()) + 
               " controllable names, but " + boost::lexical_cast<std::string>(qp_builder_.num_controllables()) + 
               " controllables were specified.");
-        controllable_names_ = controllable_names;
 
         if( soft_names.size() != qp_builder_.num_soft_constraints() )
           throw std::runtime_error("Received " + boost::lexical_cast<std::string>(soft_names.size()) + 
               " soft constraint names, but " + boost::lexical_cast<std::string>(qp_builder_.num_soft_constraints()) + 
               " soft constraints were specified.");
-        soft_constraint_names_ = soft_names;
+
+        boost::shared_ptr<Structure> structure(new Structure());
+        structure->controllable_names_ = controllable_names;
+        structure->soft_constraint_names_ = soft_names;
+        structure->structure_hash_ = calculate_structure_hash(*structure);
+        structure_ = structure;
+        scope_state_.reset();
+        observables_.resize(0);
 
         return true;
       }
 
       bool start(const Eigen::VectorXd& observables, int nWSR)
       {
-        qp_builder_.update(observables);
+        return init_solver(observables, nWSR, 0, 0, 0, 0);
+      }
 
-        qpOASES::returnValue return_value = qp_problem_.init(qp_builder_.get_H().data(), qp_builder_.get_g().data(), 
-            qp_builder_.get_A().data(), qp_builder_.get_lb().data(), qp_builder_.get_ub().data(),
-            qp_builder_.get_lbA().data(), qp_builder_.get_ubA().data(), nWSR);
+      /**
+       * Starts the controller with the working set of a previous run, e.g.
+       * from before a restart. Throws if the warm start was exported from a
+       * controller with a different structure or spec, or if qpOASES
+       * rejects its working set.
+       */
+      bool start(const Eigen::VectorXd& observables, int nWSR, const QPControllerWarmStart& warm_start)
+      {
+        if (!is_compatible(warm_start))
+          throw std::invalid_argument("Warm start does not match structure of QPController.");
 
-        if(return_value != qpOASES::SUCCESSFUL_RETURN)
-        {
-          std::cout << "Init of QP-Problem returned without success! ERROR MESSAGE: " << 
-            qpOASES::MessageHandling::getErrorCodeMessage(return_value) << std::endl;
-          std::cout << "Printing internals." << std::endl;
-          qp_builder_.print_internals();
-          std::cout << "nWSR: " << nWSR << std::endl;
-          qp_builder_.are_internals_valid();
-        }
-        
-        return return_value == qpOASES::SUCCESSFUL_RETURN;
+        qpOASES::Bounds bounds(qp_builder_.num_weights());
+        for (size_t i=0; i<warm_start.num_variables(); ++i)
+          if (!QPControllerWarmStart::is_valid_status(warm_start.bound_status_[i]) ||
+              bounds.setupBound(i, static_cast<qpOASES::SubjectToStatus>(warm_start.bound_status_[i])) !=
+                qpOASES::SUCCESSFUL_RETURN)
+            throw std::invalid_argument("Warm start has invalid status " +
+                std::to_string(warm_start.bound_status_[i]) + " for bound " + std::to_string(i) + ".");
+
+        qpOASES::Constraints constraints(qp_builder_.num_constraints());
+        for (size_t i=0; i<warm_start.num_constraints(); ++i)
+          if (!QPControllerWarmStart::is_valid_status(warm_start.constraint_status_[i]) ||
+              constraints.setupConstraint(i, static_cast<qpOASES::SubjectToStatus>(warm_start.constraint_status_[i])) !=
+                qpOASES::SUCCESSFUL_RETURN)
+            throw std::invalid_argument("Warm start has invalid status " +
+                std::to_string(warm_start.constraint_status_[i]) + " for constraint " + std::to_string(i) + ".");
+
+        return init_solver(observables, nWSR, warm_start.primal_solution_.data(),
+            warm_start.dual_solution_.data(), &bounds, &constraints);
       }
       
  
       bool update(const Eigen::VectorXd& observables, int nWSR)
       {
+       if (can_skip_update(observables))
+       {
+         hold_ticks_++;
+         num_skipped_updates_++;
+         return true;
+       }
+       hold_ticks_ = 0;
+
        qp_builder_.update(observables);
 
-       if( qp_problem_.hotstart(qp_builder_.get_H().data(), qp_builder_.get_g().data(), 
-           qp_builder_.get_A().data(), qp_builder_.get_lb().data(), qp_builder_.get_ub().data(),
-           qp_builder_.get_lbA().data(), qp_builder_.get_ubA().data(), nWSR)
-           != qpOASES::SUCCESSFUL_RETURN )
+       qpOASES::returnValue return_value = qp_problem_.hotstart(qp_builder_.get_H().data(),
+           qp_builder_.get_g().data(), qp_builder_.get_A().data(), qp_builder_.get_lb().data(),
+           qp_builder_.get_ub().data(), qp_builder_.get_lbA().data(), qp_builder_.get_ubA().data(), nWSR);
+       num_working_set_recalculations_ = nWSR;
+       if( return_value != qpOASES::SUCCESSFUL_RETURN )
           return false;
 
-        qp_problem_.getPrimalSolution(xdot_full_.data());
-        xdot_control_ = xdot_full_.segment(0, qp_builder_.num_controllables());
-        xdot_slack_ = xdot_full_.segment(qp_builder_.num_controllables(), qp_builder_.num_soft_constraints());
+        observables_ = observables;
+        feedback_stale_ = true;
+        copy_solution();
+
+        return true;
+      }
+
+      bool start(ObservablesExchange& observables, CommandExchange& commands, int nWSR)
+      {
+        if (!start(observables.fetch(), nWSR))
+          return false;
+
+        commands.publish(get_command(), get_slack());
+
+        return true;
+      }
+
+      bool update(ObservablesExchange& observables, CommandExchange& commands, int nWSR)
+      {
+        if (!update(observables.fetch(), nWSR))
+          return false;
+
+        commands.publish(get_command(), get_slack());
 
         return true;
       }
@@ -140,22 +178,234 @@ namespace giskard_core
 
       const std::vector<std::string>& get_controllable_names() const
       {
-        return controllable_names_;
+        return get_structure().controllable_names_;
       }
 
       const std::vector<std::string>& get_soft_constraint_names() const
       {
-        return soft_constraint_names_;
+        return get_structure().soft_constraint_names_;
       }
 
+      // Evaluates the feedback entries of the scope before handing it out.
       const giskard_core::Scope& get_scope() const
       {
-        return scope_;
+        evaluate_scope();
+        return get_scope_state().scope_;
       }
 
       void set_scope(const giskard_core::Scope& scope)
       {
-        scope_ = scope;
+        set_scope(scope, std::vector<giskard_core::Scope::Handle>());
+      }
+
+      /**
+       * Sets the scope, and marks the entries with the feedback handles as
+       * feedback, i.e. as not needed to build the QP. start() and update()
+       * do not touch those entries. They get evaluated on demand, with the
+       * observables of the last solve, whenever the scope is read through
+       * get_scope(), evaluate_scope(), or capture().
+       */
+      void set_scope(const giskard_core::Scope& scope, const std::vector<giskard_core::Scope::Handle>& feedback)
+      {
+        std::vector<KDL::ExpressionBase::Ptr> expressions;
+        for (auto const & handle: feedback)
+          expressions.push_back(scope.get(handle));
+        set_scope_state(scope, feedback, expressions);
+      }
+
+      const std::vector<giskard_core::Scope::Handle>& get_feedback_scope_handles() const
+      {
+        return get_scope_state().feedback_handles_;
+      }
+
+      // names of the feedback entries, in the order of their handles
+      std::vector<std::string> get_feedback_scope_names() const
+      {
+        std::vector<std::string> result;
+        for (auto const & handle: get_feedback_scope_handles())
+          result.push_back(get_scope_state().scope_.get_name(handle));
+        return result;
+      }
+
+      // Only needed if references to scope expressions are kept around.
+      void evaluate_scope() const
+      {
+        if (!feedback_stale_)
+          return;
+
+        if (static_cast<size_t>(observables_.rows()) < get_scope_state().num_feedback_inputs_)
+          throw std::length_error("Feedback of scope needs " +
+              std::to_string(get_scope_state().num_feedback_inputs_) + " observables, but the last solve got " +
+              std::to_string(observables_.rows()) + ".");
+
+        feedback_optimizer_.setInputValues(observables_);
+        feedback_stale_ = false;
+      }
+
+      void capture(ScopeSnapshot& snapshot) const
+      {
+        evaluate_scope();
+        snapshot.capture();
+      }
+
+      void capture(ConcurrentScopeSnapshot& snapshot) const
+      {
+        evaluate_scope();
+        snapshot.capture();
+      }
+
+      /**
+       * Returns a controller that can be updated independently of this one,
+       * also from another thread, e.g. to project what-if scenarios.
+       *
+       * The fork shares the names and hashes with this controller, and keeps
+       * its event trigger parameters. It needs expressions of its own,
+       * because the expression nodes cache their last evaluation. Controllers
+       * with a generator, i.e. all that generate() returns, regenerate them
+       * from their spec, which keeps shared and cached subexpressions. All
+       * others get clones of their expressions, and a solver and QP matrices
+       * of their own, which are allocated but not copied. All entries of
+       * such a cloned scope are evaluated on demand, see set_scope().
+       *
+       * The fork has to be started before it can be updated.
+       *
+       * NOTE: Cloning does not preserve subexpressions shared by several
+       *       constraints or scope entries, so a fork of a controller
+       *       without generator may evaluate them more than once per update.
+       */
+      QPController fork() const
+      {
+        if (get_structure().generator_)
+        {
+          QPController result = get_structure().generator_();
+          if (result.get_structure_hash() != get_structure_hash())
+            throw std::logic_error("Generator of QPController returned a controller with another structure.");
+          result.structure_ = structure_;
+          result.event_trigger_ = event_trigger_;
+          return result;
+        }
+
+        QPController result;
+        result.structure_ = structure_;
+        result.qp_builder_ = qp_builder_.clone();
+        result.create_solver();
+        result.event_trigger_ = event_trigger_;
+
+        giskard_core::Scope scope = get_scope_state().scope_.clone();
+        std::vector<KDL::ExpressionBase::Ptr> expressions = scope.get_expressions();
+        result.set_scope_state(scope, get_scope_state().feedback_handles_, expressions);
+
+        return result;
+      }
+
+      bool shares_structure_with(const QPController& other) const
+      {
+        return structure_ && (structure_ == other.structure_);
+      }
+
+      /**
+       * Hash over the names and the dimensions of the QP, identical for all
+       * controllers generated from the same specification.
+       */
+      HashValue get_structure_hash() const
+      {
+        return get_structure().structure_hash_;
+      }
+
+      /**
+       * Fingerprint of the spec this controller was generated from, or 0.
+       * Unlike the structure hash, it also covers gains, limits and the like.
+       */
+      HashValue get_spec_fingerprint() const
+      {
+        return get_structure().spec_fingerprint_;
+      }
+
+      void set_spec_fingerprint(HashValue fingerprint)
+      {
+        boost::shared_ptr<Structure> structure(new Structure(get_structure()));
+        structure->spec_fingerprint_ = fingerprint;
+        structure_ = structure;
+      }
+
+      // Lets fork() generate fresh expressions instead of cloning them. The
+      // generator has to return controllers with the same structure.
+      void set_generator(const Generator& generator)
+      {
+        boost::shared_ptr<Structure> structure(new Structure(get_structure()));
+        structure->generator_ = generator;
+        structure_ = structure;
+      }
+
+      // Warm starts have to come from controllers with the same structure and
+      // spec. Controllers set up through init() alone have fingerprint 0.
+      bool is_compatible(const QPControllerWarmStart& warm_start) const
+      {
+        return warm_start.structure_hash_ == get_structure_hash() &&
+          warm_start.spec_fingerprint_ == get_spec_fingerprint() &&
+          warm_start.num_variables() == qp_builder_.num_weights() &&
+          warm_start.num_constraints() == qp_builder_.num_constraints();
+      }
+
+      // only valid after the controller was started successfully
+      QPControllerWarmStart export_warm_start() const
+      {
+        if (observables_.rows() == 0)
+          throw std::runtime_error("Cannot export warm start of QPController that was not started.");
+
+        QPControllerWarmStart result;
+        result.structure_hash_ = get_structure_hash();
+        result.spec_fingerprint_ = get_spec_fingerprint();
+        result.observables_ = observables_;
+        result.primal_solution_ = xdot_full_;
+        result.dual_solution_.resize(qp_builder_.num_weights() + qp_builder_.num_constraints());
+        qp_problem_.getDualSolution(result.dual_solution_.data());
+
+        qpOASES::Bounds bounds;
+        qp_problem_.getBounds(bounds);
+        for (size_t i=0; i<qp_builder_.num_weights(); ++i)
+          result.bound_status_.push_back(bounds.getStatus(i));
+
+        qpOASES::Constraints constraints;
+        qp_problem_.getConstraints(constraints);
+        for (size_t i=0; i<qp_builder_.num_constraints(); ++i)
+          result.constraint_status_.push_back(constraints.getStatus(i));
+
+        return result;
+      }
+
+      // observables of the last successful start or update that solved the QP
+      const Eigen::VectorXd& get_observables() const
+      {
+        return observables_;
+      }
+
+      /**
+       * Activates the event-triggered mode: update() reuses the previous
+       * command while the observables barely change, see EventTriggerParams.
+       * Default-constructed parameters deactivate it again.
+       */
+      void set_event_trigger(const EventTriggerParams& params)
+      {
+        params.verify_sanity();
+        event_trigger_ = params;
+        hold_ticks_ = 0;
+      }
+
+      const EventTriggerParams& get_event_trigger() const
+      {
+        return event_trigger_;
+      }
+
+      size_t num_skipped_updates() const
+      {
+        return num_skipped_updates_;
+      }
+
+      // working set recalculations qpOASES needed in the last start or update
+      int num_working_set_recalculations() const
+      {
+        return num_working_set_recalculations_;
       }
 
       size_t num_controllables() const
@@ -176,9 +426,165 @@ namespace giskard_core
     private:
       giskard_core::QPProblemBuilder qp_builder_;
       qpOASES::SQProblem qp_problem_;
-      Eigen::VectorXd xdot_full_, xdot_control_, xdot_slack_;
-      std::vector<std::string> controllable_names_, soft_constraint_names_;
-      giskard_core::Scope scope_;
+      Eigen::VectorXd xdot_full_, xdot_control_, xdot_slack_, observables_;
+      EventTriggerParams event_trigger_;
+      size_t hold_ticks_ = 0, num_skipped_updates_ = 0;
+      int num_working_set_recalculations_ = 0;
+      // sets the inputs of the feedback scope entries, see set_scope()
+      mutable KDL::ExpressionOptimizer feedback_optimizer_;
+      mutable bool feedback_stale_ = false;
+
+      // everything that does not change after init(), shared between forks
+      struct Structure
+      {
+        std::vector<std::string> controllable_names_, soft_constraint_names_;
+        HashValue structure_hash_, spec_fingerprint_;
+        Generator generator_;
+
+        Structure() : structure_hash_(0), spec_fingerprint_(0) {}
+      };
+      typedef typename boost::shared_ptr<const Structure> StructurePtr;
+      StructurePtr structure_;
+
+      // the scope, and its entries that are evaluated on demand; shared by
+      // copies of a controller, but not by forks
+      struct ScopeState
+      {
+        giskard_core::Scope scope_;
+        std::vector<giskard_core::Scope::Handle> feedback_handles_;
+        std::vector<KDL::ExpressionBase::Ptr> feedback_expressions_;
+        size_t num_feedback_inputs_;
+
+        ScopeState() : num_feedback_inputs_(0) {}
+      };
+      typedef typename boost::shared_ptr<const ScopeState> ScopeStatePtr;
+      ScopeStatePtr scope_state_;
+
+      HashValue calculate_structure_hash(const Structure& structure) const
+      {
+        HashValue result = hash_value(std::string("QPController"));
+        for (size_t i=0; i<structure.controllable_names_.size(); ++i)
+          hash_combine(result, hash_value(structure.controllable_names_[i]));
+        for (size_t i=0; i<structure.soft_constraint_names_.size(); ++i)
+          hash_combine(result, hash_value(structure.soft_constraint_names_[i]));
+
+        hash_combine(result, hash_value(static_cast<std::uint64_t>(qp_builder_.num_controllables())));
+        hash_combine(result, hash_value(static_cast<std::uint64_t>(qp_builder_.num_soft_constraints())));
+        hash_combine(result, hash_value(static_cast<std::uint64_t>(qp_builder_.num_hard_constraints())));
+        hash_combine(result, hash_value(static_cast<std::uint64_t>(qp_builder_.num_observables())));
+
+        return result;
+      }
+
+      const Structure& get_structure() const
+      {
+        static const Structure empty_structure;
+        return structure_ ? *structure_ : empty_structure;
+      }
+
+      const ScopeState& get_scope_state() const
+      {
+        static const ScopeState empty_scope_state;
+        return scope_state_ ? *scope_state_ : empty_scope_state;
+      }
+
+      void set_scope_state(const giskard_core::Scope& scope, const std::vector<giskard_core::Scope::Handle>& feedback,
+          const std::vector<KDL::ExpressionBase::Ptr>& feedback_expressions)
+      {
+        boost::shared_ptr<ScopeState> state(new ScopeState());
+        state->scope_ = scope;
+        state->feedback_handles_ = feedback;
+        state->feedback_expressions_ = feedback_expressions;
+        for (auto const & expression: feedback_expressions)
+          state->num_feedback_inputs_ = std::max(state->num_feedback_inputs_,
+              static_cast<size_t>(expression->number_of_derivatives()));
+        scope_state_ = state;
+        prepare_feedback();
+      }
+
+      void create_solver()
+      {
+        qp_problem_ = qpOASES::SQProblem(qp_builder_.num_weights(), qp_builder_.num_constraints());
+        qpOASES::Options options;
+        // NOTE: In the past, I was using setting "reliable", and found a curious
+        //       bug: One trying to solve an already solved problem, the solver
+        //       would never finish and run out of working set iterations. The
+        //       corresponding test-case is broken flying cup. Switching to
+        //       "default" solved this on qpOASES 3.1.
+        // NOTE: Even earlier, I was using setting "MPC" that left to weird behavior
+        //       for orientation control. It seemed as if the solver returned 
+        //       inaccurate solutions. We (Alexis and Georg) decided to swith
+        //       away from "MPC" to improve this behavior. That was also for
+        //       qpOASES 3.1. However, now I cannot reproduce that problem.
+        options.setToDefault();
+        options.printLevel = qpOASES::PL_NONE;
+        qp_problem_.setOptions(options);
+
+        xdot_full_.resize(qp_builder_.num_weights());
+
+        xdot_control_.resize(qp_builder_.num_controllables());
+
+        xdot_slack_.resize(qp_builder_.num_soft_constraints());
+      }
+
+      bool init_solver(const Eigen::VectorXd& observables, int nWSR, const double* primal_guess,
+          const double* dual_guess, const qpOASES::Bounds* bounds_guess,
+          const qpOASES::Constraints* constraints_guess)
+      {
+        qp_builder_.update(observables);
+
+        qpOASES::returnValue return_value = qp_problem_.init(qp_builder_.get_H().data(), qp_builder_.get_g().data(), 
+            qp_builder_.get_A().data(), qp_builder_.get_lb().data(), qp_builder_.get_ub().data(),
+            qp_builder_.get_lbA().data(), qp_builder_.get_ubA().data(), nWSR, 0,
+            primal_guess, dual_guess, bounds_guess, constraints_guess);
+        num_working_set_recalculations_ = nWSR;
+
+        if(return_value != qpOASES::SUCCESSFUL_RETURN)
+        {
+          std::cout << "Init of QP-Problem returned without success! ERROR MESSAGE: " << 
+            qpOASES::MessageHandling::getErrorCodeMessage(return_value) << std::endl;
+          std::cout << "Printing internals." << std::endl;
+          qp_builder_.print_internals();
+          std::cout << "nWSR: " << nWSR << std::endl;
+          qp_builder_.are_internals_valid();
+          return false;
+        }
+
+        observables_ = observables;
+        feedback_stale_ = true;
+        hold_ticks_ = 0;
+        copy_solution();
+
+        return true;
+      }
+
+      void prepare_feedback()
+      {
+        std::vector<int> inputs;
+        for (size_t i=0; i<get_scope_state().num_feedback_inputs_; ++i)
+          inputs.push_back(i);
+
+        feedback_optimizer_ = KDL::ExpressionOptimizer();
+        feedback_optimizer_.prepare(inputs);
+        for (auto const & expression: get_scope_state().feedback_expressions_)
+          expression->addToOptimizer(feedback_optimizer_);
+        feedback_stale_ = !get_scope_state().feedback_expressions_.empty() && observables_.rows() > 0;
+      }
+
+      bool can_skip_update(const Eigen::VectorXd& observables) const
+      {
+        return event_trigger_.is_active() &&
+          (hold_ticks_ < event_trigger_.max_hold_ticks_) &&
+          (observables.rows() == observables_.rows()) &&
+          event_trigger_.is_below_threshold(observables, observables_);
+      }
+
+      void copy_solution()
+      {
+        qp_problem_.getPrimalSolution(xdot_full_.data());
+        xdot_control_ = xdot_full_.segment(0, qp_builder_.num_controllables());
+        xdot_slack_ = xdot_full_.segment(qp_builder_.num_controllables(), qp_builder_.num_soft_constraints());
+      }
   };
 
 }
@@ -20,21 +20,40 @@
 #ifndef GISKARD_CORE_QP_CONTROLLER_PROJECTION_HPP
 #define GISKARD_CORE_QP_CONTROLLER_PROJECTION_HPP
 
+#include <giskard_core/projection_cache.hpp>
 #include <giskard_core/qp_controller.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
 
 namespace giskard_core
 {
   class QPControllerProjectionParams
   {
     public:
+      enum Integrator { Euler, Heun, RK4 };
+
       QPControllerProjectionParams(double period, const std::vector<std::string>& observable_names,
           const std::map<std::string, double>& convergence_thresholds, size_t min_num_trajectory_points,
           size_t max_num_trajectory_points, int nWSR) :
         period_(period), observable_names_(observable_names), convergence_thresholds_(convergence_thresholds),
         min_num_trajectory_points_(min_num_trajectory_points), max_num_trajectory_points_(max_num_trajectory_points),
-        nWSR_(nWSR)
+        nWSR_(nWSR), integrator_(Euler), adaptive_(false), error_tolerance_(0.0), min_period_(period),
+        max_period_(period), stall_window_(0), stall_threshold_(0.0)
       {}
 
+      // Lets the projection choose its step size between min_period and
+      // max_period, such that the estimated local error of the controllable
+      // positions stays below error_tolerance. period_ is the initial step.
+      void set_adaptive(double error_tolerance, double min_period, double max_period)
+      {
+        adaptive_ = true;
+        error_tolerance_ = error_tolerance;
+        min_period_ = min_period;
+        max_period_ = max_period;
+      }
+
       void verify_sanity(const std::vector<std::string>& controllable_names) const
       {
         if (period_ <= 0)
@@ -43,6 +62,27 @@ namespace giskard_core
         if (nWSR_ <= 0)
           throw std::runtime_error("Request nWSR is not greater 0.");
 
+        if (adaptive_ && error_tolerance_ <= 0)
+          throw std::runtime_error("Requested error tolerance of adaptive projection is not greater 0.");
+
+        if (adaptive_ && (min_period_ <= 0 || min_period_ > period_ || period_ > max_period_))
+          throw std::runtime_error("Requested projection periods do not satisfy 0 < min_period <= period <= max_period.");
+
+        for (auto const & threshold: slack_thresholds_)
+          if (threshold.second < 0)
+            throw std::runtime_error("Requested slack threshold for '" + threshold.first + "' is negative.");
+
+        for (auto const & threshold: scope_thresholds_)
+          if (threshold.second < 0)
+            throw std::runtime_error("Requested scope threshold for '" + threshold.first + "' is negative.");
+
+        if (stall_threshold_ < 0)
+          throw std::runtime_error("Requested stall threshold is negative.");
+
+        for (auto const & resolution: cache_resolutions_)
+          if (resolution.second < 0)
+            throw std::runtime_error("Requested cache resolution for '" + resolution.first + "' is negative.");
+
         if (max_num_trajectory_points_ < min_num_trajectory_points_)
           throw std::runtime_error("Requested maximum length of trajectory is smaller than requested minimum length.");
 
@@ -65,31 +105,229 @@ namespace giskard_core
         return "default_joint_convergence_threshold"  ;
       }
 
+      static std::string default_cache_resolution_key()
+      {
+        return "default_cache_resolution";
+      }
+
       double period_;
       std::vector<std::string> observable_names_;
       std::map<std::string, double> convergence_thresholds_;
       size_t min_num_trajectory_points_, max_num_trajectory_points_;
       int nWSR_;
+      Integrator integrator_;
+      bool adaptive_;
+      double error_tolerance_, min_period_, max_period_;
+      // Task-space termination: the projection converged once the absolute
+      // slack of every listed soft constraint and the absolute value of every
+      // listed double scope expression is below its threshold.
+      std::map<std::string, double> slack_thresholds_, scope_thresholds_;
+      // Stall detection: the projection stops if the task error, i.e. the
+      // biggest monitored absolute value, decreased by less than
+      // stall_threshold_ over the last stall_window_ points. Without
+      // task-space thresholds, it stops if no controllable moved by more
+      // than stall_threshold_ over the window. A window of 0 disables it.
+      size_t stall_window_;
+      double stall_threshold_;
+      // Resolution of the start observables when looking up a ProjectionCache.
+      // Observables without resolution, and without default resolution, have
+      // to match exactly.
+      std::map<std::string, double> cache_resolutions_;
+  };
+
+  /**
+   * One trajectory point of a running projection, handed to the step callback
+   * of QPControllerProjection::run(). All getters are views on the internals
+   * of the projection, and are only valid during the callback.
+   *
+   * The observables are the simulated state at this point, starting with the
+   * positions. The velocities are those recorded in the trajectory, i.e. zero
+   * for the start point and the average velocity over the preceding step
+   * otherwise. The slacks and the scope belong to a solve of the controller
+   * at this point, also with integrators that solve at intermediate stages.
+   * That solve evaluates the scope entries the constraints depend on.
+   * get_scope() evaluates the feedback entries of the projected fork on
+   * demand, with the observables of the same solve, see
+   * QPController::set_scope() and QPController::fork(). Hence, all entries
+   * belong to this point, whether the constraints depend on them or not.
+   */
+  class QPControllerProjectionStep
+  {
+    public:
+      typedef Eigen::Block<const Eigen::MatrixXd, 1, Eigen::Dynamic> TrajectoryPoint;
+
+      QPControllerProjectionStep(size_t index, double time, const TrajectoryPoint& positions,
+          const TrajectoryPoint& velocities, const Eigen::VectorXd& observables, const QPController& controller) :
+        index_(index), time_(time), positions_(positions), velocities_(velocities), observables_(observables),
+        controller_(controller)
+      {}
+
+      size_t get_index() const
+      {
+        return index_;
+      }
+
+      double get_time() const
+      {
+        return time_;
+      }
+
+      const TrajectoryPoint& get_positions() const
+      {
+        return positions_;
+      }
+
+      const TrajectoryPoint& get_velocities() const
+      {
+        return velocities_;
+      }
+
+      const Eigen::VectorXd& get_slacks() const
+      {
+        return controller_.get_slack();
+      }
+
+      const Eigen::VectorXd& get_observables() const
+      {
+        return observables_;
+      }
+
+      const Scope& get_scope() const
+      {
+        return controller_.get_scope();
+      }
+
+      const QPController& get_controller() const
+      {
+        return controller_;
+      }
+
+    private:
+      size_t index_;
+      double time_;
+      TrajectoryPoint positions_, velocities_;
+      const Eigen::VectorXd& observables_;
+      const QPController& controller_;
   };
 
+  /**
+   * Simulates a QPController by integrating its commands.
+   *
+   * Trajectories are stored in two preallocated matrices with one row per
+   * trajectory point and one column per controllable, plus the time of every
+   * point. They are allocated once in the constructor and reused by every
+   * run(), and the getters return views on the rows filled by the last run.
+   *
+   * Every evaluation of the velocity field solves the QP once, i.e. Euler
+   * costs one solve per step, Heun two and RK4 four. In adaptive mode, Euler
+   * and Heun estimate their local error from the difference of the two Heun
+   * stages. RK4 estimates it by step doubling, and keeps the result of the two
+   * half steps. Rejected steps are retried with a smaller step size.
+   */
   class QPControllerProjection
   {
     public:
+      typedef Eigen::Block<const Eigen::MatrixXd> TrajectoryView;
+      enum TerminationReason { NotRun, JointsConverged, TaskConverged, Stalled, MaxLengthReached, Aborted };
+      // return false to stop the projection after this step
+      typedef std::function<bool(const QPControllerProjectionStep&)> StepCallback;
+
       QPControllerProjection(const QPController& controller, const QPControllerProjectionParams& params) :
-          controller_(controller), params_(params)
+          controller_(controller.fork()), params_(params), num_trajectory_points_(0), num_rejected_steps_(0),
+          k1_valid_(false), step_size_(params.period_), termination_reason_(NotRun), task_error_(0.0),
+          cache_seed_(0), cache_hash_(0), cache_hit_(false)
       {
         params_.verify_sanity(get_controllable_names());
+        // skipped updates would integrate stale commands
+        controller_.set_event_trigger(EventTriggerParams());
         init_convergence_thresholds(params.convergence_thresholds_);
+        init_task_criteria();
+        init_trajectories();
+        init_cache_key();
       }
 
+      // With a cache attached, a start state that quantizes to a cached one
+      // restores the cached trajectory instead of simulating. The controller
+      // is not started in that case. The first trajectory point is the given
+      // start, all later ones are those of the cached start, which may be off
+      // by up to the cache resolutions. See uses_cache().
       void run(const std::map<std::string, double>& start_observables)
       {
-        init_controller(start_observables);
+        init_state(start_observables);
+        if (restore_from_cache())
+          return;
 
-        while ((!max_trajectory_length_reached()) && (!controller_converged()))
+        start_controller();
+        while (!terminated())
           sim_controller_once();
 
-        verify_sane_trajectory();
+        store_in_cache();
+      }
+
+      // Calls the callback after the start and after every simulated step.
+      // Returns false if the callback stopped the projection. Bypasses the
+      // cache.
+      bool run(const std::map<std::string, double>& start_observables, const StepCallback& callback)
+      {
+        init_controller(start_observables);
+        if (num_trajectory_points() > 0 && !callback(get_last_step()))
+        {
+          termination_reason_ = Aborted;
+          return false;
+        }
+
+        while (!terminated())
+        {
+          sim_controller_once();
+          if (!callback(get_last_step()))
+          {
+            termination_reason_ = Aborted;
+            return false;
+          }
+        }
+
+        return true;
+      }
+
+      bool converged() const
+      {
+        return termination_reason_ == JointsConverged || termination_reason_ == TaskConverged;
+      }
+
+      TerminationReason get_termination_reason() const
+      {
+        return termination_reason_;
+      }
+
+      // task error of the last trajectory point, see stall detection
+      double get_task_error() const
+      {
+        return task_error_;
+      }
+
+      void set_cache(const ProjectionCachePtr& cache)
+      {
+        cache_ = cache;
+      }
+
+      const ProjectionCachePtr& get_cache() const
+      {
+        return cache_;
+      }
+
+      bool was_cache_hit() const
+      {
+        return cache_hit_;
+      }
+
+      /**
+       * Cache keys cover the expressions of the controller through its spec
+       * fingerprint. Projections of controllers without one, e.g. set up
+       * through QPController::init() alone, never read or write a cache.
+       */
+      bool uses_cache() const
+      {
+        return cache_ && controller_.get_spec_fingerprint() != 0;
       }
 
       const QPControllerProjectionParams& get_params() const
@@ -107,23 +345,58 @@ namespace giskard_core
         return params_.observable_names_;
       }
 
-      const std::vector< Eigen::VectorXd >& get_position_trajectories() const
+      size_t num_trajectory_points() const
+      {
+        return num_trajectory_points_;
+      }
+
+      TrajectoryView get_position_trajectories() const
+      {
+        return TrajectoryView(position_trajectories_, 0, 0, num_trajectory_points(), position_trajectories_.cols());
+      }
+
+      TrajectoryView get_velocity_trajectories() const
+      {
+        return TrajectoryView(velocity_trajectories_, 0, 0, num_trajectory_points(), velocity_trajectories_.cols());
+      }
+
+      Eigen::VectorBlock<const Eigen::VectorXd> get_time_trajectory() const
       {
-        return position_trajectories_;
+        return time_trajectory_.head(num_trajectory_points());
       }
 
-      const std::vector< Eigen::VectorXd >& get_velocity_trajectories() const
+      size_t num_rejected_steps() const
       {
-        return velocity_trajectories_;
+        return num_rejected_steps_;
       }
 
     protected:
       QPController controller_;
       QPControllerProjectionParams params_;
-      std::vector< Eigen::VectorXd > position_trajectories_;
-      std::vector< Eigen::VectorXd > velocity_trajectories_;
+      Eigen::MatrixXd position_trajectories_;
+      Eigen::MatrixXd velocity_trajectories_;
+      Eigen::VectorXd time_trajectory_;
+      size_t num_trajectory_points_, num_rejected_steps_;
       Eigen::VectorXd state_;
       Eigen::VectorXd convergence_thresholds_;
+      // integration buffers, k1_ holds the velocity at state_ if k1_valid_
+      Eigen::VectorXd eval_state_, positions_, next_positions_, midpoint_, half_positions_,
+          last_velocity_, k1_, k2_, k3_, k4_, k_mid_;
+      bool k1_valid_;
+      double step_size_;
+      // termination, task_values_ holds the monitored slacks followed by the
+      // monitored scope values
+      TerminationReason termination_reason_;
+      std::vector<size_t> slack_indices_;
+      KDL::DoubleExpressionArray scope_criteria_;
+      Eigen::VectorXd task_values_, task_thresholds_, error_history_;
+      double task_error_;
+      // caching, cache_seed_ hashes the controller structure and the params
+      ProjectionCachePtr cache_;
+      Eigen::VectorXd cache_resolutions_;
+      ProjectionCacheEntry::Key cache_key_;
+      HashValue cache_seed_, cache_hash_;
+      bool cache_hit_;
 
       void init_convergence_thresholds(const std::map<std::string, double>& thresholds)
       {
@@ -137,10 +410,117 @@ namespace giskard_core
             throw std::runtime_error("No '" + QPControllerProjectionParams::default_joint_convergence_threshold_key() + "' given.");
       }
 
+      void init_task_criteria()
+      {
+        const std::vector<std::string>& soft_names = controller_.get_soft_constraint_names();
+        std::vector<double> thresholds;
+        for (auto const & threshold: params_.slack_thresholds_)
+        {
+          std::vector<std::string>::const_iterator it =
+              std::find(soft_names.begin(), soft_names.end(), threshold.first);
+          if (it == soft_names.end())
+            throw std::runtime_error("Could not find soft constraint '" + threshold.first + "' for slack threshold.");
+
+          slack_indices_.push_back(it - soft_names.begin());
+          thresholds.push_back(threshold.second);
+        }
+
+        std::vector< KDL::Expression<double>::Ptr > expressions;
+        for (auto const & threshold: params_.scope_thresholds_)
+        {
+          if (!controller_.get_scope().has_double_expression(threshold.first))
+            throw std::runtime_error("Could not find double scope expression '" + threshold.first + "' for scope threshold.");
+
+          expressions.push_back(controller_.get_scope().find_double_expression(threshold.first));
+          thresholds.push_back(threshold.second);
+        }
+        scope_criteria_.set_expressions(expressions);
+
+        task_thresholds_ = Eigen::Map<Eigen::VectorXd>(thresholds.data(), thresholds.size());
+        task_values_.resize(thresholds.size());
+        error_history_.resize(params_.stall_window_ + 1);
+      }
+
+      bool has_task_criteria() const
+      {
+        return task_thresholds_.rows() > 0;
+      }
+
+      void init_trajectories()
+      {
+        size_t n = get_controllable_names().size();
+        position_trajectories_.resize(params_.max_num_trajectory_points_, n);
+        velocity_trajectories_.resize(params_.max_num_trajectory_points_, n);
+        time_trajectory_.resize(params_.max_num_trajectory_points_);
+        num_trajectory_points_ = 0;
+
+        Eigen::VectorXd* buffers[] = {&positions_, &next_positions_, &midpoint_, &half_positions_,
+            &last_velocity_, &k1_, &k2_, &k3_, &k4_, &k_mid_};
+        for (size_t i=0; i<sizeof(buffers)/sizeof(buffers[0]); ++i)
+          buffers[i]->resize(n);
+      }
+
+      void init_cache_key()
+      {
+        cache_resolutions_.resize(get_observable_names().size());
+        for (size_t i=0; i<get_observable_names().size(); ++i)
+          if (params_.cache_resolutions_.count(get_observable_names()[i]) != 0)
+            cache_resolutions_(i) = params_.cache_resolutions_.find(get_observable_names()[i])->second;
+          else if (params_.cache_resolutions_.count(QPControllerProjectionParams::default_cache_resolution_key()) != 0)
+            cache_resolutions_(i) = params_.cache_resolutions_.find(
+                QPControllerProjectionParams::default_cache_resolution_key())->second;
+          else
+            cache_resolutions_(i) = 0.0;
+        cache_key_.resize(get_observable_names().size());
+
+        // everything that changes the outcome of run(), except the start state;
+        // the fingerprint covers gains and goals that the structure hash misses
+        cache_seed_ = controller_.get_structure_hash();
+        hash_combine(cache_seed_, controller_.get_spec_fingerprint());
+        for (auto const & name: get_observable_names())
+          hash_combine(cache_seed_, hash_value(name));
+        // the same key stands for other start states at other resolutions
+        for (size_t i=0; i<cache_resolutions_.rows(); ++i)
+          hash_combine(cache_seed_, hash_value(cache_resolutions_(i)));
+        hash_combine(cache_seed_, hash_value(params_.period_));
+        hash_combine(cache_seed_, hash_value(static_cast<std::uint64_t>(params_.min_num_trajectory_points_)));
+        hash_combine(cache_seed_, hash_value(static_cast<std::uint64_t>(params_.max_num_trajectory_points_)));
+        hash_combine(cache_seed_, hash_value(static_cast<std::uint64_t>(params_.nWSR_)));
+        hash_combine(cache_seed_, hash_value(static_cast<std::uint64_t>(params_.integrator_)));
+        hash_combine(cache_seed_, hash_value(static_cast<std::uint64_t>(params_.adaptive_)));
+        hash_combine(cache_seed_, hash_value(params_.error_tolerance_));
+        hash_combine(cache_seed_, hash_value(params_.min_period_));
+        hash_combine(cache_seed_, hash_value(params_.max_period_));
+        for (size_t i=0; i<convergence_thresholds_.rows(); ++i)
+          hash_combine(cache_seed_, hash_value(convergence_thresholds_(i)));
+        for (auto const & threshold: params_.slack_thresholds_)
+        {
+          hash_combine(cache_seed_, hash_value(threshold.first));
+          hash_combine(cache_seed_, hash_value(threshold.second));
+        }
+        for (auto const & threshold: params_.scope_thresholds_)
+        {
+          hash_combine(cache_seed_, hash_value(threshold.first));
+          hash_combine(cache_seed_, hash_value(threshold.second));
+        }
+        hash_combine(cache_seed_, hash_value(static_cast<std::uint64_t>(params_.stall_window_)));
+        hash_combine(cache_seed_, hash_value(params_.stall_threshold_));
+      }
+
       void init_controller(const std::map<std::string, double>& start_observables)
       {
-        position_trajectories_.clear();
-        velocity_trajectories_.clear();
+        init_state(start_observables);
+        start_controller();
+      }
+
+      void init_state(const std::map<std::string, double>& start_observables)
+      {
+        num_trajectory_points_ = 0;
+        num_rejected_steps_ = 0;
+        step_size_ = params_.period_;
+        termination_reason_ = NotRun;
+        task_error_ = 0.0;
+        cache_hit_ = false;
 
         state_.resize(get_observable_names().size());
         for (size_t i=0; i<get_observable_names().size(); ++i)
@@ -148,59 +528,314 @@ namespace giskard_core
             throw std::runtime_error("Could not find value for observable '" + get_observable_names()[i] + "'.");
           else
             state_(i) = start_observables.find(get_observable_names()[i])->second;
+      }
 
+      void start_controller()
+      {
         if (!controller_.start(state_, params_.nWSR_))
           throw std::runtime_error("Could not start QPController.");
 
-        position_trajectories_.push_back(state_.segment(0, get_controllable_names().size()));
-        velocity_trajectories_.push_back(Eigen::VectorXd::Zero(get_controllable_names().size()));
+        eval_state_ = state_;
+        k1_ = controller_.get_command();
+        k1_valid_ = true;
+        last_velocity_ = k1_;
+
+        if (params_.max_num_trajectory_points_ > 0)
+        {
+          position_trajectories_.row(0) = state_.segment(0, get_controllable_names().size()).transpose();
+          velocity_trajectories_.row(0).setZero();
+          time_trajectory_(0) = 0.0;
+          num_trajectory_points_ = 1;
+        }
+      }
+
+      void update_cache_key()
+      {
+        cache_hash_ = cache_seed_;
+        for (size_t i=0; i<state_.rows(); ++i)
+        {
+          if (cache_resolutions_(i) > 0.0)
+            cache_key_[i] = std::llround(state_(i) / cache_resolutions_(i));
+          else
+          {
+            // exact match, 0.0 and -0.0 are the same start state
+            double value = state_(i) == 0.0 ? 0.0 : state_(i);
+            std::memcpy(&(cache_key_[i]), &value, sizeof(value));
+          }
+          hash_combine(cache_hash_, hash_value(static_cast<std::uint64_t>(cache_key_[i])));
+        }
       }
 
-      bool controller_converged() const
+      bool restore_from_cache()
       {
-        return min_trajectory_length_reached() && all_controllables_converged();
+        if (!uses_cache())
+          return false;
+
+        update_cache_key();
+        ProjectionCacheEntryConstPtr entry = cache_->find(cache_hash_, cache_seed_, cache_key_);
+        if (!entry || entry->position_trajectories_.rows() > position_trajectories_.rows() ||
+            entry->position_trajectories_.cols() != position_trajectories_.cols())
+          return false;
+
+        num_trajectory_points_ = entry->position_trajectories_.rows();
+        position_trajectories_.topRows(num_trajectory_points_) = entry->position_trajectories_;
+        velocity_trajectories_.topRows(num_trajectory_points_) = entry->velocity_trajectories_;
+        time_trajectory_.head(num_trajectory_points_) = entry->time_trajectory_;
+        if (num_trajectory_points_ > 0)
+          position_trajectories_.row(0) = state_.segment(0, get_controllable_names().size()).transpose();
+        termination_reason_ = static_cast<TerminationReason>(entry->termination_reason_);
+        task_error_ = entry->task_error_;
+        cache_hit_ = true;
+        return true;
+      }
+
+      void store_in_cache() const
+      {
+        if (!uses_cache())
+          return;
+
+        boost::shared_ptr<ProjectionCacheEntry> entry(new ProjectionCacheEntry());
+        entry->seed_ = cache_seed_;
+        entry->key_ = cache_key_;
+        entry->position_trajectories_ = get_position_trajectories();
+        entry->velocity_trajectories_ = get_velocity_trajectories();
+        entry->time_trajectory_ = get_time_trajectory();
+        entry->termination_reason_ = termination_reason_;
+        entry->task_error_ = task_error_;
+        cache_->insert(cache_hash_, entry);
+      }
+
+      // Checks the termination criteria for the last trajectory point, and
+      // records the reason if one of them is met.
+      bool terminated()
+      {
+        update_task_error();
+
+        if (!min_trajectory_length_reached())
+          return false;
+
+        if (all_controllables_converged())
+          termination_reason_ = JointsConverged;
+        else if (has_task_criteria() && task_converged())
+          termination_reason_ = TaskConverged;
+        else if (stalled())
+          termination_reason_ = Stalled;
+        else if (max_trajectory_length_reached())
+          termination_reason_ = MaxLengthReached;
+        else
+          return false;
+
+        return true;
+      }
+
+      void update_task_error()
+      {
+        if (!has_task_criteria())
+          return;
+
+        for (size_t i=0; i<slack_indices_.size(); ++i)
+          task_values_(i) = controller_.get_slack()(slack_indices_[i]);
+
+        if (scope_criteria_.num_expressions() > 0)
+        {
+          scope_criteria_.update(state_.segment(0, scope_criteria_.num_inputs()));
+          task_values_.tail(scope_criteria_.num_expressions()) = scope_criteria_.get_values();
+        }
+
+        task_error_ = task_values_.cwiseAbs().maxCoeff();
+        if (params_.stall_window_ > 0 && num_trajectory_points() > 0)
+          error_history_((num_trajectory_points() - 1) % error_history_.rows()) = task_error_;
+      }
+
+      bool task_converged() const
+      {
+        return (task_values_.array().abs() <= task_thresholds_.array()).all();
+      }
+
+      // Compares the current point with the one stall_window_ points ago. Its
+      // task error is the next entry the ring buffer will overwrite.
+      bool stalled() const
+      {
+        if (params_.stall_window_ == 0 || num_trajectory_points() <= params_.stall_window_)
+          return false;
+
+        if (has_task_criteria())
+        {
+          double old_error = error_history_(num_trajectory_points() % error_history_.rows());
+          return old_error - task_error_ < params_.stall_threshold_;
+        }
+
+        size_t last = num_trajectory_points() - 1;
+        return (position_trajectories_.row(last) - position_trajectories_.row(last - params_.stall_window_)).
+            cwiseAbs().maxCoeff() < params_.stall_threshold_;
       }
 
       bool max_trajectory_length_reached() const
       {
-        return get_position_trajectories().size() >= get_params().max_num_trajectory_points_;
+        return num_trajectory_points() >= get_params().max_num_trajectory_points_;
       }
 
       bool min_trajectory_length_reached() const
       {
-        return get_position_trajectories().size() >= get_params().min_num_trajectory_points_;
+        return num_trajectory_points() >= get_params().min_num_trajectory_points_;
       }
 
       bool all_controllables_converged() const
       {
-        using namespace Eigen;
-//        VectorXd abs_delta = controller_.get_command().cwiseAbs() - get_thresholds().cwiseAbs();
-        return ((controller_.get_command().array().abs() - get_thresholds().array().abs()) < 0).all();
+        return ((last_velocity_.array().abs() - get_thresholds().array().abs()) < 0).all();
       }
 
       void sim_controller_once()
       {
-        if (!controller_.update(state_, params_.nWSR_))
-          throw("Could not update QPController.");
+        size_t n = get_controllable_names().size();
+        positions_ = state_.segment(0, n);
+
+        double step_size = step_size_;
+        while (true)
+        {
+          double error = integrate(step_size);
+          if (!params_.adaptive_)
+            break;
+
+          double factor = step_size_factor(error);
+          if (error <= params_.error_tolerance_ || step_size <= params_.min_period_)
+          {
+            step_size_ = std::min(params_.max_period_, std::max(params_.min_period_, factor * step_size));
+            break;
+          }
+
+          ++num_rejected_steps_;
+          step_size = std::max(params_.min_period_, factor * step_size);
+        }
 
         using Eigen::operator*;
-        state_.segment(0, get_controllable_names().size()) += params_.period_ * controller_.get_command();
-        position_trajectories_.push_back(state_.segment(0, get_controllable_names().size()));
-        velocity_trajectories_.push_back(controller_.get_command());
+        last_velocity_ = (next_positions_ - positions_) / step_size;
+        state_.segment(0, n) = next_positions_;
+        position_trajectories_.row(num_trajectory_points_) = next_positions_.transpose();
+        velocity_trajectories_.row(num_trajectory_points_) = last_velocity_.transpose();
+        time_trajectory_(num_trajectory_points_) = time_trajectory_(num_trajectory_points_ - 1) + step_size;
+        ++num_trajectory_points_;
+
+        // Solves at the accepted point, unless the last stage already did, so
+        // that the slacks belong to it. The next step starts with that command.
+        positions_ = next_positions_;
+        velocity_at_state();
       }
 
-      void verify_sane_trajectory() const
+      // Integrates the controllables from positions_ over step_size into
+      // next_positions_. Returns the estimated local error in adaptive mode,
+      // and 0 otherwise.
+      double integrate(double step_size)
       {
-        if (get_position_trajectories().size() != get_velocity_trajectories().size())
-          throw std::runtime_error("Number of trajectory points in position and velocity trajectories do not match.");
+        using Eigen::operator*;
+        double h = step_size;
+        const Eigen::VectorXd& k1 = velocity_at_state();
+
+        switch (params_.integrator_)
+        {
+          case QPControllerProjectionParams::Euler:
+          {
+            next_positions_ = positions_ + h * k1;
+            if (!params_.adaptive_)
+            {
+              k1_valid_ = false;
+              return 0.0;
+            }
+
+            // k2_ is the velocity at next_positions_, i.e. the next k1_
+            evaluate(next_positions_, k2_);
+            double error = 0.5 * h * (k2_ - k1).cwiseAbs().maxCoeff();
+            if (error <= params_.error_tolerance_ || h <= params_.min_period_)
+              k1_.swap(k2_);
+            return error;
+          }
+          case QPControllerProjectionParams::Heun:
+          {
+            evaluate(positions_ + h * k1, k2_);
+            next_positions_ = positions_ + 0.5 * h * (k1 + k2_);
+            if (!params_.adaptive_)
+            {
+              k1_valid_ = false;
+              return 0.0;
+            }
+
+            double error = 0.5 * h * (k2_ - k1).cwiseAbs().maxCoeff();
+            if (error <= params_.error_tolerance_ || h <= params_.min_period_)
+              k1_valid_ = false;
+            return error;
+          }
+          case QPControllerProjectionParams::RK4:
+          {
+            rk4_step(positions_, k1, h, next_positions_);
+            if (!params_.adaptive_)
+            {
+              k1_valid_ = false;
+              return 0.0;
+            }
+
+            rk4_step(positions_, k1, 0.5 * h, midpoint_);
+            evaluate(midpoint_, k_mid_);
+            rk4_step(midpoint_, k_mid_, 0.5 * h, half_positions_);
+            double error = (half_positions_ - next_positions_).cwiseAbs().maxCoeff() / 15.0;
+            if (error <= params_.error_tolerance_ || h <= params_.min_period_)
+            {
+              next_positions_.swap(half_positions_);
+              k1_valid_ = false;
+            }
+            return error;
+          }
+          default:
+            throw std::domain_error("Projection: found non-supported integrator.");
+        }
+      }
 
-        for (const auto & position_point: get_position_trajectories())
-          if (position_point.size() != get_controllable_names().size())
-            throw std::runtime_error("Number of position values in one trajectory point does not match number of controllables.");
+      void rk4_step(const Eigen::VectorXd& positions, const Eigen::VectorXd& k1, double h, Eigen::VectorXd& result)
+      {
+        using Eigen::operator*;
+        evaluate(positions + 0.5 * h * k1, k2_);
+        evaluate(positions + 0.5 * h * k2_, k3_);
+        evaluate(positions + h * k3_, k4_);
+        result = positions + (h / 6.0) * (k1 + 2.0 * k2_ + 2.0 * k3_ + k4_);
+      }
 
-        for (const auto & velocity_point: get_velocity_trajectories())
-          if (velocity_point.size() != get_controllable_names().size())
-            throw std::runtime_error("Number of velocity values in one trajectory point does not match number of controllables.");
+      // Solves the QP with the controllables set to positions, and all other
+      // observables as in state_.
+      template<typename Derived>
+      void evaluate(const Eigen::MatrixBase<Derived>& positions, Eigen::VectorXd& velocity)
+      {
+        eval_state_.segment(0, get_controllable_names().size()) = positions;
+        if (!controller_.update(eval_state_, params_.nWSR_))
+          throw std::runtime_error("Could not update QPController.");
+        velocity = controller_.get_command();
+      }
+
+      const Eigen::VectorXd& velocity_at_state()
+      {
+        if (!k1_valid_)
+        {
+          evaluate(positions_, k1_);
+          k1_valid_ = true;
+        }
+
+        return k1_;
+      }
+
+      // Standard step size control with safety factor 0.9, bounded to shrink
+      // at most by 5 and to grow at most by 5.
+      double step_size_factor(double error) const
+      {
+        double order = params_.integrator_ == QPControllerProjectionParams::RK4 ? 5.0 : 2.0;
+        if (error <= 0.0)
+          return 5.0;
+
+        return std::min(5.0, std::max(0.2, 0.9 * std::pow(params_.error_tolerance_ / error, 1.0 / order)));
+      }
+
+      QPControllerProjectionStep get_last_step() const
+      {
+        size_t index = num_trajectory_points() - 1;
+        return QPControllerProjectionStep(index, time_trajectory_(index),
+            position_trajectories_.row(index), velocity_trajectories_.row(index), state_, controller_);
       }
 
       const Eigen::VectorXd& get_thresholds() const
@@ -392,7 +392,8 @@ namespace giskard_core
 
             DoubleSpecPtr p_gain = double_const_spec(params.p_gain);
             DoubleSpecPtr max_speed = double_const_spec(params.max_speed);
-            RotationSpecPtr delta_rot = rotation_multiplication_spec({inverse_rotation_spec(state), goal});
+            RotationSpecPtr inverse_state = inverse_rotation_spec(state);
+            RotationSpecPtr delta_rot = rotation_multiplication_spec({inverse_state, goal});
             DoubleSpecPtr rot_error = vector_norm(rot_vector(delta_rot));
             DoubleSpecPtr control = double_mul_spec({p_gain, rot_error});
 
@@ -402,8 +403,7 @@ namespace giskard_core
                           double_div({max_speed, control}));
             RotationSpecPtr intermediate_goal = slerp_spec(state, goal, interpolation_value);
 
-            return rotate_vector(state, rot_vector(rotation_multiplication_spec({inverse_rotation_spec(state),
-                                                                                 intermediate_goal})));
+            return rotate_vector(state, rot_vector(rotation_multiplication_spec({inverse_state, intermediate_goal})));
         }
 
         DoubleSpecPtr joint_control_spec(const DoubleSpecPtr& goal, const DoubleSpecPtr& state, const ControlParams& params,
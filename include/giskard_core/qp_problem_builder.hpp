@@ -47,6 +47,30 @@ namespace giskard_core
         create_output_matrices();
       }
 
+      /**
+       * Returns a builder with clones of all expressions, and with output
+       * matrices of its own that are allocated but not copied.
+       */
+      QPProblemBuilder clone() const
+      {
+        QPProblemBuilder result;
+        result.controllable_lower_bounds_ = controllable_lower_bounds_.clone();
+        result.controllable_upper_bounds_ = controllable_upper_bounds_.clone();
+        result.controllable_weights_ = controllable_weights_.clone();
+
+        result.soft_expressions_ = soft_expressions_.clone();
+        result.soft_lower_bounds_ = soft_lower_bounds_.clone();
+        result.soft_upper_bounds_ = soft_upper_bounds_.clone();
+        result.soft_weights_ = soft_weights_.clone();
+
+        result.hard_expressions_ = hard_expressions_.clone();
+        result.hard_lower_bounds_ = hard_lower_bounds_.clone();
+        result.hard_upper_bounds_ = hard_upper_bounds_.clone();
+
+        result.create_output_matrices();
+        return result;
+      }
+
       void update(const Vector& observables)
       {
         update_expressions(observables);
@@ -187,12 +211,9 @@ namespace giskard_core
 
       size_t num_observables() const
       {
-        // FIXME: calculate this based on the contents of the scope!
-        //        For certain cases this is too conservative, i.e.
-        //        some inputs are defined but only used to calculate
-        //        expressions in the scope which are reported as feedback.
-        //        Strictly speaking, that is not an input to the controller.
-        //        Still, I had intermediate use-cases for this.
+        // NOTE: Only counts the inputs of the constraints. Inputs that are
+        //       only used by feedback entries of the scope are not part of
+        //       the QP; QPController evaluates those entries on demand.
         size_t result = 0;
         result = std::max(controllable_lower_bounds_.num_inputs(), result);
         result = std::max(controllable_upper_bounds_.num_inputs(), result);
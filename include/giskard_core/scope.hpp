@@ -22,178 +22,356 @@
 #define GISKARD_CORE_SCOPE_HPP
 
 #include <string>
-#include <map>
+#include <algorithm>
+#include <array>
+#include <limits>
 #include <stdexcept>
+#include <unordered_map>
+#include <vector>
 #include <giskard_core/expressiontree.hpp>
 
 namespace giskard_core
 {
+  /**
+   * Named expressions of a controller.
+   *
+   * Every name is interned once, when its first expression is added. The
+   * expressions themselves live in one dense vector per type, and a Handle
+   * is the type plus the index into that vector. Resolve names once with
+   * resolve() and use the get_*() functions on the handles in hot loops;
+   * the find_*() functions resolve the name on every call.
+   *
+   * The same name may refer to expressions of different types.
+   */
   class Scope
   {
     public:
-      const KDL::Expression<double>::Ptr& find_double_expression(const std::string& reference_name) const
-      {
-        if(!has_double_expression(reference_name))
-          throw std::invalid_argument("Could not find double expression with name: "+ reference_name);
+      enum ExpressionType { DoubleType = 0, VectorType = 1, RotationType = 2, FrameType = 3 };
 
-        std::map< std::string, KDL::Expression<double>::Ptr >::const_iterator it =
-            double_references_.find(reference_name);
+      class Handle
+      {
+        public:
+          Handle() :
+            type_(DoubleType), index_(invalid_index()) {}
+
+          Handle(ExpressionType type, size_t index) :
+            type_(type), index_(index) {}
+
+          ExpressionType get_type() const
+          {
+            return type_;
+          }
+
+          size_t get_index() const
+          {
+            return index_;
+          }
+
+          bool is_valid() const
+          {
+            return index_ != invalid_index();
+          }
+
+          bool operator==(const Handle& other) const
+          {
+            return type_ == other.type_ && index_ == other.index_;
+          }
+
+          bool operator!=(const Handle& other) const
+          {
+            return !(*this == other);
+          }
+
+          static size_t invalid_index()
+          {
+            return std::numeric_limits<size_t>::max();
+          }
+
+        private:
+          ExpressionType type_;
+          size_t index_;
+      };
+
+      // Resolves to the first type with an expression of that name, in the
+      // order double, vector, rotation, frame.
+      Handle resolve(const std::string& reference_name) const
+      {
+        NameIndex::const_iterator it = names_.find(reference_name);
+        if (it != names_.end())
+          for (size_t i=0; i<it->second.size(); ++i)
+            if (it->second[i] != Handle::invalid_index())
+              return Handle(static_cast<ExpressionType>(i), it->second[i]);
 
-        return it->second;
+        throw std::invalid_argument("Could not find expression with name: "+ reference_name);
       }
 
-      const KDL::Expression<KDL::Vector>::Ptr& find_vector_expression(const std::string& reference_name) const
+      Handle resolve(const std::string& reference_name, ExpressionType type) const
       {
-        if(!has_vector_expression(reference_name))
-          throw std::invalid_argument("Could not find vector expression with name: "+ reference_name);
+        Handle handle = find_handle(reference_name, type);
+        if (!handle.is_valid())
+          throw std::invalid_argument("Could not find " + type_name(type) + " expression with name: "+ reference_name);
 
-        std::map< std::string, KDL::Expression<KDL::Vector>::Ptr >::const_iterator it =
-            vector_references_.find(reference_name);
+        return handle;
+      }
 
-        return it->second;
+      const KDL::Expression<double>::Ptr& get_double(const Handle& handle) const
+      {
+        return get(handle, DoubleType, double_expressions_);
       }
 
-      const KDL::Expression<KDL::Rotation>::Ptr& find_rotation_expression(const std::string& reference_name) const
+      const KDL::Expression<KDL::Vector>::Ptr& get_vector(const Handle& handle) const
       {
-        if(!has_rotation_expression(reference_name))
-          throw std::invalid_argument("Could not find rotation expression with name: "+ reference_name);
+        return get(handle, VectorType, vector_expressions_);
+      }
 
+      const KDL::Expression<KDL::Rotation>::Ptr& get_rotation(const Handle& handle) const
+      {
+        return get(handle, RotationType, rotation_expressions_);
+      }
 
-        std::map< std::string, KDL::Expression<KDL::Rotation>::Ptr >::const_iterator it =
-            rotation_references_.find(reference_name);
+      const KDL::Expression<KDL::Frame>::Ptr& get_frame(const Handle& handle) const
+      {
+        return get(handle, FrameType, frame_expressions_);
+      }
 
-        return it->second;
+      KDL::ExpressionBase::Ptr get(const Handle& handle) const
+      {
+        switch (handle.get_type())
+        {
+          case DoubleType:
+            return get_double(handle);
+          case VectorType:
+            return get_vector(handle);
+          case RotationType:
+            return get_rotation(handle);
+          case FrameType:
+            return get_frame(handle);
+          default:
+            throw std::runtime_error("Could not infer type of expression handle.");
+        }
       }
 
-      const KDL::Expression<KDL::Frame>::Ptr& find_frame_expression(const std::string& reference_name) const
+      const KDL::Expression<double>::Ptr& find_double_expression(const std::string& reference_name) const
       {
-        if(!has_frame_expression(reference_name))
-          throw std::invalid_argument("Could not find frame expression with name: "+ reference_name);
+        return get_double(resolve(reference_name, DoubleType));
+      }
 
-        std::map< std::string, KDL::Expression<KDL::Frame>::Ptr >::const_iterator it =
-            frame_references_.find(reference_name);
+      const KDL::Expression<KDL::Vector>::Ptr& find_vector_expression(const std::string& reference_name) const
+      {
+        return get_vector(resolve(reference_name, VectorType));
+      }
 
-        return it->second;
+      const KDL::Expression<KDL::Rotation>::Ptr& find_rotation_expression(const std::string& reference_name) const
+      {
+        return get_rotation(resolve(reference_name, RotationType));
       }
 
-      const KDL::ExpressionBase::Ptr find_expression(const std::string& reference_name) const
+      const KDL::Expression<KDL::Frame>::Ptr& find_frame_expression(const std::string& reference_name) const
       {
-        if(!has_expression(reference_name))
-          throw std::invalid_argument("Could not find expression with name: "+ reference_name);
+        return get_frame(resolve(reference_name, FrameType));
+      }
 
-        if (has_double_expression(reference_name))
-          return find_double_expression(reference_name);
-        else if (has_vector_expression(reference_name))
-          return find_vector_expression(reference_name);
-        else if (has_rotation_expression(reference_name))
-          return find_rotation_expression(reference_name);
-        else if (has_frame_expression(reference_name))
-          return find_frame_expression(reference_name);
-        else 
-          throw std::runtime_error("Could not infer type of expression with name '" + reference_name + "'.");
+      const KDL::ExpressionBase::Ptr find_expression(const std::string& reference_name) const
+      {
+        return get(resolve(reference_name));
       }
 
       bool has_double_expression(const std::string& expression_name) const
       {
-        return (double_references_.count(expression_name) == 1);
+        return find_handle(expression_name, DoubleType).is_valid();
       }
 
       bool has_vector_expression(const std::string& expression_name) const
       {
-        return (vector_references_.count(expression_name) == 1);
+        return find_handle(expression_name, VectorType).is_valid();
       }
 
       bool has_rotation_expression(const std::string& expression_name) const
       {
-        return (rotation_references_.count(expression_name) == 1);
+        return find_handle(expression_name, RotationType).is_valid();
       }
 
       bool has_frame_expression(const std::string& expression_name) const
       {
-        return (frame_references_.count(expression_name) == 1);
+        return find_handle(expression_name, FrameType).is_valid();
       }
 
       bool has_expression (const std::string& expression_name) const
       {
-        return has_double_expression(expression_name) ||
-          has_vector_expression(expression_name) || 
-          has_rotation_expression(expression_name) ||
-          has_frame_expression(expression_name);
+        return names_.count(expression_name) != 0;
       }
 
       void add_double_expression(const std::string& reference_name, const KDL::Expression<double>::Ptr& expression)
       {
-        if(has_double_expression(reference_name))
-          throw std::invalid_argument("Could not add double expression to scope because name already taken: "
-              + reference_name);
-
-        double_references_[reference_name] = expression;
+        add(reference_name, expression, DoubleType, double_expressions_, double_names_);
       }
 
       void add_vector_expression(const std::string& reference_name, const KDL::Expression<KDL::Vector>::Ptr& expression)
       {
-        if(has_vector_expression(reference_name))
-          throw std::invalid_argument("Could not add vector expression to scope because name already taken: "
-              + reference_name);
-
-        vector_references_[reference_name] = expression;
+        add(reference_name, expression, VectorType, vector_expressions_, vector_names_);
       }
 
       void add_rotation_expression(const std::string& reference_name, const KDL::Expression<KDL::Rotation>::Ptr& expression)
       {
-        if(has_rotation_expression(reference_name))
-          throw std::invalid_argument("Could not add rotation expression to scope because name already taken: "
-              + reference_name);
-
-        rotation_references_[reference_name] = expression;
+        add(reference_name, expression, RotationType, rotation_expressions_, rotation_names_);
       }
 
       void add_frame_expression(const std::string& reference_name, const KDL::Expression<KDL::Frame>::Ptr& expression)
       {
-        if(has_frame_expression(reference_name))
-          throw std::invalid_argument("Could not add frame expression to scope because name already taken: "
-              + reference_name);
-
-        frame_references_[reference_name] = expression;
+        add(reference_name, expression, FrameType, frame_expressions_, frame_names_);
       }
 
+      // names are returned in lexicographical order
       std::vector<std::string> get_double_names() const
       {
-        std::vector<std::string> result;
-        for (auto it=double_references_.begin(); it!=double_references_.end(); it++)
-          result.push_back(it->first);
-        return result;
+        return sorted(double_names_);
       }
 
       std::vector<std::string> get_vector_names() const
       {
-        std::vector<std::string> result;
-        for (auto it=vector_references_.begin(); it!=vector_references_.end(); it++)
-          result.push_back(it->first);
-        return result;
+        return sorted(vector_names_);
       }
 
       std::vector<std::string> get_rotation_names() const
       {
-        std::vector<std::string> result;
-        for (auto it=rotation_references_.begin(); it!=rotation_references_.end(); it++)
-          result.push_back(it->first);
-        return result;
+        return sorted(rotation_names_);
       }
 
       std::vector<std::string> get_frame_names() const
       {
-        std::vector<std::string> result;
-        for (auto it=frame_references_.begin(); it!=frame_references_.end(); it++)
-          result.push_back(it->first);
+        return sorted(frame_names_);
+      }
+
+      // all expressions, in the order double, vector, rotation, frame
+      std::vector<KDL::ExpressionBase::Ptr> get_expressions() const
+      {
+        std::vector<KDL::ExpressionBase::Ptr> result;
+        result.insert(result.end(), double_expressions_.begin(), double_expressions_.end());
+        result.insert(result.end(), vector_expressions_.begin(), vector_expressions_.end());
+        result.insert(result.end(), rotation_expressions_.begin(), rotation_expressions_.end());
+        result.insert(result.end(), frame_expressions_.begin(), frame_expressions_.end());
+        return result;
+      }
+
+      /**
+       * Returns a scope with the same names and handles, and clones of all
+       * expressions, which evaluate independently of the ones of this scope.
+       * Entries do not share subexpressions with each other after cloning.
+       */
+      Scope clone() const
+      {
+        Scope result(*this);
+        clone_all(result.double_expressions_);
+        clone_all(result.vector_expressions_);
+        clone_all(result.rotation_expressions_);
+        clone_all(result.frame_expressions_);
         return result;
       }
 
+      // name of the expression of a handle
+      const std::string& get_name(const Handle& handle) const
+      {
+        switch (handle.get_type())
+        {
+          case DoubleType:
+            return get(handle, DoubleType, double_names_);
+          case VectorType:
+            return get(handle, VectorType, vector_names_);
+          case RotationType:
+            return get(handle, RotationType, rotation_names_);
+          case FrameType:
+            return get(handle, FrameType, frame_names_);
+          default:
+            throw std::runtime_error("Could not infer type of expression handle.");
+        }
+      }
+
     private:
-      std::map< std::string, KDL::Expression<double>::Ptr > double_references_;
-      std::map< std::string, KDL::Expression<KDL::Vector>::Ptr > vector_references_;
-      std::map< std::string, KDL::Expression<KDL::Rotation>::Ptr > rotation_references_;
-      std::map< std::string, KDL::Expression<KDL::Frame>::Ptr > frame_references_;
+      // index into the typed storage per type, or Handle::invalid_index()
+      typedef std::array<size_t, 4> Indices;
+      typedef std::unordered_map<std::string, Indices> NameIndex;
+
+      NameIndex names_;
+      std::vector< KDL::Expression<double>::Ptr > double_expressions_;
+      std::vector< KDL::Expression<KDL::Vector>::Ptr > vector_expressions_;
+      std::vector< KDL::Expression<KDL::Rotation>::Ptr > rotation_expressions_;
+      std::vector< KDL::Expression<KDL::Frame>::Ptr > frame_expressions_;
+      // names in insertion order, i.e. aligned with the typed storage
+      std::vector<std::string> double_names_, vector_names_, rotation_names_, frame_names_;
+
+      Handle find_handle(const std::string& reference_name, ExpressionType type) const
+      {
+        NameIndex::const_iterator it = names_.find(reference_name);
+        if (it == names_.end())
+          return Handle();
+
+        return Handle(type, it->second[type]);
+      }
+
+      template<typename T>
+      const T& get(const Handle& handle, ExpressionType type, const std::vector<T>& storage) const
+      {
+        if (handle.get_type() != type)
+          throw std::invalid_argument("Scope handle refers to a " + type_name(handle.get_type()) +
+              " expression, not to a " + type_name(type) + " expression.");
+
+        if (handle.get_index() >= storage.size())
+          throw std::out_of_range("Scope handle with index " + std::to_string(handle.get_index()) +
+              " exceeds the " + std::to_string(storage.size()) + " " + type_name(type) + " expressions.");
+
+        return storage[handle.get_index()];
+      }
+
+      template<typename T>
+      void add(const std::string& reference_name, const T& expression, ExpressionType type,
+          std::vector<T>& storage, std::vector<std::string>& names)
+      {
+        NameIndex::iterator it = names_.find(reference_name);
+        if (it == names_.end())
+        {
+          Indices indices;
+          indices.fill(Handle::invalid_index());
+          it = names_.insert(std::make_pair(reference_name, indices)).first;
+        }
+        else if (it->second[type] != Handle::invalid_index())
+          throw std::invalid_argument("Could not add " + type_name(type) +
+              " expression to scope because name already taken: " + reference_name);
+
+        it->second[type] = storage.size();
+        storage.push_back(expression);
+        names.push_back(reference_name);
+      }
+
+      template<typename T>
+      static void clone_all(std::vector<T>& expressions)
+      {
+        for (auto & expression: expressions)
+          expression = expression->clone();
+      }
+
+      static std::vector<std::string> sorted(const std::vector<std::string>& names)
+      {
+        std::vector<std::string> result(names);
+        std::sort(result.begin(), result.end());
+        return result;
+      }
+
+      static std::string type_name(ExpressionType type)
+      {
+        switch (type)
+        {
+          case DoubleType:
+            return "double";
+          case VectorType:
+            return "vector";
+          case RotationType:
+            return "rotation";
+          case FrameType:
+            return "frame";
+          default:
+            return "unknown";
+        }
+      }
   };
 }
 
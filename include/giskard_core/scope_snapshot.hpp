@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_CORE_SCOPE_SNAPSHOT_HPP
+#define GISKARD_CORE_SCOPE_SNAPSHOT_HPP
+
+#include <giskard_core/scope.hpp>
+#include <giskard_core/triple_buffer.hpp>
+#include <Eigen/Core>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace giskard_core
+{
+  /**
+   * Position of one scope entry in the buffer of a ScopeSnapshot.
+   *
+   * Doubles take 1 value, vectors 3 (x, y, z), rotations 9 (row-major
+   * matrix), and frames 12 (row-major rotation matrix, then translation).
+   */
+  class ScopeSnapshotEntry
+  {
+    public:
+      ScopeSnapshotEntry(const std::string& name, Scope::ExpressionType type, size_t offset) :
+        name_(name), type_(type), offset_(offset), size_(value_size(type)) {}
+
+      static size_t value_size(Scope::ExpressionType type)
+      {
+        switch (type)
+        {
+          case Scope::DoubleType:
+            return 1;
+          case Scope::VectorType:
+            return 3;
+          case Scope::RotationType:
+            return 9;
+          case Scope::FrameType:
+            return 12;
+          default:
+            throw std::domain_error("Scope snapshot: found entry of non-supported type.");
+        }
+      }
+
+      std::string name_;
+      Scope::ExpressionType type_;
+      size_t offset_, size_;
+  };
+
+  /**
+   * Copies the values of a fixed set of scope entries into one flat buffer.
+   *
+   * Entries are resolved once when they are added. capture() then reads the
+   * current value of every entry, grouped by type, into a preallocated
+   * buffer whose layout is described by get_layout(). Capture through
+   * QPController::capture() right after QPController::update(), from the
+   * thread updating the controller; that also evaluates feedback entries.
+   */
+  class ScopeSnapshot
+  {
+    public:
+      ScopeSnapshot() {}
+
+      ScopeSnapshot(const Scope& scope, const std::vector<std::string>& names)
+      {
+        for (auto const & name: names)
+          add(scope, name);
+      }
+
+      // adds the entry that Scope::resolve(name) finds; returns its index in the layout
+      size_t add(const Scope& scope, const std::string& name)
+      {
+        return add(scope, scope.resolve(name));
+      }
+
+      size_t add(const Scope& scope, const std::string& name, Scope::ExpressionType type)
+      {
+        return add(scope, scope.resolve(name, type));
+      }
+
+      void capture()
+      {
+        capture(buffer_);
+      }
+
+      // Writes into an external buffer, e.g. the write buffer of a TripleBuffer.
+      void capture(Eigen::VectorXd& buffer) const
+      {
+        buffer.resize(size());
+
+        for (size_t i=0; i<doubles_.size(); ++i)
+          buffer(doubles_[i].offset_) = doubles_[i].expression_->value();
+
+        for (size_t i=0; i<vectors_.size(); ++i)
+          write(vectors_[i].expression_->value(), buffer.data() + vectors_[i].offset_);
+
+        for (size_t i=0; i<rotations_.size(); ++i)
+          write(rotations_[i].expression_->value(), buffer.data() + rotations_[i].offset_);
+
+        for (size_t i=0; i<frames_.size(); ++i)
+        {
+          KDL::Frame frame = frames_[i].expression_->value();
+          write(frame.M, buffer.data() + frames_[i].offset_);
+          write(frame.p, buffer.data() + frames_[i].offset_ + 9);
+        }
+      }
+
+      const Eigen::VectorXd& get_buffer() const
+      {
+        return buffer_;
+      }
+
+      const std::vector<ScopeSnapshotEntry>& get_layout() const
+      {
+        return layout_;
+      }
+
+      size_t size() const
+      {
+        return layout_.empty() ? 0 : layout_.back().offset_ + layout_.back().size_;
+      }
+
+      size_t num_entries() const
+      {
+        return layout_.size();
+      }
+
+      // Convenience accessors that decode one entry of a buffer with this layout.
+      double get_double(size_t entry, const Eigen::VectorXd& buffer) const
+      {
+        return buffer(get_entry(entry, Scope::DoubleType).offset_);
+      }
+
+      KDL::Vector get_vector(size_t entry, const Eigen::VectorXd& buffer) const
+      {
+        return read_vector(buffer.data() + get_entry(entry, Scope::VectorType).offset_);
+      }
+
+      KDL::Rotation get_rotation(size_t entry, const Eigen::VectorXd& buffer) const
+      {
+        return read_rotation(buffer.data() + get_entry(entry, Scope::RotationType).offset_);
+      }
+
+      KDL::Frame get_frame(size_t entry, const Eigen::VectorXd& buffer) const
+      {
+        const double* data = buffer.data() + get_entry(entry, Scope::FrameType).offset_;
+        return KDL::Frame(read_rotation(data), read_vector(data + 9));
+      }
+
+    private:
+      template<typename T>
+      struct Slot
+      {
+        typename KDL::Expression<T>::Ptr expression_;
+        size_t offset_;
+      };
+
+      std::vector<ScopeSnapshotEntry> layout_;
+      std::vector< Slot<double> > doubles_;
+      std::vector< Slot<KDL::Vector> > vectors_;
+      std::vector< Slot<KDL::Rotation> > rotations_;
+      std::vector< Slot<KDL::Frame> > frames_;
+      Eigen::VectorXd buffer_;
+
+      size_t add(const Scope& scope, const Scope::Handle& handle)
+      {
+        size_t offset = size();
+        switch (handle.get_type())
+        {
+          case Scope::DoubleType:
+            push(doubles_, scope.get_double(handle), offset);
+            break;
+          case Scope::VectorType:
+            push(vectors_, scope.get_vector(handle), offset);
+            break;
+          case Scope::RotationType:
+            push(rotations_, scope.get_rotation(handle), offset);
+            break;
+          case Scope::FrameType:
+            push(frames_, scope.get_frame(handle), offset);
+            break;
+          default:
+            throw std::domain_error("Scope snapshot: found entry of non-supported type.");
+        }
+
+        layout_.push_back(ScopeSnapshotEntry(scope.get_name(handle), handle.get_type(), offset));
+        buffer_ = Eigen::VectorXd::Zero(size());
+        return layout_.size() - 1;
+      }
+
+      template<typename T>
+      static void push(std::vector< Slot<T> >& slots, const typename KDL::Expression<T>::Ptr& expression,
+          size_t offset)
+      {
+        Slot<T> slot;
+        slot.expression_ = expression;
+        slot.offset_ = offset;
+        slots.push_back(slot);
+      }
+
+      const ScopeSnapshotEntry& get_entry(size_t entry, Scope::ExpressionType type) const
+      {
+        if (entry >= layout_.size())
+          throw std::out_of_range("Scope snapshot has no entry " + std::to_string(entry) + ".");
+
+        if (layout_[entry].type_ != type)
+          throw std::invalid_argument("Scope snapshot entry '" + layout_[entry].name_ +
+              "' has a different type than requested.");
+
+        return layout_[entry];
+      }
+
+      static void write(const KDL::Vector& vector, double* data)
+      {
+        std::copy(vector.data, vector.data + 3, data);
+      }
+
+      static void write(const KDL::Rotation& rotation, double* data)
+      {
+        std::copy(rotation.data, rotation.data + 9, data);
+      }
+
+      static KDL::Vector read_vector(const double* data)
+      {
+        return KDL::Vector(data[0], data[1], data[2]);
+      }
+
+      static KDL::Rotation read_rotation(const double* data)
+      {
+        return KDL::Rotation(data[0], data[1], data[2], data[3], data[4], data[5], data[6], data[7], data[8]);
+      }
+  };
+
+  /**
+   * ScopeSnapshot that hands its buffer from the controller thread to one
+   * reader thread through a TripleBuffer. capture() never blocks, and the
+   * reader always sees a complete snapshot of a single tick.
+   */
+  class ConcurrentScopeSnapshot
+  {
+    public:
+      ConcurrentScopeSnapshot() {}
+
+      ConcurrentScopeSnapshot(const Scope& scope, const std::vector<std::string>& names) :
+        snapshot_(scope, names), buffer_(Eigen::VectorXd::Zero(snapshot_.size()))
+      {}
+
+      // controller side
+      void capture()
+      {
+        snapshot_.capture(buffer_.get_write_buffer());
+        buffer_.publish();
+      }
+
+      // reader side
+      bool fetch()
+      {
+        return buffer_.fetch();
+      }
+
+      const Eigen::VectorXd& get_buffer() const
+      {
+        return buffer_.get_read_buffer();
+      }
+
+      // layout and decoding, read-only after construction
+      const ScopeSnapshot& get_snapshot() const
+      {
+        return snapshot_;
+      }
+
+    private:
+      ScopeSnapshot snapshot_;
+      TripleBuffer<Eigen::VectorXd> buffer_;
+  };
+}
+
+#endif // GISKARD_CORE_SCOPE_SNAPSHOT_HPP
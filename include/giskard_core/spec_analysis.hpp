@@ -0,0 +1,416 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_CORE_SPEC_ANALYSIS_HPP
+#define GISKARD_CORE_SPEC_ANALYSIS_HPP
+
+#include <giskard_core/qp_controller.hpp>
+#include <giskard_core/specifications.hpp>
+#include <giskard_core/spec_cost.hpp>
+#include <giskard_core/spec_traversal.hpp>
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace giskard_core
+{
+  inline std::string get_kind_name(SpecKind kind)
+  {
+    switch (kind)
+    {
+      case AliasReferenceKind:
+        return "AliasReferenceSpec";
+      case DoubleConstKind:
+        return "DoubleConstSpec";
+      case DoubleInputKind:
+        return "DoubleInputSpec";
+      case DoubleReferenceKind:
+        return "DoubleReferenceSpec";
+      case DoubleAdditionKind:
+        return "DoubleAdditionSpec";
+      case DoubleSubtractionKind:
+        return "DoubleSubtractionSpec";
+      case DoubleNormOfKind:
+        return "DoubleNormOfSpec";
+      case DoubleMultiplicationKind:
+        return "DoubleMultiplicationSpec";
+      case DoubleDivisionKind:
+        return "DoubleDivisionSpec";
+      case DoubleXCoordOfKind:
+        return "DoubleXCoordOfSpec";
+      case DoubleYCoordOfKind:
+        return "DoubleYCoordOfSpec";
+      case DoubleZCoordOfKind:
+        return "DoubleZCoordOfSpec";
+      case VectorDotKind:
+        return "VectorDotSpec";
+      case MinKind:
+        return "MinSpec";
+      case AbsKind:
+        return "AbsSpec";
+      case DoubleIfKind:
+        return "DoubleIfSpec";
+      case FmodKind:
+        return "FmodSpec";
+      case SinKind:
+        return "SinSpec";
+      case CosKind:
+        return "CosSpec";
+      case TanKind:
+        return "TanSpec";
+      case ASinKind:
+        return "ASinSpec";
+      case ACosKind:
+        return "ACosSpec";
+      case ATanKind:
+        return "ATanSpec";
+      case SqrtKind:
+        return "SqrtSpec";
+      case MaxKind:
+        return "MaxSpec";
+      case DoubleCachedKind:
+        return "DoubleCachedSpec";
+      case VectorCachedKind:
+        return "VectorCachedSpec";
+      case VectorConstructorKind:
+        return "VectorConstructorSpec";
+      case VectorAdditionKind:
+        return "VectorAdditionSpec";
+      case VectorSubtractionKind:
+        return "VectorSubtractionSpec";
+      case VectorReferenceKind:
+        return "VectorReferenceSpec";
+      case VectorOriginOfKind:
+        return "VectorOriginOfSpec";
+      case VectorFrameMultiplicationKind:
+        return "VectorFrameMultiplicationSpec";
+      case VectorRotationMultiplicationKind:
+        return "VectorRotationMultiplicationSpec";
+      case VectorDoubleMultiplicationKind:
+        return "VectorDoubleMultiplicationSpec";
+      case VectorRotationVectorKind:
+        return "VectorRotationVectorSpec";
+      case VectorCrossKind:
+        return "VectorCrossSpec";
+      case RotationQuaternionConstructorKind:
+        return "RotationQuaternionConstructorSpec";
+      case AxisAngleKind:
+        return "AxisAngleSpec";
+      case SlerpKind:
+        return "SlerpSpec";
+      case RotationReferenceKind:
+        return "RotationReferenceSpec";
+      case InverseRotationKind:
+        return "InverseRotationSpec";
+      case RotationMultiplicationKind:
+        return "RotationMultiplicationSpec";
+      case RotationCachedKind:
+        return "RotationCachedSpec";
+      case FrameCachedKind:
+        return "FrameCachedSpec";
+      case FrameConstructorKind:
+        return "FrameConstructorSpec";
+      case OrientationOfKind:
+        return "OrientationOfSpec";
+      case FrameMultiplicationKind:
+        return "FrameMultiplicationSpec";
+      case FrameReferenceKind:
+        return "FrameReferenceSpec";
+      case InverseFrameKind:
+        return "InverseFrameSpec";
+      default:
+        throw std::domain_error("Found spec of unknown kind " + std::to_string(kind) + ".");
+    }
+  }
+
+  // Name of the expression type a spec generates, or "alias" for alias references.
+  inline std::string get_type_name(const SpecPtr& spec)
+  {
+    class TypeNamer : public SpecVisitor
+    {
+      public:
+        using SpecVisitor::visit;
+
+        virtual void visit(Spec& spec) { name_ = "alias"; }
+        virtual void visit(DoubleSpec& spec) { name_ = "double"; }
+        virtual void visit(VectorSpec& spec) { name_ = "vector"; }
+        virtual void visit(RotationSpec& spec) { name_ = "rotation"; }
+        virtual void visit(FrameSpec& spec) { name_ = "frame"; }
+
+        std::string name_;
+    };
+
+    TypeNamer namer;
+    spec->accept(namer);
+    return namer.name_;
+  }
+
+  /**
+   * Size and estimated cost of a controller spec, see analyze().
+   *
+   * Nodes are counted once, no matter how many parents share them. The
+   * sharing ratio compares that with the number of nodes the spec would have
+   * if every shared subtree was copied for each of its parents. Depth and
+   * costs follow references into the scope, like generation does; costs
+   * only cover the nodes that the constraints depend on, i.e. what the
+   * controller evaluates every tick.
+   */
+  class SpecStatistics
+  {
+    public:
+      SpecStatistics() :
+        num_nodes_( 0 ), num_tree_nodes_( 0.0 ), depth_( 0 ), num_hot_nodes_( 0 ),
+        value_flops_( 0.0 ), derivative_flops_( 0.0 ), num_scope_entries_( 0 ),
+        num_controllables_( 0 ), num_soft_constraints_( 0 ), num_hard_constraints_( 0 ) {}
+
+      double sharing_ratio() const
+      {
+        return (num_nodes_ == 0) ? 1.0 : num_tree_nodes_ / num_nodes_;
+      }
+
+      double flops() const
+      {
+        return value_flops_ + derivative_flops_;
+      }
+
+      size_t num_nodes_;
+      double num_tree_nodes_;
+      size_t depth_, num_hot_nodes_;
+      std::map<std::string, size_t> num_nodes_per_kind_, num_nodes_per_type_;
+      double value_flops_, derivative_flops_;
+      size_t num_scope_entries_, num_controllables_, num_soft_constraints_, num_hard_constraints_;
+  };
+
+  /**
+   * Dimensions of the QP of a generated controller. The number of non-zeros
+   * of the constraint matrix A refers to the state of the last update.
+   */
+  class QPStatistics
+  {
+    public:
+      QPStatistics() :
+        num_controllables_( 0 ), num_soft_constraints_( 0 ), num_hard_constraints_( 0 ),
+        num_observables_( 0 ), num_variables_( 0 ), num_constraints_( 0 ), num_nonzeros_A_( 0 ) {}
+
+      double density_A() const
+      {
+        size_t size = num_variables_ * num_constraints_;
+        return (size == 0) ? 0.0 : static_cast<double>(num_nonzeros_A_) / size;
+      }
+
+      size_t num_controllables_, num_soft_constraints_, num_hard_constraints_, num_observables_;
+      size_t num_variables_, num_constraints_, num_nonzeros_A_;
+  };
+
+  class SpecAnalyzer
+  {
+    public:
+      SpecAnalyzer(const QPControllerSpec& spec) :
+        num_controllables_( spec.controllable_constraints_.size() ), entries_( spec.scope_ )
+      {
+        statistics_.num_scope_entries_ = spec.scope_.size();
+        statistics_.num_controllables_ = spec.controllable_constraints_.size();
+        statistics_.num_soft_constraints_ = spec.soft_constraints_.size();
+        statistics_.num_hard_constraints_ = spec.hard_constraints_.size();
+
+        std::vector<SpecPtr> roots = get_constraint_specs(spec);
+        for (auto const & entry: spec.scope_)
+          statistics_.num_tree_nodes_ += count(entry.spec);
+        for (auto const & root: roots)
+          statistics_.num_tree_nodes_ += count(root);
+
+        for (auto const & root: roots)
+        {
+          statistics_.depth_ = std::max(statistics_.depth_, get_depth(root));
+          add_cost(root);
+        }
+        statistics_.num_hot_nodes_ = hot_.size();
+      }
+
+      const SpecStatistics& get_statistics() const
+      {
+        return statistics_;
+      }
+
+    private:
+      size_t num_controllables_;
+      ScopeEntryIndex entries_;
+      SpecStatistics statistics_;
+      std::map<const Spec*, double> tree_sizes_;
+      std::map<const Spec*, size_t> depths_;
+      std::map<const Spec*, std::set<size_t> > dependencies_;
+      std::set<const Spec*> hot_, in_progress_;
+
+      // node referenced by spec, or spec itself
+      SpecPtr resolve(const SpecPtr& spec) const
+      {
+        return entries_.find_spec(spec);
+      }
+
+      // counts distinct nodes, and returns the tree size below spec
+      double count(const SpecPtr& spec)
+      {
+        if (!spec)
+          return 0.0;
+
+        std::map<const Spec*, double>::const_iterator it = tree_sizes_.find(spec.get());
+        if (it != tree_sizes_.end())
+          return it->second;
+
+        ++statistics_.num_nodes_;
+        ++statistics_.num_nodes_per_kind_[get_kind_name(spec->get_kind())];
+        ++statistics_.num_nodes_per_type_[get_type_name(spec)];
+
+        double size = 1.0;
+        for (auto const & child: spec->get_children())
+          size += count(child);
+
+        tree_sizes_[spec.get()] = size;
+        return size;
+      }
+
+      size_t get_depth(const SpecPtr& spec)
+      {
+        if (!spec || in_progress_.count(spec.get()) > 0)
+          return 0;
+
+        std::map<const Spec*, size_t>::const_iterator it = depths_.find(spec.get());
+        if (it != depths_.end())
+          return it->second;
+
+        in_progress_.insert(spec.get());
+        size_t depth = 0;
+        SpecPtr referenced = resolve(spec);
+        if (referenced)
+          depth = get_depth(referenced);
+        for (auto const & child: spec->get_children())
+          depth = std::max(depth, get_depth(child));
+        in_progress_.erase(spec.get());
+
+        depths_[spec.get()] = depth + 1;
+        return depth + 1;
+      }
+
+      // adds the cost of every node below spec once; returns the controllables it depends on
+      const std::set<size_t>& add_cost(const SpecPtr& spec)
+      {
+        static const std::set<size_t> none;
+        if (!spec || in_progress_.count(spec.get()) > 0)
+          return none;
+
+        std::map<const Spec*, std::set<size_t> >::const_iterator it = dependencies_.find(spec.get());
+        if (it != dependencies_.end())
+          return it->second;
+
+        in_progress_.insert(spec.get());
+        std::set<size_t> dependencies;
+        if (spec->get_kind() == DoubleInputKind)
+        {
+          size_t input = boost::static_pointer_cast<DoubleInputSpec>(spec)->get_input_num();
+          if (input < num_controllables_)
+            dependencies.insert(input);
+        }
+
+        SpecPtr referenced = resolve(spec);
+        if (referenced)
+        {
+          const std::set<size_t>& inputs = add_cost(referenced);
+          dependencies.insert(inputs.begin(), inputs.end());
+        }
+        for (auto const & child: spec->get_children())
+        {
+          const std::set<size_t>& inputs = add_cost(child);
+          dependencies.insert(inputs.begin(), inputs.end());
+        }
+        in_progress_.erase(spec.get());
+
+        SpecCost cost = get_cost(spec);
+        statistics_.value_flops_ += cost.value_flops_;
+        statistics_.derivative_flops_ += cost.derivative_flops_ * dependencies.size();
+        hot_.insert(spec.get());
+
+        return dependencies_[spec.get()] = dependencies;
+      }
+  };
+
+  inline SpecStatistics analyze(const QPControllerSpec& spec)
+  {
+    return SpecAnalyzer(spec).get_statistics();
+  }
+
+  inline QPStatistics analyze(const QPController& controller)
+  {
+    const QPProblemBuilder& builder = controller.get_qp_builder();
+
+    QPStatistics result;
+    result.num_controllables_ = builder.num_controllables();
+    result.num_soft_constraints_ = builder.num_soft_constraints();
+    result.num_hard_constraints_ = builder.num_hard_constraints();
+    result.num_observables_ = builder.num_observables();
+    result.num_variables_ = builder.num_weights();
+    result.num_constraints_ = builder.num_constraints();
+    result.num_nonzeros_A_ = (builder.get_A().array() != 0.0).count();
+    return result;
+  }
+
+  inline std::ostream& operator<<(std::ostream& os, const SpecStatistics& statistics)
+  {
+    os << "scope entries:        " << statistics.num_scope_entries_ << "\n";
+    os << "controllables:        " << statistics.num_controllables_ << "\n";
+    os << "soft constraints:     " << statistics.num_soft_constraints_ << "\n";
+    os << "hard constraints:     " << statistics.num_hard_constraints_ << "\n";
+    os << "nodes:                " << statistics.num_nodes_ << "\n";
+    os << "unshared nodes:       " << statistics.num_tree_nodes_ << "\n";
+    os << "sharing ratio:        " << statistics.sharing_ratio() << "\n";
+    os << "depth:                " << statistics.depth_ << "\n";
+    os << "nodes per tick:       " << statistics.num_hot_nodes_ << "\n";
+    os << "value flops:          " << statistics.value_flops_ << "\n";
+    os << "derivative flops:     " << statistics.derivative_flops_ << "\n";
+    std::ios::fmtflags flags = os.flags();
+    os << "nodes per type:\n";
+    for (auto const & count: statistics.num_nodes_per_type_)
+      os << "  " << std::left << std::setw(36) << count.first << count.second << "\n";
+    os << "nodes per kind:\n";
+    for (auto const & count: statistics.num_nodes_per_kind_)
+      os << "  " << std::left << std::setw(36) << count.first << count.second << "\n";
+    os.flags(flags);
+    return os;
+  }
+
+  inline std::ostream& operator<<(std::ostream& os, const QPStatistics& statistics)
+  {
+    os << "controllables:        " << statistics.num_controllables_ << "\n";
+    os << "soft constraints:     " << statistics.num_soft_constraints_ << "\n";
+    os << "hard constraints:     " << statistics.num_hard_constraints_ << "\n";
+    os << "observables:          " << statistics.num_observables_ << "\n";
+    os << "QP variables:         " << statistics.num_variables_ << "\n";
+    os << "QP constraints:       " << statistics.num_constraints_ << "\n";
+    os << "non-zeros of A:       " << statistics.num_nonzeros_A_ << "\n";
+    os << "density of A:         " << statistics.density_A() << "\n";
+    return os;
+  }
+}
+
+#endif // GISKARD_CORE_SPEC_ANALYSIS_HPP
@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_CORE_SPEC_ARENA_HPP
+#define GISKARD_CORE_SPEC_ARENA_HPP
+
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace giskard_core
+{
+  /**
+   * Memory of a SpecArena: a list of blocks that are filled front to back,
+   * and released all at once when the memory gets destroyed.
+   */
+  class SpecArenaMemory
+  {
+    public:
+      SpecArenaMemory(size_t block_size) :
+        block_size_( block_size ), used_( block_size ), num_bytes_( 0 ), num_allocations_( 0 )
+      {
+        if (block_size == 0)
+          throw std::invalid_argument("Spec arena needs a block size above zero.");
+      }
+
+      void* allocate(size_t size, size_t alignment)
+      {
+        size_t offset = (used_ + alignment - 1) / alignment * alignment;
+        if (blocks_.empty() || offset + size > block_size_)
+        {
+          // oversized requests get a block of their own
+          size_t block_size = std::max(block_size_, size + alignment);
+          blocks_.push_back(std::unique_ptr<char[]>(new char[block_size]));
+          block_sizes_.push_back(block_size);
+          std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(blocks_.back().get());
+          offset = (begin + alignment - 1) / alignment * alignment - begin;
+        }
+
+        void* result = blocks_.back().get() + offset;
+        used_ = (block_sizes_.back() > block_size_) ? block_size_ : offset + size;
+        num_bytes_ += size;
+        ++num_allocations_;
+        return result;
+      }
+
+      // bytes handed out so far
+      size_t num_bytes() const
+      {
+        return num_bytes_;
+      }
+
+      size_t num_allocations() const
+      {
+        return num_allocations_;
+      }
+
+      size_t num_blocks() const
+      {
+        return blocks_.size();
+      }
+
+    private:
+      size_t block_size_, used_, num_bytes_, num_allocations_;
+      std::vector< std::unique_ptr<char[]> > blocks_;
+      std::vector<size_t> block_sizes_;
+  };
+
+  typedef typename boost::shared_ptr<SpecArenaMemory> SpecArenaMemoryPtr;
+
+  /**
+   * Allocator that takes its memory from a SpecArenaMemory and never gives
+   * it back one by one. Every copy keeps the memory alive, so specs created
+   * through it stay valid until the last of them is destroyed.
+   */
+  template<typename T>
+  class SpecArenaAllocator
+  {
+    public:
+      typedef T value_type;
+      typedef T* pointer;
+      typedef const T* const_pointer;
+      typedef T& reference;
+      typedef const T& const_reference;
+      typedef std::size_t size_type;
+      typedef std::ptrdiff_t difference_type;
+
+      template<typename U>
+      struct rebind
+      {
+        typedef SpecArenaAllocator<U> other;
+      };
+
+      SpecArenaAllocator(const SpecArenaMemoryPtr& memory) :
+        memory_( memory ) {}
+
+      template<typename U>
+      SpecArenaAllocator(const SpecArenaAllocator<U>& other) :
+        memory_( other.get_memory() ) {}
+
+      pointer allocate(size_type n, const void* hint = 0)
+      {
+        return static_cast<pointer>(memory_->allocate(n * sizeof(T), alignof(T)));
+      }
+
+      void deallocate(pointer p, size_type n) {}
+
+      template<typename U, typename... Args>
+      void construct(U* p, Args&&... args)
+      {
+        ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+      }
+
+      template<typename U>
+      void destroy(U* p)
+      {
+        p->~U();
+      }
+
+      size_type max_size() const
+      {
+        return std::numeric_limits<size_type>::max() / sizeof(T);
+      }
+
+      const SpecArenaMemoryPtr& get_memory() const
+      {
+        return memory_;
+      }
+
+    private:
+      SpecArenaMemoryPtr memory_;
+  };
+
+  template<typename T, typename U>
+  inline bool operator==(const SpecArenaAllocator<T>& lhs, const SpecArenaAllocator<U>& rhs)
+  {
+    return lhs.get_memory() == rhs.get_memory();
+  }
+
+  template<typename T, typename U>
+  inline bool operator!=(const SpecArenaAllocator<T>& lhs, const SpecArenaAllocator<U>& rhs)
+  {
+    return !(lhs == rhs);
+  }
+
+  /**
+   * Optional bump allocation of whole spec documents, e.g. while parsing
+   * a large controller spec. While a SpecArenaGuard is alive, make_spec()
+   * allocates every new spec node, together with its reference count, from
+   * the blocks of the arena of that guard instead of the heap.
+   *
+   * Specs created in an arena are ordinary shared pointers. Destroying them
+   * only runs their destructors; the blocks are freed all at once after the
+   * arena and the last spec allocated from it are gone.
+   *
+   * NOTE: An arena is not thread-safe. Use one arena per thread.
+   */
+  class SpecArena
+  {
+    public:
+      SpecArena(size_t block_size = default_block_size()) :
+        memory_( new SpecArenaMemory(block_size) ) {}
+
+      template<typename T, typename... Args>
+      boost::shared_ptr<T> create(Args&&... args)
+      {
+        return boost::allocate_shared<T>(SpecArenaAllocator<T>(memory_), std::forward<Args>(args)...);
+      }
+
+      const SpecArenaMemory& get_memory() const
+      {
+        return *memory_;
+      }
+
+      static size_t default_block_size()
+      {
+        return 64 * 1024;
+      }
+
+      // arena that make_spec() allocates from in this thread, if any
+      static SpecArena*& current()
+      {
+        static thread_local SpecArena* arena = 0;
+        return arena;
+      }
+
+    private:
+      SpecArenaMemoryPtr memory_;
+  };
+
+  // Makes make_spec() allocate from arena in this thread, until the guard goes out of scope.
+  class SpecArenaGuard
+  {
+    public:
+      SpecArenaGuard(SpecArena& arena) :
+        previous_( SpecArena::current() )
+      {
+        SpecArena::current() = &arena;
+      }
+
+      ~SpecArenaGuard()
+      {
+        SpecArena::current() = previous_;
+      }
+
+    private:
+      SpecArena* previous_;
+
+      SpecArenaGuard(const SpecArenaGuard& other);
+      SpecArenaGuard& operator=(const SpecArenaGuard& other);
+  };
+
+  // Creates a spec node with one allocation, from the current arena if there is one.
+  template<typename T, typename... Args>
+  inline boost::shared_ptr<T> make_spec(Args&&... args)
+  {
+    if (SpecArena::current())
+      return SpecArena::current()->create<T>(std::forward<Args>(args)...);
+
+    return boost::make_shared<T>(std::forward<Args>(args)...);
+  }
+}
+
+#endif // GISKARD_CORE_SPEC_ARENA_HPP
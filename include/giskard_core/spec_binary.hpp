@@ -0,0 +1,903 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_CORE_SPEC_BINARY_HPP
+#define GISKARD_CORE_SPEC_BINARY_HPP
+
+#include <giskard_core/specifications.hpp>
+#include <giskard_core/spec_traversal.hpp>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace giskard_core
+{
+  // Spec of the given kind with default values and children.
+  inline SpecPtr create_spec(SpecKind kind)
+  {
+    switch (kind)
+    {
+      case AliasReferenceKind:
+        return make_spec<AliasReferenceSpec>();
+      case DoubleConstKind:
+        return make_spec<DoubleConstSpec>();
+      case DoubleInputKind:
+        return make_spec<DoubleInputSpec>();
+      case DoubleReferenceKind:
+        return make_spec<DoubleReferenceSpec>();
+      case DoubleAdditionKind:
+        return make_spec<DoubleAdditionSpec>();
+      case DoubleSubtractionKind:
+        return make_spec<DoubleSubtractionSpec>();
+      case DoubleNormOfKind:
+        return make_spec<DoubleNormOfSpec>();
+      case DoubleMultiplicationKind:
+        return make_spec<DoubleMultiplicationSpec>();
+      case DoubleDivisionKind:
+        return make_spec<DoubleDivisionSpec>();
+      case DoubleXCoordOfKind:
+        return make_spec<DoubleXCoordOfSpec>();
+      case DoubleYCoordOfKind:
+        return make_spec<DoubleYCoordOfSpec>();
+      case DoubleZCoordOfKind:
+        return make_spec<DoubleZCoordOfSpec>();
+      case VectorDotKind:
+        return make_spec<VectorDotSpec>();
+      case MinKind:
+        return make_spec<MinSpec>();
+      case AbsKind:
+        return make_spec<AbsSpec>();
+      case DoubleIfKind:
+        return make_spec<DoubleIfSpec>();
+      case FmodKind:
+        return make_spec<FmodSpec>();
+      case SinKind:
+        return make_spec<SinSpec>();
+      case CosKind:
+        return make_spec<CosSpec>();
+      case TanKind:
+        return make_spec<TanSpec>();
+      case ASinKind:
+        return make_spec<ASinSpec>();
+      case ACosKind:
+        return make_spec<ACosSpec>();
+      case ATanKind:
+        return make_spec<ATanSpec>();
+      case SqrtKind:
+        return make_spec<SqrtSpec>();
+      case MaxKind:
+        return make_spec<MaxSpec>();
+      case DoubleCachedKind:
+        return make_spec<DoubleCachedSpec>();
+      case VectorCachedKind:
+        return make_spec<VectorCachedSpec>();
+      case VectorConstructorKind:
+        return make_spec<VectorConstructorSpec>();
+      case VectorAdditionKind:
+        return make_spec<VectorAdditionSpec>();
+      case VectorSubtractionKind:
+        return make_spec<VectorSubtractionSpec>();
+      case VectorReferenceKind:
+        return make_spec<VectorReferenceSpec>();
+      case VectorOriginOfKind:
+        return make_spec<VectorOriginOfSpec>();
+      case VectorFrameMultiplicationKind:
+        return make_spec<VectorFrameMultiplicationSpec>();
+      case VectorRotationMultiplicationKind:
+        return make_spec<VectorRotationMultiplicationSpec>();
+      case VectorDoubleMultiplicationKind:
+        return make_spec<VectorDoubleMultiplicationSpec>();
+      case VectorRotationVectorKind:
+        return make_spec<VectorRotationVectorSpec>();
+      case VectorCrossKind:
+        return make_spec<VectorCrossSpec>();
+      case RotationQuaternionConstructorKind:
+        return make_spec<RotationQuaternionConstructorSpec>();
+      case AxisAngleKind:
+        return make_spec<AxisAngleSpec>();
+      case SlerpKind:
+        return make_spec<SlerpSpec>();
+      case RotationReferenceKind:
+        return make_spec<RotationReferenceSpec>();
+      case InverseRotationKind:
+        return make_spec<InverseRotationSpec>();
+      case RotationMultiplicationKind:
+        return make_spec<RotationMultiplicationSpec>();
+      case RotationCachedKind:
+        return make_spec<RotationCachedSpec>();
+      case FrameCachedKind:
+        return make_spec<FrameCachedSpec>();
+      case FrameConstructorKind:
+        return make_spec<FrameConstructorSpec>();
+      case OrientationOfKind:
+        return make_spec<OrientationOfSpec>();
+      case FrameMultiplicationKind:
+        return make_spec<FrameMultiplicationSpec>();
+      case FrameReferenceKind:
+        return make_spec<FrameReferenceSpec>();
+      case InverseFrameKind:
+        return make_spec<InverseFrameSpec>();
+      default:
+        throw std::domain_error("Cannot create spec of unknown kind " + std::to_string(kind) + ".");
+    }
+  }
+
+  /**
+   * Tags that stand for the spec kinds in binary specs. They are frozen, so
+   * reordering SpecKind does not break existing files. New kinds get new tags.
+   */
+  inline std::uint32_t get_binary_tag(SpecKind kind)
+  {
+    switch (kind)
+    {
+      case AliasReferenceKind:
+        return 0;
+      case DoubleConstKind:
+        return 1;
+      case DoubleInputKind:
+        return 2;
+      case DoubleReferenceKind:
+        return 3;
+      case DoubleAdditionKind:
+        return 4;
+      case DoubleSubtractionKind:
+        return 5;
+      case DoubleNormOfKind:
+        return 6;
+      case DoubleMultiplicationKind:
+        return 7;
+      case DoubleDivisionKind:
+        return 8;
+      case DoubleXCoordOfKind:
+        return 9;
+      case DoubleYCoordOfKind:
+        return 10;
+      case DoubleZCoordOfKind:
+        return 11;
+      case VectorDotKind:
+        return 12;
+      case MinKind:
+        return 13;
+      case AbsKind:
+        return 14;
+      case DoubleIfKind:
+        return 15;
+      case FmodKind:
+        return 16;
+      case SinKind:
+        return 17;
+      case CosKind:
+        return 18;
+      case TanKind:
+        return 19;
+      case ASinKind:
+        return 20;
+      case ACosKind:
+        return 21;
+      case ATanKind:
+        return 22;
+      case SqrtKind:
+        return 23;
+      case MaxKind:
+        return 24;
+      case DoubleCachedKind:
+        return 25;
+      case VectorCachedKind:
+        return 26;
+      case VectorConstructorKind:
+        return 27;
+      case VectorAdditionKind:
+        return 28;
+      case VectorSubtractionKind:
+        return 29;
+      case VectorReferenceKind:
+        return 30;
+      case VectorOriginOfKind:
+        return 31;
+      case VectorFrameMultiplicationKind:
+        return 32;
+      case VectorRotationMultiplicationKind:
+        return 33;
+      case VectorDoubleMultiplicationKind:
+        return 34;
+      case VectorRotationVectorKind:
+        return 35;
+      case VectorCrossKind:
+        return 36;
+      case RotationQuaternionConstructorKind:
+        return 37;
+      case AxisAngleKind:
+        return 38;
+      case SlerpKind:
+        return 39;
+      case RotationReferenceKind:
+        return 40;
+      case InverseRotationKind:
+        return 41;
+      case RotationMultiplicationKind:
+        return 42;
+      case RotationCachedKind:
+        return 43;
+      case FrameCachedKind:
+        return 44;
+      case FrameConstructorKind:
+        return 45;
+      case OrientationOfKind:
+        return 46;
+      case FrameMultiplicationKind:
+        return 47;
+      case FrameReferenceKind:
+        return 48;
+      case InverseFrameKind:
+        return 49;
+    }
+    throw std::domain_error("Spec kind " + std::to_string(kind) + " has no binary tag.");
+  }
+
+  inline SpecKind get_binary_kind(std::uint32_t tag)
+  {
+    switch (tag)
+    {
+      case 0:
+        return AliasReferenceKind;
+      case 1:
+        return DoubleConstKind;
+      case 2:
+        return DoubleInputKind;
+      case 3:
+        return DoubleReferenceKind;
+      case 4:
+        return DoubleAdditionKind;
+      case 5:
+        return DoubleSubtractionKind;
+      case 6:
+        return DoubleNormOfKind;
+      case 7:
+        return DoubleMultiplicationKind;
+      case 8:
+        return DoubleDivisionKind;
+      case 9:
+        return DoubleXCoordOfKind;
+      case 10:
+        return DoubleYCoordOfKind;
+      case 11:
+        return DoubleZCoordOfKind;
+      case 12:
+        return VectorDotKind;
+      case 13:
+        return MinKind;
+      case 14:
+        return AbsKind;
+      case 15:
+        return DoubleIfKind;
+      case 16:
+        return FmodKind;
+      case 17:
+        return SinKind;
+      case 18:
+        return CosKind;
+      case 19:
+        return TanKind;
+      case 20:
+        return ASinKind;
+      case 21:
+        return ACosKind;
+      case 22:
+        return ATanKind;
+      case 23:
+        return SqrtKind;
+      case 24:
+        return MaxKind;
+      case 25:
+        return DoubleCachedKind;
+      case 26:
+        return VectorCachedKind;
+      case 27:
+        return VectorConstructorKind;
+      case 28:
+        return VectorAdditionKind;
+      case 29:
+        return VectorSubtractionKind;
+      case 30:
+        return VectorReferenceKind;
+      case 31:
+        return VectorOriginOfKind;
+      case 32:
+        return VectorFrameMultiplicationKind;
+      case 33:
+        return VectorRotationMultiplicationKind;
+      case 34:
+        return VectorDoubleMultiplicationKind;
+      case 35:
+        return VectorRotationVectorKind;
+      case 36:
+        return VectorCrossKind;
+      case 37:
+        return RotationQuaternionConstructorKind;
+      case 38:
+        return AxisAngleKind;
+      case 39:
+        return SlerpKind;
+      case 40:
+        return RotationReferenceKind;
+      case 41:
+        return InverseRotationKind;
+      case 42:
+        return RotationMultiplicationKind;
+      case 43:
+        return RotationCachedKind;
+      case 44:
+        return FrameCachedKind;
+      case 45:
+        return FrameConstructorKind;
+      case 46:
+        return OrientationOfKind;
+      case 47:
+        return FrameMultiplicationKind;
+      case 48:
+        return FrameReferenceKind;
+      case 49:
+        return InverseFrameKind;
+      default:
+        throw std::runtime_error("Binary spec contains unknown tag " + std::to_string(tag) + ".");
+    }
+  }
+
+  /**
+   * Binary format of controller specs, for specs that get loaded often, e.g.
+   * at every controller start. A file consists of this header, followed by
+   * these sections:
+   *
+   * - values: the doubles of all constants and quaternions
+   * - nodes: six integers per spec node, i.e. its tag, its first child, its
+   *   number of children, its first value, its number of values, and its
+   *   attribute, which is the input number of inputs and the string of
+   *   references
+   * - children: node indices
+   * - string offsets: one per string, plus the end of the last string
+   * - scope entries: name and spec
+   * - controllable constraints: lower, upper, weight, input number, and name
+   * - soft constraints: expression, lower, upper, weight, and name
+   * - hard constraints: expression, lower, and upper
+   * - string data
+   *
+   * All integers are 32 bits wide and in host byte order. Nodes come after
+   * their children, and a node shared by several parents is stored once, as
+   * is every string. Every spec is required; none() is no valid index.
+   */
+  class BinarySpecHeader
+  {
+    public:
+      char magic_[4];
+      std::uint32_t version_, num_values_, num_nodes_, num_children_, num_strings_, num_string_bytes_,
+          num_scope_entries_, num_controllables_, num_soft_constraints_, num_hard_constraints_, reserved_;
+
+      static const char* magic()
+      {
+        return "GSPC";
+      }
+
+      static std::uint32_t version()
+      {
+        return 1;
+      }
+
+      static std::uint32_t none()
+      {
+        return std::numeric_limits<std::uint32_t>::max();
+      }
+
+      static const size_t node_size = 6;
+      static const size_t controllable_size = 5;
+      static const size_t soft_constraint_size = 5;
+      static const size_t hard_constraint_size = 3;
+  };
+
+  static_assert(sizeof(BinarySpecHeader) % sizeof(double) == 0, "Values of binary specs need to be aligned.");
+
+  class BinarySpecWriter
+  {
+    public:
+      std::string write(const QPControllerSpec& spec)
+      {
+        clear();
+
+        for (auto const & entry: spec.scope_)
+          scope_entries_.insert(scope_entries_.end(), {add_string(entry.name), add_node(entry.spec)});
+        for (auto const & constraint: spec.controllable_constraints_)
+          controllables_.insert(controllables_.end(), {add_node(constraint.lower_), add_node(constraint.upper_),
+              add_node(constraint.weight_), to_index(constraint.input_number_), add_string(constraint.name_)});
+        for (auto const & constraint: spec.soft_constraints_)
+          soft_constraints_.insert(soft_constraints_.end(), {add_node(constraint.expression_),
+              add_node(constraint.lower_), add_node(constraint.upper_), add_node(constraint.weight_),
+              add_string(constraint.name_)});
+        for (auto const & constraint: spec.hard_constraints_)
+          hard_constraints_.insert(hard_constraints_.end(), {add_node(constraint.expression_),
+              add_node(constraint.lower_), add_node(constraint.upper_)});
+        string_offsets_.push_back(to_index(strings_.size()));
+
+        BinarySpecHeader header;
+        std::memcpy(header.magic_, BinarySpecHeader::magic(), sizeof(header.magic_));
+        header.version_ = BinarySpecHeader::version();
+        header.num_values_ = to_index(values_.size());
+        header.num_nodes_ = to_index(nodes_.size() / BinarySpecHeader::node_size);
+        header.num_children_ = to_index(children_.size());
+        header.num_strings_ = to_index(string_offsets_.size() - 1);
+        header.num_string_bytes_ = to_index(strings_.size());
+        header.num_scope_entries_ = to_index(spec.scope_.size());
+        header.num_controllables_ = to_index(spec.controllable_constraints_.size());
+        header.num_soft_constraints_ = to_index(spec.soft_constraints_.size());
+        header.num_hard_constraints_ = to_index(spec.hard_constraints_.size());
+        header.reserved_ = 0;
+
+        std::string result(reinterpret_cast<const char*>(&header), sizeof(header));
+        append(result, values_);
+        for (auto section: {&nodes_, &children_, &string_offsets_, &scope_entries_, &controllables_,
+            &soft_constraints_, &hard_constraints_})
+          append(result, *section);
+        result += strings_;
+        return result;
+      }
+
+    private:
+      std::unordered_map<const Spec*, std::uint32_t> node_indices_;
+      std::unordered_map<std::string, std::uint32_t> string_indices_;
+      std::vector<double> values_;
+      std::vector<std::uint32_t> nodes_, children_, string_offsets_, scope_entries_, controllables_,
+          soft_constraints_, hard_constraints_;
+      std::string strings_;
+
+      void clear()
+      {
+        node_indices_.clear();
+        string_indices_.clear();
+        values_.clear();
+        for (auto section: {&nodes_, &children_, &string_offsets_, &scope_entries_, &controllables_,
+            &soft_constraints_, &hard_constraints_})
+          section->clear();
+        strings_.clear();
+      }
+
+      static std::uint32_t to_index(size_t value)
+      {
+        if (value >= BinarySpecHeader::none())
+          throw std::length_error("Spec is too large for the binary format.");
+        return static_cast<std::uint32_t>(value);
+      }
+
+      template<typename T>
+      static void append(std::string& data, const std::vector<T>& section)
+      {
+        data.append(reinterpret_cast<const char*>(section.data()), section.size() * sizeof(T));
+      }
+
+      std::uint32_t add_string(const std::string& s)
+      {
+        std::unordered_map<std::string, std::uint32_t>::const_iterator it = string_indices_.find(s);
+        if (it != string_indices_.end())
+          return it->second;
+
+        std::uint32_t index = to_index(string_offsets_.size());
+        string_offsets_.push_back(to_index(strings_.size()));
+        strings_ += s;
+        string_indices_[s] = index;
+        return index;
+      }
+
+      // adds spec after its children, unless it is there already; returns its index
+      std::uint32_t add_node(const SpecPtr& spec)
+      {
+        if (!spec)
+          throw std::invalid_argument("Cannot write a missing spec to the binary format.");
+
+        std::unordered_map<const Spec*, std::uint32_t>::const_iterator it = node_indices_.find(spec.get());
+        if (it != node_indices_.end())
+          return it->second;
+
+        std::vector<std::uint32_t> children;
+        for (auto const & child: spec->get_children())
+          children.push_back(add_node(child));
+
+        size_t first_value = values_.size();
+        std::uint32_t attribute = 0;
+        std::string name;
+        if (spec->get_kind() == DoubleConstKind)
+          values_.push_back(boost::static_pointer_cast<DoubleConstSpec>(spec)->get_value());
+        else if (spec->get_kind() == RotationQuaternionConstructorKind)
+        {
+          RotationQuaternionConstructorSpecPtr quaternion =
+            boost::static_pointer_cast<RotationQuaternionConstructorSpec>(spec);
+          values_.insert(values_.end(), {quaternion->get_x(), quaternion->get_y(), quaternion->get_z(),
+              quaternion->get_w()});
+        }
+        else if (spec->get_kind() == DoubleInputKind)
+          attribute = to_index(boost::static_pointer_cast<DoubleInputSpec>(spec)->get_input_num());
+        else if (get_reference_name(spec, name))
+          attribute = add_string(name);
+
+        std::uint32_t index = to_index(nodes_.size() / BinarySpecHeader::node_size);
+        nodes_.insert(nodes_.end(), {get_binary_tag(spec->get_kind()), to_index(children_.size()),
+            to_index(children.size()), to_index(first_value), to_index(values_.size() - first_value), attribute});
+        children_.insert(children_.end(), children.begin(), children.end());
+        node_indices_[spec.get()] = index;
+        return index;
+      }
+  };
+
+  /**
+   * Reads specs in the binary format from memory that stays valid while
+   * reading, e.g. a mapped file. Checks every size and index, and throws
+   * std::runtime_error for data that is not a valid binary spec.
+   */
+  class BinarySpecReader
+  {
+    public:
+      BinarySpecReader(const char* data, size_t size) :
+        data_( data ), size_( size )
+      {
+        if (!is_binary_spec(data, size))
+          throw std::runtime_error("Data is no binary spec.");
+
+        std::memcpy(&header_, data, sizeof(header_));
+        if (header_.version_ != BinarySpecHeader::version())
+          throw std::runtime_error("Binary spec has version " + std::to_string(header_.version_) +
+              ", but only version " + std::to_string(BinarySpecHeader::version()) + " is supported.");
+
+        std::uint64_t offset = sizeof(header_);
+        values_offset_ = offset;
+        offset += std::uint64_t(header_.num_values_) * sizeof(double);
+        nodes_offset_ = offset;
+        offset += std::uint64_t(header_.num_nodes_) * BinarySpecHeader::node_size * sizeof(std::uint32_t);
+        children_offset_ = offset;
+        offset += std::uint64_t(header_.num_children_) * sizeof(std::uint32_t);
+        string_offsets_offset_ = offset;
+        offset += (std::uint64_t(header_.num_strings_) + 1) * sizeof(std::uint32_t);
+        scope_offset_ = offset;
+        offset += std::uint64_t(header_.num_scope_entries_) * 2 * sizeof(std::uint32_t);
+        controllables_offset_ = offset;
+        offset += std::uint64_t(header_.num_controllables_) * BinarySpecHeader::controllable_size * sizeof(std::uint32_t);
+        soft_offset_ = offset;
+        offset += std::uint64_t(header_.num_soft_constraints_) * BinarySpecHeader::soft_constraint_size * sizeof(std::uint32_t);
+        hard_offset_ = offset;
+        offset += std::uint64_t(header_.num_hard_constraints_) * BinarySpecHeader::hard_constraint_size * sizeof(std::uint32_t);
+        strings_offset_ = offset;
+        offset += header_.num_string_bytes_;
+
+        if (offset != size)
+          throw std::runtime_error("Binary spec should have " + std::to_string(offset) + " bytes, but has " +
+              std::to_string(size) + ".");
+      }
+
+      QPControllerSpec read()
+      {
+        read_strings();
+        read_nodes();
+
+        QPControllerSpec result;
+        for (size_t i=0; i<header_.num_scope_entries_; ++i)
+          result.scope_.push_back(ScopeEntry(get_string(get_index(scope_offset_, 2*i)),
+                get_node(get_index(scope_offset_, 2*i + 1))));
+
+        for (size_t i=0; i<header_.num_controllables_; ++i)
+        {
+          size_t first = BinarySpecHeader::controllable_size * i;
+          ControllableConstraintSpec constraint;
+          constraint.lower_ = get_double(get_index(controllables_offset_, first));
+          constraint.upper_ = get_double(get_index(controllables_offset_, first + 1));
+          constraint.weight_ = get_double(get_index(controllables_offset_, first + 2));
+          constraint.input_number_ = get_index(controllables_offset_, first + 3);
+          constraint.name_ = get_string(get_index(controllables_offset_, first + 4));
+          result.controllable_constraints_.push_back(constraint);
+        }
+
+        for (size_t i=0; i<header_.num_soft_constraints_; ++i)
+        {
+          size_t first = BinarySpecHeader::soft_constraint_size * i;
+          SoftConstraintSpec constraint;
+          constraint.expression_ = get_double(get_index(soft_offset_, first));
+          constraint.lower_ = get_double(get_index(soft_offset_, first + 1));
+          constraint.upper_ = get_double(get_index(soft_offset_, first + 2));
+          constraint.weight_ = get_double(get_index(soft_offset_, first + 3));
+          constraint.name_ = get_string(get_index(soft_offset_, first + 4));
+          result.soft_constraints_.push_back(constraint);
+        }
+
+        for (size_t i=0; i<header_.num_hard_constraints_; ++i)
+        {
+          size_t first = BinarySpecHeader::hard_constraint_size * i;
+          HardConstraintSpec constraint;
+          constraint.expression_ = get_double(get_index(hard_offset_, first));
+          constraint.lower_ = get_double(get_index(hard_offset_, first + 1));
+          constraint.upper_ = get_double(get_index(hard_offset_, first + 2));
+          result.hard_constraints_.push_back(constraint);
+        }
+
+        return result;
+      }
+
+      static bool is_binary_spec(const char* data, size_t size)
+      {
+        return size >= sizeof(BinarySpecHeader) &&
+            std::memcmp(data, BinarySpecHeader::magic(), sizeof(BinarySpecHeader::magic_)) == 0;
+      }
+
+    private:
+      const char* data_;
+      size_t size_;
+      BinarySpecHeader header_;
+      size_t values_offset_, nodes_offset_, children_offset_, string_offsets_offset_, scope_offset_,
+          controllables_offset_, soft_offset_, hard_offset_, strings_offset_;
+      std::vector<std::string> strings_;
+      std::vector<SpecPtr> nodes_;
+
+      template<typename T>
+      T get(size_t offset) const
+      {
+        T result;
+        std::memcpy(&result, data_ + offset, sizeof(T));
+        return result;
+      }
+
+      std::uint32_t get_index(size_t section_offset, size_t i) const
+      {
+        return get<std::uint32_t>(section_offset + i * sizeof(std::uint32_t));
+      }
+
+      const std::string& get_string(std::uint32_t index) const
+      {
+        if (index >= strings_.size())
+          throw std::runtime_error("Binary spec refers to string " + std::to_string(index) + ", but has only " +
+              std::to_string(strings_.size()) + ".");
+        return strings_[index];
+      }
+
+      SpecPtr get_node(std::uint32_t index) const
+      {
+        if (index == BinarySpecHeader::none())
+          throw std::runtime_error("Binary spec refers to a missing node.");
+        if (index >= nodes_.size())
+          throw std::runtime_error("Binary spec refers to node " + std::to_string(index) +
+              ", which is not stored before.");
+        return nodes_[index];
+      }
+
+      DoubleSpecPtr get_double(std::uint32_t index) const
+      {
+        SpecPtr node = get_node(index);
+        DoubleSpecPtr result = boost::dynamic_pointer_cast<DoubleSpec>(node);
+        if (!result)
+          throw std::runtime_error("Binary spec has a constraint that is no double spec.");
+        return result;
+      }
+
+      void read_strings()
+      {
+        strings_.clear();
+        std::uint32_t begin = get_index(string_offsets_offset_, 0);
+        for (size_t i=0; i<header_.num_strings_; ++i)
+        {
+          std::uint32_t end = get_index(string_offsets_offset_, i + 1);
+          if (begin > end || end > header_.num_string_bytes_)
+            throw std::runtime_error("Binary spec has an invalid string offset.");
+          strings_.push_back(std::string(data_ + strings_offset_ + begin, end - begin));
+          begin = end;
+        }
+      }
+
+      void read_nodes()
+      {
+        nodes_.clear();
+        nodes_.reserve(header_.num_nodes_);
+        for (size_t i=0; i<header_.num_nodes_; ++i)
+        {
+          SpecKind kind = get_binary_kind(get_index(nodes_offset_, BinarySpecHeader::node_size * i));
+          std::uint32_t first_child = get_index(nodes_offset_, BinarySpecHeader::node_size * i + 1);
+          std::uint32_t num_children = get_index(nodes_offset_, BinarySpecHeader::node_size * i + 2);
+          std::uint32_t first_value = get_index(nodes_offset_, BinarySpecHeader::node_size * i + 3);
+          std::uint32_t num_values = get_index(nodes_offset_, BinarySpecHeader::node_size * i + 4);
+          std::uint32_t attribute = get_index(nodes_offset_, BinarySpecHeader::node_size * i + 5);
+
+          if (std::uint64_t(first_child) + num_children > header_.num_children_ ||
+              std::uint64_t(first_value) + num_values > header_.num_values_)
+            throw std::runtime_error("Binary spec node " + std::to_string(i) + " is out of bounds.");
+
+          std::vector<double> values;
+          for (size_t j=0; j<num_values; ++j)
+            values.push_back(get<double>(values_offset_ + (first_value + j) * sizeof(double)));
+
+          // children come first, so a valid file cannot contain cycles
+          std::vector<SpecPtr> children;
+          for (size_t j=0; j<num_children; ++j)
+          {
+            std::uint32_t child = get_index(children_offset_, first_child + j);
+            if (child >= i)
+              throw std::runtime_error("Binary spec node " + std::to_string(i) + " has child " +
+                  std::to_string(child) + ", which is not stored before.");
+            children.push_back(get_node(child));
+          }
+
+          try
+          {
+            nodes_.push_back(read_node(kind, values, attribute, children));
+          }
+          catch (const std::logic_error& e)
+          {
+            throw std::runtime_error("Binary spec node " + std::to_string(i) + " is invalid: " + e.what());
+          }
+        }
+      }
+
+      SpecPtr read_node(SpecKind kind, const std::vector<double>& values, std::uint32_t attribute,
+          const std::vector<SpecPtr>& children) const
+      {
+        SpecPtr spec = create_spec(kind);
+        switch (spec->get_kind())
+        {
+          case DoubleConstKind:
+            check_num_values(values, 1);
+            boost::static_pointer_cast<DoubleConstSpec>(spec)->set_value(values[0]);
+            break;
+          case RotationQuaternionConstructorKind:
+          {
+            check_num_values(values, 4);
+            RotationQuaternionConstructorSpecPtr quaternion =
+              boost::static_pointer_cast<RotationQuaternionConstructorSpec>(spec);
+            quaternion->set_x(values[0]);
+            quaternion->set_y(values[1]);
+            quaternion->set_z(values[2]);
+            quaternion->set_w(values[3]);
+            break;
+          }
+          case DoubleInputKind:
+            boost::static_pointer_cast<DoubleInputSpec>(spec)->set_input_num(attribute);
+            break;
+          case AliasReferenceKind:
+            boost::static_pointer_cast<AliasReferenceSpec>(spec)->set_reference_name(get_string(attribute));
+            break;
+          case DoubleReferenceKind:
+            boost::static_pointer_cast<DoubleReferenceSpec>(spec)->set_reference_name(get_string(attribute));
+            break;
+          case VectorReferenceKind:
+            boost::static_pointer_cast<VectorReferenceSpec>(spec)->set_reference_name(get_string(attribute));
+            break;
+          case RotationReferenceKind:
+            boost::static_pointer_cast<RotationReferenceSpec>(spec)->set_reference_name(get_string(attribute));
+            break;
+          case FrameReferenceKind:
+            boost::static_pointer_cast<FrameReferenceSpec>(spec)->set_reference_name(get_string(attribute));
+            break;
+          default:
+            check_num_values(values, 0);
+        }
+        spec->set_children(children);
+
+        return spec;
+      }
+
+      static void check_num_values(const std::vector<double>& values, size_t expected)
+      {
+        if (values.size() != expected)
+          throw std::length_error("Expected " + std::to_string(expected) + " values of spec, but got " +
+              std::to_string(values.size()) + ".");
+      }
+  };
+
+  // Read-only memory mapping of a whole file, unmapped on destruction.
+  class MappedFile
+  {
+    public:
+      MappedFile(const std::string& filename) :
+        data_( 0 ), size_( 0 )
+      {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+          throw std::runtime_error("Could not open file '" + filename + "': " + std::strerror(errno));
+
+        struct stat status;
+        if (::fstat(fd, &status) != 0)
+        {
+          ::close(fd);
+          throw std::runtime_error("Could not read size of file '" + filename + "'.");
+        }
+
+        size_ = static_cast<size_t>(status.st_size);
+        if (size_ > 0)
+        {
+          void* data = ::mmap(0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+          if (data == MAP_FAILED)
+          {
+            ::close(fd);
+            throw std::runtime_error("Could not map file '" + filename + "': " + std::strerror(errno));
+          }
+          data_ = static_cast<const char*>(data);
+        }
+        ::close(fd);
+      }
+
+      ~MappedFile()
+      {
+        if (data_)
+          ::munmap(const_cast<char*>(data_), size_);
+      }
+
+      const char* data() const
+      {
+        return data_;
+      }
+
+      size_t size() const
+      {
+        return size_;
+      }
+
+    private:
+      const char* data_;
+      size_t size_;
+
+      MappedFile(const MappedFile& other);
+      MappedFile& operator=(const MappedFile& other);
+  };
+
+  inline std::string write_binary_spec(const QPControllerSpec& spec)
+  {
+    return BinarySpecWriter().write(spec);
+  }
+
+  inline QPControllerSpec read_binary_spec(const char* data, size_t size)
+  {
+    return BinarySpecReader(data, size).read();
+  }
+
+  inline bool is_binary_spec(const char* data, size_t size)
+  {
+    return BinarySpecReader::is_binary_spec(data, size);
+  }
+
+  inline void save_binary_spec(const QPControllerSpec& spec, const std::string& filename)
+  {
+    std::string data = write_binary_spec(spec);
+    std::ofstream file(filename.c_str(), std::ios::binary);
+    if (!file.write(data.data(), data.size()))
+      throw std::runtime_error("Could not write binary spec to file '" + filename + "'.");
+  }
+
+  /**
+   * Loads a binary spec by mapping its file into memory, i.e. without reading
+   * or parsing it first. The specs get created with make_spec(), and go to
+   * the current SpecArena if there is one.
+   */
+  inline QPControllerSpec load_binary_spec(const std::string& filename)
+  {
+    MappedFile file(filename);
+    return read_binary_spec(file.data(), file.size());
+  }
+}
+
+#endif // GISKARD_CORE_SPEC_BINARY_HPP
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_CORE_SPEC_COST_HPP
+#define GISKARD_CORE_SPEC_COST_HPP
+
+#include <giskard_core/specifications.hpp>
+#include <algorithm>
+
+namespace giskard_core
+{
+  /**
+   * Rough cost of evaluating one spec node once: floating-point operations
+   * for its value, and for one partial derivative. Transcendental functions
+   * count as ten operations. Meant to compare specs with each other, not to
+   * predict absolute run-times.
+   */
+  class SpecCost
+  {
+    public:
+      SpecCost(double value_flops = 0.0, double derivative_flops = 0.0) :
+        value_flops_( value_flops ), derivative_flops_( derivative_flops ) {}
+
+      double value_flops_, derivative_flops_;
+  };
+
+  inline SpecCost get_cost(const SpecPtr& spec)
+  {
+    // number of binary operations of n-ary specs
+    double n = std::max(spec->get_children().size(), size_t(1)) - 1.0;
+
+    switch (spec->get_kind())
+    {
+      case DoubleAdditionKind:
+      case DoubleSubtractionKind:
+        return SpecCost(std::max(n, 1.0), std::max(n, 1.0));
+      case DoubleMultiplicationKind:
+        return SpecCost(n, 3.0 * n);
+      case DoubleDivisionKind:
+        return SpecCost(std::max(n, 1.0), 5.0 * std::max(n, 1.0));
+      case DoubleNormOfKind:
+        return SpecCost(15.0, 7.0);
+      case VectorDotKind:
+        return SpecCost(5.0, 10.0);
+      case MinKind:
+      case MaxKind:
+      case AbsKind:
+      case DoubleIfKind:
+      case FmodKind:
+        return SpecCost(1.0, 0.0);
+      case SinKind:
+      case CosKind:
+      case TanKind:
+      case ASinKind:
+      case ACosKind:
+      case ATanKind:
+      case SqrtKind:
+        return SpecCost(10.0, 12.0);
+      case VectorAdditionKind:
+      case VectorSubtractionKind:
+        return SpecCost(3.0 * std::max(n, 1.0), 3.0 * std::max(n, 1.0));
+      case VectorFrameMultiplicationKind:
+        return SpecCost(18.0, 33.0);
+      case VectorRotationMultiplicationKind:
+        return SpecCost(15.0, 30.0);
+      case VectorDoubleMultiplicationKind:
+        return SpecCost(3.0, 9.0);
+      case VectorRotationVectorKind:
+        return SpecCost(40.0, 40.0);
+      case VectorCrossKind:
+        return SpecCost(9.0, 18.0);
+      case AxisAngleKind:
+        return SpecCost(40.0, 20.0);
+      case SlerpKind:
+        return SpecCost(100.0, 50.0);
+      case InverseRotationKind:
+        return SpecCost(0.0, 9.0);
+      case RotationMultiplicationKind:
+        return SpecCost(45.0 * n, 30.0 * n);
+      case FrameMultiplicationKind:
+        return SpecCost(63.0 * n, 54.0 * n);
+      case InverseFrameKind:
+        return SpecCost(15.0, 30.0);
+      default:
+        // constants, inputs, references, caches, constructors, and accessors
+        return SpecCost();
+    }
+  }
+}
+
+#endif // GISKARD_CORE_SPEC_COST_HPP
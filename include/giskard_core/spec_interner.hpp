@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_CORE_SPEC_INTERNER_HPP
+#define GISKARD_CORE_SPEC_INTERNER_HPP
+
+#include <giskard_core/specifications.hpp>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace giskard_core
+{
+  /**
+   * Hash-consing of specs: intern() returns one canonical node for every
+   * group of equal specs it has seen, so that equal subtrees become the
+   * same node. Interning works bottom-up and replaces the children of the
+   * interned nodes by their canonical versions.
+   *
+   * Generation memoizes per node, so an interned spec also generates one
+   * shared expression per distinct subtree.
+   *
+   * Constants are only merged if their values are identical. Spec::hash()
+   * leaves them out, so the table keys on their exact bits instead.
+   *
+   * NOTE: Canonical nodes are shared afterwards. Modifying one of them
+   *       through its setters modifies all places that use it.
+   */
+  class SpecInterner
+  {
+    public:
+      SpecInterner() : num_hits_(0) {}
+
+      SpecPtr intern(const SpecPtr& spec)
+      {
+        if (!spec)
+          return spec;
+
+        // replacing children by equal ones keeps all hashes
+        Spec::HashPass pass;
+        Interned::const_iterator done = interned_.find(spec.get());
+        if (done != interned_.end())
+          return done->second.second;
+
+        std::vector<SpecPtr> children = spec->get_children();
+        bool changed = false;
+        for (auto & child: children)
+        {
+          SpecPtr canonical = intern(child);
+          changed = changed || (canonical != child);
+          child = canonical;
+        }
+        if (changed)
+          spec->replace_equal_children(children);
+
+        SpecPtr result = spec;
+        std::vector<SpecPtr>& bucket = table_[get_key(spec)];
+        for (auto const & candidate: bucket)
+          if (candidate->equals(*spec))
+          {
+            result = candidate;
+            ++num_hits_;
+            break;
+          }
+        if (result == spec)
+          bucket.push_back(spec);
+
+        interned_[spec.get()] = std::make_pair(spec, result);
+        return result;
+      }
+
+      template<typename T>
+      boost::shared_ptr<T> intern(const boost::shared_ptr<T>& spec)
+      {
+        return boost::dynamic_pointer_cast<T>(intern(SpecPtr(spec)));
+      }
+
+      void intern(QPControllerSpec& spec)
+      {
+        Spec::HashPass pass;
+        for (auto & entry: spec.scope_)
+          entry.spec = intern(entry.spec);
+
+        for (auto & constraint: spec.controllable_constraints_)
+        {
+          constraint.lower_ = intern(constraint.lower_);
+          constraint.upper_ = intern(constraint.upper_);
+          constraint.weight_ = intern(constraint.weight_);
+        }
+
+        for (auto & constraint: spec.soft_constraints_)
+        {
+          constraint.expression_ = intern(constraint.expression_);
+          constraint.lower_ = intern(constraint.lower_);
+          constraint.upper_ = intern(constraint.upper_);
+          constraint.weight_ = intern(constraint.weight_);
+        }
+
+        for (auto & constraint: spec.hard_constraints_)
+        {
+          constraint.expression_ = intern(constraint.expression_);
+          constraint.lower_ = intern(constraint.lower_);
+          constraint.upper_ = intern(constraint.upper_);
+        }
+      }
+
+      // number of distinct specs
+      size_t size() const
+      {
+        size_t result = 0;
+        for (auto const & bucket: table_)
+          result += bucket.second.size();
+        return result;
+      }
+
+      // number of specs that were replaced by an equal canonical one
+      size_t num_hits() const
+      {
+        return num_hits_;
+      }
+
+      void clear()
+      {
+        table_.clear();
+        interned_.clear();
+        num_hits_ = 0;
+      }
+
+    private:
+      // every spec seen so far, and its canonical node; holding on to the
+      // spec keeps its address from being reused by a new spec
+      typedef std::unordered_map<const Spec*, std::pair<SpecPtr, SpecPtr> > Interned;
+
+      std::unordered_map<HashValue, std::vector<SpecPtr> > table_;
+      Interned interned_;
+      size_t num_hits_;
+
+      // Structural hash, plus the exact values of the constants of spec and
+      // the addresses of its children, which are canonical already. Keeps
+      // buckets small where all constants share one structural hash.
+      static HashValue get_key(const SpecPtr& spec)
+      {
+        HashValue result = spec->hash();
+        switch (spec->get_kind())
+        {
+          case DoubleConstKind:
+            hash_combine(result, hash_value(static_cast<const DoubleConstSpec&>(*spec).get_value()));
+            break;
+          case RotationQuaternionConstructorKind:
+          {
+            const RotationQuaternionConstructorSpec& quaternion =
+              static_cast<const RotationQuaternionConstructorSpec&>(*spec);
+            for (double value: {quaternion.get_x(), quaternion.get_y(), quaternion.get_z(), quaternion.get_w()})
+              hash_combine(result, hash_value(value));
+            break;
+          }
+          default:
+            break;
+        }
+
+        for (auto const & child: spec->get_children())
+          hash_combine(result, hash_value(static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(child.get()))));
+        return result;
+      }
+  };
+}
+
+#endif // GISKARD_CORE_SPEC_INTERNER_HPP
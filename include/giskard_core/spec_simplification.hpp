@@ -0,0 +1,549 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_CORE_SPEC_SIMPLIFICATION_HPP
+#define GISKARD_CORE_SPEC_SIMPLIFICATION_HPP
+
+#include <giskard_core/specifications.hpp>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace giskard_core
+{
+  /**
+   * Constant folding and algebraic simplification of specs. Every node
+   * whose children are all constant becomes a constant, and additions,
+   * subtractions, multiplications, divisions, conditionals, and chains of
+   * rotation and frame multiplications drop their neutral elements and fuse
+   * their constant inputs.
+   *
+   * Simplification works bottom-up and never modifies the given specs. New
+   * nodes are only created where something changed; all other nodes are
+   * shared with the input. References into the scope are left as they are,
+   * and so are cached specs.
+   */
+  class SpecSimplifier
+  {
+    public:
+      SpecSimplifier() : num_simplifications_(0) {}
+
+      SpecPtr simplify(const SpecPtr& spec)
+      {
+        if (!spec)
+          return spec;
+
+        Simplified::const_iterator done = simplified_.find(spec.get());
+        if (done != simplified_.end())
+          return done->second.second;
+
+        std::vector<SpecPtr> children = spec->get_children();
+        bool changed = false;
+        for (auto & child: children)
+        {
+          SpecPtr simplified = simplify(child);
+          changed = changed || (simplified != child);
+          child = simplified;
+        }
+
+        SpecPtr result = spec;
+        if (changed)
+        {
+          result = spec->clone();
+          result->set_children(children);
+        }
+
+        SpecPtr rewritten = rewrite(result);
+        if (rewritten != result)
+          ++num_simplifications_;
+
+        simplified_[spec.get()] = std::make_pair(spec, rewritten);
+        return rewritten;
+      }
+
+      template<typename T>
+      boost::shared_ptr<T> simplify(const boost::shared_ptr<T>& spec)
+      {
+        return boost::dynamic_pointer_cast<T>(simplify(SpecPtr(spec)));
+      }
+
+      QPControllerSpec simplify(const QPControllerSpec& spec)
+      {
+        QPControllerSpec result = spec;
+
+        for (auto & entry: result.scope_)
+          entry.spec = simplify(entry.spec);
+
+        for (auto & constraint: result.controllable_constraints_)
+        {
+          constraint.lower_ = simplify(constraint.lower_);
+          constraint.upper_ = simplify(constraint.upper_);
+          constraint.weight_ = simplify(constraint.weight_);
+        }
+
+        for (auto & constraint: result.soft_constraints_)
+        {
+          constraint.expression_ = simplify(constraint.expression_);
+          constraint.lower_ = simplify(constraint.lower_);
+          constraint.upper_ = simplify(constraint.upper_);
+          constraint.weight_ = simplify(constraint.weight_);
+        }
+
+        for (auto & constraint: result.hard_constraints_)
+        {
+          constraint.expression_ = simplify(constraint.expression_);
+          constraint.lower_ = simplify(constraint.lower_);
+          constraint.upper_ = simplify(constraint.upper_);
+        }
+
+        return result;
+      }
+
+      // number of nodes that got replaced by a simpler one
+      size_t num_simplifications() const
+      {
+        return num_simplifications_;
+      }
+
+      void clear()
+      {
+        simplified_.clear();
+        num_simplifications_ = 0;
+      }
+
+    private:
+      // every spec seen so far, and its simplified version; holding on to the
+      // spec keeps its address from being reused by a new spec
+      typedef std::unordered_map<const Spec*, std::pair<SpecPtr, SpecPtr> > Simplified;
+
+      Simplified simplified_;
+      size_t num_simplifications_;
+
+      // evaluates a spec whose children are all constant into a constant spec
+      class Folder : public SpecVisitor
+      {
+        public:
+          using SpecVisitor::visit;
+
+          virtual void visit(DoubleSpec& spec)
+          {
+            result_ = make_constant(spec.get_expression(Scope())->value());
+          }
+
+          virtual void visit(VectorSpec& spec)
+          {
+            result_ = make_constant(spec.get_expression(Scope())->value());
+          }
+
+          virtual void visit(RotationSpec& spec)
+          {
+            result_ = make_constant(spec.get_expression(Scope())->value());
+          }
+
+          virtual void visit(FrameSpec& spec)
+          {
+            result_ = make_constant(spec.get_expression(Scope())->value());
+          }
+
+          const SpecPtr& get_result() const
+          {
+            return result_;
+          }
+
+        private:
+          SpecPtr result_;
+      };
+
+      // spec has already got simplified children
+      static SpecPtr rewrite(const SpecPtr& spec)
+      {
+        if (is_constant(spec) || spec->get_children().empty())
+          return spec;
+
+        switch (spec->get_kind())
+        {
+          case DoubleCachedKind:
+          case VectorCachedKind:
+          case RotationCachedKind:
+          case FrameCachedKind:
+            return spec;
+          case DoubleAdditionKind:
+            return rewrite_addition(boost::static_pointer_cast<DoubleAdditionSpec>(spec));
+          case DoubleSubtractionKind:
+            return rewrite_subtraction(boost::static_pointer_cast<DoubleSubtractionSpec>(spec));
+          case DoubleMultiplicationKind:
+            return rewrite_multiplication(boost::static_pointer_cast<DoubleMultiplicationSpec>(spec));
+          case DoubleDivisionKind:
+            return rewrite_division(boost::static_pointer_cast<DoubleDivisionSpec>(spec));
+          case DoubleIfKind:
+            return rewrite_if(boost::static_pointer_cast<DoubleIfSpec>(spec));
+          case VectorAdditionKind:
+            return rewrite_addition(boost::static_pointer_cast<VectorAdditionSpec>(spec));
+          case VectorDoubleMultiplicationKind:
+            return rewrite_scaling(boost::static_pointer_cast<VectorDoubleMultiplicationSpec>(spec));
+          case VectorRotationMultiplicationKind:
+            return rewrite_rotation(boost::static_pointer_cast<VectorRotationMultiplicationSpec>(spec));
+          case VectorFrameMultiplicationKind:
+            return rewrite_transformation(boost::static_pointer_cast<VectorFrameMultiplicationSpec>(spec));
+          case RotationMultiplicationKind:
+            return rewrite_chain(boost::static_pointer_cast<RotationMultiplicationSpec>(spec));
+          case FrameMultiplicationKind:
+            return rewrite_chain(boost::static_pointer_cast<FrameMultiplicationSpec>(spec));
+          default:
+            break;
+        }
+
+        for (auto const & child: spec->get_children())
+          if (!is_constant(child))
+            return spec;
+
+        return fold(spec);
+      }
+
+      ///
+      /// constants
+      ///
+
+      static bool is_constant(const SpecPtr& spec)
+      {
+        if (!spec)
+          return false;
+
+        switch (spec->get_kind())
+        {
+          case DoubleConstKind:
+          case RotationQuaternionConstructorKind:
+            return true;
+          case VectorConstructorKind:
+          case FrameConstructorKind:
+            for (auto const & child: spec->get_children())
+              if (!is_constant(child))
+                return false;
+            return true;
+          default:
+            return false;
+        }
+      }
+
+      // evaluates spec, all its children have to be constant
+      static SpecPtr fold(const SpecPtr& spec)
+      {
+        Folder folder;
+        spec->accept(folder);
+        return folder.get_result() ? folder.get_result() : spec;
+      }
+
+      template<typename T, typename SpecType>
+      static T get_value(const boost::shared_ptr<SpecType>& spec)
+      {
+        return spec->get_expression(Scope())->value();
+      }
+
+      static DoubleSpecPtr make_constant(double value)
+      {
+        return double_const_spec(value);
+      }
+
+      static VectorSpecPtr make_constant(const KDL::Vector& value)
+      {
+        return vector_constructor_spec(double_const_spec(value.x()), double_const_spec(value.y()),
+            double_const_spec(value.z()));
+      }
+
+      static RotationSpecPtr make_constant(const KDL::Rotation& value)
+      {
+        double x, y, z, w;
+        value.GetQuaternion(x, y, z, w);
+        return quaternion_spec(x, y, z, w);
+      }
+
+      static FrameSpecPtr make_constant(const KDL::Frame& value)
+      {
+        return frame_constructor_spec(make_constant(value.p), make_constant(value.M));
+      }
+
+      // exact comparisons like for doubles, anything else changes the value
+      static bool is_identity(const KDL::Vector& value)
+      {
+        return value.x() == 0.0 && value.y() == 0.0 && value.z() == 0.0;
+      }
+
+      static bool is_identity(const KDL::Rotation& value)
+      {
+        for (int i=0; i<3; ++i)
+          for (int j=0; j<3; ++j)
+            if (value(i, j) != ((i == j) ? 1.0 : 0.0))
+              return false;
+        return true;
+      }
+
+      static bool is_identity(const KDL::Frame& value)
+      {
+        return is_identity(value.p) && is_identity(value.M);
+      }
+
+      ///
+      /// rewrite rules
+      ///
+
+      static SpecPtr rewrite_addition(const DoubleAdditionSpecPtr& spec)
+      {
+        double sum = 0.0;
+        std::vector<DoubleSpecPtr> inputs;
+        for (auto const & input: spec->get_inputs())
+          if (is_constant(input))
+            sum += get_value<double>(input);
+          else
+            inputs.push_back(input);
+
+        if (sum != 0.0 || inputs.empty())
+          inputs.push_back(make_constant(sum));
+
+        if (inputs.size() == 1)
+          return inputs[0];
+
+        return (inputs.size() == spec->get_inputs().size()) ? spec : double_add_spec(inputs);
+      }
+
+      static SpecPtr rewrite_subtraction(const DoubleSubtractionSpecPtr& spec)
+      {
+        const std::vector<DoubleSpecPtr>& inputs = spec->get_inputs();
+        if (inputs.size() == 1)
+          return is_constant(inputs[0]) ? SpecPtr(make_constant(-get_value<double>(inputs[0]))) : spec;
+
+        double subtrahend = 0.0;
+        std::vector<DoubleSpecPtr> subtrahends;
+        for (size_t i=1; i<inputs.size(); ++i)
+          if (is_constant(inputs[i]))
+            subtrahend += get_value<double>(inputs[i]);
+          else
+            subtrahends.push_back(inputs[i]);
+
+        if (subtrahends.empty() && is_constant(inputs[0]))
+          return make_constant(get_value<double>(inputs[0]) - subtrahend);
+
+        if (subtrahend != 0.0)
+          subtrahends.push_back(make_constant(subtrahend));
+
+        if (subtrahends.empty())
+          return inputs[0];
+
+        if (subtrahends.size() + 1 == inputs.size())
+          return spec;
+
+        subtrahends.insert(subtrahends.begin(), inputs[0]);
+        return double_sub_spec(subtrahends);
+      }
+
+      static SpecPtr rewrite_multiplication(const DoubleMultiplicationSpecPtr& spec)
+      {
+        double product = 1.0;
+        std::vector<DoubleSpecPtr> inputs;
+        for (auto const & input: spec->get_inputs())
+          if (is_constant(input))
+            product *= get_value<double>(input);
+          else
+            inputs.push_back(input);
+
+        if (product == 0.0)
+          return make_constant(0.0);
+
+        if (product != 1.0 || inputs.empty())
+          inputs.push_back(make_constant(product));
+
+        if (inputs.size() == 1)
+          return inputs[0];
+
+        return (inputs.size() == spec->get_inputs().size()) ? spec : double_mul_spec(inputs);
+      }
+
+      // never folds a division by a constant zero, generation keeps it as it is
+      static SpecPtr rewrite_division(const DoubleDivisionSpecPtr& spec)
+      {
+        const std::vector<DoubleSpecPtr>& inputs = spec->get_inputs();
+        if (inputs.size() == 1)
+          return (is_constant(inputs[0]) && get_value<double>(inputs[0]) != 0.0) ?
+              SpecPtr(make_constant(1.0 / get_value<double>(inputs[0]))) : spec;
+
+        double divisor = 1.0;
+        std::vector<DoubleSpecPtr> divisors;
+        for (size_t i=1; i<inputs.size(); ++i)
+          if (is_constant(inputs[i]))
+            divisor *= get_value<double>(inputs[i]);
+          else
+            divisors.push_back(inputs[i]);
+
+        if (divisor == 0.0)
+          return spec;
+
+        if (divisors.empty() && is_constant(inputs[0]))
+          return make_constant(get_value<double>(inputs[0]) / divisor);
+
+        if (divisor != 1.0)
+          divisors.push_back(make_constant(divisor));
+
+        if (divisors.empty())
+          return inputs[0];
+
+        if (divisors.size() + 1 == inputs.size())
+          return spec;
+
+        divisors.insert(divisors.begin(), inputs[0]);
+        return double_div(divisors);
+      }
+
+      // same semantics as KDL::conditional
+      static SpecPtr rewrite_if(const DoubleIfSpecPtr& spec)
+      {
+        if (!is_constant(spec->get_condition()))
+          return spec;
+
+        return get_value<double>(spec->get_condition()) >= 0.0 ? spec->get_if() : spec->get_else();
+      }
+
+      static SpecPtr rewrite_addition(const VectorAdditionSpecPtr& spec)
+      {
+        KDL::Vector sum = KDL::Vector::Zero();
+        std::vector<VectorSpecPtr> inputs;
+        for (auto const & input: spec->get_inputs())
+          if (is_constant(input))
+            sum = sum + get_value<KDL::Vector>(input);
+          else
+            inputs.push_back(input);
+
+        if (!is_identity(sum) || inputs.empty())
+          inputs.push_back(make_constant(sum));
+
+        if (inputs.size() == 1)
+          return inputs[0];
+
+        if (inputs.size() == spec->get_inputs().size())
+          return spec;
+
+        VectorAdditionSpecPtr result = make_spec<VectorAdditionSpec>();
+        result->set_inputs(inputs);
+        return result;
+      }
+
+      static SpecPtr rewrite_scaling(const VectorDoubleMultiplicationSpecPtr& spec)
+      {
+        if (is_constant(spec->get_vector()) && is_constant(spec->get_double()))
+          return fold(spec);
+
+        if (is_constant(spec->get_double()) && get_value<double>(spec->get_double()) == 1.0)
+          return spec->get_vector();
+
+        return spec;
+      }
+
+      static SpecPtr rewrite_rotation(const VectorRotationMultiplicationSpecPtr& spec)
+      {
+        if (is_constant(spec->get_vector()) && is_constant(spec->get_rotation()))
+          return fold(spec);
+
+        if (is_constant(spec->get_rotation()) && is_identity(get_value<KDL::Rotation>(spec->get_rotation())))
+          return spec->get_vector();
+
+        return spec;
+      }
+
+      static SpecPtr rewrite_transformation(const VectorFrameMultiplicationSpecPtr& spec)
+      {
+        if (is_constant(spec->get_vector()) && is_constant(spec->get_frame()))
+          return fold(spec);
+
+        if (is_constant(spec->get_frame()) && is_identity(get_value<KDL::Frame>(spec->get_frame())))
+          return spec->get_vector();
+
+        return spec;
+      }
+
+      static SpecPtr rewrite_chain(const RotationMultiplicationSpecPtr& spec)
+      {
+        std::vector<RotationSpecPtr> inputs = fuse<KDL::Rotation>(spec->get_inputs());
+        if (inputs.size() == spec->get_inputs().size())
+          return spec;
+
+        if (inputs.empty())
+          return make_constant(KDL::Rotation::Identity());
+
+        return (inputs.size() == 1) ? SpecPtr(inputs[0]) : SpecPtr(rotation_multiplication_spec(inputs));
+      }
+
+      static SpecPtr rewrite_chain(const FrameMultiplicationSpecPtr& spec)
+      {
+        std::vector<FrameSpecPtr> inputs = fuse<KDL::Frame>(spec->get_inputs());
+        if (inputs.size() == spec->get_inputs().size())
+          return spec;
+
+        if (inputs.empty())
+          return make_constant(KDL::Frame::Identity());
+
+        return (inputs.size() == 1) ? SpecPtr(inputs[0]) : SpecPtr(frame_multiplication_spec(inputs));
+      }
+
+      // Multiplies adjacent constants of a chain, and drops identities. Returns
+      // the inputs unchanged if there is nothing to fuse.
+      template<typename T, typename SpecType>
+      static std::vector< boost::shared_ptr<SpecType> > fuse(
+          const std::vector< boost::shared_ptr<SpecType> >& inputs)
+      {
+        using KDL::operator*;
+        std::vector< boost::shared_ptr<SpecType> > result;
+        bool changed = false;
+        for (size_t i=0; i<inputs.size(); )
+        {
+          if (!is_constant(inputs[i]))
+          {
+            result.push_back(inputs[i]);
+            ++i;
+            continue;
+          }
+
+          size_t end = i + 1;
+          T product = get_value<T>(inputs[i]);
+          for (; end<inputs.size() && is_constant(inputs[end]); ++end)
+            product = product * get_value<T>(inputs[end]);
+
+          if (is_identity(product))
+            changed = true;
+          else if (end == i + 1)
+            result.push_back(inputs[i]);
+          else
+          {
+            result.push_back(boost::dynamic_pointer_cast<SpecType>(make_constant(product)));
+            changed = true;
+          }
+          i = end;
+        }
+
+        return changed ? result : inputs;
+      }
+  };
+
+  // Simplified copy of spec, see SpecSimplifier.
+  inline QPControllerSpec simplify(const QPControllerSpec& spec)
+  {
+    SpecSimplifier simplifier;
+    return simplifier.simplify(spec);
+  }
+}
+
+#endif // GISKARD_CORE_SPEC_SIMPLIFICATION_HPP
@@ -0,0 +1,551 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_CORE_SPEC_TRAVERSAL_HPP
+#define GISKARD_CORE_SPEC_TRAVERSAL_HPP
+
+#include <giskard_core/specifications.hpp>
+#include <giskard_core/spec_cost.hpp>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace giskard_core
+{
+  // Returns true, and sets name, if spec refers to an entry of the scope.
+  inline bool get_reference_name(const SpecPtr& spec, std::string& name)
+  {
+    if (!spec)
+      return false;
+
+    switch (spec->get_kind())
+    {
+      case DoubleReferenceKind:
+        name = boost::static_pointer_cast<DoubleReferenceSpec>(spec)->get_reference_name();
+        return true;
+      case VectorReferenceKind:
+        name = boost::static_pointer_cast<VectorReferenceSpec>(spec)->get_reference_name();
+        return true;
+      case RotationReferenceKind:
+        name = boost::static_pointer_cast<RotationReferenceSpec>(spec)->get_reference_name();
+        return true;
+      case FrameReferenceKind:
+        name = boost::static_pointer_cast<FrameReferenceSpec>(spec)->get_reference_name();
+        return true;
+      case AliasReferenceKind:
+        name = boost::static_pointer_cast<AliasReferenceSpec>(spec)->get_reference_name();
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  // All specs of the constraints, i.e. everything the QP is built from.
+  inline std::vector<SpecPtr> get_constraint_specs(const QPControllerSpec& spec)
+  {
+    std::vector<SpecPtr> result;
+    for (auto const & constraint: spec.controllable_constraints_)
+      result.insert(result.end(), {constraint.lower_, constraint.upper_, constraint.weight_});
+    for (auto const & constraint: spec.soft_constraints_)
+      result.insert(result.end(), {constraint.expression_, constraint.lower_, constraint.upper_, constraint.weight_});
+    for (auto const & constraint: spec.hard_constraints_)
+      result.insert(result.end(), {constraint.expression_, constraint.lower_, constraint.upper_});
+    return result;
+  }
+
+  // Copy of spec and all nodes below it; nodes shared in spec stay shared in the copy.
+  inline SpecPtr copy_nodes(const SpecPtr& spec, std::map<const Spec*, SpecPtr>& copies)
+  {
+    if (!spec)
+      return spec;
+
+    std::map<const Spec*, SpecPtr>::const_iterator it = copies.find(spec.get());
+    if (it != copies.end())
+      return it->second;
+
+    std::vector<SpecPtr> children = spec->get_children();
+    for (auto & child: children)
+      child = copy_nodes(child, copies);
+
+    SpecPtr result = spec->clone();
+    result->set_children(children);
+    copies[spec.get()] = result;
+    return result;
+  }
+
+  template<typename T>
+  inline boost::shared_ptr<T> copy_nodes(const boost::shared_ptr<T>& spec, std::map<const Spec*, SpecPtr>& copies)
+  {
+    return boost::static_pointer_cast<T>(copy_nodes(SpecPtr(spec), copies));
+  }
+
+  // Copy of a controller spec that shares no nodes with it, e.g. to keep it
+  // unaffected by later changes through the setters of spec.
+  inline QPControllerSpec copy_nodes(const QPControllerSpec& spec)
+  {
+    std::map<const Spec*, SpecPtr> copies;
+    QPControllerSpec result = spec;
+
+    for (auto & entry: result.scope_)
+      entry.spec = copy_nodes(entry.spec, copies);
+
+    for (auto & constraint: result.controllable_constraints_)
+    {
+      constraint.lower_ = copy_nodes(constraint.lower_, copies);
+      constraint.upper_ = copy_nodes(constraint.upper_, copies);
+      constraint.weight_ = copy_nodes(constraint.weight_, copies);
+    }
+
+    for (auto & constraint: result.soft_constraints_)
+    {
+      constraint.expression_ = copy_nodes(constraint.expression_, copies);
+      constraint.lower_ = copy_nodes(constraint.lower_, copies);
+      constraint.upper_ = copy_nodes(constraint.upper_, copies);
+      constraint.weight_ = copy_nodes(constraint.weight_, copies);
+    }
+
+    for (auto & constraint: result.hard_constraints_)
+    {
+      constraint.expression_ = copy_nodes(constraint.expression_, copies);
+      constraint.lower_ = copy_nodes(constraint.lower_, copies);
+      constraint.upper_ = copy_nodes(constraint.upper_, copies);
+    }
+
+    return result;
+  }
+
+  // A scope entry, identified by its name and the type of its expression, see Scope.
+  typedef std::pair<std::string, Scope::ExpressionType> ScopeEntryKey;
+
+  /**
+   * Entries of a scope spec by name and type. Like in Scope, the same name
+   * may refer to entries of different types. Typed references resolve to the
+   * entry of their type, and alias references to the first type with an
+   * entry of that name, in the order double, vector, rotation, frame, see
+   * Scope::resolve(). Entries that generate() rejects are left out.
+   */
+  class ScopeEntryIndex
+  {
+    public:
+      explicit ScopeEntryIndex(const ScopeSpec& scope)
+      {
+        for (auto const & entry: scope)
+        {
+          ScopeEntryKey key;
+          bool valid = get_entry_type(entry.spec, key.second);
+          if (!valid && entry.spec && entry.spec->get_kind() == AliasReferenceKind)
+            // an alias entry gets the type of the entry it refers to
+            valid = find(entry.spec, key);
+          key.first = entry.name;
+
+          valid = valid && entries_.insert(std::make_pair(key, entry.spec)).second;
+          keys_.push_back(std::make_pair(valid, key));
+        }
+      }
+
+      // Sets key to the entry spec refers to; false if spec is no reference, or the entry does not exist.
+      bool find(const SpecPtr& spec, ScopeEntryKey& key) const
+      {
+        if (!get_reference_name(spec, key.first))
+          return false;
+
+        switch (spec->get_kind())
+        {
+          case DoubleReferenceKind:
+            key.second = Scope::DoubleType;
+            return entries_.count(key) > 0;
+          case VectorReferenceKind:
+            key.second = Scope::VectorType;
+            return entries_.count(key) > 0;
+          case RotationReferenceKind:
+            key.second = Scope::RotationType;
+            return entries_.count(key) > 0;
+          case FrameReferenceKind:
+            key.second = Scope::FrameType;
+            return entries_.count(key) > 0;
+          default:
+            for (Scope::ExpressionType type: {Scope::DoubleType, Scope::VectorType, Scope::RotationType, Scope::FrameType})
+            {
+              key.second = type;
+              if (entries_.count(key) > 0)
+                return true;
+            }
+            return false;
+        }
+      }
+
+      // Spec of the entry spec refers to, or an empty pointer, see find().
+      SpecPtr find_spec(const SpecPtr& spec) const
+      {
+        ScopeEntryKey key;
+        return find(spec, key) ? get_spec(key) : SpecPtr();
+      }
+
+      const SpecPtr& get_spec(const ScopeEntryKey& key) const
+      {
+        std::map<ScopeEntryKey, SpecPtr>::const_iterator it = entries_.find(key);
+        if (it == entries_.end())
+          throw std::invalid_argument("Could not find scope entry with name: " + key.first);
+
+        return it->second;
+      }
+
+      // Sets key to the key of the entry at position index of the scope; false if generate() rejects that entry.
+      bool get_key(size_t index, ScopeEntryKey& key) const
+      {
+        key = keys_.at(index).second;
+        return keys_[index].first;
+      }
+
+    private:
+      std::map<ScopeEntryKey, SpecPtr> entries_;
+      std::vector< std::pair<bool, ScopeEntryKey> > keys_;
+
+      static bool get_entry_type(const SpecPtr& spec, Scope::ExpressionType& type)
+      {
+        class TypeGetter : public SpecVisitor
+        {
+          public:
+            using SpecVisitor::visit;
+
+            TypeGetter() : valid_( false ), type_( Scope::DoubleType ) {}
+
+            virtual void visit(Spec& spec) { valid_ = false; }
+            virtual void visit(DoubleSpec& spec) { set(Scope::DoubleType); }
+            virtual void visit(VectorSpec& spec) { set(Scope::VectorType); }
+            virtual void visit(RotationSpec& spec) { set(Scope::RotationType); }
+            virtual void visit(FrameSpec& spec) { set(Scope::FrameType); }
+
+            bool valid_;
+            Scope::ExpressionType type_;
+
+          private:
+            void set(Scope::ExpressionType type)
+            {
+              valid_ = true;
+              type_ = type;
+            }
+        };
+
+        if (!spec)
+          return false;
+
+        TypeGetter getter;
+        spec->accept(getter);
+        type = getter.type_;
+        return getter.valid_;
+      }
+  };
+
+  /**
+   * Keys of all scope entries the roots depend on, following references
+   * into the scope transitively. References to entries that are not part of
+   * the scope are ignored; generate() reports those.
+   */
+  inline std::set<ScopeEntryKey> find_reachable_scope_entries(const std::vector<SpecPtr>& roots,
+      const ScopeEntryIndex& entries)
+  {
+    std::set<ScopeEntryKey> result;
+    std::set<const Spec*> visited;
+    std::vector<SpecPtr> open(roots.begin(), roots.end());
+    while (!open.empty())
+    {
+      SpecPtr spec = open.back();
+      open.pop_back();
+      if (!spec || !visited.insert(spec.get()).second)
+        continue;
+
+      ScopeEntryKey key;
+      if (entries.find(spec, key))
+      {
+        if (result.insert(key).second)
+          open.push_back(entries.get_spec(key));
+      }
+      else
+      {
+        std::vector<SpecPtr> children = spec->get_children();
+        open.insert(open.end(), children.begin(), children.end());
+      }
+    }
+
+    return result;
+  }
+
+  inline std::set<ScopeEntryKey> find_reachable_scope_entries(const std::vector<SpecPtr>& roots,
+      const ScopeSpec& scope)
+  {
+    return find_reachable_scope_entries(roots, ScopeEntryIndex(scope));
+  }
+
+  // Hash over the values of all constants below spec; memo keeps it linear for shared nodes.
+  inline HashValue hash_constants(const SpecPtr& spec, std::map<const Spec*, HashValue>& memo)
+  {
+    if (!spec)
+      return 0;
+
+    std::map<const Spec*, HashValue>::const_iterator it = memo.find(spec.get());
+    if (it != memo.end())
+      return it->second;
+
+    HashValue result = 0;
+    if (spec->get_kind() == DoubleConstKind)
+      hash_combine(result, hash_value(boost::static_pointer_cast<DoubleConstSpec>(spec)->get_value()));
+    else if (spec->get_kind() == RotationQuaternionConstructorKind)
+    {
+      RotationQuaternionConstructorSpecPtr quaternion =
+        boost::static_pointer_cast<RotationQuaternionConstructorSpec>(spec);
+      for (double value: {quaternion->get_x(), quaternion->get_y(), quaternion->get_z(), quaternion->get_w()})
+        hash_combine(result, hash_value(value));
+    }
+
+    for (auto const & child: spec->get_children())
+      hash_combine(result, hash_constants(child, memo));
+
+    memo[spec.get()] = result;
+    return result;
+  }
+
+  /**
+   * Hash of a whole controller spec, including the values of all constants
+   * that Spec::hash() leaves out. Controllers generated from specs with
+   * different fingerprints may behave differently, even if they share their
+   * structure hash.
+   */
+  inline HashValue fingerprint(const QPControllerSpec& spec)
+  {
+    HashValue result = hash_value(std::string("QPControllerSpec"));
+    std::vector<SpecPtr> roots;
+    for (auto const & entry: spec.scope_)
+    {
+      hash_combine(result, hash_value(entry.name));
+      roots.push_back(entry.spec);
+    }
+    for (auto const & constraint: spec.controllable_constraints_)
+    {
+      hash_combine(result, hash_value(constraint.name_));
+      hash_combine(result, hash_value(static_cast<std::uint64_t>(constraint.input_number_)));
+    }
+    for (auto const & constraint: spec.soft_constraints_)
+      hash_combine(result, hash_value(constraint.name_));
+    hash_combine(result, hash_value(static_cast<std::uint64_t>(spec.hard_constraints_.size())));
+
+    std::vector<SpecPtr> constraint_specs = get_constraint_specs(spec);
+    roots.insert(roots.end(), constraint_specs.begin(), constraint_specs.end());
+    Spec::HashPass pass;
+    for (auto const & root: roots)
+      hash_combine(result, root ? root->hash() : 0);
+
+    std::map<const Spec*, HashValue> constants;
+    for (auto const & root: roots)
+      hash_combine(result, hash_constants(root, constants));
+
+    return result;
+  }
+
+  /**
+   * Decides which shared nodes below spec are worth a cache, bottom-up, and
+   * marks the others as uncached in memo. Caching a node saves its cost for
+   * every parent but the first, which has to be at least min_saved_flops to
+   * pay for the cache. Explicitly cached specs are never wrapped again.
+   * Returns the cost of evaluating spec once more, see get_cost().
+   */
+  inline double select_cached_specs(const SpecPtr& spec, const ScopeEntryIndex& entries,
+      double min_saved_flops, ExpressionMemo& memo, std::map<const Spec*, double>& costs)
+  {
+    if (!spec)
+      return 0.0;
+
+    std::map<const Spec*, double>::const_iterator it = costs.find(spec.get());
+    if (it != costs.end())
+      return it->second;
+    // guards against cyclic references, which generate() reports
+    costs[spec.get()] = 0.0;
+
+    SpecCost own_cost = get_cost(spec);
+    double cost = own_cost.value_flops_ + own_cost.derivative_flops_;
+    cost += select_cached_specs(entries.find_spec(spec), entries, min_saved_flops, memo, costs);
+    for (auto const & child: spec->get_children())
+      cost += select_cached_specs(child, entries, min_saved_flops, memo, costs);
+
+    switch (spec->get_kind())
+    {
+      case DoubleCachedKind:
+      case VectorCachedKind:
+      case RotationCachedKind:
+      case FrameCachedKind:
+        memo.set_uncached(spec.get());
+        cost = 0.0;
+        break;
+      default:
+        if (memo.is_cached(spec.get()))
+        {
+          if ((memo.get_fan_out(spec.get()) - 1) * cost < min_saved_flops)
+            memo.set_uncached(spec.get());
+          else
+            cost = 0.0;
+        }
+    }
+
+    return costs[spec.get()] = cost;
+  }
+
+  /**
+   * Memo to generate the scope and the roots with, see ExpressionMemo. Counts
+   * the parents of every spec node reachable from the scope or the roots,
+   * and caches the shared nodes that save at least min_saved_flops per
+   * update, see select_cached_specs().
+   */
+  inline ExpressionMemoPtr create_expression_memo(const ScopeSpec& scope, const std::vector<SpecPtr>& roots,
+      double min_saved_flops = 4.0)
+  {
+    ScopeEntryIndex entries(scope);
+
+    ExpressionMemoPtr memo(new ExpressionMemo());
+    std::set<const Spec*> visited;
+    std::vector<SpecPtr> open;
+
+    // an edge to a reference is also an edge to the referenced entry
+    auto add_parent = [&entries, &memo, &open] (const SpecPtr& spec)
+    {
+      memo->add_parent(spec.get());
+      open.push_back(spec);
+
+      SpecPtr entry = entries.find_spec(spec);
+      if (entry)
+        memo->add_parent(entry.get());
+    };
+
+    for (auto const & entry: scope)
+      open.push_back(entry.spec);
+    for (auto const & root: roots)
+      add_parent(root);
+
+    while (!open.empty())
+    {
+      SpecPtr spec = open.back();
+      open.pop_back();
+      if (!spec || !visited.insert(spec.get()).second)
+        continue;
+
+      for (auto const & child: spec->get_children())
+        add_parent(child);
+
+      // the denominator of fmod is evaluated during generation, i.e. before
+      // any cached expression below it would have been updated
+      if (spec->get_kind() == FmodKind)
+      {
+        std::set<ScopeEntryKey> keys = find_reachable_scope_entries({spec->get_children()[1]}, entries);
+        std::vector<SpecPtr> uncached = {spec->get_children()[1]};
+        for (auto const & key: keys)
+          uncached.push_back(entries.get_spec(key));
+        std::set<const Spec*> marked;
+        while (!uncached.empty())
+        {
+          SpecPtr node = uncached.back();
+          uncached.pop_back();
+          if (!node || !marked.insert(node.get()).second)
+            continue;
+          memo->set_uncached(node.get());
+          for (auto const & child: node->get_children())
+            uncached.push_back(child);
+        }
+      }
+    }
+
+    std::map<const Spec*, double> costs;
+    for (auto const & entry: scope)
+      select_cached_specs(entry.spec, entries, min_saved_flops, *memo, costs);
+    for (auto const & root: roots)
+      select_cached_specs(root, entries, min_saved_flops, *memo, costs);
+
+    return memo;
+  }
+
+  /**
+   * Keys of the scope entries that no constraint depends on, in the order
+   * of the scope. These only serve as feedback, and the controller does not
+   * need to evaluate them during its updates.
+   */
+  inline std::vector<ScopeEntryKey> find_feedback_scope_entries(const QPControllerSpec& spec)
+  {
+    ScopeEntryIndex entries(spec.scope_);
+    std::set<ScopeEntryKey> hot = find_reachable_scope_entries(get_constraint_specs(spec), entries);
+
+    std::vector<ScopeEntryKey> result;
+    for (size_t i=0; i<spec.scope_.size(); ++i)
+    {
+      ScopeEntryKey key;
+      if (entries.get_key(i, key) && hot.count(key) == 0)
+        result.push_back(key);
+    }
+    return result;
+  }
+
+  /**
+   * Removes all scope entries that neither the constraints nor the entries
+   * listed in keep depend on, e.g. intermediate results left over by spec
+   * generators. Keeping a name keeps its entries of every type. Returns the
+   * names of the removed entries, in scope order.
+   */
+  inline std::vector<std::string> prune_scope(QPControllerSpec& spec,
+      const std::vector<std::string>& keep = std::vector<std::string>())
+  {
+    ScopeEntryIndex entries(spec.scope_);
+    std::set<ScopeEntryKey> kept;
+    std::vector<SpecPtr> roots = get_constraint_specs(spec);
+    for (auto const & name: keep)
+    {
+      bool found = false;
+      for (size_t i=0; i<spec.scope_.size(); ++i)
+      {
+        ScopeEntryKey key;
+        if (spec.scope_[i].name == name && entries.get_key(i, key) && kept.insert(key).second)
+          roots.push_back(entries.get_spec(key));
+        found = found || spec.scope_[i].name == name;
+      }
+      if (!found)
+        throw std::invalid_argument("Cannot keep scope entry '" + name + "', it does not exist.");
+    }
+
+    std::set<ScopeEntryKey> reachable = find_reachable_scope_entries(roots, entries);
+    reachable.insert(kept.begin(), kept.end());
+
+    // entries that generate() rejects stay, so that it still reports them
+    ScopeSpec scope;
+    std::vector<std::string> pruned;
+    for (size_t i=0; i<spec.scope_.size(); ++i)
+    {
+      ScopeEntryKey key;
+      if (!entries.get_key(i, key) || reachable.count(key) > 0)
+        scope.push_back(spec.scope_[i]);
+      else
+        pruned.push_back(spec.scope_[i].name);
+    }
+
+    spec.scope_ = scope;
+    return pruned;
+  }
+}
+
+#endif // GISKARD_CORE_SPEC_TRAVERSAL_HPP
@@ -24,9 +24,16 @@
 #include <string>
 #include <iostream>
 #include <map>
+#include <unordered_map>
+#include <atomic>
+#include <cstdint>
+#include <limits>
 #include <boost/lexical_cast.hpp>
 #include <giskard_core/expressiontree.hpp>
+#include <giskard_core/expression_memo.hpp>
+#include <giskard_core/hashing.hpp>
 #include <giskard_core/scope.hpp>
+#include <giskard_core/spec_arena.hpp>
 
 namespace giskard_core
 {
@@ -34,10 +41,397 @@ namespace giskard_core
   /// base of all specifications of expressions
   ///
 
+  class Spec;
+  typedef typename boost::shared_ptr<Spec> SpecPtr;
+
+  class DoubleSpec;
+  class VectorSpec;
+  class RotationSpec;
+  class FrameSpec;
+  class AliasReferenceSpec;
+  class DoubleConstSpec;
+  class DoubleInputSpec;
+  class DoubleReferenceSpec;
+  class DoubleAdditionSpec;
+  class DoubleSubtractionSpec;
+  class DoubleNormOfSpec;
+  class DoubleMultiplicationSpec;
+  class DoubleDivisionSpec;
+  class DoubleXCoordOfSpec;
+  class DoubleYCoordOfSpec;
+  class DoubleZCoordOfSpec;
+  class VectorDotSpec;
+  class MinSpec;
+  class AbsSpec;
+  class DoubleIfSpec;
+  class FmodSpec;
+  class SinSpec;
+  class CosSpec;
+  class TanSpec;
+  class ASinSpec;
+  class ACosSpec;
+  class ATanSpec;
+  class SqrtSpec;
+  class MaxSpec;
+  class DoubleCachedSpec;
+  class VectorCachedSpec;
+  class VectorConstructorSpec;
+  class VectorAdditionSpec;
+  class VectorSubtractionSpec;
+  class VectorReferenceSpec;
+  class VectorOriginOfSpec;
+  class VectorFrameMultiplicationSpec;
+  class VectorRotationMultiplicationSpec;
+  class VectorDoubleMultiplicationSpec;
+  class VectorRotationVectorSpec;
+  class VectorCrossSpec;
+  class RotationQuaternionConstructorSpec;
+  class AxisAngleSpec;
+  class SlerpSpec;
+  class RotationReferenceSpec;
+  class InverseRotationSpec;
+  class RotationMultiplicationSpec;
+  class RotationCachedSpec;
+  class FrameCachedSpec;
+  class FrameConstructorSpec;
+  class OrientationOfSpec;
+  class FrameMultiplicationSpec;
+  class FrameReferenceSpec;
+  class InverseFrameSpec;
+
+  // type tag of every concrete spec, see Spec::get_kind()
+  enum SpecKind
+  {
+    AliasReferenceKind,
+    DoubleConstKind,
+    DoubleInputKind,
+    DoubleReferenceKind,
+    DoubleAdditionKind,
+    DoubleSubtractionKind,
+    DoubleNormOfKind,
+    DoubleMultiplicationKind,
+    DoubleDivisionKind,
+    DoubleXCoordOfKind,
+    DoubleYCoordOfKind,
+    DoubleZCoordOfKind,
+    VectorDotKind,
+    MinKind,
+    AbsKind,
+    DoubleIfKind,
+    FmodKind,
+    SinKind,
+    CosKind,
+    TanKind,
+    ASinKind,
+    ACosKind,
+    ATanKind,
+    SqrtKind,
+    MaxKind,
+    DoubleCachedKind,
+    VectorCachedKind,
+    VectorConstructorKind,
+    VectorAdditionKind,
+    VectorSubtractionKind,
+    VectorReferenceKind,
+    VectorOriginOfKind,
+    VectorFrameMultiplicationKind,
+    VectorRotationMultiplicationKind,
+    VectorDoubleMultiplicationKind,
+    VectorRotationVectorKind,
+    VectorCrossKind,
+    RotationQuaternionConstructorKind,
+    AxisAngleKind,
+    SlerpKind,
+    RotationReferenceKind,
+    InverseRotationKind,
+    RotationMultiplicationKind,
+    RotationCachedKind,
+    FrameCachedKind,
+    FrameConstructorKind,
+    OrientationOfKind,
+    FrameMultiplicationKind,
+    FrameReferenceKind,
+    InverseFrameKind
+  };
+
+  /**
+   * Double dispatch over the concrete spec types through Spec::accept().
+   * By default, every visit() forwards to the visit() of the direct base
+   * class of its spec, e.g. visit(DoubleAdditionSpec&) to visit(DoubleSpec&),
+   * and those end in visit(Spec&), which does nothing. A visitor overrides
+   * only the overloads it cares about.
+   */
+  class SpecVisitor
+  {
+    public:
+      virtual ~SpecVisitor() {}
+
+      virtual void visit(Spec& spec) {}
+      virtual void visit(DoubleSpec& spec);
+      virtual void visit(VectorSpec& spec);
+      virtual void visit(RotationSpec& spec);
+      virtual void visit(FrameSpec& spec);
+
+      virtual void visit(AliasReferenceSpec& spec);
+      virtual void visit(DoubleConstSpec& spec);
+      virtual void visit(DoubleInputSpec& spec);
+      virtual void visit(DoubleReferenceSpec& spec);
+      virtual void visit(DoubleAdditionSpec& spec);
+      virtual void visit(DoubleSubtractionSpec& spec);
+      virtual void visit(DoubleNormOfSpec& spec);
+      virtual void visit(DoubleMultiplicationSpec& spec);
+      virtual void visit(DoubleDivisionSpec& spec);
+      virtual void visit(DoubleXCoordOfSpec& spec);
+      virtual void visit(DoubleYCoordOfSpec& spec);
+      virtual void visit(DoubleZCoordOfSpec& spec);
+      virtual void visit(VectorDotSpec& spec);
+      virtual void visit(MinSpec& spec);
+      virtual void visit(AbsSpec& spec);
+      virtual void visit(DoubleIfSpec& spec);
+      virtual void visit(FmodSpec& spec);
+      virtual void visit(SinSpec& spec);
+      virtual void visit(CosSpec& spec);
+      virtual void visit(TanSpec& spec);
+      virtual void visit(ASinSpec& spec);
+      virtual void visit(ACosSpec& spec);
+      virtual void visit(ATanSpec& spec);
+      virtual void visit(SqrtSpec& spec);
+      virtual void visit(MaxSpec& spec);
+      virtual void visit(DoubleCachedSpec& spec);
+      virtual void visit(VectorCachedSpec& spec);
+      virtual void visit(VectorConstructorSpec& spec);
+      virtual void visit(VectorAdditionSpec& spec);
+      virtual void visit(VectorSubtractionSpec& spec);
+      virtual void visit(VectorReferenceSpec& spec);
+      virtual void visit(VectorOriginOfSpec& spec);
+      virtual void visit(VectorFrameMultiplicationSpec& spec);
+      virtual void visit(VectorRotationMultiplicationSpec& spec);
+      virtual void visit(VectorDoubleMultiplicationSpec& spec);
+      virtual void visit(VectorRotationVectorSpec& spec);
+      virtual void visit(VectorCrossSpec& spec);
+      virtual void visit(RotationQuaternionConstructorSpec& spec);
+      virtual void visit(AxisAngleSpec& spec);
+      virtual void visit(SlerpSpec& spec);
+      virtual void visit(RotationReferenceSpec& spec);
+      virtual void visit(InverseRotationSpec& spec);
+      virtual void visit(RotationMultiplicationSpec& spec);
+      virtual void visit(RotationCachedSpec& spec);
+      virtual void visit(FrameCachedSpec& spec);
+      virtual void visit(FrameConstructorSpec& spec);
+      virtual void visit(OrientationOfSpec& spec);
+      virtual void visit(FrameMultiplicationSpec& spec);
+      virtual void visit(FrameReferenceSpec& spec);
+      virtual void visit(InverseFrameSpec& spec);
+  };
+
   class Spec
   { 
     public:
       virtual bool equals(const Spec& other) const = 0;
+
+      // shallow copy, shares the children with this spec
+      virtual SpecPtr clone() const = 0;
+
+      // type tag, allows to dispatch on the type without RTTI
+      virtual SpecKind get_kind() const = 0;
+
+      // calls the overload of visitor.visit() for the type of this spec
+      virtual void accept(SpecVisitor& visitor) = 0;
+
+      // direct sub-specifications, references to the scope are not followed
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return std::vector<SpecPtr>();
+      }
+
+      // replaces the direct sub-specifications, in the order of get_children()
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 0);
+      }
+
+      typedef std::unordered_map<const Spec*, HashValue> HashMemo;
+
+      /**
+       * Hashes of all nodes visited during the outermost HashPass of this
+       * thread; all nested passes share its memo. hash() and equals() open
+       * one, so that no node gets hashed twice during one call. Open one
+       * around many calls of hash() on specs that are not modified
+       * meanwhile, e.g. when hashing all roots of a controller spec.
+       */
+      class HashPass
+      {
+        public:
+          HashPass() :
+            owner_( !get_current() )
+          {
+            if (owner_)
+              get_current() = &memo_;
+          }
+
+          ~HashPass()
+          {
+            if (owner_)
+              get_current() = 0;
+          }
+
+          HashMemo& get_memo() const
+          {
+            return *get_current();
+          }
+
+        private:
+          bool owner_;
+          HashMemo memo_;
+
+          static HashMemo*& get_current()
+          {
+            static thread_local HashMemo* memo = 0;
+            return memo;
+          }
+
+          HashPass(const HashPass& other);
+          HashPass& operator=(const HashPass& other);
+      };
+
+      /**
+       * Structural hash over the type, the input numbers, the reference names,
+       * and the hashes of all children. Constant values are left out because
+       * equals() compares them with a tolerance; equal specs therefore always
+       * have equal hashes.
+       *
+       * Every node caches its hash, together with the hashes of its children
+       * it was computed from. The cache of a node stays valid until the node
+       * itself gets modified or the hash of one of its children changes, so
+       * modifying one spec does not invalidate unrelated ones. Shared nodes
+       * are visited once per outermost call of hash() or equals(). Several
+       * threads may hash the same spec at once, as long as no thread modifies
+       * it meanwhile.
+       *
+       * NOTE: Hashes change whenever the order of SpecKind changes.
+       */
+      HashValue hash() const
+      {
+        HashPass pass;
+        HashMemo& memo = pass.get_memo();
+        HashMemo::const_iterator it = memo.find(this);
+        if (it != memo.end())
+          return it->second;
+
+        HashValue children = 0;
+        for (auto const & child: get_children())
+          hash_combine(children, child ? child->hash() : 0);
+
+        HashValue result;
+        std::uint64_t version = version_.load(std::memory_order_relaxed);
+        if (hash_version_.load(std::memory_order_acquire) == version &&
+            children_hash_.load(std::memory_order_relaxed) == children)
+          result = hash_.load(std::memory_order_relaxed);
+        else
+        {
+          result = hash_value(static_cast<std::uint64_t>(get_kind()));
+          hash_attributes(result);
+          hash_combine(result, children);
+          hash_.store(result, std::memory_order_relaxed);
+          children_hash_.store(children, std::memory_order_relaxed);
+          hash_version_.store(version, std::memory_order_release);
+        }
+
+        memo[this] = result;
+        return result;
+      }
+
+      /**
+       * Like set_children(), for children that are equal to the current ones,
+       * e.g. canonical nodes from SpecInterner. Such a replacement does not
+       * change any hash, so the cached hash of this node stays valid.
+       */
+      void replace_equal_children(const std::vector<SpecPtr>& children)
+      {
+        is_touch_suppressed() = true;
+        try
+        {
+          set_children(children);
+        }
+        catch (...)
+        {
+          is_touch_suppressed() = false;
+          throw;
+        }
+        is_touch_suppressed() = false;
+      }
+
+    protected:
+      Spec() {}
+
+      // copies start without a cached hash
+      Spec(const Spec& other) {}
+
+      Spec& operator=(const Spec& other)
+      {
+        return *this;
+      }
+
+      // has to be called by every function that modifies a spec
+      void touch()
+      {
+        if (!is_touch_suppressed())
+          version_.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      // hashes everything that equals() compares, except children and constants
+      virtual void hash_attributes(HashValue& seed) const {}
+
+      static void check_num_children(const std::vector<SpecPtr>& children, size_t expected)
+      {
+        if (children.size() != expected)
+          throw std::length_error("Expected " + std::to_string(expected) + " children of spec, but got " +
+              std::to_string(children.size()) + ".");
+      }
+
+      template<typename T>
+      static boost::shared_ptr<T> child_cast(const SpecPtr& child)
+      {
+        boost::shared_ptr<T> result = boost::dynamic_pointer_cast<T>(child);
+        if (child && !result)
+          throw std::invalid_argument("Child of spec has wrong type.");
+        return result;
+      }
+
+      // Looks up the expression of this spec in the current memo, if there
+      // is one, and only calls generate on a miss, see ExpressionMemoGuard.
+      template<typename T, typename Generator>
+      typename KDL::Expression<T>::Ptr memoize(const Generator& generate)
+      {
+        ExpressionMemo* memo = ExpressionMemo::current();
+        if (!memo)
+          return generate();
+
+        KDL::ExpressionBase::Ptr expression;
+        if (memo->find(this, expression))
+          return boost::static_pointer_cast< KDL::Expression<T> >(expression);
+
+        typename KDL::Expression<T>::Ptr result = generate();
+        if (memo->is_cached(this) && !get_children().empty())
+          result = KDL::cached<T>(result);
+        memo->insert(this, result);
+        return result;
+      }
+
+    private:
+      // counts the modifications of this node
+      std::atomic<std::uint64_t> version_{0};
+      // cached hash, valid for the version it is published with and the
+      // hashes of the children it was computed from
+      mutable std::atomic<HashValue> hash_{0}, children_hash_{0};
+      mutable std::atomic<std::uint64_t> hash_version_{std::numeric_limits<std::uint64_t>::max()};
+
+      static bool& is_touch_suppressed()
+      {
+        static thread_local bool suppressed = false;
+        return suppressed;
+      }
+
   };
 
   inline bool operator==(const Spec& lhs, const Spec& rhs)
@@ -50,8 +444,6 @@ namespace giskard_core
     return !operator==(lhs,rhs);
   }
 
-  typedef typename boost::shared_ptr<Spec> SpecPtr;
-
   ///
   /// next level of expression specifications
   ///
@@ -72,21 +464,50 @@ namespace giskard_core
 
       void set_reference_name(const std::string& reference_name)
       {
+        touch();
         reference_name_ = reference_name;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<AliasReferenceSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return AliasReferenceKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const AliasReferenceSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
   
-        return (dynamic_cast<const AliasReferenceSpec*>(&other)->get_reference_name().compare(this->get_reference_name()) == 0);
+        return (static_cast<const AliasReferenceSpec*>(&other)->get_reference_name().compare(this->get_reference_name()) == 0);
       }
   
       KDL::ExpressionBase::Ptr get_expression(const giskard_core::Scope& scope)
       {
         return scope.find_expression(get_reference_name());
       }
+    protected:
+      virtual void hash_attributes(HashValue& seed) const
+      {
+        hash_combine(seed, hash_value(get_reference_name()));
+      }
+
     private:
       std::string reference_name_;
   };
@@ -95,7 +516,7 @@ namespace giskard_core
 
   inline AliasReferenceSpecPtr alias_reference_spec(const std::string& reference_name = "")
   {
-    return AliasReferenceSpecPtr(new AliasReferenceSpec(reference_name));
+    return make_spec<AliasReferenceSpec>(reference_name);
   }
 
   class DoubleSpec : public Spec
@@ -103,7 +524,12 @@ namespace giskard_core
     public:
       virtual bool equals(const Spec& other) const = 0;
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope) = 0;
+      KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      {
+        return memoize<double>([this, &scope] () { return generate_expression(scope); });
+      }
+
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope) = 0;
   };
 
   typedef typename boost::shared_ptr<DoubleSpec> DoubleSpecPtr;
@@ -113,7 +539,12 @@ namespace giskard_core
     public:
       virtual bool equals(const Spec& other) const = 0;
 
-      virtual KDL::Expression<KDL::Vector>::Ptr get_expression(const giskard_core::Scope& scope) = 0;
+      KDL::Expression<KDL::Vector>::Ptr get_expression(const giskard_core::Scope& scope)
+      {
+        return memoize<KDL::Vector>([this, &scope] () { return generate_expression(scope); });
+      }
+
+      virtual KDL::Expression<KDL::Vector>::Ptr generate_expression(const giskard_core::Scope& scope) = 0;
   };
 
   typedef typename boost::shared_ptr<VectorSpec> VectorSpecPtr;
@@ -123,7 +554,12 @@ namespace giskard_core
     public:
       virtual bool equals(const Spec& other) const = 0;
 
-      virtual KDL::Expression<KDL::Rotation>::Ptr get_expression(const giskard_core::Scope& scope) = 0;
+      KDL::Expression<KDL::Rotation>::Ptr get_expression(const giskard_core::Scope& scope)
+      {
+        return memoize<KDL::Rotation>([this, &scope] () { return generate_expression(scope); });
+      }
+
+      virtual KDL::Expression<KDL::Rotation>::Ptr generate_expression(const giskard_core::Scope& scope) = 0;
   };
 
   typedef typename boost::shared_ptr<RotationSpec> RotationSpecPtr;
@@ -133,7 +569,12 @@ namespace giskard_core
     public:
       virtual bool equals(const Spec& other) const = 0;
 
-      virtual KDL::Expression<KDL::Frame>::Ptr get_expression(const giskard_core::Scope& scope) = 0;
+      KDL::Expression<KDL::Frame>::Ptr get_expression(const giskard_core::Scope& scope)
+      {
+        return memoize<KDL::Frame>([this, &scope] () { return generate_expression(scope); });
+      }
+
+      virtual KDL::Expression<KDL::Frame>::Ptr generate_expression(const giskard_core::Scope& scope) = 0;
   };
 
   typedef typename boost::shared_ptr<FrameSpec> FrameSpecPtr;
@@ -171,19 +612,42 @@ namespace giskard_core
 
       void set_value(double value)
       {
+        touch();
         value_ = value;
       } 
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<DoubleConstSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return DoubleConstKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const DoubleConstSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
         return KDL::epsilon >
-            std::abs(dynamic_cast<const DoubleConstSpec*>(&other)->get_value() - this->get_value());
+            std::abs(static_cast<const DoubleConstSpec*>(&other)->get_value() - this->get_value());
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::Constant(get_value());
       }
@@ -196,7 +660,7 @@ namespace giskard_core
 
   inline DoubleSpecPtr double_const_spec(double value)
   {
-    return DoubleConstSpecPtr(new DoubleConstSpec(value));
+    return make_spec<DoubleConstSpec>(value);
   }
 
   class DoubleInputSpec : public DoubleSpec
@@ -217,22 +681,51 @@ namespace giskard_core
 
       void set_input_num(size_t input_num)
       {
+        touch();
         input_num_ = input_num;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<DoubleInputSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return DoubleInputKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const DoubleInputSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        return dynamic_cast<const DoubleInputSpec*>(&other)->get_input_num() == this->get_input_num();
+        return static_cast<const DoubleInputSpec*>(&other)->get_input_num() == this->get_input_num();
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::input(get_input_num());
       }
 
+    protected:
+      virtual void hash_attributes(HashValue& seed) const
+      {
+        hash_combine(seed, hash_value(static_cast<std::uint64_t>(get_input_num())));
+      }
+
     private:
       size_t input_num_;
   };
@@ -241,7 +734,7 @@ namespace giskard_core
 
   inline DoubleInputSpecPtr input(size_t input_num = 0)
   {
-    return DoubleInputSpecPtr(new DoubleInputSpec(input_num));
+    return make_spec<DoubleInputSpec>(input_num);
   }
 
   class DoubleReferenceSpec : public DoubleSpec
@@ -254,22 +747,51 @@ namespace giskard_core
 
       void set_reference_name(const std::string& reference_name)
       {
+        touch();
         reference_name_ = reference_name;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<DoubleReferenceSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return DoubleReferenceKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const DoubleReferenceSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
           return false;
 
-        return (dynamic_cast<const DoubleReferenceSpec*>(&other)->get_reference_name().compare(this->get_reference_name()) == 0);
+        if(other.get_kind() != get_kind())
+          return false;
+
+        return (static_cast<const DoubleReferenceSpec*>(&other)->get_reference_name().compare(this->get_reference_name()) == 0);
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return scope.find_double_expression(get_reference_name());
       }
 
+    protected:
+      virtual void hash_attributes(HashValue& seed) const
+      {
+        hash_combine(seed, hash_value(get_reference_name()));
+      }
+
     private:
       std::string reference_name_;
   };
@@ -294,15 +816,38 @@ namespace giskard_core
 
       void set_inputs(const std::vector<DoubleSpecPtr>& inputs)
       {
+        touch();
         inputs_ = inputs;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<DoubleAdditionSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return DoubleAdditionKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const DoubleAdditionSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const DoubleAdditionSpec* other_p = dynamic_cast<const DoubleAdditionSpec*>(&other);
+        const DoubleAdditionSpec* other_p = static_cast<const DoubleAdditionSpec*>(&other);
 
         if(get_inputs().size() != other_p->get_inputs().size())
           return false;
@@ -326,16 +871,32 @@ namespace giskard_core
         return true;
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
-        KDL::Expression<double>::Ptr result = KDL::Constant(0.0);
+        if(get_inputs().empty())
+          return KDL::Constant(0.0);
+
+        KDL::Expression<double>::Ptr result = get_inputs()[0]->get_expression(scope);
         using KDL::operator+;
-        for(size_t i=0; i<get_inputs().size(); ++i)
+        for(size_t i=1; i<get_inputs().size(); ++i)
           result = result + get_inputs()[i]->get_expression(scope);
     
         return result;
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return std::vector<SpecPtr>(inputs_.begin(), inputs_.end());
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        std::vector<DoubleSpecPtr> inputs;
+        for (auto const & child: children)
+          inputs.push_back(child_cast<DoubleSpec>(child));
+        set_inputs(inputs);
+      }
+
     private:
       std::vector<DoubleSpecPtr> inputs_;
    };
@@ -344,7 +905,7 @@ namespace giskard_core
 
   inline DoubleAdditionSpecPtr double_add_spec(const std::vector<DoubleSpecPtr>& inputs = {double_const_spec()})
   {
-    return DoubleAdditionSpecPtr(new DoubleAdditionSpec(inputs));
+    return make_spec<DoubleAdditionSpec>(inputs);
   }
 
   class DoubleSubtractionSpec: public DoubleSpec
@@ -365,15 +926,38 @@ namespace giskard_core
 
       void set_inputs(const std::vector<DoubleSpecPtr>& inputs)
       {
+        touch();
         inputs_ = inputs;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<DoubleSubtractionSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return DoubleSubtractionKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const DoubleSubtractionSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const DoubleSubtractionSpec* other_p = dynamic_cast<const DoubleSubtractionSpec*>(&other);
+        const DoubleSubtractionSpec* other_p = static_cast<const DoubleSubtractionSpec*>(&other);
 
         if(get_inputs().size() != other_p->get_inputs().size())
           return false;
@@ -397,7 +981,7 @@ namespace giskard_core
         return true;
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         if(get_inputs().size() == 0)
           throw std::length_error("Found DoubleSubtractionSpec with zero inputs.");
@@ -420,6 +1004,19 @@ namespace giskard_core
         }
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return std::vector<SpecPtr>(inputs_.begin(), inputs_.end());
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        std::vector<DoubleSpecPtr> inputs;
+        for (auto const & child: children)
+          inputs.push_back(child_cast<DoubleSpec>(child));
+        set_inputs(inputs);
+      }
+
     private:
       std::vector<giskard_core::DoubleSpecPtr> inputs_;
   };
@@ -428,7 +1025,7 @@ namespace giskard_core
 
   inline DoubleSubtractionSpecPtr double_sub_spec(const std::vector<DoubleSpecPtr>& inputs = {double_const_spec()})
   {
-    return DoubleSubtractionSpecPtr(new DoubleSubtractionSpec(inputs));
+    return make_spec<DoubleSubtractionSpec>(inputs);
   }
 
   class DoubleNormOfSpec : public DoubleSpec
@@ -449,22 +1046,57 @@ namespace giskard_core
 
       void set_vector(const giskard_core::VectorSpecPtr& vector)
       {
+        touch();
         vector_ = vector;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<DoubleNormOfSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return DoubleNormOfKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const DoubleNormOfSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        return dynamic_cast<const DoubleNormOfSpec*>(&other)->get_vector()->equals(*(this->get_vector()));
+        return static_cast<const DoubleNormOfSpec*>(&other)->get_vector()->equals(*(this->get_vector()));
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::norm(get_vector()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {vector_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 1);
+        vector_ = child_cast<VectorSpec>(children[0]);
+        touch();
+      }
+
     private:
       giskard_core::VectorSpecPtr vector_;
   };
@@ -473,7 +1105,7 @@ namespace giskard_core
 
   inline DoubleNormOfSpecPtr vector_norm(const VectorSpecPtr& new_vector = vector_constructor_spec())
   {
-    return DoubleNormOfSpecPtr(new DoubleNormOfSpec(new_vector));
+    return make_spec<DoubleNormOfSpec>(new_vector);
   }
 
   class DoubleMultiplicationSpec: public DoubleSpec
@@ -494,15 +1126,38 @@ namespace giskard_core
 
       void set_inputs(const std::vector<DoubleSpecPtr>& inputs)
       {
+        touch();
         inputs_ = inputs;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<DoubleMultiplicationSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return DoubleMultiplicationKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const DoubleMultiplicationSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const DoubleMultiplicationSpec* other_p = dynamic_cast<const DoubleMultiplicationSpec*>(&other);
+        const DoubleMultiplicationSpec* other_p = static_cast<const DoubleMultiplicationSpec*>(&other);
 
         if(get_inputs().size() != other_p->get_inputs().size())
           return false;
@@ -526,17 +1181,33 @@ namespace giskard_core
         return true;
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
-        KDL::Expression<double>::Ptr result = KDL::Constant(1.0);
+        if(get_inputs().empty())
+          return KDL::Constant(1.0);
+
+        KDL::Expression<double>::Ptr result = get_inputs()[0]->get_expression(scope);
 
         using KDL::operator*;
-        for(size_t i=0; i<get_inputs().size(); ++i)
+        for(size_t i=1; i<get_inputs().size(); ++i)
           result = result * get_inputs()[i]->get_expression(scope);
 
         return result; 
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return std::vector<SpecPtr>(inputs_.begin(), inputs_.end());
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        std::vector<DoubleSpecPtr> inputs;
+        for (auto const & child: children)
+          inputs.push_back(child_cast<DoubleSpec>(child));
+        set_inputs(inputs);
+      }
+
     private:
       std::vector<giskard_core::DoubleSpecPtr> inputs_;
   };
@@ -545,7 +1216,7 @@ namespace giskard_core
 
   inline DoubleMultiplicationSpecPtr double_mul_spec(const std::vector<DoubleSpecPtr>& inputs = {double_const_spec()})
   {
-    return DoubleMultiplicationSpecPtr(new DoubleMultiplicationSpec(inputs));
+    return make_spec<DoubleMultiplicationSpec>(inputs);
   }
 
   class DoubleDivisionSpec: public DoubleSpec
@@ -566,15 +1237,38 @@ namespace giskard_core
 
       void set_inputs(const std::vector<DoubleSpecPtr>& inputs)
       {
+        touch();
         inputs_ = inputs;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<DoubleDivisionSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return DoubleDivisionKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const DoubleDivisionSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const DoubleDivisionSpec* other_p = dynamic_cast<const DoubleDivisionSpec*>(&other);
+        const DoubleDivisionSpec* other_p = static_cast<const DoubleDivisionSpec*>(&other);
 
         if(get_inputs().size() != other_p->get_inputs().size())
           return false;
@@ -598,7 +1292,7 @@ namespace giskard_core
         return true;
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         if(get_inputs().size() == 0)
           throw std::length_error("Found DoubleDivisionSpec with zero inputs.");
@@ -621,6 +1315,19 @@ namespace giskard_core
         }
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return std::vector<SpecPtr>(inputs_.begin(), inputs_.end());
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        std::vector<DoubleSpecPtr> inputs;
+        for (auto const & child: children)
+          inputs.push_back(child_cast<DoubleSpec>(child));
+        set_inputs(inputs);
+      }
+
     private:
       std::vector<giskard_core::DoubleSpecPtr> inputs_;
   };
@@ -629,7 +1336,7 @@ namespace giskard_core
 
   inline DoubleDivisionSpecPtr double_div(const std::vector<DoubleSpecPtr>& inputs = {double_const_spec()})
   {
-    return DoubleDivisionSpecPtr(new DoubleDivisionSpec(inputs));
+    return make_spec<DoubleDivisionSpec>(inputs);
   }
 
   class DoubleXCoordOfSpec : public DoubleSpec
@@ -650,22 +1357,57 @@ namespace giskard_core
 
       void set_vector(const giskard_core::VectorSpecPtr& vector)
       {
+        touch();
         vector_ = vector;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<DoubleXCoordOfSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return DoubleXCoordOfKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const DoubleXCoordOfSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        return dynamic_cast<const DoubleXCoordOfSpec*>(&other)->get_vector()->equals(*(this->get_vector()));
+        return static_cast<const DoubleXCoordOfSpec*>(&other)->get_vector()->equals(*(this->get_vector()));
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::coord_x(get_vector()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {vector_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 1);
+        vector_ = child_cast<VectorSpec>(children[0]);
+        touch();
+      }
+
     private:
       giskard_core::VectorSpecPtr vector_;
   };
@@ -674,7 +1416,7 @@ namespace giskard_core
 
   inline DoubleXCoordOfSpecPtr x_coord(const VectorSpecPtr vector_ = vector_constructor_spec())
   {
-    return DoubleXCoordOfSpecPtr(new DoubleXCoordOfSpec(vector_));
+    return make_spec<DoubleXCoordOfSpec>(vector_);
   }
 
   class DoubleYCoordOfSpec : public DoubleSpec
@@ -695,31 +1437,66 @@ namespace giskard_core
 
       void set_vector(const giskard_core::VectorSpecPtr& vector)
       {
+        touch();
         vector_ = vector;
       }
 
-      virtual bool equals(const Spec& other) const
+      virtual SpecPtr clone() const
       {
-        if(!dynamic_cast<const DoubleYCoordOfSpec*>(&other))
-          return false;
+        return make_spec<DoubleYCoordOfSpec>(*this);
+      }
 
-        return dynamic_cast<const DoubleYCoordOfSpec*>(&other)->get_vector()->equals(*(this->get_vector()));
+      virtual SpecKind get_kind() const
+      {
+        return DoubleYCoordOfKind;
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual void accept(SpecVisitor& visitor)
       {
-        return KDL::coord_y(get_vector()->get_expression(scope));
+        visitor.visit(*this);
       }
 
-    private:
-      giskard_core::VectorSpecPtr vector_;
+      virtual bool equals(const Spec& other) const
+      {
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
+          return false;
+
+        return static_cast<const DoubleYCoordOfSpec*>(&other)->get_vector()->equals(*(this->get_vector()));
+      }
+
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
+      {
+        return KDL::coord_y(get_vector()->get_expression(scope));
+      }
+
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {vector_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 1);
+        vector_ = child_cast<VectorSpec>(children[0]);
+        touch();
+      }
+
+    private:
+      giskard_core::VectorSpecPtr vector_;
   };
 
   typedef typename boost::shared_ptr<DoubleYCoordOfSpec> DoubleYCoordOfSpecPtr;
 
   inline DoubleYCoordOfSpecPtr y_coord(const VectorSpecPtr vector_ = vector_constructor_spec())
   {
-    return DoubleYCoordOfSpecPtr(new DoubleYCoordOfSpec(vector_));
+    return make_spec<DoubleYCoordOfSpec>(vector_);
   }
 
   class DoubleZCoordOfSpec : public DoubleSpec
@@ -740,22 +1517,57 @@ namespace giskard_core
 
       void set_vector(const giskard_core::VectorSpecPtr& vector)
       {
+        touch();
         vector_ = vector;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<DoubleZCoordOfSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return DoubleZCoordOfKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const DoubleZCoordOfSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        return dynamic_cast<const DoubleZCoordOfSpec*>(&other)->get_vector()->equals(*(this->get_vector()));
+        return static_cast<const DoubleZCoordOfSpec*>(&other)->get_vector()->equals(*(this->get_vector()));
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::coord_z(get_vector()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {vector_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 1);
+        vector_ = child_cast<VectorSpec>(children[0]);
+        touch();
+      }
+
     private:
       giskard_core::VectorSpecPtr vector_;
   };
@@ -764,7 +1576,7 @@ namespace giskard_core
 
   inline DoubleZCoordOfSpecPtr z_coord(const VectorSpecPtr vector_ = vector_constructor_spec())
   {
-    return DoubleZCoordOfSpecPtr(new DoubleZCoordOfSpec(vector_));
+    return make_spec<DoubleZCoordOfSpec>(vector_);
   }
 
   class VectorDotSpec: public DoubleSpec
@@ -782,20 +1594,44 @@ namespace giskard_core
 
       void set_lhs(const VectorSpecPtr& lhs)
       {
+        touch();
         lhs_ = lhs;
       }
 
       void set_rhs(const VectorSpecPtr& rhs)
       {
+        touch();
         rhs_ = rhs;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<VectorDotSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return VectorDotKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const VectorDotSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const VectorDotSpec* other_p = dynamic_cast<const VectorDotSpec*>(&other);
+        const VectorDotSpec* other_p = static_cast<const VectorDotSpec*>(&other);
 
         return get_lhs().get() && get_rhs().get() &&
             other_p->get_lhs().get() && other_p->get_rhs().get() &&
@@ -803,11 +1639,24 @@ namespace giskard_core
             get_rhs()->equals(*(other_p->get_rhs()));
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::dot(get_lhs()->get_expression(scope), get_rhs()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {lhs_, rhs_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 2);
+        lhs_ = child_cast<VectorSpec>(children[0]);
+        rhs_ = child_cast<VectorSpec>(children[1]);
+        touch();
+      }
+
     private:
       giskard_core::VectorSpecPtr lhs_, rhs_;
   };
@@ -829,20 +1678,44 @@ namespace giskard_core
 
       void set_lhs(const DoubleSpecPtr& lhs)
       {
+        touch();
         lhs_ = lhs;
       }
 
       void set_rhs(const DoubleSpecPtr& rhs)
       {
+        touch();
         rhs_ = rhs;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<MinSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return MinKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const MinSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const MinSpec* other_p = dynamic_cast<const MinSpec*>(&other);
+        const MinSpec* other_p = static_cast<const MinSpec*>(&other);
 
         return get_lhs().get() && get_rhs().get() &&
             other_p->get_lhs().get() && other_p->get_rhs().get() &&
@@ -850,11 +1723,24 @@ namespace giskard_core
             get_rhs()->equals(*(other_p->get_rhs()));
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::minimum(get_lhs()->get_expression(scope), get_rhs()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {lhs_, rhs_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 2);
+        lhs_ = child_cast<DoubleSpec>(children[0]);
+        rhs_ = child_cast<DoubleSpec>(children[1]);
+        touch();
+      }
+
     private:
       giskard_core::DoubleSpecPtr lhs_, rhs_;
   };
@@ -879,25 +1765,60 @@ namespace giskard_core
 
       void set_value(const DoubleSpecPtr& value)
       {
+        touch();
         value_ = value;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<AbsSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return AbsKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const AbsSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const AbsSpec* other_p = dynamic_cast<const AbsSpec*>(&other);
+        const AbsSpec* other_p = static_cast<const AbsSpec*>(&other);
 
         return get_value().get() && other_p->get_value().get() &&
             get_value()->equals(*(other_p->get_value()));
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::abs(get_value()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {value_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 1);
+        value_ = child_cast<DoubleSpec>(children[0]);
+        touch();
+      }
+
     private:
       giskard_core::DoubleSpecPtr value_;
   };
@@ -906,7 +1827,7 @@ namespace giskard_core
 
   inline AbsSpecPtr double_abs(const DoubleSpecPtr& value = double_const_spec())
   {
-    return AbsSpecPtr(new AbsSpec(value));
+    return make_spec<AbsSpec>(value);
   }
 
   class DoubleIfSpec: public DoubleSpec
@@ -937,25 +1858,50 @@ namespace giskard_core
 
       void set_condition(const DoubleSpecPtr& condition)
       {
+        touch();
         condition_ = condition;
       }
 
       void set_if(const DoubleSpecPtr& new_if)
       {
+        touch();
         if_ = new_if;
       }
 
       void set_else(const DoubleSpecPtr& new_else)
       {
+        touch();
         else_ = new_else;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<DoubleIfSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return DoubleIfKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const DoubleIfSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const DoubleIfSpec* other_p = dynamic_cast<const DoubleIfSpec*>(&other);
+        const DoubleIfSpec* other_p = static_cast<const DoubleIfSpec*>(&other);
 
         return get_condition().get() && get_if().get() && get_else().get() &&
             other_p->get_condition().get() && other_p->get_if().get() && other_p->get_else().get() &&
@@ -964,11 +1910,25 @@ namespace giskard_core
             get_else()->equals(*(other_p->get_else()));
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::conditional<double>(get_condition()->get_expression(scope), get_if()->get_expression(scope), get_else()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {condition_, if_, else_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 3);
+        condition_ = child_cast<DoubleSpec>(children[0]);
+        if_ = child_cast<DoubleSpec>(children[1]);
+        else_ = child_cast<DoubleSpec>(children[2]);
+        touch();
+      }
+
     private:
       giskard_core::DoubleSpecPtr condition_, if_, else_;
   };
@@ -978,7 +1938,7 @@ namespace giskard_core
   inline DoubleSpecPtr double_if(const DoubleSpecPtr& condition_ =
       double_const_spec(), const DoubleSpecPtr& if_ = double_const_spec(), const DoubleSpecPtr& else_ = double_const_spec())
   {
-    return DoubleIfSpecPtr(new DoubleIfSpec(condition_, if_, else_));
+    return make_spec<DoubleIfSpec>(condition_, if_, else_);
   }
 
   class FmodSpec: public DoubleSpec
@@ -999,6 +1959,7 @@ namespace giskard_core
 
       void set_nominator(const DoubleSpecPtr& nominator)
       {
+        touch();
         nominator_ = nominator;
       }
 
@@ -1009,6 +1970,7 @@ namespace giskard_core
 
       void set_denominator(const DoubleSpecPtr& denominator)
       {
+        touch();
         denominator_ = denominator;
       }
 
@@ -1017,12 +1979,34 @@ namespace giskard_core
         return get_nominator().get() && get_denominator().get();
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<FmodSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return FmodKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const FmodSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const FmodSpec* other_p = dynamic_cast<const FmodSpec*>(&other);
+        const FmodSpec* other_p = static_cast<const FmodSpec*>(&other);
 
         if(!members_valid() || !other_p->members_valid())
           return false;
@@ -1031,7 +2015,7 @@ namespace giskard_core
                (get_denominator()->equals(*( other_p->get_denominator())));
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         // note: This expression only expects a TRUE expressions for the nominator.
         //       While this makes sense, it does break code symmetry.
@@ -1041,6 +2025,19 @@ namespace giskard_core
         return KDL::fmod(nominator, denominator);
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {nominator_, denominator_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 2);
+        nominator_ = child_cast<DoubleSpec>(children[0]);
+        denominator_ = child_cast<DoubleSpec>(children[1]);
+        touch();
+      }
+
     private:
       DoubleSpecPtr nominator_, denominator_;
   };
@@ -1050,7 +2047,7 @@ namespace giskard_core
   inline DoubleSpecPtr fmod(const DoubleSpecPtr& nominator =
       double_const_spec(), const DoubleSpecPtr& demoninator = double_const_spec())
   {
-    return FmodSpecPtr(new FmodSpec(nominator, demoninator));
+    return make_spec<FmodSpec>(nominator, demoninator);
   }
 
   class SinSpec: public DoubleSpec
@@ -1063,25 +2060,60 @@ namespace giskard_core
 
       void set_value(const DoubleSpecPtr& value)
       {
+        touch();
         value_ = value;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<SinSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return SinKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const SinSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const SinSpec* other_p = dynamic_cast<const SinSpec*>(&other);
+        const SinSpec* other_p = static_cast<const SinSpec*>(&other);
 
         return get_value().get() && other_p->get_value().get() &&
             get_value()->equals(*(other_p->get_value()));
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::sin(get_value()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {value_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 1);
+        value_ = child_cast<DoubleSpec>(children[0]);
+        touch();
+      }
+
     private:
       giskard_core::DoubleSpecPtr value_;
   };
@@ -1098,25 +2130,60 @@ namespace giskard_core
 
       void set_value(const DoubleSpecPtr& value)
       {
+        touch();
         value_ = value;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<CosSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return CosKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const CosSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const CosSpec* other_p = dynamic_cast<const CosSpec*>(&other);
+        const CosSpec* other_p = static_cast<const CosSpec*>(&other);
 
         return get_value().get() && other_p->get_value().get() &&
             get_value()->equals(*(other_p->get_value()));
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::cos(get_value()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {value_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 1);
+        value_ = child_cast<DoubleSpec>(children[0]);
+        touch();
+      }
+
     private:
       giskard_core::DoubleSpecPtr value_;
   };
@@ -1133,25 +2200,60 @@ namespace giskard_core
 
       void set_value(const DoubleSpecPtr& value)
       {
+        touch();
         value_ = value;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<TanSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return TanKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const TanSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const TanSpec* other_p = dynamic_cast<const TanSpec*>(&other);
+        const TanSpec* other_p = static_cast<const TanSpec*>(&other);
 
         return get_value().get() && other_p->get_value().get() &&
             get_value()->equals(*(other_p->get_value()));
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::tan(get_value()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {value_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 1);
+        value_ = child_cast<DoubleSpec>(children[0]);
+        touch();
+      }
+
     private:
       giskard_core::DoubleSpecPtr value_;
   };
@@ -1169,25 +2271,60 @@ namespace giskard_core
 
       void set_value(const DoubleSpecPtr& value)
       {
+        touch();
         value_ = value;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<ASinSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return ASinKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const ASinSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const ASinSpec* other_p = dynamic_cast<const ASinSpec*>(&other);
+        const ASinSpec* other_p = static_cast<const ASinSpec*>(&other);
 
         return get_value().get() && other_p->get_value().get() &&
             get_value()->equals(*(other_p->get_value()));
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::asin(get_value()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {value_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 1);
+        value_ = child_cast<DoubleSpec>(children[0]);
+        touch();
+      }
+
     private:
       giskard_core::DoubleSpecPtr value_;
   };
@@ -1204,25 +2341,60 @@ namespace giskard_core
 
       void set_value(const DoubleSpecPtr& value)
       {
+        touch();
         value_ = value;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<ACosSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return ACosKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const ACosSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const ACosSpec* other_p = dynamic_cast<const ACosSpec*>(&other);
+        const ACosSpec* other_p = static_cast<const ACosSpec*>(&other);
 
         return get_value().get() && other_p->get_value().get() &&
             get_value()->equals(*(other_p->get_value()));
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::acos(get_value()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {value_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 1);
+        value_ = child_cast<DoubleSpec>(children[0]);
+        touch();
+      }
+
     private:
       giskard_core::DoubleSpecPtr value_;
   };
@@ -1239,25 +2411,60 @@ namespace giskard_core
 
       void set_value(const DoubleSpecPtr& value)
       {
+        touch();
         value_ = value;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<ATanSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return ATanKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const ATanSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const ATanSpec* other_p = dynamic_cast<const ATanSpec*>(&other);
+        const ATanSpec* other_p = static_cast<const ATanSpec*>(&other);
 
         return get_value().get() && other_p->get_value().get() &&
             get_value()->equals(*(other_p->get_value()));
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::atan(get_value()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {value_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 1);
+        value_ = child_cast<DoubleSpec>(children[0]);
+        touch();
+      }
+
     private:
       giskard_core::DoubleSpecPtr value_;
   };
@@ -1274,25 +2481,60 @@ namespace giskard_core
 
       void set_value(const DoubleSpecPtr& value)
       {
+        touch();
         value_ = value;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<SqrtSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return SqrtKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const SqrtSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const SqrtSpec* other_p = dynamic_cast<const SqrtSpec*>(&other);
+        const SqrtSpec* other_p = static_cast<const SqrtSpec*>(&other);
 
         return get_value().get() && other_p->get_value().get() &&
             get_value()->equals(*(other_p->get_value()));
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::sqrt(get_value()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {value_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 1);
+        value_ = child_cast<DoubleSpec>(children[0]);
+        touch();
+      }
+
     private:
       giskard_core::DoubleSpecPtr value_;
   };
@@ -1314,20 +2556,44 @@ namespace giskard_core
 
       void set_lhs(const DoubleSpecPtr& lhs)
       {
+        touch();
         lhs_ = lhs;
       }
 
       void set_rhs(const DoubleSpecPtr& rhs)
       {
+        touch();
         rhs_ = rhs;
       }
 
-      virtual bool equals(const Spec& other) const
+      virtual SpecPtr clone() const
       {
-        if(!dynamic_cast<const MaxSpec*>(&other))
+        return make_spec<MaxSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return MaxKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
+      virtual bool equals(const Spec& other) const
+      {
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const MaxSpec* other_p = dynamic_cast<const MaxSpec*>(&other);
+        const MaxSpec* other_p = static_cast<const MaxSpec*>(&other);
 
         return get_lhs().get() && get_rhs().get() &&
             other_p->get_lhs().get() && other_p->get_rhs().get() &&
@@ -1335,17 +2601,113 @@ namespace giskard_core
             get_rhs()->equals(*(other_p->get_rhs()));
       }
 
-      virtual KDL::Expression<double>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::maximum(get_lhs()->get_expression(scope), get_rhs()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {lhs_, rhs_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 2);
+        lhs_ = child_cast<DoubleSpec>(children[0]);
+        rhs_ = child_cast<DoubleSpec>(children[1]);
+        touch();
+      }
+
     private:
       giskard_core::DoubleSpecPtr lhs_, rhs_;
   };
 
   typedef typename boost::shared_ptr<MaxSpec> MaxSpecPtr;
 
+  class DoubleCachedSpec: public DoubleSpec
+  {
+    public:
+      DoubleCachedSpec() :
+        value_( double_const_spec() ) {}
+      DoubleCachedSpec(const DoubleCachedSpec& other) :
+        value_ ( other.get_value() ) {}
+      DoubleCachedSpec(const DoubleSpecPtr& value) :
+        value_( value ) {}
+      ~DoubleCachedSpec() {}
+
+      const giskard_core::DoubleSpecPtr& get_value() const
+      {
+        return value_;
+      }
+
+      void set_value(const giskard_core::DoubleSpecPtr& value)
+      {
+        touch();
+        value_ = value;
+      }
+
+      virtual SpecPtr clone() const
+      {
+        return make_spec<DoubleCachedSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return DoubleCachedKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
+      virtual bool equals(const Spec& other) const
+      {
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
+          return false;
+
+        const DoubleCachedSpec* other_p = static_cast<const DoubleCachedSpec*>(&other);
+
+        return get_value().get() && other_p->get_value().get() &&
+            get_value()->equals(*(other_p->get_value()));
+      }
+
+      virtual KDL::Expression<double>::Ptr generate_expression(const giskard_core::Scope& scope)
+      {
+        return KDL::cached<double>(get_value()->get_expression(scope));
+      }
+
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {value_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 1);
+        value_ = child_cast<DoubleSpec>(children[0]);
+        touch();
+      }
+
+    private:
+      DoubleSpecPtr value_;
+  };
+
+  typedef typename boost::shared_ptr<DoubleCachedSpec> DoubleCachedSpecPtr;
+
+  inline DoubleSpecPtr cached_double(const DoubleSpecPtr& value)
+  {
+    return make_spec<DoubleCachedSpec>(value);
+  }
+
   ///
   /// specifications of vector expressions
   ///
@@ -1360,25 +2722,60 @@ namespace giskard_core
 
       void set_vector(const giskard_core::VectorSpecPtr& vector)
       {
+        touch();
         vector_ = vector;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<VectorCachedSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return VectorCachedKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const VectorCachedSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const VectorCachedSpec* other_p = dynamic_cast<const VectorCachedSpec*>(&other);
+        const VectorCachedSpec* other_p = static_cast<const VectorCachedSpec*>(&other);
 
         return get_vector().get() && other_p->get_vector().get() &&
             get_vector()->equals(*(other_p->get_vector()));
       }
 
-      virtual KDL::Expression<KDL::Vector>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<KDL::Vector>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::cached<KDL::Vector>(get_vector()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {vector_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 1);
+        vector_ = child_cast<VectorSpec>(children[0]);
+        touch();
+      }
+
     private:
       VectorSpecPtr vector_;
   };
@@ -1393,7 +2790,7 @@ namespace giskard_core
       VectorConstructorSpec(const DoubleSpecPtr& x, const DoubleSpecPtr& y, const DoubleSpecPtr& z) :
         x_( x ), y_( y ), z_( z ) {}
       VectorConstructorSpec(const VectorConstructorSpec& other) :
-        x_( other.get_x() ), y_( other.get_x() ), z_( other.get_x() ) {}
+        x_( other.get_x() ), y_( other.get_y() ), z_( other.get_z() ) {}
       ~VectorConstructorSpec() {}
 
       const DoubleSpecPtr& get_x() const
@@ -1403,6 +2800,7 @@ namespace giskard_core
 
       void set_x(const DoubleSpecPtr& x)
       {
+        touch();
         x_ = x;
       }
 
@@ -1413,6 +2811,7 @@ namespace giskard_core
 
       void set_y(const DoubleSpecPtr& y)
       {
+        touch();
         y_ = y;
       }
 
@@ -1423,6 +2822,7 @@ namespace giskard_core
 
       void set_z(const DoubleSpecPtr& z)
       {
+        touch();
         z_ = z;
       }
 
@@ -1434,12 +2834,34 @@ namespace giskard_core
         set_z(z);
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<VectorConstructorSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return VectorConstructorKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const VectorConstructorSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const VectorConstructorSpec* other_p = dynamic_cast<const VectorConstructorSpec*>(&other);
+        const VectorConstructorSpec* other_p = static_cast<const VectorConstructorSpec*>(&other);
         
         if(!members_valid() || !other_p->members_valid())
           return false;
@@ -1453,12 +2875,26 @@ namespace giskard_core
         return get_x().get() && get_y().get() && get_z().get();
       }
 
-      virtual KDL::Expression<KDL::Vector>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<KDL::Vector>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::vector(get_x()->get_expression(scope), 
             get_y()->get_expression(scope), get_z()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {x_, y_, z_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 3);
+        x_ = child_cast<DoubleSpec>(children[0]);
+        y_ = child_cast<DoubleSpec>(children[1]);
+        z_ = child_cast<DoubleSpec>(children[2]);
+        touch();
+      }
+
     private:
       DoubleSpecPtr x_, y_, z_;
   };
@@ -1467,7 +2903,7 @@ namespace giskard_core
 
   inline VectorSpecPtr vector_constructor_spec(const DoubleSpecPtr& x, const DoubleSpecPtr& y, const DoubleSpecPtr& z)
   {
-    return VectorConstructorSpecPtr(new VectorConstructorSpec(x, y, z));
+    return make_spec<VectorConstructorSpec>(x, y, z);
   }
 
   class VectorAdditionSpec: public VectorSpec
@@ -1480,15 +2916,38 @@ namespace giskard_core
 
       void set_inputs(const std::vector<VectorSpecPtr>& inputs)
       {
+        touch();
         inputs_ = inputs;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<VectorAdditionSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return VectorAdditionKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const VectorAdditionSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const VectorAdditionSpec* other_p = dynamic_cast<const VectorAdditionSpec*>(&other);
+        const VectorAdditionSpec* other_p = static_cast<const VectorAdditionSpec*>(&other);
 
         if(get_inputs().size() != other_p->get_inputs().size())
           return false;
@@ -1512,18 +2971,34 @@ namespace giskard_core
         return true;
       }
 
-      virtual KDL::Expression<KDL::Vector>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<KDL::Vector>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         using KDL::operator+;
 
-        KDL::Expression<KDL::Vector>::Ptr result = KDL::vector(KDL::Constant(0.0), KDL::Constant(0.0), KDL::Constant(0.0));
+        if(get_inputs().empty())
+          return KDL::Constant(KDL::Vector::Zero());
 
-        for(size_t i=0; i<get_inputs().size(); ++i)
+        KDL::Expression<KDL::Vector>::Ptr result = get_inputs()[0]->get_expression(scope);
+
+        for(size_t i=1; i<get_inputs().size(); ++i)
           result = result + get_inputs()[i]->get_expression(scope);
 
         return result;
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return std::vector<SpecPtr>(inputs_.begin(), inputs_.end());
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        std::vector<VectorSpecPtr> inputs;
+        for (auto const & child: children)
+          inputs.push_back(child_cast<VectorSpec>(child));
+        set_inputs(inputs);
+      }
+
     private:
       std::vector<giskard_core::VectorSpecPtr> inputs_;
   };
@@ -1548,15 +3023,38 @@ namespace giskard_core
 
       void set_inputs(const std::vector<VectorSpecPtr>& inputs)
       {
+        touch();
         inputs_ = inputs;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<VectorSubtractionSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return VectorSubtractionKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const VectorSubtractionSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const VectorSubtractionSpec* other_p = dynamic_cast<const VectorSubtractionSpec*>(&other);
+        const VectorSubtractionSpec* other_p = static_cast<const VectorSubtractionSpec*>(&other);
 
         if(get_inputs().size() != other_p->get_inputs().size())
           return false;
@@ -1580,7 +3078,7 @@ namespace giskard_core
         return true;
       }
 
-      virtual KDL::Expression<KDL::Vector>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<KDL::Vector>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         if(get_inputs().size() == 0)
           throw std::length_error("Found VectorSubtractionSpec with zero inputs.");
@@ -1603,6 +3101,19 @@ namespace giskard_core
         }
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return std::vector<SpecPtr>(inputs_.begin(), inputs_.end());
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        std::vector<VectorSpecPtr> inputs;
+        for (auto const & child: children)
+          inputs.push_back(child_cast<VectorSpec>(child));
+        set_inputs(inputs);
+      }
+
     private:
       std::vector<giskard_core::VectorSpecPtr> inputs_;
   };
@@ -1611,7 +3122,7 @@ namespace giskard_core
 
   inline VectorSubtractionSpecPtr vector_sub_spec(const std::vector<VectorSpecPtr>& inputs = {vector_constructor_spec()})
   {
-    return VectorSubtractionSpecPtr(new VectorSubtractionSpec(inputs));
+    return make_spec<VectorSubtractionSpec>(inputs);
   }
 
   class VectorReferenceSpec : public VectorSpec
@@ -1624,22 +3135,51 @@ namespace giskard_core
 
       void set_reference_name(const std::string& reference_name)
       {
+        touch();
         reference_name_ = reference_name;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<VectorReferenceSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return VectorReferenceKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const VectorReferenceSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        return (dynamic_cast<const VectorReferenceSpec*>(&other)->get_reference_name().compare(this->get_reference_name()) == 0);
+        return (static_cast<const VectorReferenceSpec*>(&other)->get_reference_name().compare(this->get_reference_name()) == 0);
       }
 
-      virtual KDL::Expression<KDL::Vector>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<KDL::Vector>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return scope.find_vector_expression(get_reference_name());
       }
 
+    protected:
+      virtual void hash_attributes(HashValue& seed) const
+      {
+        hash_combine(seed, hash_value(get_reference_name()));
+      }
+
     private:
       std::string reference_name_;
   };
@@ -1664,22 +3204,57 @@ namespace giskard_core
 
       void set_frame(const giskard_core::FrameSpecPtr& frame)
       {
+        touch();
         frame_ = frame;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<VectorOriginOfSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return VectorOriginOfKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const VectorOriginOfSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
           return false;
 
-        return dynamic_cast<const VectorOriginOfSpec*>(&other)->get_frame()->equals(*(this->get_frame()));
+        if(other.get_kind() != get_kind())
+          return false;
+
+        return static_cast<const VectorOriginOfSpec*>(&other)->get_frame()->equals(*(this->get_frame()));
       }
 
-      virtual KDL::Expression<KDL::Vector>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<KDL::Vector>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::origin(get_frame()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {frame_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 1);
+        frame_ = child_cast<FrameSpec>(children[0]);
+        touch();
+      }
+
     private:
       giskard_core::FrameSpecPtr frame_;
   };
@@ -1688,7 +3263,7 @@ namespace giskard_core
 
   inline VectorOriginOfSpecPtr origin(const FrameSpecPtr& frame)
   {
-    return VectorOriginOfSpecPtr(new VectorOriginOfSpec(frame));
+    return make_spec<VectorOriginOfSpec>(frame);
   }
 
   class VectorFrameMultiplicationSpec: public VectorSpec
@@ -1706,33 +3281,70 @@ namespace giskard_core
 
       void set_vector(const VectorSpecPtr& vector)
       {
+        touch();
         vector_ = vector;
       }
 
       void set_frame(const FrameSpecPtr& frame)
       {
+        touch();
         frame_ = frame;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<VectorFrameMultiplicationSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return VectorFrameMultiplicationKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const VectorFrameMultiplicationSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const VectorFrameMultiplicationSpec* other_p = dynamic_cast<const VectorFrameMultiplicationSpec*>(&other);
+        const VectorFrameMultiplicationSpec* other_p = static_cast<const VectorFrameMultiplicationSpec*>(&other);
 
         return get_frame().get() && get_vector().get() && 
             get_frame()->equals(*(other_p->get_frame())) &&
             get_vector()->equals(*(other_p->get_vector()));
       }
 
-      virtual KDL::Expression<KDL::Vector>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<KDL::Vector>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         using KDL::operator*;
 
         return get_frame()->get_expression(scope) * get_vector()->get_expression(scope);
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {frame_, vector_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 2);
+        frame_ = child_cast<FrameSpec>(children[0]);
+        vector_ = child_cast<VectorSpec>(children[1]);
+        touch();
+      }
+
     private:
       VectorSpecPtr vector_;
       FrameSpecPtr frame_;
@@ -1763,33 +3375,70 @@ namespace giskard_core
 
       void set_vector(const VectorSpecPtr& vector)
       {
+        touch();
         vector_ = vector;
       }
 
       void set_rotation(const RotationSpecPtr& rotation)
       {
+        touch();
         rotation_ = rotation;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<VectorRotationMultiplicationSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return VectorRotationMultiplicationKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const VectorRotationMultiplicationSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
           return false;
 
-        const VectorRotationMultiplicationSpec* other_p = dynamic_cast<const VectorRotationMultiplicationSpec*>(&other);
+        if(other.get_kind() != get_kind())
+          return false;
+
+        const VectorRotationMultiplicationSpec* other_p = static_cast<const VectorRotationMultiplicationSpec*>(&other);
 
         return get_rotation().get() && get_vector().get() && 
             get_rotation()->equals(*(other_p->get_rotation())) &&
             get_vector()->equals(*(other_p->get_vector()));
       }
 
-      virtual KDL::Expression<KDL::Vector>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<KDL::Vector>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         using KDL::operator*;
 
         return get_rotation()->get_expression(scope) * get_vector()->get_expression(scope);
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {rotation_, vector_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 2);
+        rotation_ = child_cast<RotationSpec>(children[0]);
+        vector_ = child_cast<VectorSpec>(children[1]);
+        touch();
+      }
+
     private:
       VectorSpecPtr vector_;
       RotationSpecPtr rotation_;
@@ -1800,7 +3449,7 @@ namespace giskard_core
   inline VectorRotationMultiplicationSpecPtr rotate_vector(const RotationSpecPtr& new_rotation =
       quaternion_spec(), const VectorSpecPtr& new_vector = vector_constructor_spec())
   {
-    return VectorRotationMultiplicationSpecPtr(new VectorRotationMultiplicationSpec(new_rotation, new_vector));
+    return make_spec<VectorRotationMultiplicationSpec>(new_rotation, new_vector);
   }
 
   class VectorDoubleMultiplicationSpec: public VectorSpec
@@ -1826,34 +3475,71 @@ namespace giskard_core
 
       void set_vector(const VectorSpecPtr& vector)
       {
+        touch();
         vector_ = vector;
       }
 
       void set_double(const DoubleSpecPtr& new_double)
       {
+        touch();
         double_ = new_double;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<VectorDoubleMultiplicationSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return VectorDoubleMultiplicationKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const VectorDoubleMultiplicationSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
         const VectorDoubleMultiplicationSpec* other_p = 
-            dynamic_cast<const VectorDoubleMultiplicationSpec*>(&other);
+            static_cast<const VectorDoubleMultiplicationSpec*>(&other);
 
         return get_double().get() && get_vector().get() && 
             get_double()->equals(*(other_p->get_double())) &&
             get_vector()->equals(*(other_p->get_vector()));
       }
 
-      virtual KDL::Expression<KDL::Vector>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<KDL::Vector>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         using KDL::operator*;
 
         return get_double()->get_expression(scope) * get_vector()->get_expression(scope);
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {double_, vector_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 2);
+        double_ = child_cast<DoubleSpec>(children[0]);
+        vector_ = child_cast<VectorSpec>(children[1]);
+        touch();
+      }
+
     private:
       VectorSpecPtr vector_;
       DoubleSpecPtr double_;
@@ -1864,7 +3550,7 @@ namespace giskard_core
   inline VectorDoubleMultiplicationSpecPtr vector_double_mul(const VectorSpecPtr& new_vector =
       vector_constructor_spec(), const DoubleSpecPtr& new_double = double_const_spec())
   {
-    return VectorDoubleMultiplicationSpecPtr(new VectorDoubleMultiplicationSpec(new_vector, new_double));
+    return make_spec<VectorDoubleMultiplicationSpec>(new_vector, new_double);
   }
 
   class VectorRotationVectorSpec : public VectorSpec
@@ -1885,22 +3571,57 @@ namespace giskard_core
 
       void set_rotation(const giskard_core::RotationSpecPtr& rotation)
       {
+        touch();
         rotation_ = rotation;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<VectorRotationVectorSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return VectorRotationVectorKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const VectorRotationVectorSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
           return false;
 
-        return dynamic_cast<const VectorRotationVectorSpec*>(&other)->get_rotation()->equals(*(this->get_rotation()));
+        if(other.get_kind() != get_kind())
+          return false;
+
+        return static_cast<const VectorRotationVectorSpec*>(&other)->get_rotation()->equals(*(this->get_rotation()));
       }
 
-      virtual KDL::Expression<KDL::Vector>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<KDL::Vector>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::getRotVec(get_rotation()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {rotation_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 1);
+        rotation_ = child_cast<RotationSpec>(children[0]);
+        touch();
+      }
+
     private:
       giskard_core::RotationSpecPtr rotation_;
   };
@@ -1909,7 +3630,7 @@ namespace giskard_core
 
   inline VectorSpecPtr rot_vector(const RotationSpecPtr& rotation = quaternion_spec())
   {
-    return VectorRotationVectorSpecPtr(new VectorRotationVectorSpec(rotation));
+    return make_spec<VectorRotationVectorSpec>(rotation);
   }
 
   class VectorCrossSpec: public VectorSpec
@@ -1927,32 +3648,69 @@ namespace giskard_core
 
       void set_lhs(const VectorSpecPtr& lhs)
       {
+        touch();
         lhs_ = lhs;
       }
 
       void set_rhs(const VectorSpecPtr& rhs)
       {
+        touch();
         rhs_ = rhs;
       }
 
-      virtual bool equals(const Spec& other) const
+      virtual SpecPtr clone() const
       {
-        if(!dynamic_cast<const VectorCrossSpec*>(&other))
-          return false;
-
-        const VectorCrossSpec* other_p = dynamic_cast<const VectorCrossSpec*>(&other);
-
-        return get_lhs().get() && get_rhs().get() &&
-            other_p->get_lhs().get() && other_p->get_rhs().get() &&
-            get_lhs()->equals(*(other_p->get_lhs())) &&
-            get_rhs()->equals(*(other_p->get_rhs()));
+        return make_spec<VectorCrossSpec>(*this);
       }
 
-      virtual KDL::Expression<KDL::Vector>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual SpecKind get_kind() const
+      {
+        return VectorCrossKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
+      virtual bool equals(const Spec& other) const
+      {
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
+          return false;
+
+        const VectorCrossSpec* other_p = static_cast<const VectorCrossSpec*>(&other);
+
+        return get_lhs().get() && get_rhs().get() &&
+            other_p->get_lhs().get() && other_p->get_rhs().get() &&
+            get_lhs()->equals(*(other_p->get_lhs())) &&
+            get_rhs()->equals(*(other_p->get_rhs()));
+      }
+
+      virtual KDL::Expression<KDL::Vector>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::cross(get_lhs()->get_expression(scope), get_rhs()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {lhs_, rhs_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 2);
+        lhs_ = child_cast<VectorSpec>(children[0]);
+        rhs_ = child_cast<VectorSpec>(children[1]);
+        touch();
+      }
+
     private:
       giskard_core::VectorSpecPtr lhs_, rhs_;
   };
@@ -2003,34 +3761,60 @@ namespace giskard_core
 
       void set_x(double x)
       {
+        touch();
         x_ = x;
       }
 
       void set_y(double y)
       {
+        touch();
         y_ = y;
       }
       
       void set_z(double z)
       {
+        touch();
         z_ = z;
       }
 
       void set_w(double w)
       {
+        touch();
         w_ = w;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<RotationQuaternionConstructorSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return RotationQuaternionConstructorKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const RotationQuaternionConstructorSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
           return false;
 
-        return (KDL::epsilon > std::abs(dynamic_cast<const RotationQuaternionConstructorSpec*>(&other)->get_x() - this->get_x())) &&
-            (KDL::epsilon > std::abs(dynamic_cast<const RotationQuaternionConstructorSpec*>(&other)->get_y() - this->get_y())) && (KDL::epsilon > std::abs(dynamic_cast<const RotationQuaternionConstructorSpec*>(&other)->get_z() - this->get_z())) && (KDL::epsilon > std::abs(dynamic_cast<const RotationQuaternionConstructorSpec*>(&other)->get_w() - this->get_w()));
+        if(other.get_kind() != get_kind())
+          return false;
+
+        return (KDL::epsilon > std::abs(static_cast<const RotationQuaternionConstructorSpec*>(&other)->get_x() - this->get_x())) &&
+            (KDL::epsilon > std::abs(static_cast<const RotationQuaternionConstructorSpec*>(&other)->get_y() - this->get_y())) && (KDL::epsilon > std::abs(static_cast<const RotationQuaternionConstructorSpec*>(&other)->get_z() - this->get_z())) && (KDL::epsilon > std::abs(static_cast<const RotationQuaternionConstructorSpec*>(&other)->get_w() - this->get_w()));
       }
 
-      virtual KDL::Expression<KDL::Rotation>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<KDL::Rotation>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::Constant(KDL::Rotation::Quaternion(get_x(), get_y(), get_z(), get_w()));
       }
@@ -2043,7 +3827,7 @@ namespace giskard_core
 
   inline RotationSpecPtr quaternion_spec(double x, double y, double z, double w)
   {
-    return RotationQuaternionConstructorSpecPtr(new RotationQuaternionConstructorSpec(x, y, z, w));
+    return make_spec<RotationQuaternionConstructorSpec>(x, y, z, w);
   }
 
   class AxisAngleSpec: public RotationSpec
@@ -2064,6 +3848,7 @@ namespace giskard_core
 
       void set_axis(const VectorSpecPtr& axis)
       {
+        touch();
         axis_ = axis;
       }
 
@@ -2074,6 +3859,7 @@ namespace giskard_core
 
       void set_angle(const DoubleSpecPtr& angle)
       {
+        touch();
         angle_ = angle;
       }
 
@@ -2082,12 +3868,34 @@ namespace giskard_core
         return get_axis().get() && get_angle().get();
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<AxisAngleSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return AxisAngleKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const AxisAngleSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const AxisAngleSpec* other_p = dynamic_cast<const AxisAngleSpec*>(&other);
+        const AxisAngleSpec* other_p = static_cast<const AxisAngleSpec*>(&other);
 
         if(!members_valid() || !other_p->members_valid())
           return false;
@@ -2096,7 +3904,7 @@ namespace giskard_core
                (get_axis()->equals(*( other_p->get_axis())));
       }
 
-      virtual KDL::Expression<KDL::Rotation>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<KDL::Rotation>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         KDL::Expression<KDL::Vector>::Ptr axis = get_axis()->get_expression(scope);
         KDL::Expression<double>::Ptr angle = get_angle()->get_expression(scope);
@@ -2112,6 +3920,19 @@ namespace giskard_core
         return KDL::rotVec(near_axis, near_angle);
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {axis_, angle_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 2);
+        axis_ = child_cast<VectorSpec>(children[0]);
+        angle_ = child_cast<DoubleSpec>(children[1]);
+        touch();
+      }
+
     private:
       VectorSpecPtr axis_;
       DoubleSpecPtr angle_;
@@ -2122,7 +3943,7 @@ namespace giskard_core
   inline AxisAngleSpecPtr axis_angle_spec(const VectorSpecPtr& axis =
       vector_constructor_spec(), const DoubleSpecPtr& angle = double_const_spec())
   {
-    return AxisAngleSpecPtr(new AxisAngleSpec(axis, angle));
+    return make_spec<AxisAngleSpec>(axis, angle);
   }
 
   class SlerpSpec: public RotationSpec
@@ -2143,6 +3964,7 @@ namespace giskard_core
 
       void set_from(const RotationSpecPtr& from)
       {
+        touch();
         from_ = from;
       }
 
@@ -2153,6 +3975,7 @@ namespace giskard_core
 
       void set_to(const RotationSpecPtr& to)
       {
+        touch();
         to_ = to;
       }
 
@@ -2163,6 +3986,7 @@ namespace giskard_core
 
       void set_param(const DoubleSpecPtr& param)
       {
+        touch();
         param_ = param;
       }
 
@@ -2171,12 +3995,34 @@ namespace giskard_core
         return get_from().get() && get_to().get() && get_param().get();
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<SlerpSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return SlerpKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const SlerpSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const SlerpSpec* other_p = dynamic_cast<const SlerpSpec*>(&other);
+        const SlerpSpec* other_p = static_cast<const SlerpSpec*>(&other);
 
         if(!members_valid() || !other_p->members_valid())
           return false;
@@ -2186,7 +4032,7 @@ namespace giskard_core
                (get_param()->equals(*( other_p->get_param())));
       }
 
-      virtual KDL::Expression<KDL::Rotation>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<KDL::Rotation>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         // NOTE: This type of expression not part of the original KDL::expressiongraph
         //       library. It is actually part of giskard_core.
@@ -2195,6 +4041,20 @@ namespace giskard_core
             get_param()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {from_, to_, param_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 3);
+        from_ = child_cast<RotationSpec>(children[0]);
+        to_ = child_cast<RotationSpec>(children[1]);
+        param_ = child_cast<DoubleSpec>(children[2]);
+        touch();
+      }
+
     private:
       RotationSpecPtr from_, to_;
       DoubleSpecPtr param_;
@@ -2204,7 +4064,7 @@ namespace giskard_core
 
   inline RotationSpecPtr slerp_spec(const RotationSpecPtr& from, const RotationSpecPtr& to, const DoubleSpecPtr& param)
   {
-    return SlerpSpecPtr(new SlerpSpec(from, to, param));
+    return make_spec<SlerpSpec>(from, to, param);
   }
 
   class RotationReferenceSpec : public RotationSpec
@@ -2217,22 +4077,51 @@ namespace giskard_core
 
       void set_reference_name(const std::string& reference_name)
       {
+        touch();
         reference_name_ = reference_name;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<RotationReferenceSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return RotationReferenceKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const RotationReferenceSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        return (dynamic_cast<const RotationReferenceSpec*>(&other)->get_reference_name().compare(this->get_reference_name()) == 0);
+        return (static_cast<const RotationReferenceSpec*>(&other)->get_reference_name().compare(this->get_reference_name()) == 0);
       }
 
-      virtual KDL::Expression<KDL::Rotation>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<KDL::Rotation>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return scope.find_rotation_expression(get_reference_name());
       }
 
+    protected:
+      virtual void hash_attributes(HashValue& seed) const
+      {
+        hash_combine(seed, hash_value(get_reference_name()));
+      }
+
     private:
       std::string reference_name_;
   };
@@ -2257,22 +4146,57 @@ namespace giskard_core
 
       void set_rotation(const RotationSpecPtr& rotation)
       {
+        touch();
         rotation_ = rotation;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<InverseRotationSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return InverseRotationKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const InverseRotationSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
           return false;
 
-        return dynamic_cast<const InverseRotationSpec*>(&other)->get_rotation()->equals(*(this->get_rotation()));
+        if(other.get_kind() != get_kind())
+          return false;
+
+        return static_cast<const InverseRotationSpec*>(&other)->get_rotation()->equals(*(this->get_rotation()));
       }
 
-      virtual KDL::Expression<KDL::Rotation>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<KDL::Rotation>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::inv(get_rotation()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {rotation_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 1);
+        rotation_ = child_cast<RotationSpec>(children[0]);
+        touch();
+      }
+
     private:
       RotationSpecPtr rotation_;
   };
@@ -2281,7 +4205,7 @@ namespace giskard_core
   
   inline InverseRotationSpecPtr inverse_rotation_spec(const RotationSpecPtr& rotation)
   {
-    return InverseRotationSpecPtr(new InverseRotationSpec(rotation));
+    return make_spec<InverseRotationSpec>(rotation);
   }
 
   class RotationMultiplicationSpec: public RotationSpec
@@ -2302,16 +4226,39 @@ namespace giskard_core
 
       void set_inputs(const std::vector<RotationSpecPtr>& inputs)
       {
+        touch();
         inputs_ = inputs;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<RotationMultiplicationSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return RotationMultiplicationKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const RotationMultiplicationSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
         const RotationMultiplicationSpec* other_p = 
-          dynamic_cast<const RotationMultiplicationSpec*>(&other);
+          static_cast<const RotationMultiplicationSpec*>(&other);
 
         if(get_inputs().size() != other_p->get_inputs().size())
           return false;
@@ -2335,17 +4282,33 @@ namespace giskard_core
         return true;
       }
 
-      virtual KDL::Expression<KDL::Rotation>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<KDL::Rotation>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
-        KDL::Expression<KDL::Rotation>::Ptr result = KDL::Constant(KDL::Rotation::Identity());
+        if(get_inputs().empty())
+          return KDL::Constant(KDL::Rotation::Identity());
+
+        KDL::Expression<KDL::Rotation>::Ptr result = get_inputs()[0]->get_expression(scope);
 
         using KDL::operator*;
-        for(size_t i=0; i<get_inputs().size(); ++i)
+        for(size_t i=1; i<get_inputs().size(); ++i)
           result = result * get_inputs()[i]->get_expression(scope);
 
         return result; 
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return std::vector<SpecPtr>(inputs_.begin(), inputs_.end());
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        std::vector<RotationSpecPtr> inputs;
+        for (auto const & child: children)
+          inputs.push_back(child_cast<RotationSpec>(child));
+        set_inputs(inputs);
+      }
+
     private:
       std::vector<giskard_core::RotationSpecPtr> inputs_;
   };
@@ -2354,7 +4317,90 @@ namespace giskard_core
 
   inline RotationMultiplicationSpecPtr rotation_multiplication_spec(const std::vector<RotationSpecPtr>& inputs)
   {
-    return RotationMultiplicationSpecPtr(new RotationMultiplicationSpec(inputs));
+    return make_spec<RotationMultiplicationSpec>(inputs);
+  }
+
+  class RotationCachedSpec: public RotationSpec
+  {
+    public:
+      RotationCachedSpec() :
+        rotation_( quaternion_spec() ) {}
+      RotationCachedSpec(const RotationCachedSpec& other) :
+        rotation_ ( other.get_rotation() ) {}
+      RotationCachedSpec(const RotationSpecPtr& rotation) :
+        rotation_( rotation ) {}
+      ~RotationCachedSpec() {}
+
+      const giskard_core::RotationSpecPtr& get_rotation() const
+      {
+        return rotation_;
+      }
+
+      void set_rotation(const giskard_core::RotationSpecPtr& rotation)
+      {
+        touch();
+        rotation_ = rotation;
+      }
+
+      virtual SpecPtr clone() const
+      {
+        return make_spec<RotationCachedSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return RotationCachedKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
+      virtual bool equals(const Spec& other) const
+      {
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
+          return false;
+
+        const RotationCachedSpec* other_p = static_cast<const RotationCachedSpec*>(&other);
+
+        return get_rotation().get() && other_p->get_rotation().get() &&
+            get_rotation()->equals(*(other_p->get_rotation()));
+      }
+
+      virtual KDL::Expression<KDL::Rotation>::Ptr generate_expression(const giskard_core::Scope& scope)
+      {
+        return KDL::cached<KDL::Rotation>(get_rotation()->get_expression(scope));
+      }
+
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {rotation_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 1);
+        rotation_ = child_cast<RotationSpec>(children[0]);
+        touch();
+      }
+
+    private:
+      RotationSpecPtr rotation_;
+  };
+
+  typedef typename boost::shared_ptr<RotationCachedSpec> RotationCachedSpecPtr;
+
+  inline RotationSpecPtr cached_rotation(const RotationSpecPtr& rotation)
+  {
+    return make_spec<RotationCachedSpec>(rotation);
   }
 
   ///
@@ -2379,25 +4425,60 @@ namespace giskard_core
 
       void set_frame(const giskard_core::FrameSpecPtr& frame)
       {
+        touch();
         frame_ = frame;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<FrameCachedSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return FrameCachedKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const FrameCachedSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const FrameCachedSpec* other_p = dynamic_cast<const FrameCachedSpec*>(&other);
+        const FrameCachedSpec* other_p = static_cast<const FrameCachedSpec*>(&other);
 
         return get_frame().get() && other_p->get_frame().get() &&
             get_frame()->equals(*(other_p->get_frame()));
       }
 
-      virtual KDL::Expression<KDL::Frame>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<KDL::Frame>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::cached<KDL::Frame>(get_frame()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {frame_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 1);
+        frame_ = child_cast<FrameSpec>(children[0]);
+        touch();
+      }
+
     private:
       FrameSpecPtr frame_;
   };
@@ -2406,7 +4487,7 @@ namespace giskard_core
 
   inline FrameSpecPtr cached_frame(const FrameSpecPtr& frame)
   {
-    return FrameCachedSpecPtr(new FrameCachedSpec(frame));
+    return make_spec<FrameCachedSpec>(frame);
   }
 
 
@@ -2428,6 +4509,7 @@ namespace giskard_core
 
       void set_translation(const giskard_core::VectorSpecPtr& translation)
       {
+        touch();
         translation_ = translation;
       }
 
@@ -2438,15 +4520,38 @@ namespace giskard_core
 
       void set_rotation(const giskard_core::RotationSpecPtr& rotation)
       {
+        touch();
         rotation_ = rotation;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<FrameConstructorSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return FrameConstructorKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const FrameConstructorSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const FrameConstructorSpec* other_p = dynamic_cast<const FrameConstructorSpec*>(&other);
+        const FrameConstructorSpec* other_p = static_cast<const FrameConstructorSpec*>(&other);
 
         if(!members_valid() || !other_p->members_valid())
           return false;
@@ -2460,7 +4565,7 @@ namespace giskard_core
         return get_translation().get() && get_rotation().get();
       }
 
-      virtual KDL::Expression<KDL::Frame>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<KDL::Frame>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         KDL::Expression<KDL::Rotation>::Ptr rot = get_rotation()->get_expression(scope);
 
@@ -2468,6 +4573,19 @@ namespace giskard_core
         return KDL::frame(rot, trans);
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {translation_, rotation_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 2);
+        translation_ = child_cast<VectorSpec>(children[0]);
+        rotation_ = child_cast<RotationSpec>(children[1]);
+        touch();
+      }
+
     private:
       VectorSpecPtr translation_;
       RotationSpecPtr rotation_;
@@ -2477,14 +4595,14 @@ namespace giskard_core
 
   inline FrameSpecPtr frame_constructor_spec(const VectorSpecPtr& translation, const RotationSpecPtr& rotation)
   {
-    return FrameConstructorSpecPtr(new FrameConstructorSpec(translation, rotation));
+    return make_spec<FrameConstructorSpec>(translation, rotation);
   }
 
   class OrientationOfSpec : public RotationSpec
   {
     public:
       OrientationOfSpec() :
-        frame_( FrameConstructorSpecPtr(new FrameConstructorSpec())) {}
+        frame_( make_spec<FrameConstructorSpec>()) {}
       OrientationOfSpec(const OrientationOfSpec& other) :
         frame_( other.get_frame() ) {}
       OrientationOfSpec(const FrameSpecPtr& frame) :
@@ -2498,22 +4616,57 @@ namespace giskard_core
 
       void set_frame(const giskard_core::FrameSpecPtr& frame)
       {
+        touch();
         frame_ = frame;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<OrientationOfSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return OrientationOfKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const OrientationOfSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        return dynamic_cast<const OrientationOfSpec*>(&other)->get_frame()->equals(*(this->get_frame()));
+        return static_cast<const OrientationOfSpec*>(&other)->get_frame()->equals(*(this->get_frame()));
       }
 
-      virtual KDL::Expression<KDL::Rotation>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<KDL::Rotation>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::rotation(get_frame()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {frame_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 1);
+        frame_ = child_cast<FrameSpec>(children[0]);
+        touch();
+      }
+
     private:
       giskard_core::FrameSpecPtr frame_;
   };
@@ -2522,7 +4675,7 @@ namespace giskard_core
 
   inline OrientationOfSpecPtr orientation_of_spec(const FrameSpecPtr& frame)
   {
-    return OrientationOfSpecPtr(new OrientationOfSpec(frame));
+    return make_spec<OrientationOfSpec>(frame);
   }
 
   class FrameMultiplicationSpec: public FrameSpec
@@ -2542,15 +4695,38 @@ namespace giskard_core
 
       void set_inputs(const std::vector<FrameSpecPtr>& inputs)
       {
+        touch();
         inputs_ = inputs;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<FrameMultiplicationSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return FrameMultiplicationKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const FrameMultiplicationSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        const FrameMultiplicationSpec* other_p = dynamic_cast<const FrameMultiplicationSpec*>(&other);
+        const FrameMultiplicationSpec* other_p = static_cast<const FrameMultiplicationSpec*>(&other);
 
         if(get_inputs().size() != other_p->get_inputs().size())
           return false;
@@ -2574,17 +4750,33 @@ namespace giskard_core
         return true;
       }
 
-      virtual KDL::Expression<KDL::Frame>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<KDL::Frame>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
-        KDL::Expression<KDL::Frame>::Ptr result = KDL::Constant(KDL::Frame::Identity());
+        if(get_inputs().empty())
+          return KDL::Constant(KDL::Frame::Identity());
+
+        KDL::Expression<KDL::Frame>::Ptr result = get_inputs()[0]->get_expression(scope);
 
         using KDL::operator*;
-        for(size_t i=0; i<get_inputs().size(); ++i)
+        for(size_t i=1; i<get_inputs().size(); ++i)
           result = result * get_inputs()[i]->get_expression(scope);
 
         return result;
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return std::vector<SpecPtr>(inputs_.begin(), inputs_.end());
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        std::vector<FrameSpecPtr> inputs;
+        for (auto const & child: children)
+          inputs.push_back(child_cast<FrameSpec>(child));
+        set_inputs(inputs);
+      }
+
     private:
       std::vector<giskard_core::FrameSpecPtr> inputs_;
   };
@@ -2593,7 +4785,7 @@ namespace giskard_core
 
   inline FrameMultiplicationSpecPtr frame_multiplication_spec(const std::vector<FrameSpecPtr>& inputs = {})
   {
-    return FrameMultiplicationSpecPtr(new FrameMultiplicationSpec(inputs));
+    return make_spec<FrameMultiplicationSpec>(inputs);
   }
 
   class FrameReferenceSpec : public FrameSpec
@@ -2606,22 +4798,51 @@ namespace giskard_core
 
       void set_reference_name(const std::string& reference_name)
       {
+        touch();
         reference_name_ = reference_name;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<FrameReferenceSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return FrameReferenceKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const FrameReferenceSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        return (dynamic_cast<const FrameReferenceSpec*>(&other)->get_reference_name().compare(this->get_reference_name()) == 0);
+        return (static_cast<const FrameReferenceSpec*>(&other)->get_reference_name().compare(this->get_reference_name()) == 0);
       }
 
-      virtual KDL::Expression<KDL::Frame>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<KDL::Frame>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return scope.find_frame_expression(get_reference_name());
       }
 
+    protected:
+      virtual void hash_attributes(HashValue& seed) const
+      {
+        hash_combine(seed, hash_value(get_reference_name()));
+      }
+
     private:
       std::string reference_name_;
   };
@@ -2646,22 +4867,57 @@ namespace giskard_core
 
       void set_frame(const FrameSpecPtr& frame)
       {
+        touch();
         frame_ = frame;
       }
 
+      virtual SpecPtr clone() const
+      {
+        return make_spec<InverseFrameSpec>(*this);
+      }
+
+      virtual SpecKind get_kind() const
+      {
+        return InverseFrameKind;
+      }
+
+      virtual void accept(SpecVisitor& visitor)
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const InverseFrameSpec*>(&other))
+        if(this == &other)
+          return true;
+
+        HashPass pass;
+        if(hash() != other.hash())
+          return false;
+
+        if(other.get_kind() != get_kind())
           return false;
 
-        return dynamic_cast<const InverseFrameSpec*>(&other)->get_frame()->equals(*(this->get_frame()));
+        return static_cast<const InverseFrameSpec*>(&other)->get_frame()->equals(*(this->get_frame()));
       }
 
-      virtual KDL::Expression<KDL::Frame>::Ptr get_expression(const giskard_core::Scope& scope)
+      virtual KDL::Expression<KDL::Frame>::Ptr generate_expression(const giskard_core::Scope& scope)
       {
         return KDL::inv(get_frame()->get_expression(scope));
       }
 
+      virtual std::vector<SpecPtr> get_children() const
+      {
+        return {frame_};
+      }
+
+      virtual void set_children(const std::vector<SpecPtr>& children)
+      {
+        check_num_children(children, 1);
+        frame_ = child_cast<FrameSpec>(children[0]);
+        touch();
+      }
+
     private:
       FrameSpecPtr frame_;
   };
@@ -2671,7 +4927,7 @@ namespace giskard_core
   inline InverseFrameSpecPtr inverse_frame_spec(const FrameSpecPtr& frame =
       frame_constructor_spec())
   {
-    return InverseFrameSpecPtr(new InverseFrameSpec(frame));
+    return make_spec<InverseFrameSpec>(frame);
   }
 
   ///
@@ -2741,6 +4997,280 @@ namespace giskard_core
       std::vector< giskard_core::SoftConstraintSpec > soft_constraints_;
       std::vector< giskard_core::HardConstraintSpec > hard_constraints_;
   };
+
+  ///
+  /// default visits, forwarding to the base class of the visited spec
+  ///
+
+  inline void SpecVisitor::visit(DoubleSpec& spec)
+  {
+    visit(static_cast<Spec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(VectorSpec& spec)
+  {
+    visit(static_cast<Spec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(RotationSpec& spec)
+  {
+    visit(static_cast<Spec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(FrameSpec& spec)
+  {
+    visit(static_cast<Spec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(AliasReferenceSpec& spec)
+  {
+    visit(static_cast<Spec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(DoubleConstSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(DoubleInputSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(DoubleReferenceSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(DoubleAdditionSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(DoubleSubtractionSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(DoubleNormOfSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(DoubleMultiplicationSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(DoubleDivisionSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(DoubleXCoordOfSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(DoubleYCoordOfSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(DoubleZCoordOfSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(VectorDotSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(MinSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(AbsSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(DoubleIfSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(FmodSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(SinSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(CosSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(TanSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(ASinSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(ACosSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(ATanSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(SqrtSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(MaxSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(DoubleCachedSpec& spec)
+  {
+    visit(static_cast<DoubleSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(VectorCachedSpec& spec)
+  {
+    visit(static_cast<VectorSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(VectorConstructorSpec& spec)
+  {
+    visit(static_cast<VectorSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(VectorAdditionSpec& spec)
+  {
+    visit(static_cast<VectorSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(VectorSubtractionSpec& spec)
+  {
+    visit(static_cast<VectorSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(VectorReferenceSpec& spec)
+  {
+    visit(static_cast<VectorSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(VectorOriginOfSpec& spec)
+  {
+    visit(static_cast<VectorSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(VectorFrameMultiplicationSpec& spec)
+  {
+    visit(static_cast<VectorSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(VectorRotationMultiplicationSpec& spec)
+  {
+    visit(static_cast<VectorSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(VectorDoubleMultiplicationSpec& spec)
+  {
+    visit(static_cast<VectorSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(VectorRotationVectorSpec& spec)
+  {
+    visit(static_cast<VectorSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(VectorCrossSpec& spec)
+  {
+    visit(static_cast<VectorSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(RotationQuaternionConstructorSpec& spec)
+  {
+    visit(static_cast<RotationSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(AxisAngleSpec& spec)
+  {
+    visit(static_cast<RotationSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(SlerpSpec& spec)
+  {
+    visit(static_cast<RotationSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(RotationReferenceSpec& spec)
+  {
+    visit(static_cast<RotationSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(InverseRotationSpec& spec)
+  {
+    visit(static_cast<RotationSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(RotationMultiplicationSpec& spec)
+  {
+    visit(static_cast<RotationSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(RotationCachedSpec& spec)
+  {
+    visit(static_cast<RotationSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(FrameCachedSpec& spec)
+  {
+    visit(static_cast<FrameSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(FrameConstructorSpec& spec)
+  {
+    visit(static_cast<FrameSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(OrientationOfSpec& spec)
+  {
+    visit(static_cast<RotationSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(FrameMultiplicationSpec& spec)
+  {
+    visit(static_cast<FrameSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(FrameReferenceSpec& spec)
+  {
+    visit(static_cast<FrameSpec&>(spec));
+  }
+
+  inline void SpecVisitor::visit(InverseFrameSpec& spec)
+  {
+    visit(static_cast<FrameSpec&>(spec));
+  }
 }
 
 #endif // GISKARD_CORE_SPECIFICATIONS_HPP
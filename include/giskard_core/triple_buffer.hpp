@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_CORE_TRIPLE_BUFFER_HPP
+#define GISKARD_CORE_TRIPLE_BUFFER_HPP
+
+#include <atomic>
+#include <cstddef>
+
+namespace giskard_core
+{
+  /**
+   * Wait-free single-producer/single-consumer exchange of values of type T.
+   *
+   * The writer fills get_write_buffer() and calls publish(), the reader calls
+   * fetch() and then reads get_read_buffer(). Neither side ever blocks, and the
+   * reader always sees the most recently published, completely written value.
+   * All three buffers are allocated upfront, so exchanging pre-sized values
+   * like Eigen vectors does not allocate.
+   */
+  template <typename T>
+  class TripleBuffer
+  {
+    public:
+      TripleBuffer() :
+        write_index_(0), middle_(1), read_index_(2)
+      {}
+
+      explicit TripleBuffer(const T& initial_value) :
+        write_index_(0), middle_(1), read_index_(2)
+      {
+        reset(initial_value);
+      }
+
+      // NOT thread-safe, only to be called before the writer and reader start.
+      void reset(const T& value)
+      {
+        for (size_t i=0; i<3; ++i)
+          buffers_[i] = value;
+        write_index_ = 0;
+        middle_.store(1);
+        read_index_ = 2;
+      }
+
+      // writer side
+      T& get_write_buffer()
+      {
+        return buffers_[write_index_];
+      }
+
+      void publish()
+      {
+        unsigned char old_middle =
+          middle_.exchange(write_index_ | fresh_flag(), std::memory_order_acq_rel);
+        write_index_ = old_middle & index_mask();
+      }
+
+      void publish(const T& value)
+      {
+        get_write_buffer() = value;
+        publish();
+      }
+
+      // reader side
+      bool has_fresh_value() const
+      {
+        return (middle_.load(std::memory_order_acquire) & fresh_flag()) != 0;
+      }
+
+      bool fetch()
+      {
+        if (!has_fresh_value())
+          return false;
+
+        unsigned char old_middle = middle_.exchange(read_index_, std::memory_order_acq_rel);
+        read_index_ = old_middle & index_mask();
+        return true;
+      }
+
+      const T& get_read_buffer() const
+      {
+        return buffers_[read_index_];
+      }
+
+    private:
+      T buffers_[3];
+      // index of the buffer currently owned by the writer
+      unsigned char write_index_;
+      // index of the buffer handed over between writer and reader, plus the
+      // flag signalling that it holds a value the reader did not fetch, yet
+      std::atomic<unsigned char> middle_;
+      // index of the buffer currently owned by the reader
+      unsigned char read_index_;
+
+      static unsigned char index_mask()
+      {
+        return 0x03;
+      }
+
+      static unsigned char fresh_flag()
+      {
+        return 0x04;
+      }
+  };
+}
+
+#endif // GISKARD_CORE_TRIPLE_BUFFER_HPP
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_CORE_WARM_START_HPP
+#define GISKARD_CORE_WARM_START_HPP
+
+#include <giskard_core/hashing.hpp>
+#include <Eigen/Core>
+#include <qpOASES.hpp>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace giskard_core
+{
+  /**
+   * Solver state of a QPController that allows a warm start of qpOASES,
+   * i.e. the status of all bounds and constraints of the working set, and the
+   * observables and the primal and dual solution of the last solve.
+   *
+   * The state is keyed by the structure hash and the spec fingerprint of the
+   * controller it was exported from. Its binary encoding uses the native byte order, it is meant to
+   * survive restarts, not to travel between machines.
+   */
+  class QPControllerWarmStart
+  {
+    public:
+      QPControllerWarmStart() : structure_hash_(0), spec_fingerprint_(0) {}
+
+      HashValue structure_hash_, spec_fingerprint_;
+      Eigen::VectorXd observables_, primal_solution_, dual_solution_;
+      // values of qpOASES::SubjectToStatus, see is_valid_status()
+      std::vector<int> bound_status_, constraint_status_;
+
+      size_t num_variables() const
+      {
+        return bound_status_.size();
+      }
+
+      size_t num_constraints() const
+      {
+        return constraint_status_.size();
+      }
+
+      std::string to_binary() const
+      {
+        if (primal_solution_.rows() != static_cast<int>(num_variables()) ||
+            dual_solution_.rows() != static_cast<int>(num_variables() + num_constraints()))
+          throw std::length_error("Solution of warm start does not match its number of variables and constraints.");
+
+        std::string result;
+        result.append(magic(), 4);
+        append(result, format_version());
+        append(result, structure_hash_);
+        append(result, spec_fingerprint_);
+        append(result, static_cast<std::uint32_t>(observables_.rows()));
+        append(result, static_cast<std::uint32_t>(num_variables()));
+        append(result, static_cast<std::uint32_t>(num_constraints()));
+        result.append(reinterpret_cast<const char*>(observables_.data()), observables_.rows() * sizeof(double));
+        result.append(reinterpret_cast<const char*>(primal_solution_.data()), primal_solution_.rows() * sizeof(double));
+        result.append(reinterpret_cast<const char*>(dual_solution_.data()), dual_solution_.rows() * sizeof(double));
+        for (size_t i=0; i<bound_status_.size(); ++i)
+          result.push_back(static_cast<char>(bound_status_[i]));
+        for (size_t i=0; i<constraint_status_.size(); ++i)
+          result.push_back(static_cast<char>(constraint_status_[i]));
+
+        return result;
+      }
+
+      static QPControllerWarmStart from_binary(const std::string& data)
+      {
+        if (data.size() < 4 || data.compare(0, 4, magic(), 4) != 0)
+          throw std::runtime_error("Data is not a giskard warm start.");
+
+        size_t offset = 4;
+        if (read<std::uint32_t>(data, offset) != format_version())
+          throw std::runtime_error("Warm start has unsupported format version.");
+
+        QPControllerWarmStart result;
+        result.structure_hash_ = read<HashValue>(data, offset);
+        result.spec_fingerprint_ = read<HashValue>(data, offset);
+        size_t num_observables = read<std::uint32_t>(data, offset);
+        size_t num_variables = read<std::uint32_t>(data, offset);
+        size_t num_constraints = read<std::uint32_t>(data, offset);
+
+        size_t expected_size = offset +
+          (num_observables + 2*num_variables + num_constraints) * sizeof(double) +
+          num_variables + num_constraints;
+        if (data.size() != expected_size)
+          throw std::runtime_error("Warm start has size " + std::to_string(data.size()) +
+              ", expected " + std::to_string(expected_size) + ".");
+
+        result.observables_.resize(num_observables);
+        read_doubles(data, offset, result.observables_);
+        result.primal_solution_.resize(num_variables);
+        read_doubles(data, offset, result.primal_solution_);
+        result.dual_solution_.resize(num_variables + num_constraints);
+        read_doubles(data, offset, result.dual_solution_);
+        for (size_t i=0; i<num_variables; ++i)
+          result.bound_status_.push_back(read_status(data, offset));
+        for (size_t i=0; i<num_constraints; ++i)
+          result.constraint_status_.push_back(read_status(data, offset));
+
+        return result;
+      }
+
+      // A working set only has bounds and constraints that are inactive, or at their lower or upper bound.
+      static bool is_valid_status(int status)
+      {
+        return status == qpOASES::ST_LOWER || status == qpOASES::ST_INACTIVE || status == qpOASES::ST_UPPER;
+      }
+
+    private:
+      static const char* magic()
+      {
+        return "GSKW";
+      }
+
+      static std::uint32_t format_version()
+      {
+        return 2;
+      }
+
+      template <typename T>
+      static void append(std::string& data, const T& value)
+      {
+        data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+      }
+
+      template <typename T>
+      static T read(const std::string& data, size_t& offset)
+      {
+        if (offset + sizeof(T) > data.size())
+          throw std::runtime_error("Warm start is truncated.");
+
+        T value;
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return value;
+      }
+
+      static int read_status(const std::string& data, size_t& offset)
+      {
+        int status = static_cast<signed char>(data[offset++]);
+        if (!is_valid_status(status))
+          throw std::runtime_error("Warm start has invalid status " + std::to_string(status) + ".");
+        return status;
+      }
+
+      static void read_doubles(const std::string& data, size_t& offset, Eigen::VectorXd& values)
+      {
+        std::memcpy(values.data(), data.data() + offset, values.rows() * sizeof(double));
+        offset += values.rows() * sizeof(double);
+      }
+  };
+}
+
+#endif // GISKARD_CORE_WARM_START_HPP
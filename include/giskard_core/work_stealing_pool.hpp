@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_CORE_WORK_STEALING_POOL_HPP
+#define GISKARD_CORE_WORK_STEALING_POOL_HPP
+
+#include <boost/shared_ptr.hpp>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace giskard_core
+{
+  /**
+   * Fixed set of worker threads executing batches of indexed tasks.
+   *
+   * run() distributes the task indices round-robin over per-worker queues.
+   * Every worker pops tasks from the back of its own queue and, once that is
+   * empty, steals from the front of the queues of the other workers. run()
+   * blocks until all tasks of the batch have finished, and rethrows the first
+   * exception thrown by any task.
+   *
+   * A pool with zero threads executes all tasks sequentially and in order on
+   * the calling thread. run() must not be called concurrently.
+   */
+  class WorkStealingPool
+  {
+    public:
+      typedef std::function<void(size_t task, size_t worker)> Task;
+
+      explicit WorkStealingPool(size_t num_threads) :
+        task_(0), generation_(0), pending_(0), stop_(false)
+      {
+        for (size_t i=0; i<num_threads; ++i)
+          queues_.push_back(QueuePtr(new Queue()));
+
+        for (size_t i=0; i<num_threads; ++i)
+          threads_.push_back(std::thread(&WorkStealingPool::work, this, i));
+      }
+
+      ~WorkStealingPool()
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          stop_ = true;
+        }
+        work_cv_.notify_all();
+
+        for (size_t i=0; i<threads_.size(); ++i)
+          threads_[i].join();
+      }
+
+      size_t num_threads() const
+      {
+        return threads_.size();
+      }
+
+      void run(size_t num_tasks, const Task& task)
+      {
+        if (num_tasks == 0)
+          return;
+
+        if (threads_.empty())
+        {
+          for (size_t i=0; i<num_tasks; ++i)
+            task(i, 0);
+          return;
+        }
+
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          task_ = &task;
+          error_ = std::exception_ptr();
+          pending_ = num_tasks;
+
+          for (size_t i=0; i<num_tasks; ++i)
+          {
+            Queue& queue = *(queues_[i % queues_.size()]);
+            std::lock_guard<std::mutex> queue_lock(queue.mutex_);
+            queue.tasks_.push_back(i);
+          }
+
+          ++generation_;
+        }
+        work_cv_.notify_all();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this] () { return pending_ == 0; });
+        task_ = 0;
+
+        if (error_)
+          std::rethrow_exception(error_);
+      }
+
+    private:
+      struct Queue
+      {
+        std::mutex mutex_;
+        std::deque<size_t> tasks_;
+      };
+      typedef typename boost::shared_ptr<Queue> QueuePtr;
+
+      std::vector<QueuePtr> queues_;
+      std::vector<std::thread> threads_;
+      std::mutex mutex_;
+      std::condition_variable work_cv_, done_cv_;
+      const Task* task_;
+      size_t generation_, pending_;
+      bool stop_;
+      std::exception_ptr error_;
+
+      void work(size_t worker)
+      {
+        size_t seen_generation = 0;
+        while (true)
+        {
+          {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [this, seen_generation] ()
+                { return stop_ || generation_ != seen_generation; });
+            if (stop_)
+              return;
+            seen_generation = generation_;
+          }
+
+          size_t index;
+          while (pop(worker, index) || steal(worker, index))
+            execute(index, worker);
+        }
+      }
+
+      void execute(size_t index, size_t worker)
+      {
+        // A popped index guarantees that its batch is still running, i.e.
+        // that task_ points to the task of that batch.
+        const Task* task;
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          task = task_;
+        }
+
+        std::exception_ptr error;
+        try
+        {
+          (*task)(index, worker);
+        }
+        catch (...)
+        {
+          error = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error && !error_)
+          error_ = error;
+        if (--pending_ == 0)
+          done_cv_.notify_all();
+      }
+
+      bool pop(size_t worker, size_t& index)
+      {
+        Queue& queue = *(queues_[worker]);
+        std::lock_guard<std::mutex> lock(queue.mutex_);
+        if (queue.tasks_.empty())
+          return false;
+
+        index = queue.tasks_.back();
+        queue.tasks_.pop_back();
+        return true;
+      }
+
+      bool steal(size_t worker, size_t& index)
+      {
+        for (size_t i=1; i<queues_.size(); ++i)
+        {
+          Queue& queue = *(queues_[(worker + i) % queues_.size()]);
+          std::lock_guard<std::mutex> lock(queue.mutex_);
+          if (queue.tasks_.empty())
+            continue;
+
+          index = queue.tasks_.front();
+          queue.tasks_.pop_front();
+          return true;
+        }
+
+        return false;
+      }
+  };
+}
+
+#endif // GISKARD_CORE_WORK_STEALING_POOL_HPP
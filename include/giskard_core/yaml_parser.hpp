@@ -22,29 +22,62 @@
 #define GISKARD_CORE_YAML_PARSER_HPP
 
 #include <yaml-cpp/yaml.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 #include <giskard_core/specifications.hpp>
 
 namespace YAML {
 
+  // encodes any spec, dispatching on its type through SpecEncoder
+  inline Node encode_spec(const giskard_core::SpecPtr& spec);
+
+  // expression types of the specs in YAML
+  enum SpecKeywordType
+  {
+    DoubleKeyword,
+    VectorKeyword,
+    RotationKeyword,
+    FrameKeyword
+  };
+
+  /**
+   * Entry of the keyword table of the parser. Tells the type and kind of
+   * the spec that a map with this keyword as its single key decodes to,
+   * and holds the predicate checking the shape of such a map and its
+   * decoder.
+   */
+  class SpecKeyword
+  {
+    public:
+      typedef bool (*Predicate)(const Node& node);
+      typedef bool (*Decoder)(const Node& node, giskard_core::SpecPtr& spec);
+
+      SpecKeywordType type_;
+      giskard_core::SpecKind kind_;
+      Predicate matches_;
+      Decoder decode_;
+  };
+
+  // entry of the single key of a map node, if it is a spec keyword and node has its shape
+  inline const SpecKeyword* find_spec_keyword(const Node& node);
+
+  inline bool decode_keyword_spec(const Node& node, SpecKeywordType type, giskard_core::SpecPtr& spec)
+  {
+    const SpecKeyword* keyword = find_spec_keyword(node);
+    return keyword && (keyword->type_ == type) && keyword->decode_(node, spec);
+  }
+
   // 
   // parsing of double specs
   //
 
   inline bool is_const_double(const Node& node)
   {
-    if(!node.IsScalar())
-      return false;
-
-    try
-    {
-      node.as<double>();
-      return true;
-    }
-    catch (const YAML::Exception& e)
-    {
-      return false;
-    }
+    double value;
+    return node.IsScalar() && convert<double>::decode(node, value);
   }
 
   template<>
@@ -63,7 +96,7 @@ namespace YAML {
       if(!is_const_double(node))
         return false;
   
-      rhs = giskard_core::DoubleConstSpecPtr(new giskard_core::DoubleConstSpec());
+      rhs = giskard_core::make_spec<giskard_core::DoubleConstSpec>();
       rhs->set_value(node.as<double>());
 
       return true;
@@ -92,7 +125,7 @@ namespace YAML {
       if(!is_input(node))
         return false;
   
-      rhs = giskard_core::DoubleInputSpecPtr(new giskard_core::DoubleInputSpec());
+      rhs = giskard_core::make_spec<giskard_core::DoubleInputSpec>();
       rhs->set_input_num(node["input-var"].as<size_t>());
 
       return true;
@@ -101,18 +134,7 @@ namespace YAML {
 
   inline bool is_double_reference(const Node& node)
   {
-    if(!node.IsScalar())
-      return false;
-
-    try
-    {
-      node.as<std::string>();
-      return true;
-    }
-    catch (const YAML::Exception& e)
-    {
-      return false;
-    }
+    return node.IsScalar();
   }
 
   template<>
@@ -131,7 +153,7 @@ namespace YAML {
       if(!is_double_reference(node))
         return false;
  
-      rhs = giskard_core::DoubleReferenceSpecPtr(new giskard_core::DoubleReferenceSpec());
+      rhs = giskard_core::make_spec<giskard_core::DoubleReferenceSpec>();
       rhs->set_reference_name(node.as<std::string>());
 
       return true;
@@ -159,7 +181,7 @@ namespace YAML {
       if(!is_double_addition(node))
         return false;
 
-      rhs = giskard_core::DoubleAdditionSpecPtr(new giskard_core::DoubleAdditionSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::DoubleAdditionSpec>(); 
       rhs->set_inputs(node["double-add"].as< std::vector<giskard_core::DoubleSpecPtr> >());
 
       return true;
@@ -187,7 +209,7 @@ namespace YAML {
       if(!is_double_subtraction(node))
         return false;
 
-      rhs = giskard_core::DoubleSubtractionSpecPtr(new giskard_core::DoubleSubtractionSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::DoubleSubtractionSpec>(); 
       rhs->set_inputs(node["double-sub"].as< std::vector<giskard_core::DoubleSpecPtr> >());
 
       return true;
@@ -215,7 +237,7 @@ namespace YAML {
       if(!is_double_norm_of(node))
         return false;
   
-      rhs = giskard_core::DoubleNormOfSpecPtr(new giskard_core::DoubleNormOfSpec());
+      rhs = giskard_core::make_spec<giskard_core::DoubleNormOfSpec>();
       rhs->set_vector(node["vector-norm"].as<giskard_core::VectorSpecPtr>());
 
       return true;
@@ -243,7 +265,7 @@ namespace YAML {
       if(!is_double_multiplication(node))
         return false;
 
-      rhs = giskard_core::DoubleMultiplicationSpecPtr(new giskard_core::DoubleMultiplicationSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::DoubleMultiplicationSpec>(); 
       rhs->set_inputs(node["double-mul"].as< std::vector<giskard_core::DoubleSpecPtr> >());
 
       return true;
@@ -271,7 +293,7 @@ namespace YAML {
       if(!is_double_division(node))
         return false;
 
-      rhs = giskard_core::DoubleDivisionSpecPtr(new giskard_core::DoubleDivisionSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::DoubleDivisionSpec>(); 
       rhs->set_inputs(node["double-div"].as< std::vector<giskard_core::DoubleSpecPtr> >());
 
       return true;
@@ -298,7 +320,7 @@ namespace YAML {
       if(!is_x_coord_of(node))
         return false;
 
-      rhs = giskard_core::DoubleXCoordOfSpecPtr(new giskard_core::DoubleXCoordOfSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::DoubleXCoordOfSpec>(); 
       rhs->set_vector(node["x-coord"].as< giskard_core::VectorSpecPtr >());
 
       return true;
@@ -325,7 +347,7 @@ namespace YAML {
       if(!is_y_coord_of(node))
         return false;
 
-      rhs = giskard_core::DoubleYCoordOfSpecPtr(new giskard_core::DoubleYCoordOfSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::DoubleYCoordOfSpec>(); 
       rhs->set_vector(node["y-coord"].as< giskard_core::VectorSpecPtr >());
 
       return true;
@@ -352,7 +374,7 @@ namespace YAML {
       if(!is_z_coord_of(node))
         return false;
 
-      rhs = giskard_core::DoubleZCoordOfSpecPtr(new giskard_core::DoubleZCoordOfSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::DoubleZCoordOfSpec>(); 
       rhs->set_vector(node["z-coord"].as< giskard_core::VectorSpecPtr >());
 
       return true;
@@ -381,7 +403,7 @@ namespace YAML {
       if(!is_vector_dot(node))
         return false;
 
-      rhs = giskard_core::VectorDotSpecPtr(new giskard_core::VectorDotSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::VectorDotSpec>(); 
       rhs->set_lhs(node["vector-dot"][0].as< giskard_core::VectorSpecPtr >());
       rhs->set_rhs(node["vector-dot"][1].as< giskard_core::VectorSpecPtr >());
 
@@ -411,7 +433,7 @@ namespace YAML {
       if(!is_vector_cross(node))
         return false;
 
-      rhs = giskard_core::VectorCrossSpecPtr(new giskard_core::VectorCrossSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::VectorCrossSpec>(); 
       rhs->set_lhs(node["vector-cross"][0].as< giskard_core::VectorSpecPtr >());
       rhs->set_rhs(node["vector-cross"][1].as< giskard_core::VectorSpecPtr >());
 
@@ -439,7 +461,7 @@ namespace YAML {
       if(!is_abs(node))
         return false;
 
-      rhs = giskard_core::AbsSpecPtr(new giskard_core::AbsSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::AbsSpec>(); 
       rhs->set_value(node["abs"].as< giskard_core::DoubleSpecPtr >());
 
       return true;
@@ -466,7 +488,7 @@ namespace YAML {
       if(!is_sin(node))
         return false;
 
-      rhs = giskard_core::SinSpecPtr(new giskard_core::SinSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::SinSpec>(); 
       rhs->set_value(node["sin"].as< giskard_core::DoubleSpecPtr >());
 
       return true;
@@ -495,7 +517,7 @@ namespace YAML {
       if(!is_max(node))
         return false;
 
-      rhs = giskard_core::MaxSpecPtr(new giskard_core::MaxSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::MaxSpec>(); 
       rhs->set_lhs(node["max"][0].as< giskard_core::DoubleSpecPtr >());
       rhs->set_rhs(node["max"][1].as< giskard_core::DoubleSpecPtr >());
 
@@ -523,7 +545,7 @@ namespace YAML {
       if(!is_cos(node))
         return false;
 
-      rhs = giskard_core::CosSpecPtr(new giskard_core::CosSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::CosSpec>(); 
       rhs->set_value(node["cos"].as< giskard_core::DoubleSpecPtr >());
 
       return true;
@@ -550,7 +572,7 @@ namespace YAML {
       if(!is_tan(node))
         return false;
 
-      rhs = giskard_core::TanSpecPtr(new giskard_core::TanSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::TanSpec>(); 
       rhs->set_value(node["tan"].as< giskard_core::DoubleSpecPtr >());
 
       return true;
@@ -577,7 +599,7 @@ namespace YAML {
       if(!is_asin(node))
         return false;
 
-      rhs = giskard_core::ASinSpecPtr(new giskard_core::ASinSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::ASinSpec>(); 
       rhs->set_value(node["asin"].as< giskard_core::DoubleSpecPtr >());
 
       return true;
@@ -604,7 +626,7 @@ namespace YAML {
       if(!is_acos(node))
         return false;
 
-      rhs = giskard_core::ACosSpecPtr(new giskard_core::ACosSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::ACosSpec>(); 
       rhs->set_value(node["acos"].as< giskard_core::DoubleSpecPtr >());
 
       return true;
@@ -631,7 +653,7 @@ namespace YAML {
       if(!is_atan(node))
         return false;
 
-      rhs = giskard_core::ATanSpecPtr(new giskard_core::ATanSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::ATanSpec>(); 
       rhs->set_value(node["atan"].as< giskard_core::DoubleSpecPtr >());
 
       return true;
@@ -658,7 +680,7 @@ namespace YAML {
       if(!is_sqrt(node))
         return false;
 
-      rhs = giskard_core::SqrtSpecPtr(new giskard_core::SqrtSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::SqrtSpec>(); 
       rhs->set_value(node["sqrt"].as< giskard_core::DoubleSpecPtr >());
 
       return true;
@@ -687,7 +709,7 @@ namespace YAML {
       if(!is_fmod(node))
         return false;
 
-      rhs = giskard_core::FmodSpecPtr(new giskard_core::FmodSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::FmodSpec>(); 
       rhs->set_nominator(node["fmod"][0].as< giskard_core::DoubleSpecPtr >());
       rhs->set_denominator(node["fmod"][1].as< giskard_core::DoubleSpecPtr >());
 
@@ -717,7 +739,7 @@ namespace YAML {
       if(!is_min(node))
         return false;
 
-      rhs = giskard_core::MinSpecPtr(new giskard_core::MinSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::MinSpec>(); 
       rhs->set_lhs(node["min"][0].as< giskard_core::DoubleSpecPtr >());
       rhs->set_rhs(node["min"][1].as< giskard_core::DoubleSpecPtr >());
 
@@ -748,7 +770,7 @@ namespace YAML {
       if(!is_double_if(node))
         return false;
 
-      rhs = giskard_core::DoubleIfSpecPtr(new giskard_core::DoubleIfSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::DoubleIfSpec>(); 
       rhs->set_condition(node["double-if"][0].as< giskard_core::DoubleSpecPtr >());
       rhs->set_if(node["double-if"][1].as< giskard_core::DoubleSpecPtr >());
       rhs->set_else(node["double-if"][2].as< giskard_core::DoubleSpecPtr >());
@@ -757,283 +779,58 @@ namespace YAML {
     }
   };
 
+  inline bool is_cached_double(const Node& node)
+  {
+    return node.IsMap() && (node.size() == 1) && node["cached-double"];
+  }
+
   template<>
-  struct convert<giskard_core::DoubleSpecPtr> 
+  struct convert<giskard_core::DoubleCachedSpecPtr> 
   {
-    
-    static Node encode(const giskard_core::DoubleSpecPtr& rhs) 
+    static Node encode(const giskard_core::DoubleCachedSpecPtr& rhs) 
     {
       Node node;
+      node["cached-double"] = rhs->get_value();
+      return node;
+    }
+  
+    static bool decode(const Node& node, giskard_core::DoubleCachedSpecPtr& rhs) 
+    {
+      if(!is_cached_double(node))
+        return false;
 
-      if(boost::dynamic_pointer_cast<giskard_core::DoubleConstSpec>(rhs).get())
-      {
-        giskard_core::DoubleConstSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::DoubleConstSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard_core::DoubleInputSpec>(rhs).get())
-      {
-        giskard_core::DoubleInputSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::DoubleInputSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard_core::DoubleReferenceSpec>(rhs).get())
-      {
-        giskard_core::DoubleReferenceSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::DoubleReferenceSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard_core::DoubleAdditionSpec>(rhs).get())
-      {
-        giskard_core::DoubleAdditionSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::DoubleAdditionSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard_core::DoubleSubtractionSpec>(rhs).get())
-      {
-        giskard_core::DoubleSubtractionSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::DoubleSubtractionSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard_core::DoubleNormOfSpec>(rhs).get())
-      {
-        giskard_core::DoubleNormOfSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::DoubleNormOfSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard_core::DoubleMultiplicationSpec>(rhs).get())
-      {
-        giskard_core::DoubleMultiplicationSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::DoubleMultiplicationSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard_core::DoubleDivisionSpec>(rhs).get())
-      {
-        giskard_core::DoubleDivisionSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::DoubleDivisionSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard_core::DoubleXCoordOfSpec>(rhs).get())
-      {
-        giskard_core::DoubleXCoordOfSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::DoubleXCoordOfSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard_core::DoubleYCoordOfSpec>(rhs).get())
-      {
-        giskard_core::DoubleYCoordOfSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::DoubleYCoordOfSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard_core::DoubleZCoordOfSpec>(rhs).get())
-      {
-        giskard_core::DoubleZCoordOfSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::DoubleZCoordOfSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard_core::VectorDotSpec>(rhs).get())
-      {
-        giskard_core::VectorDotSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::VectorDotSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard_core::MinSpec>(rhs).get())
-      {
-        giskard_core::MinSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::MinSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard_core::MaxSpec>(rhs).get())
-      {
-        giskard_core::MaxSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::MaxSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard_core::AbsSpec>(rhs).get())
-      {
-        giskard_core::AbsSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::AbsSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard_core::SinSpec>(rhs).get())
-      {
-        giskard_core::SinSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::SinSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard_core::CosSpec>(rhs).get())
-      {
-        giskard_core::CosSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::CosSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard_core::TanSpec>(rhs).get())
-      {
-        giskard_core::TanSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::TanSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard_core::ASinSpec>(rhs).get())
-      {
-        giskard_core::ASinSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::ASinSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard_core::ACosSpec>(rhs).get())
-      {
-        giskard_core::ACosSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::ACosSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard_core::ATanSpec>(rhs).get())
-      {
-        giskard_core::ATanSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::ATanSpec>(rhs);
-        node = p;
-      }  
-      else if(boost::dynamic_pointer_cast<giskard_core::SqrtSpec>(rhs).get())
-      {
-        giskard_core::SqrtSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::SqrtSpec>(rhs);
-        node = p;
-      }      
-      else if(boost::dynamic_pointer_cast<giskard_core::FmodSpec>(rhs).get())
-      {
-        giskard_core::FmodSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::FmodSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard_core::DoubleIfSpec>(rhs).get())
-      {
-        giskard_core::DoubleIfSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard_core::DoubleIfSpec>(rhs);
-        node = p;
-      }
+      rhs = giskard_core::make_spec<giskard_core::DoubleCachedSpec>(); 
+      rhs->set_value(node["cached-double"].as<giskard_core::DoubleSpecPtr>());
 
-      return node;
+      return true;
+    }
+  };
+
+  template<>
+  struct convert<giskard_core::DoubleSpecPtr> 
+  {
+    
+    static Node encode(const giskard_core::DoubleSpecPtr& rhs) 
+    {
+      return encode_spec(rhs);
     }
   
     static bool decode(const Node& node, giskard_core::DoubleSpecPtr& rhs) 
     {
-
+      giskard_core::SpecPtr spec;
       if(is_const_double(node))
       {
         rhs = node.as<giskard_core::DoubleConstSpecPtr>();
         return true;
       }
-      else if(is_input(node))
-      {
-        rhs = node.as<giskard_core::DoubleInputSpecPtr>();
-        return true;
-      }
-      else if(is_double_addition(node))
-      {
-        rhs = node.as<giskard_core::DoubleAdditionSpecPtr>();
-        return true;
-      }
-      else if(is_double_subtraction(node))
-      {
-        rhs = node.as<giskard_core::DoubleSubtractionSpecPtr>();
-        return true;
-      }
-      else if(is_double_multiplication(node))
-      {
-        rhs = node.as<giskard_core::DoubleMultiplicationSpecPtr>();
-        return true;
-      }
-      else if(is_double_division(node))
-      {
-        rhs = node.as<giskard_core::DoubleDivisionSpecPtr>();
-        return true;
-      }
-      else if(is_double_norm_of(node))
-      {
-        rhs = node.as<giskard_core::DoubleNormOfSpecPtr>();
-        return true;
-      }
-      else if(is_x_coord_of(node))
-      {
-        rhs = node.as<giskard_core::DoubleXCoordOfSpecPtr>();
-        return true;
-      }
-      else if(is_y_coord_of(node))
-      {
-        rhs = node.as<giskard_core::DoubleYCoordOfSpecPtr>();
-        return true;
-      }
-      else if(is_z_coord_of(node))
-      {
-        rhs = node.as<giskard_core::DoubleZCoordOfSpecPtr>();
-        return true;
-      }
       else if(is_double_reference(node))
       {
         rhs = node.as<giskard_core::DoubleReferenceSpecPtr>();
         return true;
       }
-      else if(is_vector_dot(node))
-      {
-        rhs = node.as<giskard_core::VectorDotSpecPtr>();
-        return true;
-      }
-      else if(is_min(node))
-      {
-        rhs = node.as<giskard_core::MinSpecPtr>();
-        return true;
-      }
-      else if(is_max(node))
+      else if(decode_keyword_spec(node, DoubleKeyword, spec))
       {
-        rhs = node.as<giskard_core::MaxSpecPtr>();
-        return true;
-      }
-      else if(is_abs(node))
-      {
-        rhs = node.as<giskard_core::AbsSpecPtr>();
-        return true;
-      }
-      else if(is_sin(node))
-      {
-        rhs = node.as<giskard_core::SinSpecPtr>();
-        return true;
-      }
-      else if(is_cos(node))
-      {
-        rhs = node.as<giskard_core::CosSpecPtr>();
-        return true;
-      }
-      else if(is_tan(node))
-      {
-        rhs = node.as<giskard_core::TanSpecPtr>();
-        return true;
-      }
-      else if(is_asin(node))
-      {
-        rhs = node.as<giskard_core::ASinSpecPtr>();
-        return true;
-      }
-      else if(is_acos(node))
-      {
-        rhs = node.as<giskard_core::ACosSpecPtr>();
-        return true;
-      }
-      else if(is_atan(node))
-      {
-        rhs = node.as<giskard_core::ATanSpecPtr>();
-        return true;
-      }
-      else if(is_sqrt(node))
-      {
-        rhs = node.as<giskard_core::SqrtSpecPtr>();
-        return true;
-      }
-      else if(is_fmod(node))
-      {
-        rhs = node.as<giskard_core::FmodSpecPtr>();
-        return true;
-      }
-      else if(is_double_if(node))
-      {
-        rhs = node.as<giskard_core::DoubleIfSpecPtr>();
+        rhs = boost::static_pointer_cast<giskard_core::DoubleSpec>(spec);
         return true;
       }
       else {
@@ -1067,7 +864,7 @@ namespace YAML {
       if(!is_cached_vector(node))
         return false;
 
-      rhs = giskard_core::VectorCachedSpecPtr(new giskard_core::VectorCachedSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::VectorCachedSpec>(); 
       rhs->set_vector(node["cached-vector"].as<giskard_core::VectorSpecPtr>());
 
       return true;
@@ -1097,7 +894,7 @@ namespace YAML {
       if(!is_constructor_vector(node))
         return false;
 
-      rhs = giskard_core::VectorConstructorSpecPtr(new giskard_core::VectorConstructorSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::VectorConstructorSpec>(); 
       rhs->set_x(node["vector3"][0].as<giskard_core::DoubleSpecPtr>());
       rhs->set_y(node["vector3"][1].as<giskard_core::DoubleSpecPtr>());
       rhs->set_z(node["vector3"][2].as<giskard_core::DoubleSpecPtr>());
@@ -1108,18 +905,7 @@ namespace YAML {
 
   inline bool is_vector_reference(const Node& node)
   {
-    if(!node.IsScalar())
-      return false;
-
-    try
-    {
-      node.as<std::string>();
-      return true;
-    }
-    catch (const YAML::Exception& e)
-    {
-      return false;
-    }
+    return node.IsScalar();
   }
 
   template<>
@@ -1138,7 +924,7 @@ namespace YAML {
       if(!is_vector_reference(node))
         return false;
   
-      rhs = giskard_core::VectorReferenceSpecPtr(new giskard_core::VectorReferenceSpec());
+      rhs = giskard_core::make_spec<giskard_core::VectorReferenceSpec>();
       rhs->set_reference_name(node.as<std::string>());
 
       return true;
@@ -1166,7 +952,7 @@ namespace YAML {
       if(!is_vector_origin_of(node))
         return false;
   
-      rhs = giskard_core::VectorOriginOfSpecPtr(new giskard_core::VectorOriginOfSpec());
+      rhs = giskard_core::make_spec<giskard_core::VectorOriginOfSpec>();
       rhs->set_frame(node["origin-of"].as<giskard_core::FrameSpecPtr>());
 
       return true;
@@ -1194,7 +980,7 @@ namespace YAML {
       if(!is_vector_addition(node))
         return false;
 
-      rhs = giskard_core::VectorAdditionSpecPtr(new giskard_core::VectorAdditionSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::VectorAdditionSpec>(); 
       rhs->set_inputs(node["vector-add"].as< std::vector<giskard_core::VectorSpecPtr> >());
 
       return true;
@@ -1222,7 +1008,7 @@ namespace YAML {
       if(!is_vector_subtraction(node))
         return false;
 
-      rhs = giskard_core::VectorSubtractionSpecPtr(new giskard_core::VectorSubtractionSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::VectorSubtractionSpec>(); 
       rhs->set_inputs(node["vector-sub"].as< std::vector<giskard_core::VectorSpecPtr> >());
 
       return true;
@@ -1251,7 +1037,7 @@ namespace YAML {
       if(!is_vector_rotation_multiplication(node))
         return false;
 
-      rhs = giskard_core::VectorRotationMultiplicationSpecPtr(new giskard_core::VectorRotationMultiplicationSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::VectorRotationMultiplicationSpec>(); 
       rhs->set_rotation(node["rotate-vector"][0].as< giskard_core::RotationSpecPtr >());
       rhs->set_vector(node["rotate-vector"][1].as< giskard_core::VectorSpecPtr >());
 
@@ -1281,7 +1067,7 @@ namespace YAML {
       if(!is_vector_frame_multiplication(node))
         return false;
 
-      rhs = giskard_core::VectorFrameMultiplicationSpecPtr(new giskard_core::VectorFrameMultiplicationSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::VectorFrameMultiplicationSpec>(); 
       rhs->set_frame(node["transform-vector"][0].as< giskard_core::FrameSpecPtr >());
       rhs->set_vector(node["transform-vector"][1].as< giskard_core::VectorSpecPtr >());
 
@@ -1311,7 +1097,7 @@ namespace YAML {
       if(!is_vector_double_multiplication(node))
         return false;
 
-      rhs = giskard_core::VectorDoubleMultiplicationSpecPtr(new giskard_core::VectorDoubleMultiplicationSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::VectorDoubleMultiplicationSpec>(); 
       rhs->set_double(node["scale-vector"][0].as< giskard_core::DoubleSpecPtr >());
       rhs->set_vector(node["scale-vector"][1].as< giskard_core::VectorSpecPtr >());
 
@@ -1340,7 +1126,7 @@ namespace YAML {
       if(!is_vector_rotation_vector(node))
         return false;
   
-      rhs = giskard_core::VectorRotationVectorSpecPtr(new giskard_core::VectorRotationVectorSpec());
+      rhs = giskard_core::make_spec<giskard_core::VectorRotationVectorSpec>();
       rhs->set_rotation(node["rot-vector"].as<giskard_core::RotationSpecPtr>());
 
       return true;
@@ -1352,89 +1138,20 @@ namespace YAML {
   {
     static Node encode(const giskard_core::VectorSpecPtr& rhs) 
     {
-      Node node;
-
-      if(boost::dynamic_pointer_cast<giskard_core::VectorCachedSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::VectorCachedSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard_core::VectorConstructorSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::VectorConstructorSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard_core::VectorReferenceSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::VectorReferenceSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard_core::VectorOriginOfSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::VectorOriginOfSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard_core::VectorAdditionSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::VectorAdditionSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard_core::VectorCrossSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::VectorCrossSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard_core::VectorSubtractionSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::VectorSubtractionSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard_core::VectorFrameMultiplicationSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::VectorFrameMultiplicationSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard_core::VectorRotationMultiplicationSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::VectorRotationMultiplicationSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard_core::VectorDoubleMultiplicationSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::VectorDoubleMultiplicationSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard_core::VectorRotationVectorSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::VectorRotationVectorSpec>(rhs);
-
-      return node;
+      return encode_spec(rhs);
     }
   
     static bool decode(const Node& node, giskard_core::VectorSpecPtr& rhs) 
     {
-      if(is_cached_vector(node))
-      {
-        rhs = node.as<giskard_core::VectorCachedSpecPtr>();
-        return true;
-      }
-      else if(is_constructor_vector(node))
-      {
-        rhs = node.as<giskard_core::VectorConstructorSpecPtr>();
-        return true;
-      }
-      else if(is_vector_reference(node))
+      giskard_core::SpecPtr spec;
+      if(is_vector_reference(node))
       {
         rhs = node.as<giskard_core::VectorReferenceSpecPtr>();
         return true;
       }
-      else if(is_vector_origin_of(node))
-      {
-        rhs = node.as<giskard_core::VectorOriginOfSpecPtr>();
-        return true;
-      }
-      else if(is_vector_addition(node))
-      {
-        rhs = node.as<giskard_core::VectorAdditionSpecPtr>();
-        return true;
-      }
-      else if(is_vector_cross(node))
-      {
-        rhs = node.as<giskard_core::VectorCrossSpecPtr>();
-        return true;
-      }      
-      else if(is_vector_subtraction(node))
-      {
-        rhs = node.as<giskard_core::VectorSubtractionSpecPtr>();
-        return true;
-      }
-      else if(is_vector_frame_multiplication(node))
-      {
-        rhs = node.as<giskard_core::VectorFrameMultiplicationSpecPtr>();
-        return true;
-      }
-      else if(is_vector_rotation_multiplication(node))
-      {
-        rhs = node.as<giskard_core::VectorRotationMultiplicationSpecPtr>();
-        return true;
-      }
-      else if(is_vector_double_multiplication(node))
-      {
-        rhs = node.as<giskard_core::VectorDoubleMultiplicationSpecPtr>();
-        return true;
-      }
-      else if(is_vector_rotation_vector(node))
+      else if(decode_keyword_spec(node, VectorKeyword, spec))
       {
-        rhs = node.as<giskard_core::VectorRotationVectorSpecPtr>();
+        rhs = boost::static_pointer_cast<giskard_core::VectorSpec>(spec);
         return true;
       }
       else{
@@ -1473,7 +1190,7 @@ namespace YAML {
       if(!is_quaternion_constructor(node))
         return false;
 
-      rhs = giskard_core::RotationQuaternionConstructorSpecPtr(new giskard_core::RotationQuaternionConstructorSpec());
+      rhs = giskard_core::make_spec<giskard_core::RotationQuaternionConstructorSpec>();
       rhs->set_x(node["quaternion"][0].as<double>());
       rhs->set_y(node["quaternion"][1].as<double>());
       rhs->set_z(node["quaternion"][2].as<double>());
@@ -1506,7 +1223,7 @@ namespace YAML {
       if(!is_slerp(node))
         return false;
 
-      rhs = giskard_core::SlerpSpecPtr(new giskard_core::SlerpSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::SlerpSpec>(); 
       rhs->set_from(node["slerp"][0].as<giskard_core::RotationSpecPtr>());
       rhs->set_to(node["slerp"][1].as<giskard_core::RotationSpecPtr>());
       rhs->set_param(node["slerp"][2].as<giskard_core::DoubleSpecPtr>());
@@ -1537,7 +1254,7 @@ namespace YAML {
       if(!is_axis_angle(node))
         return false;
 
-      rhs = giskard_core::AxisAngleSpecPtr(new giskard_core::AxisAngleSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::AxisAngleSpec>(); 
       rhs->set_axis(node["axis-angle"][0].as<giskard_core::VectorSpecPtr>());
       rhs->set_angle(node["axis-angle"][1].as<giskard_core::DoubleSpecPtr>());
 
@@ -1566,7 +1283,7 @@ namespace YAML {
       if(!is_orientation_of(node))
         return false;
   
-      rhs = giskard_core::OrientationOfSpecPtr(new giskard_core::OrientationOfSpec());
+      rhs = giskard_core::make_spec<giskard_core::OrientationOfSpec>();
       rhs->set_frame(node["orientation-of"].as<giskard_core::FrameSpecPtr>());
 
       return true;
@@ -1575,18 +1292,7 @@ namespace YAML {
 
   inline bool is_rotation_reference(const Node& node)
   {
-    if(!node.IsScalar())
-      return false;
-
-    try
-    {
-      node.as<std::string>();
-      return true;
-    }
-    catch (const YAML::Exception& e)
-    {
-      return false;
-    }
+    return node.IsScalar();
   }
 
   template<>
@@ -1605,7 +1311,7 @@ namespace YAML {
       if(!is_rotation_reference(node))
         return false;
  
-      rhs = giskard_core::RotationReferenceSpecPtr(new giskard_core::RotationReferenceSpec());
+      rhs = giskard_core::make_spec<giskard_core::RotationReferenceSpec>();
       rhs->set_reference_name(node.as<std::string>());
 
       return true;
@@ -1633,7 +1339,7 @@ namespace YAML {
       if(!is_inverse_rotation(node))
         return false;
 
-      rhs = giskard_core::InverseRotationSpecPtr(new giskard_core::InverseRotationSpec());
+      rhs = giskard_core::make_spec<giskard_core::InverseRotationSpec>();
       rhs->set_rotation(node["inverse-rotation"].as<giskard_core::RotationSpecPtr>());
 
       return true;
@@ -1661,73 +1367,59 @@ namespace YAML {
       if(!is_rotation_multiplication(node))
         return false;
 
-      rhs = giskard_core::RotationMultiplicationSpecPtr(new giskard_core::RotationMultiplicationSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::RotationMultiplicationSpec>(); 
       rhs->set_inputs(node["rotation-mul"].as< std::vector<giskard_core::RotationSpecPtr> >());
 
       return true;
     }
   };
 
+  inline bool is_cached_rotation(const Node& node)
+  {
+    return node.IsMap() && (node.size() == 1) && node["cached-rotation"];
+  }
+
   template<>
-  struct convert<giskard_core::RotationSpecPtr> 
+  struct convert<giskard_core::RotationCachedSpecPtr> 
   {
-    static Node encode(const giskard_core::RotationSpecPtr& rhs) 
+    static Node encode(const giskard_core::RotationCachedSpecPtr& rhs) 
     {
       Node node;
+      node["cached-rotation"] = rhs->get_rotation();
+      return node;
+    }
+  
+    static bool decode(const Node& node, giskard_core::RotationCachedSpecPtr& rhs) 
+    {
+      if(!is_cached_rotation(node))
+        return false;
 
-      if(boost::dynamic_pointer_cast<giskard_core::AxisAngleSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::AxisAngleSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard_core::RotationQuaternionConstructorSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::RotationQuaternionConstructorSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard_core::OrientationOfSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::OrientationOfSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard_core::RotationReferenceSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::RotationReferenceSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard_core::InverseRotationSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::InverseRotationSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard_core::RotationMultiplicationSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::RotationMultiplicationSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard_core::SlerpSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::SlerpSpec>(rhs);
+      rhs = giskard_core::make_spec<giskard_core::RotationCachedSpec>(); 
+      rhs->set_rotation(node["cached-rotation"].as<giskard_core::RotationSpecPtr>());
 
-      return node;
+      return true;
+    }
+  };
+
+  template<>
+  struct convert<giskard_core::RotationSpecPtr> 
+  {
+    static Node encode(const giskard_core::RotationSpecPtr& rhs) 
+    {
+      return encode_spec(rhs);
     }
   
     static bool decode(const Node& node, giskard_core::RotationSpecPtr& rhs) 
     {
-      if(is_axis_angle(node))
-      {
-        rhs = node.as<giskard_core::AxisAngleSpecPtr>();
-        return true;
-      } 
-      else if(is_slerp(node))
-      {
-        rhs = node.as<giskard_core::SlerpSpecPtr>();
-        return true;
-      } 
-      else if(is_quaternion_constructor(node))
-      {
-        rhs = node.as<giskard_core::RotationQuaternionConstructorSpecPtr>();
-        return true;
-      }
-      else if(is_rotation_reference(node))
+      giskard_core::SpecPtr spec;
+      if(is_rotation_reference(node))
       {
         rhs = node.as<giskard_core::RotationReferenceSpecPtr>();
         return true;
       }
-      else if(is_orientation_of(node))
-      {
-        rhs = node.as<giskard_core::OrientationOfSpecPtr>();
-        return true;
-      }
-      else if(is_inverse_rotation(node))
-      {
-        rhs = node.as<giskard_core::InverseRotationSpecPtr>();
-        return true;
-      }
-      else if(is_rotation_multiplication(node))
+      else if(decode_keyword_spec(node, RotationKeyword, spec))
       {
-        rhs = node.as<giskard_core::RotationMultiplicationSpecPtr>();
+        rhs = boost::static_pointer_cast<giskard_core::RotationSpec>(spec);
         return true;
       }
       else
@@ -1759,7 +1451,7 @@ namespace YAML {
       if(!is_cached_frame(node))
         return false;
 
-      rhs = giskard_core::FrameCachedSpecPtr(new giskard_core::FrameCachedSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::FrameCachedSpec>(); 
       rhs->set_frame(node["cached-frame"].as<giskard_core::FrameSpecPtr>());
 
       return true;
@@ -1788,7 +1480,7 @@ namespace YAML {
       if(!is_constructor_frame(node))
         return false;
 
-      rhs = giskard_core::FrameConstructorSpecPtr(new giskard_core::FrameConstructorSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::FrameConstructorSpec>(); 
       rhs->set_rotation(node["frame"][0].as<giskard_core::RotationSpecPtr>());
       rhs->set_translation(node["frame"][1].as<giskard_core::VectorSpecPtr>());
 
@@ -1817,7 +1509,7 @@ namespace YAML {
       if(!is_frame_multiplication(node))
         return false;
 
-      rhs = giskard_core::FrameMultiplicationSpecPtr(new giskard_core::FrameMultiplicationSpec()); 
+      rhs = giskard_core::make_spec<giskard_core::FrameMultiplicationSpec>(); 
       rhs->set_inputs(node["frame-mul"].as< std::vector<giskard_core::FrameSpecPtr> >());
 
       return true;
@@ -1826,18 +1518,7 @@ namespace YAML {
 
   inline bool is_frame_reference(const Node& node)
   {
-    if(!node.IsScalar())
-      return false;
-
-    try
-    {
-      node.as<std::string>();
-      return true;
-    }
-    catch (const YAML::Exception& e)
-    {
-      return false;
-    }
+    return node.IsScalar();
   }
 
   template<>
@@ -1856,7 +1537,7 @@ namespace YAML {
       if(!is_frame_reference(node))
         return false;
   
-      rhs = giskard_core::FrameReferenceSpecPtr(new giskard_core::FrameReferenceSpec());
+      rhs = giskard_core::make_spec<giskard_core::FrameReferenceSpec>();
       rhs->set_reference_name(node.as<std::string>());
 
       return true;
@@ -1884,7 +1565,7 @@ namespace YAML {
       if(!is_inverse_frame(node))
         return false;
 
-      rhs = giskard_core::InverseFrameSpecPtr(new giskard_core::InverseFrameSpec());
+      rhs = giskard_core::make_spec<giskard_core::InverseFrameSpec>();
       rhs->set_frame(node["inverse-frame"].as<giskard_core::FrameSpecPtr>());
 
       return true;
@@ -1896,47 +1577,20 @@ namespace YAML {
   {
     static Node encode(const giskard_core::FrameSpecPtr& rhs) 
     {
-      Node node;
-
-      if(boost::dynamic_pointer_cast<giskard_core::FrameCachedSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::FrameCachedSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard_core::FrameConstructorSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::FrameConstructorSpec>(rhs);
-      else if (boost::dynamic_pointer_cast<giskard_core::FrameMultiplicationSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::FrameMultiplicationSpec>(rhs);
-      else if (boost::dynamic_pointer_cast<giskard_core::FrameReferenceSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::FrameReferenceSpec>(rhs);
-      else if (boost::dynamic_pointer_cast<giskard_core::InverseFrameSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::InverseFrameSpec>(rhs);
-
-      return node;
+      return encode_spec(rhs);
     }
   
     static bool decode(const Node& node, giskard_core::FrameSpecPtr& rhs) 
     {
-      if(is_cached_frame(node))
-      {
-        rhs = node.as<giskard_core::FrameCachedSpecPtr>();
-        return true;
-      }
-      else if(is_constructor_frame(node))
+      giskard_core::SpecPtr spec;
+      if(is_frame_reference(node))
       {
-        rhs = node.as<giskard_core::FrameConstructorSpecPtr>();
+        rhs = node.as<giskard_core::FrameReferenceSpecPtr>();
         return true;
       }
-      else if(is_frame_multiplication(node))
+      else if(decode_keyword_spec(node, FrameKeyword, spec))
       {
-        rhs = node.as<giskard_core::FrameMultiplicationSpecPtr>();
-        return true;
-      }
-      else if(is_frame_reference(node))
-      {
-        rhs = node.as<giskard_core::FrameReferenceSpecPtr>();
-        return true;
-      }
-      else if(is_inverse_frame(node))
-      {
-        rhs = node.as<giskard_core::InverseFrameSpecPtr>();
+        rhs = boost::static_pointer_cast<giskard_core::FrameSpec>(spec);
         return true;
       }
       else
@@ -1950,18 +1604,7 @@ namespace YAML {
 
   inline bool is_alias_reference(const Node& node)
   {
-    if(!node.IsScalar() || is_const_double(node))
-      return false;
-
-    try
-    {
-      node.as<std::string>();
-      return true;
-    }
-    catch (const YAML::Exception& e)
-    {
-      return false;
-    }
+    return node.IsScalar() && !is_const_double(node);
   }
 
   template<>
@@ -1980,7 +1623,7 @@ namespace YAML {
       if(!is_alias_reference(node))
         return false;
  
-      rhs = giskard_core::AliasReferenceSpecPtr(new giskard_core::AliasReferenceSpec(node.as<std::string>()));
+      rhs = giskard_core::make_spec<giskard_core::AliasReferenceSpec>(node.as<std::string>());
 
       return true;
     }
@@ -1991,39 +1634,604 @@ namespace YAML {
   /// parsing of general specifications
   ///
 
+  /**
+   * Decoding mode used by convert<QPControllerSpec>. While a
+   * SharedSpecDecoding is alive, decode_keyword() decodes every YAML node
+   * only once. An alias is the very node of its anchor, so it decodes to
+   * the same spec, and the sharing written by emit_shared() survives parsing.
+   *
+   * Nodes are identified with Node::is(). Their marks only narrow down the
+   * search, since a map starts at the same mark as its first key.
+   */
+  class SharedSpecDecoding
+  {
+    public:
+      SharedSpecDecoding() :
+        previous_( current() )
+      {
+        current() = this;
+      }
+
+      ~SharedSpecDecoding()
+      {
+        current() = previous_;
+      }
+
+      bool find(const Node& node, giskard_core::SpecPtr& spec) const
+      {
+        if (node.Mark().is_null())
+          return false;
+
+        std::unordered_map<int, Specs>::const_iterator it = specs_.find(node.Mark().pos);
+        if (it == specs_.end())
+          return false;
+
+        for (auto const & entry: it->second)
+          if (entry.first.is(node))
+          {
+            spec = entry.second;
+            return true;
+          }
+        return false;
+      }
+
+      void insert(const Node& node, const giskard_core::SpecPtr& spec)
+      {
+        if (!node.Mark().is_null())
+          specs_[node.Mark().pos].push_back(std::make_pair(node, spec));
+      }
+
+      // decoding that decode_keyword() uses in this thread, if any
+      static SharedSpecDecoding*& current()
+      {
+        static thread_local SharedSpecDecoding* decoding = 0;
+        return decoding;
+      }
+
+    private:
+      typedef std::vector< std::pair<Node, giskard_core::SpecPtr> > Specs;
+
+      SharedSpecDecoding* previous_;
+      std::unordered_map<int, Specs> specs_;
+
+      SharedSpecDecoding(const SharedSpecDecoding& other);
+      SharedSpecDecoding& operator=(const SharedSpecDecoding& other);
+  };
+
+  template<typename T>
+  inline bool decode_keyword(const Node& node, giskard_core::SpecPtr& spec)
+  {
+    SharedSpecDecoding* shared = SharedSpecDecoding::current();
+    if (shared && shared->find(node, spec))
+      return true;
+
+    boost::shared_ptr<T> result;
+    if(!convert< boost::shared_ptr<T> >::decode(node, result))
+      return false;
+
+    spec = result;
+    if (shared)
+      shared->insert(node, spec);
+    return true;
+  }
+
+  /**
+   * All keywords of spec maps. Decoding a map looks up its single key here
+   * instead of trying every predicate in turn, so that parsing a node does
+   * not get slower with more keywords.
+   */
+  inline const std::unordered_map<std::string, SpecKeyword>& get_spec_keywords()
+  {
+    static const std::unordered_map<std::string, SpecKeyword> keywords =
+    {
+      {"input-var", {DoubleKeyword, giskard_core::DoubleInputKind, &is_input,
+          &decode_keyword<giskard_core::DoubleInputSpec>}},
+      {"double-add", {DoubleKeyword, giskard_core::DoubleAdditionKind, &is_double_addition,
+          &decode_keyword<giskard_core::DoubleAdditionSpec>}},
+      {"double-sub", {DoubleKeyword, giskard_core::DoubleSubtractionKind, &is_double_subtraction,
+          &decode_keyword<giskard_core::DoubleSubtractionSpec>}},
+      {"vector-norm", {DoubleKeyword, giskard_core::DoubleNormOfKind, &is_double_norm_of,
+          &decode_keyword<giskard_core::DoubleNormOfSpec>}},
+      {"double-mul", {DoubleKeyword, giskard_core::DoubleMultiplicationKind, &is_double_multiplication,
+          &decode_keyword<giskard_core::DoubleMultiplicationSpec>}},
+      {"double-div", {DoubleKeyword, giskard_core::DoubleDivisionKind, &is_double_division,
+          &decode_keyword<giskard_core::DoubleDivisionSpec>}},
+      {"x-coord", {DoubleKeyword, giskard_core::DoubleXCoordOfKind, &is_x_coord_of,
+          &decode_keyword<giskard_core::DoubleXCoordOfSpec>}},
+      {"y-coord", {DoubleKeyword, giskard_core::DoubleYCoordOfKind, &is_y_coord_of,
+          &decode_keyword<giskard_core::DoubleYCoordOfSpec>}},
+      {"z-coord", {DoubleKeyword, giskard_core::DoubleZCoordOfKind, &is_z_coord_of,
+          &decode_keyword<giskard_core::DoubleZCoordOfSpec>}},
+      {"vector-dot", {DoubleKeyword, giskard_core::VectorDotKind, &is_vector_dot,
+          &decode_keyword<giskard_core::VectorDotSpec>}},
+      {"min", {DoubleKeyword, giskard_core::MinKind, &is_min,
+          &decode_keyword<giskard_core::MinSpec>}},
+      {"max", {DoubleKeyword, giskard_core::MaxKind, &is_max,
+          &decode_keyword<giskard_core::MaxSpec>}},
+      {"abs", {DoubleKeyword, giskard_core::AbsKind, &is_abs,
+          &decode_keyword<giskard_core::AbsSpec>}},
+      {"double-if", {DoubleKeyword, giskard_core::DoubleIfKind, &is_double_if,
+          &decode_keyword<giskard_core::DoubleIfSpec>}},
+      {"fmod", {DoubleKeyword, giskard_core::FmodKind, &is_fmod,
+          &decode_keyword<giskard_core::FmodSpec>}},
+      {"sqrt", {DoubleKeyword, giskard_core::SqrtKind, &is_sqrt,
+          &decode_keyword<giskard_core::SqrtSpec>}},
+      {"sin", {DoubleKeyword, giskard_core::SinKind, &is_sin,
+          &decode_keyword<giskard_core::SinSpec>}},
+      {"cos", {DoubleKeyword, giskard_core::CosKind, &is_cos,
+          &decode_keyword<giskard_core::CosSpec>}},
+      {"tan", {DoubleKeyword, giskard_core::TanKind, &is_tan,
+          &decode_keyword<giskard_core::TanSpec>}},
+      {"asin", {DoubleKeyword, giskard_core::ASinKind, &is_asin,
+          &decode_keyword<giskard_core::ASinSpec>}},
+      {"acos", {DoubleKeyword, giskard_core::ACosKind, &is_acos,
+          &decode_keyword<giskard_core::ACosSpec>}},
+      {"atan", {DoubleKeyword, giskard_core::ATanKind, &is_atan,
+          &decode_keyword<giskard_core::ATanSpec>}},
+      {"cached-double", {DoubleKeyword, giskard_core::DoubleCachedKind, &is_cached_double,
+          &decode_keyword<giskard_core::DoubleCachedSpec>}},
+      {"cached-vector", {VectorKeyword, giskard_core::VectorCachedKind, &is_cached_vector,
+          &decode_keyword<giskard_core::VectorCachedSpec>}},
+      {"vector3", {VectorKeyword, giskard_core::VectorConstructorKind, &is_constructor_vector,
+          &decode_keyword<giskard_core::VectorConstructorSpec>}},
+      {"origin-of", {VectorKeyword, giskard_core::VectorOriginOfKind, &is_vector_origin_of,
+          &decode_keyword<giskard_core::VectorOriginOfSpec>}},
+      {"vector-add", {VectorKeyword, giskard_core::VectorAdditionKind, &is_vector_addition,
+          &decode_keyword<giskard_core::VectorAdditionSpec>}},
+      {"vector-sub", {VectorKeyword, giskard_core::VectorSubtractionKind, &is_vector_subtraction,
+          &decode_keyword<giskard_core::VectorSubtractionSpec>}},
+      {"transform-vector", {VectorKeyword, giskard_core::VectorFrameMultiplicationKind, &is_vector_frame_multiplication,
+          &decode_keyword<giskard_core::VectorFrameMultiplicationSpec>}},
+      {"scale-vector", {VectorKeyword, giskard_core::VectorDoubleMultiplicationKind, &is_vector_double_multiplication,
+          &decode_keyword<giskard_core::VectorDoubleMultiplicationSpec>}},
+      {"rot-vector", {VectorKeyword, giskard_core::VectorRotationVectorKind, &is_vector_rotation_vector,
+          &decode_keyword<giskard_core::VectorRotationVectorSpec>}},
+      {"rotate-vector", {VectorKeyword, giskard_core::VectorRotationMultiplicationKind, &is_vector_rotation_multiplication,
+          &decode_keyword<giskard_core::VectorRotationMultiplicationSpec>}},
+      {"vector-cross", {VectorKeyword, giskard_core::VectorCrossKind, &is_vector_cross,
+          &decode_keyword<giskard_core::VectorCrossSpec>}},
+      {"quaternion", {RotationKeyword, giskard_core::RotationQuaternionConstructorKind, &is_quaternion_constructor,
+          &decode_keyword<giskard_core::RotationQuaternionConstructorSpec>}},
+      {"axis-angle", {RotationKeyword, giskard_core::AxisAngleKind, &is_axis_angle,
+          &decode_keyword<giskard_core::AxisAngleSpec>}},
+      {"orientation-of", {RotationKeyword, giskard_core::OrientationOfKind, &is_orientation_of,
+          &decode_keyword<giskard_core::OrientationOfSpec>}},
+      {"inverse-rotation", {RotationKeyword, giskard_core::InverseRotationKind, &is_inverse_rotation,
+          &decode_keyword<giskard_core::InverseRotationSpec>}},
+      {"rotation-mul", {RotationKeyword, giskard_core::RotationMultiplicationKind, &is_rotation_multiplication,
+          &decode_keyword<giskard_core::RotationMultiplicationSpec>}},
+      {"slerp", {RotationKeyword, giskard_core::SlerpKind, &is_slerp,
+          &decode_keyword<giskard_core::SlerpSpec>}},
+      {"cached-rotation", {RotationKeyword, giskard_core::RotationCachedKind, &is_cached_rotation,
+          &decode_keyword<giskard_core::RotationCachedSpec>}},
+      {"cached-frame", {FrameKeyword, giskard_core::FrameCachedKind, &is_cached_frame,
+          &decode_keyword<giskard_core::FrameCachedSpec>}},
+      {"frame", {FrameKeyword, giskard_core::FrameConstructorKind, &is_constructor_frame,
+          &decode_keyword<giskard_core::FrameConstructorSpec>}},
+      {"frame-mul", {FrameKeyword, giskard_core::FrameMultiplicationKind, &is_frame_multiplication,
+          &decode_keyword<giskard_core::FrameMultiplicationSpec>}},
+      {"inverse-frame", {FrameKeyword, giskard_core::InverseFrameKind, &is_inverse_frame,
+          &decode_keyword<giskard_core::InverseFrameSpec>}}
+    };
+
+    return keywords;
+  }
+
+  inline const SpecKeyword* find_spec_keyword(const Node& node)
+  {
+    if(!node.IsMap() || (node.size() != 1))
+      return 0;
+
+    const Node key = node.begin()->first;
+    if(!key.IsScalar())
+      return 0;
+
+    std::unordered_map<std::string, SpecKeyword>::const_iterator it = get_spec_keywords().find(key.Scalar());
+    if(it == get_spec_keywords().end() || !it->second.matches_(node))
+      return 0;
+
+    return &it->second;
+  }
+
+  inline bool is_spec_keyword(const Node& node, SpecKeywordType type)
+  {
+    const SpecKeyword* keyword = find_spec_keyword(node);
+    return keyword && (keyword->type_ == type);
+  }
+
   inline bool is_double_spec(const Node& node)
   {
-    return is_const_double(node) || is_input(node) || is_double_reference(node) ||
-        is_double_norm_of(node) || is_double_multiplication(node) || is_double_division(node) ||
-        is_double_addition(node) || is_double_subtraction(node) ||
-        is_x_coord_of(node) || is_y_coord_of(node) || is_z_coord_of(node) ||
-        is_vector_dot(node) || is_min(node) || is_max(node) || is_double_if(node) || is_abs(node) ||
-        is_fmod(node) || is_sqrt(node) ||
-        is_sin(node) || is_cos(node) || is_tan(node) || is_asin(node) || is_acos(node) || is_atan(node);
+    return is_const_double(node) || is_double_reference(node) || is_spec_keyword(node, DoubleKeyword);
   }
 
   inline bool is_vector_spec(const Node& node)
   {
-    return is_cached_vector(node) || is_constructor_vector(node) || is_vector_reference(node) ||
-        is_vector_origin_of(node) || is_vector_addition(node) ||
-        is_vector_subtraction(node) ||
-        is_vector_frame_multiplication(node) || is_vector_double_multiplication(node) ||
-        is_vector_rotation_vector(node) || is_vector_rotation_multiplication(node) || is_vector_cross(node);
+    return is_vector_reference(node) || is_spec_keyword(node, VectorKeyword);
   }
 
   inline bool is_rotation_spec(const Node& node)
   {
-    return is_quaternion_constructor(node) || is_axis_angle(node) || 
-      is_rotation_reference(node) || is_orientation_of(node) ||
-      is_inverse_rotation(node) || is_rotation_multiplication(node) ||
-      is_slerp(node);
+    return is_rotation_reference(node) || is_spec_keyword(node, RotationKeyword);
   }
 
   inline bool is_frame_spec(const Node& node)
   {
-    return is_cached_frame(node) || is_constructor_frame(node) || 
-        is_frame_multiplication(node) || is_frame_reference(node) ||
-        is_inverse_frame(node);
+    return is_frame_reference(node) || is_spec_keyword(node, FrameKeyword);
+  }
+
+  //
+  // encoding of arbitrary specs
+  //
+
+  class SpecEncoder : public giskard_core::SpecVisitor
+  {
+    public:
+      using giskard_core::SpecVisitor::visit;
+
+      SpecEncoder(const giskard_core::SpecPtr& spec) :
+        spec_( spec ) {}
+
+      const Node& get_node() const
+      {
+        return node_;
+      }
+
+      virtual void visit(giskard_core::AliasReferenceSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::DoubleConstSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::DoubleInputSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::DoubleReferenceSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::DoubleAdditionSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::DoubleSubtractionSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::DoubleNormOfSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::DoubleMultiplicationSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::DoubleDivisionSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::DoubleXCoordOfSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::DoubleYCoordOfSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::DoubleZCoordOfSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::VectorDotSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::MinSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::AbsSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::DoubleIfSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::FmodSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::SinSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::CosSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::TanSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::ASinSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::ACosSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::ATanSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::SqrtSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::MaxSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::DoubleCachedSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::VectorCachedSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::VectorConstructorSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::VectorAdditionSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::VectorSubtractionSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::VectorReferenceSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::VectorOriginOfSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::VectorFrameMultiplicationSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::VectorRotationMultiplicationSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::VectorDoubleMultiplicationSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::VectorRotationVectorSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::VectorCrossSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::RotationQuaternionConstructorSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::AxisAngleSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::SlerpSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::RotationReferenceSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::InverseRotationSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::RotationMultiplicationSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::RotationCachedSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::FrameCachedSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::FrameConstructorSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::OrientationOfSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::FrameMultiplicationSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::FrameReferenceSpec& spec)
+      {
+        encode(spec);
+      }
+
+      virtual void visit(giskard_core::InverseFrameSpec& spec)
+      {
+        encode(spec);
+      }
+
+    private:
+      giskard_core::SpecPtr spec_;
+      Node node_;
+
+      template<typename T>
+      void encode(T& spec)
+      {
+        node_ = boost::static_pointer_cast<T>(spec_);
+      }
+  };
+
+  /**
+   * Encoding mode used by emit_shared(). While a SharedSpecEncoding is
+   * alive, encode_spec() encodes every spec node only once, and tags the
+   * encodings of nodes with several parents, so that emit_shared() can write
+   * them once as an anchor, with aliases at their other uses.
+   *
+   * Sharing is detected by pointer identity. Intern a spec with SpecInterner
+   * beforehand to also share subtrees that are merely equal.
+   */
+  class SharedSpecEncoding
+  {
+    public:
+      SharedSpecEncoding(const std::vector<giskard_core::SpecPtr>& roots) :
+        previous_( current() ), num_anchors_( 0 )
+      {
+        for (auto const & root: roots)
+          add_parent(root);
+        current() = this;
+      }
+
+      ~SharedSpecEncoding()
+      {
+        current() = previous_;
+      }
+
+      bool find(const giskard_core::SpecPtr& spec, Node& node) const
+      {
+        std::unordered_map<const giskard_core::Spec*, Node>::const_iterator it = nodes_.find(spec.get());
+        if (it == nodes_.end())
+          return false;
+
+        node = it->second;
+        return true;
+      }
+
+      void insert(const giskard_core::SpecPtr& spec, Node& node)
+      {
+        // leaves are as short as an alias to them
+        if (num_parents_[spec.get()] > 1 && !spec->get_children().empty())
+          node.SetTag(tag_prefix() + "s" + std::to_string(++num_anchors_));
+        nodes_[spec.get()] = node;
+      }
+
+      size_t num_anchors() const
+      {
+        return num_anchors_;
+      }
+
+      // prefix of the tags of shared encodings, never written to the output
+      static const std::string& tag_prefix()
+      {
+        static const std::string prefix = "!giskard-shared:";
+        return prefix;
+      }
+
+      // encoding that encode_spec() uses in this thread, if any
+      static SharedSpecEncoding*& current()
+      {
+        static thread_local SharedSpecEncoding* encoding = 0;
+        return encoding;
+      }
+
+    private:
+      SharedSpecEncoding* previous_;
+      size_t num_anchors_;
+      std::unordered_map<const giskard_core::Spec*, size_t> num_parents_;
+      std::unordered_map<const giskard_core::Spec*, Node> nodes_;
+
+      void add_parent(const giskard_core::SpecPtr& spec)
+      {
+        if (spec && ++num_parents_[spec.get()] == 1)
+          for (auto const & child: spec->get_children())
+            add_parent(child);
+      }
+
+      SharedSpecEncoding(const SharedSpecEncoding& other);
+      SharedSpecEncoding& operator=(const SharedSpecEncoding& other);
+  };
+
+  inline Node encode_spec(const giskard_core::SpecPtr& spec)
+  {
+    if(!spec)
+      return Node();
+
+    SharedSpecEncoding* shared = SharedSpecEncoding::current();
+    Node node;
+    if (shared && shared->find(spec, node))
+      return node;
+
+    SpecEncoder encoder(spec);
+    spec->accept(encoder);
+    node = encoder.get_node();
+    if (shared)
+      shared->insert(spec, node);
+    return node;
   }
 
   template<>
@@ -2031,46 +2239,22 @@ namespace YAML {
   {
     static Node encode(const giskard_core::SpecPtr& rhs) 
     {
-      Node node;
-      if(boost::dynamic_pointer_cast<giskard_core::AliasReferenceSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::AliasReferenceSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard_core::FrameSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::FrameSpec>(rhs);
-      else if (boost::dynamic_pointer_cast<giskard_core::VectorSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::VectorSpec>(rhs);
-      else if (boost::dynamic_pointer_cast<giskard_core::RotationSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::RotationSpec>(rhs);
-      else if (boost::dynamic_pointer_cast<giskard_core::DoubleSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard_core::DoubleSpec>(rhs);
-
-      return node;
+      return encode_spec(rhs);
     }
   
     static bool decode(const Node& node, giskard_core::SpecPtr& rhs) 
     {
-      if(is_alias_reference(node))
+      const SpecKeyword* keyword = find_spec_keyword(node);
+      if(keyword)
+        return keyword->decode_(node, rhs);
+      else if(is_alias_reference(node))
       {
         rhs = node.as<giskard_core::AliasReferenceSpecPtr>();
         return true;
       }
-      else if(is_double_spec(node))
-      {
-        rhs = node.as<giskard_core::DoubleSpecPtr>();
-        return true;
-      }
-      else if(is_vector_spec(node))
-      {
-        rhs = node.as<giskard_core::VectorSpecPtr>();
-        return true;
-      }
-      else if(is_rotation_spec(node))
-      {
-        rhs = node.as<giskard_core::RotationSpecPtr>();
-        return true;
-      }
-      else if(is_frame_spec(node))
+      else if(is_const_double(node))
       {
-        rhs = node.as<giskard_core::FrameSpecPtr>();
+        rhs = node.as<giskard_core::DoubleConstSpecPtr>();
         return true;
       }
       else
@@ -2247,6 +2431,7 @@ namespace YAML {
       if(!is_qp_controller_spec(node))
         return false;
 
+      SharedSpecDecoding decoding;
       rhs.scope_ = node["scope"].as< std::vector<giskard_core::ScopeEntry> >();
       rhs.controllable_constraints_ = 
           node["controllable-constraints"].as< std::vector<giskard_core::ControllableConstraintSpec> >();
@@ -2259,6 +2444,88 @@ namespace YAML {
     }
   };
 
+  ///
+  /// emission of shared subtrees
+  ///
+
+  inline void emit_shared_node(Emitter& out, const Node& node, std::unordered_set<std::string>& anchors)
+  {
+    const std::string& prefix = SharedSpecEncoding::tag_prefix();
+    if (node.Tag().compare(0, prefix.size(), prefix) == 0)
+    {
+      std::string anchor = node.Tag().substr(prefix.size());
+      if (!anchors.insert(anchor).second)
+      {
+        out << Alias(anchor);
+        return;
+      }
+      out << Anchor(anchor);
+    }
+
+    switch (node.Type())
+    {
+      case NodeType::Sequence:
+        if (node.Style() == EmitterStyle::Flow)
+          out << Flow;
+        out << BeginSeq;
+        for (auto const & element: node)
+          emit_shared_node(out, element, anchors);
+        out << EndSeq;
+        break;
+      case NodeType::Map:
+        if (node.Style() == EmitterStyle::Flow)
+          out << Flow;
+        out << BeginMap;
+        for (auto const & entry: node)
+        {
+          out << Key;
+          emit_shared_node(out, entry.first, anchors);
+          out << Value;
+          emit_shared_node(out, entry.second, anchors);
+        }
+        out << EndMap;
+        break;
+      case NodeType::Scalar:
+        out << node.Scalar();
+        break;
+      default:
+        out << Null;
+    }
+  }
+
+  /**
+   * Emits a controller spec like 'out << Node(spec)', but writes every spec
+   * node with several parents only once, as a YAML anchor, and an alias at
+   * each of its other uses. Parsing the result gives an equal spec with the
+   * same sharing, see SharedSpecDecoding.
+   */
+  inline void emit_shared(Emitter& out, const giskard_core::QPControllerSpec& spec)
+  {
+    std::vector<giskard_core::SpecPtr> roots;
+    for (auto const & entry: spec.scope_)
+      roots.push_back(entry.spec);
+    for (auto const & constraint: spec.controllable_constraints_)
+      roots.insert(roots.end(), {constraint.lower_, constraint.upper_, constraint.weight_});
+    for (auto const & constraint: spec.soft_constraints_)
+      roots.insert(roots.end(),
+          {constraint.expression_, constraint.lower_, constraint.upper_, constraint.weight_});
+    for (auto const & constraint: spec.hard_constraints_)
+      roots.insert(roots.end(), {constraint.expression_, constraint.lower_, constraint.upper_});
+
+    SharedSpecEncoding encoding(roots);
+    Node node;
+    node = spec;
+    std::unordered_set<std::string> anchors;
+    emit_shared_node(out, node, anchors);
+  }
+
+  inline std::string dump_shared(const giskard_core::QPControllerSpec& spec)
+  {
+    Emitter out;
+    emit_shared(out, spec);
+    return out.c_str();
+  }
+
 }
 
 #endif // GISKARD_CORE_YAML_PARSER_HPP
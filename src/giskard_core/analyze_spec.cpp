@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <iostream>
+#include <yaml-cpp/yaml.h>
+#include <giskard_core/giskard_core.hpp>
+
+int main(int argc, char **argv)
+{
+  if (argc != 2)
+  {
+    std::cout << "Usage: rosrun giskard_core analyze_spec <controller_spec.yaml>" << std::endl;
+    return 0;
+  }
+
+  giskard_core::QPControllerSpec spec = YAML::LoadFile(argv[1]).as<giskard_core::QPControllerSpec>();
+  std::cout << "spec '" << argv[1] << "'" << std::endl;
+  std::cout << giskard_core::analyze(spec) << std::endl;
+
+  // the sparsity of A depends on the state, this reports it for all observables at zero
+  giskard_core::QPController controller = giskard_core::generate(spec);
+  controller.start(Eigen::VectorXd::Zero(controller.num_observables()), 1000);
+  std::cout << "controller" << std::endl;
+  std::cout << giskard_core::analyze(controller);
+
+  return 0;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <fstream>
+#include <iostream>
+#include <yaml-cpp/yaml.h>
+#include <giskard_core/giskard_core.hpp>
+
+int main(int argc, char **argv)
+{
+  if (argc != 3)
+  {
+    std::cout << "Usage: rosrun giskard_core convert_spec <input_file> <output_file>" << std::endl;
+    std::cout << "Converts a YAML controller spec to the binary format, or a binary one back to YAML." << std::endl;
+    return 0;
+  }
+
+  giskard_core::MappedFile input(argv[1]);
+  if (giskard_core::is_binary_spec(input.data(), input.size()))
+  {
+    // shared nodes of the binary spec become YAML anchors
+    std::string yaml = YAML::dump_shared(giskard_core::read_binary_spec(input.data(), input.size()));
+
+    std::ofstream output_file(argv[2]);
+    if (!(output_file << yaml << std::endl))
+      throw std::runtime_error("Failed to write file '" + std::string(argv[2]) + "'.");
+  }
+  else
+  {
+    giskard_core::QPControllerSpec spec =
+      YAML::Load(std::string(input.data(), input.size())).as<giskard_core::QPControllerSpec>();
+    // equal subtrees become one node, which the binary format stores once
+    giskard_core::SpecInterner().intern(spec);
+    giskard_core::save_binary_spec(spec, argv[2]);
+  }
+
+  return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <gtest/gtest.h>
+#include <giskard_core/giskard_core.hpp>
+#include <thread>
+
+class ControllerExchangeTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      nWSR = 100;
+
+      KDL::Expression<double>::Ptr joint = KDL::input(0);
+      KDL::Expression<double>::Ptr goal = KDL::input(1);
+
+      using KDL::operator-;
+      controller.init({KDL::Constant(-0.1)}, {KDL::Constant(0.1)}, {KDL::Constant(0.1)}, {"joint"},
+          {joint}, {goal - joint}, {goal - joint}, {KDL::Constant(10.0)}, {"goal"},
+          {joint}, {KDL::Constant(-2.0) - joint}, {KDL::Constant(2.0) - joint});
+    }
+
+    virtual void TearDown(){}
+
+    giskard_core::QPController controller;
+    int nWSR;
+};
+
+TEST_F(ControllerExchangeTest, TripleBuffer)
+{
+  giskard_core::TripleBuffer<int> buffer(0);
+
+  EXPECT_FALSE(buffer.has_fresh_value());
+  EXPECT_FALSE(buffer.fetch());
+  EXPECT_EQ(0, buffer.get_read_buffer());
+
+  buffer.publish(1);
+  EXPECT_TRUE(buffer.has_fresh_value());
+  buffer.publish(2);
+  EXPECT_TRUE(buffer.fetch());
+  EXPECT_EQ(2, buffer.get_read_buffer());
+  EXPECT_FALSE(buffer.fetch());
+  EXPECT_EQ(2, buffer.get_read_buffer());
+
+  buffer.get_write_buffer() = 3;
+  buffer.publish();
+  EXPECT_TRUE(buffer.fetch());
+  EXPECT_EQ(3, buffer.get_read_buffer());
+}
+
+TEST_F(ControllerExchangeTest, ConcurrentSnapshotsAreConsistent)
+{
+  size_t num_values = 1000;
+  giskard_core::TripleBuffer<Eigen::VectorXd> buffer(Eigen::VectorXd::Zero(20));
+
+  std::thread writer([&buffer, num_values] ()
+      {
+        for (size_t i=1; i<=num_values; ++i)
+        {
+          buffer.get_write_buffer().setConstant(i);
+          buffer.publish();
+        }
+      });
+
+  double last_value = 0.0;
+  while (last_value < num_values)
+  {
+    if (!buffer.fetch())
+      continue;
+
+    const Eigen::VectorXd& snapshot = buffer.get_read_buffer();
+    ASSERT_EQ(snapshot.minCoeff(), snapshot.maxCoeff());
+    ASSERT_LT(last_value, snapshot(0));
+    last_value = snapshot(0);
+  }
+
+  writer.join();
+}
+
+TEST_F(ControllerExchangeTest, ObservableSlices)
+{
+  giskard_core::ObservablesExchange exchange(Eigen::VectorXd::Constant(4, -1.0));
+  EXPECT_EQ(4, exchange.num_observables());
+
+  size_t joints = exchange.add_slice(0, 2);
+  size_t goals = exchange.add_slice(3, 1);
+  EXPECT_EQ(2, exchange.num_slices());
+
+  EXPECT_THROW(exchange.add_slice(1, 2), std::invalid_argument);
+  EXPECT_THROW(exchange.add_slice(2, 0), std::invalid_argument);
+  EXPECT_THROW(exchange.add_slice(2, 3), std::length_error);
+  EXPECT_THROW(exchange.publish(joints, Eigen::VectorXd::Zero(3)), std::length_error);
+  EXPECT_THROW(exchange.publish(5, Eigen::VectorXd::Zero(2)), std::out_of_range);
+
+  EXPECT_TRUE(exchange.fetch().isApprox(Eigen::VectorXd::Constant(4, -1.0)));
+
+  exchange.publish(joints, Eigen::VectorXd::Constant(2, 1.0));
+  exchange.get_write_buffer(goals)(0) = 2.0;
+  exchange.publish(goals);
+
+  Eigen::VectorXd expected(4);
+  expected << 1.0, 1.0, -1.0, 2.0;
+  EXPECT_TRUE(exchange.fetch().isApprox(expected));
+  EXPECT_TRUE(exchange.get_observables().isApprox(expected));
+}
+
+TEST_F(ControllerExchangeTest, ControllerUpdate)
+{
+  giskard_core::ObservablesExchange observables(controller.num_observables());
+  size_t joints = observables.add_slice(0, 1);
+  size_t goals = observables.add_slice(1, 1);
+  giskard_core::CommandExchange commands(controller.num_controllables(),
+      controller.num_soft_constraints());
+
+  observables.publish(joints, Eigen::VectorXd::Constant(1, 0.0));
+  observables.publish(goals, Eigen::VectorXd::Constant(1, 1.0));
+  ASSERT_TRUE(controller.start(observables, commands, nWSR));
+  ASSERT_TRUE(commands.fetch());
+  EXPECT_NEAR(0.1, commands.get_command()(0), 1e-6);
+  EXPECT_EQ(1, commands.get_slack().rows());
+
+  observables.publish(goals, Eigen::VectorXd::Constant(1, -1.0));
+  ASSERT_TRUE(controller.update(observables, commands, nWSR));
+  ASSERT_TRUE(commands.fetch());
+  EXPECT_NEAR(-0.1, commands.get_command()(0), 1e-6);
+  EXPECT_FALSE(commands.fetch());
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <gtest/gtest.h>
+#include <giskard_core/giskard_core.hpp>
+#include <atomic>
+
+class ControllerSchedulerTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      nWSR = 100;
+      num_controllers = 8;
+    }
+
+    virtual void TearDown(){}
+
+    // every controller gets its own expression graph
+    giskard_core::QPController make_controller() const
+    {
+      KDL::Expression<double>::Ptr joint = KDL::input(0);
+      KDL::Expression<double>::Ptr goal = KDL::input(1);
+
+      using KDL::operator-;
+      giskard_core::QPController controller;
+      controller.init({KDL::Constant(-0.1)}, {KDL::Constant(0.1)}, {KDL::Constant(0.1)}, {"joint"},
+          {joint}, {goal - joint}, {goal - joint}, {KDL::Constant(10.0)}, {"goal"},
+          {joint}, {KDL::Constant(-2.0) - joint}, {KDL::Constant(2.0) - joint});
+      return controller;
+    }
+
+    void add_controllers(giskard_core::ControllerScheduler& scheduler, std::vector<double>& goals) const
+    {
+      goals.resize(num_controllers);
+      for (size_t i=0; i<num_controllers; ++i)
+      {
+        goals[i] = 0.05 * i - 0.2;
+        double* goal = &(goals[i]);
+        scheduler.add_controller("controller " + std::to_string(i), make_controller(),
+            [goal] (Eigen::VectorXd& observables) { observables << 0.0, *goal; }, 1.0, nWSR);
+      }
+    }
+
+    int nWSR;
+    size_t num_controllers;
+};
+
+TEST_F(ControllerSchedulerTest, PoolRunsAllTasks)
+{
+  for (size_t num_threads=0; num_threads<4; ++num_threads)
+  {
+    giskard_core::WorkStealingPool pool(num_threads);
+    EXPECT_EQ(num_threads, pool.num_threads());
+
+    for (size_t batch=0; batch<10; ++batch)
+    {
+      std::vector<std::atomic<int>> counters(100);
+      for (size_t i=0; i<counters.size(); ++i)
+        counters[i] = 0;
+
+      pool.run(counters.size(), [&counters, num_threads] (size_t task, size_t worker)
+          {
+            ASSERT_LT(worker, std::max(num_threads, size_t(1)));
+            counters[task]++;
+          });
+
+      for (size_t i=0; i<counters.size(); ++i)
+        ASSERT_EQ(1, counters[i]);
+    }
+  }
+}
+
+TEST_F(ControllerSchedulerTest, PoolRethrowsExceptions)
+{
+  giskard_core::WorkStealingPool pool(2);
+
+  EXPECT_THROW(pool.run(10, [] (size_t task, size_t worker)
+      {
+        if (task == 7)
+          throw std::runtime_error("task failed");
+      }), std::runtime_error);
+
+  EXPECT_NO_THROW(pool.run(10, [] (size_t task, size_t worker) {}));
+}
+
+TEST_F(ControllerSchedulerTest, AddController)
+{
+  giskard_core::ControllerScheduler scheduler(2);
+  auto source = [] (Eigen::VectorXd& observables) {};
+
+  EXPECT_THROW(scheduler.add_controller("a", make_controller(), source, 0.0, nWSR), std::invalid_argument);
+  EXPECT_THROW(scheduler.add_controller("a", make_controller(),
+        giskard_core::ControllerScheduler::ObservableSource(), 0.01, nWSR), std::invalid_argument);
+
+  EXPECT_EQ(0, scheduler.add_controller("a", make_controller(), source, 0.01, nWSR));
+  EXPECT_EQ(1, scheduler.num_controllers());
+  EXPECT_STREQ("a", scheduler.get_name(0).c_str());
+  EXPECT_THROW(scheduler.get_controller(1), std::out_of_range);
+}
+
+TEST_F(ControllerSchedulerTest, SimulationMatchesRealtime)
+{
+  giskard_core::ControllerScheduler realtime(4);
+  giskard_core::ControllerScheduler simulation(4, giskard_core::ControllerScheduler::Simulation);
+  EXPECT_EQ(0, simulation.num_threads());
+
+  std::vector<double> realtime_goals, simulation_goals;
+  add_controllers(realtime, realtime_goals);
+  add_controllers(simulation, simulation_goals);
+
+  for (size_t cycle=0; cycle<5; ++cycle)
+  {
+    ASSERT_TRUE(realtime.update());
+    ASSERT_TRUE(simulation.update());
+
+    for (size_t i=0; i<num_controllers; ++i)
+      ASSERT_DOUBLE_EQ(realtime.get_controller(i).get_command()(0),
+          simulation.get_controller(i).get_command()(0));
+  }
+
+  for (size_t i=0; i<num_controllers; ++i)
+  {
+    EXPECT_NEAR(std::max(-0.1, std::min(0.1, simulation_goals[i])),
+        simulation.get_controller(i).get_command()(0), 1e-6);
+
+    const giskard_core::ControllerStatistics& stats = simulation.get_statistics(i);
+    EXPECT_EQ(5, stats.num_updates_);
+    EXPECT_EQ(0, stats.num_failures_);
+    EXPECT_EQ(0, stats.num_deadline_misses_);
+    EXPECT_LE(stats.last_duration_, stats.max_duration_);
+    EXPECT_LE(stats.mean_duration(), stats.max_duration_);
+  }
+
+  realtime.reset_statistics();
+  EXPECT_EQ(0, realtime.get_statistics(0).num_updates_);
+}
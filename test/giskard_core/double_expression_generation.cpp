@@ -723,3 +723,72 @@ TEST_F(DoubleExpressionGenerationTest, Fmod)
 
   EXPECT_NEAR(exp->value(), std::fmod(2.1, 1.5), 1e-10);
 }
+
+TEST_F(DoubleExpressionGenerationTest, Cached)
+{
+  std::string s = "cached-double: {double-mul: [{input-var: 0}, 2.0]}";
+  YAML::Node node = YAML::Load(s);
+
+  ASSERT_NO_THROW(node.as<giskard_core::DoubleSpecPtr>());
+  giskard_core::DoubleSpecPtr spec = node.as<giskard_core::DoubleSpecPtr>();
+  EXPECT_EQ(giskard_core::DoubleCachedKind, spec->get_kind());
+
+  KDL::Expression<double>::Ptr exp = spec->get_expression(giskard_core::Scope());
+  ASSERT_TRUE(exp.get());
+  exp->setInputValue(0, 1.5);
+  EXPECT_DOUBLE_EQ(3.0, exp->value());
+  EXPECT_DOUBLE_EQ(2.0, exp->derivative(0));
+
+  YAML::Node encoded;
+  encoded = spec;
+  EXPECT_TRUE(spec->equals(*(encoded.as<giskard_core::DoubleSpecPtr>())));
+}
+
+TEST_F(DoubleExpressionGenerationTest, SharedSpecNodes)
+{
+  using namespace giskard_core;
+  DoubleSpecPtr shared = double_mul_spec({input(0), double_const_spec(2.0)});
+  DoubleSpecPtr divisor = double_add_spec({double_const_spec(1.0), double_const_spec(0.5)});
+  ScopeSpec scope_spec = {ScopeEntry("a", shared), ScopeEntry("b", double_add_spec({shared, shared})),
+      ScopeEntry("c", shared), ScopeEntry("d", double_add_spec({divisor, divisor})),
+      ScopeEntry("e", fmod(input(0), divisor))};
+
+  ExpressionMemoPtr memo = create_expression_memo(scope_spec, std::vector<SpecPtr>());
+  EXPECT_EQ(2, memo->get_fan_out(shared.get()));
+  EXPECT_TRUE(memo->is_cached(shared.get()));
+  EXPECT_EQ(3, memo->get_fan_out(divisor.get()));
+  EXPECT_FALSE(memo->is_cached(divisor.get()));
+
+  // only shared nodes that save more than a cache costs get cached
+  DoubleSpecPtr cheap = double_add_spec({input(0), input(1)});
+  DoubleSpecPtr explicitly_cached = cached_double(double_mul_spec({input(0), input(1)}));
+  ScopeSpec cost_spec = {ScopeEntry("a", double_mul_spec({cheap, cheap})),
+      ScopeEntry("b", double_mul_spec({explicitly_cached, explicitly_cached}))};
+  ExpressionMemoPtr cost_memo = create_expression_memo(cost_spec, std::vector<SpecPtr>());
+  EXPECT_EQ(2, cost_memo->get_fan_out(cheap.get()));
+  EXPECT_FALSE(cost_memo->is_cached(cheap.get()));
+  EXPECT_EQ(2, cost_memo->get_fan_out(explicitly_cached.get()));
+  EXPECT_FALSE(cost_memo->is_cached(explicitly_cached.get()));
+  EXPECT_TRUE(create_expression_memo(cost_spec, std::vector<SpecPtr>(), 0.0)->is_cached(cheap.get()));
+
+  // references count as parents of the entry of their type
+  DoubleSpecPtr shadowed = double_mul_spec({input(0), input(1)});
+  VectorSpecPtr shadowing = vector_constructor_spec(input(0), input(1), input(2));
+  ScopeSpec typed_spec = {ScopeEntry("x", shadowed), ScopeEntry("x", shadowing)};
+  ExpressionMemoPtr typed_memo = create_expression_memo(typed_spec,
+      {alias_reference_spec("x"), alias_reference_spec("x")});
+  EXPECT_EQ(2, typed_memo->get_fan_out(shadowed.get()));
+  EXPECT_EQ(0, typed_memo->get_fan_out(shadowing.get()));
+
+  // one expression per spec node during generation
+  Scope scope = generate(scope_spec);
+  EXPECT_EQ(scope.find_double_expression("a"), scope.find_double_expression("c"));
+  EXPECT_FALSE(ExpressionMemo::current());
+
+  KDL::Expression<double>::Ptr exp = scope.find_double_expression("e");
+  exp->setInputValue(0, 2.0);
+  EXPECT_NEAR(exp->value(), std::fmod(2.0, 1.5), 1e-10);
+
+  // without memo, every call generates a new expression
+  EXPECT_NE(shared->get_expression(scope), shared->get_expression(scope));
+}
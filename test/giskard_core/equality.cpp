@@ -20,6 +20,8 @@
 
 #include <gtest/gtest.h>
 #include <giskard_core/giskard_core.hpp>
+#include <set>
+#include <thread>
 
 class EqualityTest : public ::testing::Test
 {
@@ -61,3 +63,173 @@ TEST_F(EqualityTest, SlerpControl)
       EXPECT_EQ(i==j, spec1->equals(*spec2));
     }
 }
+
+TEST_F(EqualityTest, StructuralHash)
+{
+  using namespace giskard_core;
+  DoubleSpecPtr a = double_add_spec({input(0), double_const_spec(1.0)});
+  DoubleSpecPtr b = double_add_spec({input(0), double_const_spec(1.0)});
+  DoubleSpecPtr c = double_add_spec({input(1), double_const_spec(1.0)});
+  DoubleSpecPtr d = double_mul_spec({input(0), double_const_spec(1.0)});
+
+  EXPECT_EQ(a->hash(), b->hash());
+  EXPECT_NE(a->hash(), c->hash());
+  EXPECT_NE(a->hash(), d->hash());
+
+  // constants are compared with a tolerance, so they do not go into the hash
+  EXPECT_EQ(double_const_spec(1.0)->hash(), double_const_spec(2.0)->hash());
+
+  // modifications invalidate the cached hash
+  boost::dynamic_pointer_cast<DoubleAdditionSpec>(b)->set_inputs({input(1), double_const_spec(1.0)});
+  EXPECT_EQ(c->hash(), b->hash());
+  EXPECT_NE(a->hash(), b->hash());
+  EXPECT_FALSE(a->equals(*b));
+
+  // also of every spec above a modified node
+  DoubleInputSpecPtr leaf = input(0);
+  DoubleSpecPtr parent = double_mul_spec({double_add_spec({leaf}), double_const_spec(2.0)});
+  HashValue before = parent->hash();
+  leaf->set_input_num(1);
+  EXPECT_NE(before, parent->hash());
+  leaf->set_input_num(0);
+  EXPECT_EQ(before, parent->hash());
+
+  DoubleAdditionSpecPtr e = double_add_spec();
+  e->set_children({input(1), double_const_spec(1.0)});
+  EXPECT_TRUE(e->equals(*c));
+  EXPECT_THROW(e->set_children({vector_constructor_spec()}), std::invalid_argument);
+  EXPECT_THROW(x_coord()->set_children({}), std::length_error);
+}
+
+TEST_F(EqualityTest, Interning)
+{
+  YAML::Node node = YAML::LoadFile("pr2_cart_cart_control.yaml");
+  giskard_core::QPControllerSpec spec = node.as<giskard_core::QPControllerSpec>();
+  giskard_core::QPControllerSpec original = node.as<giskard_core::QPControllerSpec>();
+  giskard_core::HashValue fingerprint = giskard_core::fingerprint(spec);
+  EXPECT_EQ(fingerprint, giskard_core::fingerprint(original));
+
+  giskard_core::SpecInterner interner;
+  interner.intern(spec);
+  EXPECT_LT(0, interner.num_hits());
+
+  ASSERT_EQ(original.scope_.size(), spec.scope_.size());
+  for (size_t i=0; i<spec.scope_.size(); ++i)
+    EXPECT_TRUE(spec.scope_[i].spec->equals(*(original.scope_[i].spec)));
+
+  // equal specs end up as the same node
+  giskard_core::SpecPtr lhs = interner.intern(giskard_core::double_add_spec({giskard_core::input(3)}));
+  giskard_core::SpecPtr rhs = interner.intern(giskard_core::double_add_spec({giskard_core::input(3)}));
+  EXPECT_EQ(lhs, rhs);
+
+  // different constants change the fingerprint, but not the structural hashes
+  boost::dynamic_pointer_cast<giskard_core::DoubleConstSpec>(
+      original.controllable_constraints_[0].weight_)->set_value(42.0);
+  EXPECT_NE(fingerprint, giskard_core::fingerprint(original));
+
+  giskard_core::QPController controller = giskard_core::generate(spec);
+  EXPECT_EQ(fingerprint, controller.get_spec_fingerprint());
+}
+
+TEST_F(EqualityTest, InterningConstants)
+{
+  giskard_core::SpecInterner interner;
+  std::vector<giskard_core::SpecPtr> sums;
+  for (size_t i=0; i<1000; ++i)
+    sums.push_back(interner.intern(giskard_core::double_add_spec(
+        {giskard_core::input(0), giskard_core::double_const_spec(0.001 * i)})));
+  EXPECT_EQ(1000, std::set<giskard_core::SpecPtr>(sums.begin(), sums.end()).size());
+
+  // only constants with identical values get merged
+  for (size_t i=0; i<sums.size(); i+=100)
+    EXPECT_EQ(sums[i], interner.intern(giskard_core::double_add_spec(
+        {giskard_core::input(0), giskard_core::double_const_spec(0.001 * i)})));
+  EXPECT_NE(interner.intern(giskard_core::double_const_spec(0.0)),
+      interner.intern(giskard_core::double_const_spec(1e-12)));
+  EXPECT_EQ(interner.intern(giskard_core::double_const_spec(0.0)),
+      interner.intern(giskard_core::double_const_spec(-0.0)));
+}
+
+TEST_F(EqualityTest, ConcurrentHash)
+{
+  YAML::Node node = YAML::LoadFile("pr2_cart_cart_control.yaml");
+  giskard_core::QPControllerSpec spec = node.as<giskard_core::QPControllerSpec>();
+  giskard_core::QPControllerSpec reference = node.as<giskard_core::QPControllerSpec>();
+
+  std::vector<giskard_core::HashValue> fingerprints(4, 0);
+  std::vector<std::thread> threads;
+  for (size_t i=0; i<fingerprints.size(); ++i)
+    threads.push_back(std::thread([&spec, &fingerprints, i]()
+        { fingerprints[i] = giskard_core::fingerprint(spec); }));
+  for (auto & thread: threads)
+    thread.join();
+
+  for (auto const & fingerprint: fingerprints)
+    EXPECT_EQ(giskard_core::fingerprint(reference), fingerprint);
+}
+
+TEST_F(EqualityTest, CopyNodes)
+{
+  giskard_core::DoubleSpecPtr shared = giskard_core::double_add_spec({giskard_core::input(0)});
+  giskard_core::QPControllerSpec spec;
+  spec.scope_.push_back(giskard_core::ScopeEntry("a", giskard_core::double_mul_spec({shared, shared})));
+  spec.scope_.push_back(giskard_core::ScopeEntry("b", shared));
+
+  giskard_core::QPControllerSpec copy = giskard_core::copy_nodes(spec);
+  EXPECT_EQ(giskard_core::fingerprint(spec), giskard_core::fingerprint(copy));
+  EXPECT_NE(spec.scope_[1].spec, copy.scope_[1].spec);
+  std::vector<giskard_core::SpecPtr> children = copy.scope_[0].spec->get_children();
+  ASSERT_EQ(2, children.size());
+  EXPECT_EQ(children[0], children[1]);
+  EXPECT_EQ(copy.scope_[1].spec, children[0]);
+}
+
+class KindCounter : public giskard_core::SpecVisitor
+{
+  public:
+    using giskard_core::SpecVisitor::visit;
+
+    KindCounter() : num_additions(0), num_doubles(0), num_others(0) {}
+
+    virtual void visit(giskard_core::Spec& spec)
+    {
+      ++num_others;
+    }
+
+    virtual void visit(giskard_core::DoubleSpec& spec)
+    {
+      ++num_doubles;
+    }
+
+    virtual void visit(giskard_core::DoubleAdditionSpec& spec)
+    {
+      ++num_additions;
+    }
+
+    size_t num_additions, num_doubles, num_others;
+};
+
+TEST_F(EqualityTest, KindDispatch)
+{
+  YAML::Node node = YAML::LoadFile("pr2_cart_cart_control.yaml");
+  giskard_core::QPControllerSpec spec = node.as<giskard_core::QPControllerSpec>();
+
+  KindCounter counter;
+  for (auto const & entry: spec.scope_)
+    entry.spec->accept(counter);
+  EXPECT_EQ(spec.scope_.size(), counter.num_additions + counter.num_doubles + counter.num_others);
+
+  // the most specific overload wins, all others fall back to the base class
+  KindCounter sum_counter;
+  giskard_core::double_add_spec({giskard_core::input(0)})->accept(sum_counter);
+  giskard_core::input(0)->accept(sum_counter);
+  giskard_core::quaternion_spec()->accept(sum_counter);
+  EXPECT_EQ(1, sum_counter.num_additions);
+  EXPECT_EQ(1, sum_counter.num_doubles);
+  EXPECT_EQ(1, sum_counter.num_others);
+
+  EXPECT_EQ(giskard_core::DoubleAdditionKind, giskard_core::double_add_spec()->get_kind());
+  EXPECT_EQ(giskard_core::AliasReferenceKind, giskard_core::alias_reference_spec("a")->get_kind());
+  EXPECT_FALSE(giskard_core::double_add_spec({giskard_core::input(0)})->equals(
+        *giskard_core::double_mul_spec({giskard_core::input(0)})));
+}
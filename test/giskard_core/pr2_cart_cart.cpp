@@ -145,3 +145,79 @@ TEST_F(PR2CartCartControlTest, SlerpControl)
 
   // FIXME: finish test-case
 }
+
+TEST_F(PR2CartCartControlTest, PruneScope)
+{
+  YAML::Node node = YAML::LoadFile("pr2_cart_cart_control.yaml");
+  giskard_core::QPControllerSpec spec = node.as<giskard_core::QPControllerSpec>();
+  giskard_core::QPControllerSpec pruned_spec = spec;
+
+  EXPECT_THROW(giskard_core::prune_scope(pruned_spec, {"does_not_exist"}), std::invalid_argument);
+
+  std::vector<std::string> pruned = giskard_core::prune_scope(pruned_spec, {"l_rot_control"});
+  EXPECT_EQ(std::vector<std::string>({"l_trans_scaled_error", "r_trans_scaled_error", "weight_elbow_control"}),
+      pruned);
+  EXPECT_EQ(spec.scope_.size(), pruned_spec.scope_.size() + pruned.size());
+  EXPECT_TRUE(giskard_core::prune_scope(pruned_spec, {"l_rot_control"}).empty());
+
+  giskard_core::QPController controller = giskard_core::generate(spec);
+  giskard_core::QPController pruned_controller = giskard_core::generate(pruned_spec);
+  EXPECT_TRUE(pruned_controller.get_scope().has_expression("l_rot_control"));
+  EXPECT_FALSE(pruned_controller.get_scope().has_expression("weight_elbow_control"));
+
+  ASSERT_TRUE(controller.start(q, nWSR));
+  ASSERT_TRUE(pruned_controller.start(q, nWSR));
+  EXPECT_TRUE(controller.get_command().isApprox(pruned_controller.get_command()));
+}
+
+TEST_F(PR2CartCartControlTest, Simplify)
+{
+  YAML::Node node = YAML::LoadFile("pr2_cart_cart_control.yaml");
+  giskard_core::QPControllerSpec spec = node.as<giskard_core::QPControllerSpec>();
+
+  giskard_core::SpecSimplifier simplifier;
+  giskard_core::QPControllerSpec simplified_spec = simplifier.simplify(spec);
+  EXPECT_LT(0, simplifier.num_simplifications());
+  ASSERT_EQ(spec.scope_.size(), simplified_spec.scope_.size());
+
+  giskard_core::QPController controller = giskard_core::generate(spec);
+  giskard_core::QPController simplified_controller = giskard_core::generate(simplified_spec);
+
+  ASSERT_TRUE(controller.start(q, nWSR));
+  ASSERT_TRUE(simplified_controller.start(q, nWSR));
+  EXPECT_TRUE(controller.get_command().isApprox(simplified_controller.get_command()));
+}
+
+TEST_F(PR2CartCartControlTest, Fork)
+{
+  YAML::Node node = YAML::LoadFile("pr2_cart_cart_control.yaml");
+  giskard_core::QPControllerSpec spec = node.as<giskard_core::QPControllerSpec>();
+  std::string shared_name = spec.scope_[0].name;
+  spec.scope_.push_back(giskard_core::ScopeEntry("shared_copy", spec.scope_[0].spec));
+
+  giskard_core::QPController controller = giskard_core::generate(spec);
+  giskard_core::QPController fork = controller.fork();
+  EXPECT_TRUE(fork.shares_structure_with(controller));
+  EXPECT_EQ(controller.get_spec_fingerprint(), fork.get_spec_fingerprint());
+
+  // the fork generates expressions of its own, with the same sharing
+  KDL::ExpressionBase::Ptr shared = controller.get_scope().find_expression(shared_name);
+  KDL::ExpressionBase::Ptr forked_shared = fork.get_scope().find_expression(shared_name);
+  EXPECT_EQ(shared, controller.get_scope().find_expression("shared_copy"));
+  EXPECT_EQ(forked_shared, fork.get_scope().find_expression("shared_copy"));
+  EXPECT_NE(shared, forked_shared);
+  EXPECT_NE(controller.get_qp_builder().get_soft_expressions()[0], fork.get_qp_builder().get_soft_expressions()[0]);
+
+  // changes to the spec after generation do not reach forks
+  giskard_core::DoubleConstSpecPtr weight = boost::dynamic_pointer_cast<giskard_core::DoubleConstSpec>(
+      spec.controllable_constraints_[0].weight_);
+  ASSERT_TRUE(weight.get());
+  weight->set_value(42.0);
+  giskard_core::QPController later_fork = controller.fork();
+
+  ASSERT_TRUE(controller.start(q, nWSR));
+  ASSERT_TRUE(fork.start(q, nWSR));
+  ASSERT_TRUE(later_fork.start(q, nWSR));
+  EXPECT_TRUE(controller.get_command().isApprox(fork.get_command()));
+  EXPECT_TRUE(controller.get_command().isApprox(later_fork.get_command()));
+}
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <gtest/gtest.h>
+#include <giskard_core/giskard_core.hpp>
+
+using namespace giskard_core;
+
+class ProjectionCacheTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      ASSERT_TRUE(urdf.initFile("pr2.urdf"));
+      joint_name = "torso_lift_joint";
+      goal_name = create_input_name("torso_controller", joint_name);
+    }
+
+    virtual void TearDown(){}
+
+    ProjectionCacheEntryConstPtr make_entry(std::int64_t key, size_t num_points) const
+    {
+      boost::shared_ptr<ProjectionCacheEntry> entry(new ProjectionCacheEntry());
+      entry->key_ = {key};
+      entry->position_trajectories_ = Eigen::MatrixXd::Constant(num_points, 1, key);
+      entry->velocity_trajectories_ = Eigen::MatrixXd::Zero(num_points, 1);
+      entry->time_trajectory_ = Eigen::VectorXd::Zero(num_points);
+      return entry;
+    }
+
+    QPControllerSpecGenerator make_generator(double p_gain = 10.0) const
+    {
+      ControlParams single_joint_params;
+      single_joint_params.root_link = "base_link";
+      single_joint_params.tip_link = "torso_lift_link";
+      single_joint_params.p_gain = p_gain;
+      single_joint_params.max_speed = 0.2;
+      single_joint_params.weight = 1.0;
+      single_joint_params.type = ControlParams::ControlType::Joint;
+      std::map<std::string, double> weights = {{Robot::default_joint_weight_key(), 0.001}, {joint_name, 0.01}};
+      std::map<std::string, double> thresholds = {{Robot::default_joint_velocity_key(), 0.5}, {joint_name, 0.01}};
+      QPControllerParams params(urdf, "base_footprint", weights, thresholds, {{"torso_controller", single_joint_params}});
+      return QPControllerSpecGenerator(params);
+    }
+
+    urdf::Model urdf;
+    std::string joint_name, goal_name;
+};
+
+TEST_F(ProjectionCacheTest, LeastRecentlyUsed)
+{
+  ProjectionCache cache(2, 1000000);
+  EXPECT_EQ(0, cache.size());
+  EXPECT_FALSE(cache.find(1, 0, {1}));
+
+  cache.insert(1, make_entry(1, 10));
+  cache.insert(2, make_entry(2, 10));
+  EXPECT_EQ(2, cache.size());
+  EXPECT_EQ(2 * make_entry(1, 10)->num_bytes(), cache.num_bytes());
+
+  // same hash, but different key or seed
+  EXPECT_FALSE(cache.find(1, 0, {3}));
+  EXPECT_FALSE(cache.find(1, 5, {1}));
+
+  ASSERT_TRUE(cache.find(1, 0, {1}));
+  EXPECT_DOUBLE_EQ(1.0, cache.find(1, 0, {1})->position_trajectories_(0, 0));
+
+  // entry 2 is the least recently used one
+  cache.insert(3, make_entry(3, 10));
+  EXPECT_EQ(2, cache.size());
+  EXPECT_EQ(1, cache.num_evictions());
+  EXPECT_FALSE(cache.find(2, 0, {2}));
+  EXPECT_TRUE(cache.find(1, 0, {1}));
+  EXPECT_TRUE(cache.find(3, 0, {3}));
+
+  EXPECT_EQ(4, cache.num_hits());
+  EXPECT_EQ(4, cache.num_misses());
+  EXPECT_DOUBLE_EQ(4.0 / 8.0, cache.hit_rate());
+
+  cache.reset_statistics();
+  EXPECT_EQ(0, cache.num_hits());
+  EXPECT_DOUBLE_EQ(0.0, cache.hit_rate());
+
+  cache.clear();
+  EXPECT_EQ(0, cache.size());
+  EXPECT_EQ(0, cache.num_bytes());
+}
+
+TEST_F(ProjectionCacheTest, MemoryBound)
+{
+  size_t entry_size = make_entry(1, 100)->num_bytes();
+  ProjectionCache cache(100, 2 * entry_size + entry_size / 2);
+
+  cache.insert(1, make_entry(1, 100));
+  cache.insert(2, make_entry(2, 100));
+  cache.insert(3, make_entry(3, 100));
+  EXPECT_EQ(2, cache.size());
+  EXPECT_GE(cache.max_bytes(), cache.num_bytes());
+  EXPECT_FALSE(cache.find(1, 0, {1}));
+
+  // entries bigger than the whole cache are not stored
+  cache.insert(4, make_entry(4, 1000));
+  EXPECT_FALSE(cache.find(4, 0, {4}));
+  EXPECT_GE(cache.max_bytes(), cache.num_bytes());
+}
+
+TEST_F(ProjectionCacheTest, CachedProjection)
+{
+  QPControllerSpecGenerator gen = make_generator();
+  QPController controller = generate(gen.get_spec());
+  QPControllerProjectionParams params(0.01, gen.get_observable_names(), {{joint_name, 0.0001}}, 50, 2000, 100);
+  params.cache_resolutions_ = {{QPControllerProjectionParams::default_cache_resolution_key(), 0.001}};
+
+  ProjectionCachePtr cache(new ProjectionCache(10, 10000000));
+  QPControllerProjection projection(controller, params);
+  projection.set_cache(cache);
+  EXPECT_EQ(cache, projection.get_cache());
+
+  projection.run({{joint_name, 0.2}, {goal_name, 0.05}});
+  EXPECT_FALSE(projection.was_cache_hit());
+  EXPECT_EQ(1, cache->size());
+  Eigen::MatrixXd positions = projection.get_position_trajectories();
+  QPControllerProjection::TerminationReason reason = projection.get_termination_reason();
+
+  // within the resolution of the first start state
+  projection.run({{joint_name, 0.2001}, {goal_name, 0.05}});
+  EXPECT_TRUE(projection.was_cache_hit());
+  EXPECT_EQ(reason, projection.get_termination_reason());
+  ASSERT_EQ(positions.rows(), projection.get_position_trajectories().rows());
+  EXPECT_DOUBLE_EQ(0.2001, projection.get_position_trajectories()(0, 0));
+  EXPECT_TRUE(positions.bottomRows(positions.rows() - 1).isApprox(
+      projection.get_position_trajectories().bottomRows(positions.rows() - 1)));
+
+  projection.run({{joint_name, 0.1}, {goal_name, 0.05}});
+  EXPECT_FALSE(projection.was_cache_hit());
+  EXPECT_DOUBLE_EQ(0.1, projection.get_position_trajectories()(0, 0));
+  EXPECT_EQ(2, cache->size());
+
+  // projections with other params do not share results
+  QPControllerProjectionParams other_params = params;
+  other_params.period_ = 0.02;
+  other_params.min_period_ = 0.02;
+  other_params.max_period_ = 0.02;
+  QPControllerProjection other_projection(controller, other_params);
+  other_projection.set_cache(cache);
+  other_projection.run({{joint_name, 0.2}, {goal_name, 0.05}});
+  EXPECT_FALSE(other_projection.was_cache_hit());
+
+  EXPECT_EQ(1, cache->num_hits());
+  EXPECT_EQ(3, cache->num_misses());
+
+  // same quantized start state, but at another resolution
+  QPControllerProjectionParams fine_params = params;
+  fine_params.cache_resolutions_ = {{joint_name, 0.001}};
+  QPControllerProjection fine_projection(controller, fine_params);
+  fine_projection.set_cache(cache);
+  fine_projection.run({{joint_name, 0.02}, {goal_name, 0.05}});
+
+  QPControllerProjectionParams coarse_params = params;
+  coarse_params.cache_resolutions_ = {{joint_name, 0.01}};
+  QPControllerProjection coarse_projection(controller, coarse_params);
+  coarse_projection.set_cache(cache);
+  coarse_projection.run({{joint_name, 0.2}, {goal_name, 0.05}});
+  EXPECT_FALSE(coarse_projection.was_cache_hit());
+  // moves down to the goal, not up like the fine projection
+  ASSERT_LT(1, coarse_projection.num_trajectory_points());
+  EXPECT_GT(coarse_projection.get_position_trajectories()(0, 0),
+      coarse_projection.get_position_trajectories()(1, 0));
+}
+
+TEST_F(ProjectionCacheTest, ControllerKeys)
+{
+  QPControllerSpecGenerator gen = make_generator(10.0);
+  QPControllerProjectionParams params(0.01, gen.get_observable_names(), {{joint_name, 0.0001}}, 50, 2000, 100);
+  ProjectionCachePtr cache(new ProjectionCache(10, 10000000));
+  std::map<std::string, double> start_state = {{joint_name, 0.2}, {goal_name, 0.05}};
+
+  QPControllerProjection projection(generate(gen.get_spec()), params);
+  projection.set_cache(cache);
+  EXPECT_TRUE(projection.uses_cache());
+  projection.run(start_state);
+  EXPECT_EQ(1, cache->size());
+
+  // same names and structure, but another gain
+  QPController slow_controller = generate(make_generator(2.0).get_spec());
+  QPController fast_controller = generate(gen.get_spec());
+  EXPECT_EQ(fast_controller.get_structure_hash(), slow_controller.get_structure_hash());
+  EXPECT_NE(fast_controller.get_spec_fingerprint(), slow_controller.get_spec_fingerprint());
+
+  QPControllerProjection slow_projection(slow_controller, params);
+  slow_projection.set_cache(cache);
+  slow_projection.run(start_state);
+  EXPECT_FALSE(slow_projection.was_cache_hit());
+  EXPECT_LT(projection.num_trajectory_points(), slow_projection.num_trajectory_points());
+  EXPECT_EQ(2, cache->size());
+
+  QPControllerProjection fast_projection(fast_controller, params);
+  fast_projection.set_cache(cache);
+  fast_projection.run(start_state);
+  EXPECT_TRUE(fast_projection.was_cache_hit());
+
+  // controllers without a spec fingerprint do not use the cache at all
+  slow_controller.set_spec_fingerprint(0);
+  QPControllerProjection unkeyed_projection(slow_controller, params);
+  unkeyed_projection.set_cache(cache);
+  EXPECT_FALSE(unkeyed_projection.uses_cache());
+  unkeyed_projection.run(start_state);
+  unkeyed_projection.run(start_state);
+  EXPECT_FALSE(unkeyed_projection.was_cache_hit());
+  EXPECT_EQ(2, cache->size());
+}
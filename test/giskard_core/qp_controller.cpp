@@ -20,6 +20,7 @@
 
 #include <gtest/gtest.h>
 #include <giskard_core/giskard_core.hpp>
+#include <thread>
 
 class QPControllerTest : public ::testing::Test
 {
@@ -83,6 +84,23 @@ class QPControllerTest : public ::testing::Test
 
     virtual void TearDown(){}
 
+    // commands of a controller that moves the state by its commands
+    std::vector<Eigen::VectorXd> simulate(giskard_core::QPController& controller, const Eigen::VectorXd& start,
+        size_t num_steps)
+    {
+      std::vector<Eigen::VectorXd> commands;
+      Eigen::VectorXd state = start;
+      if (!controller.start(state, nWSR))
+        return commands;
+
+      for (size_t i=0; i<num_steps && controller.update(state, nWSR); ++i)
+      {
+        commands.push_back(controller.get_command());
+        state += controller.get_command();
+      }
+      return commands;
+    }
+
     std::vector< KDL::Expression<double>::Ptr > controllable_lower, controllable_upper,
         controllable_weights, soft_expressions, soft_lower, soft_upper, soft_weights,
         hard_expressions, hard_lower, hard_upper;
@@ -144,3 +162,280 @@ TEST_F(QPControllerTest, Update)
    for(size_t i=0; i<hard_upper.size(); ++i)
      EXPECT_LE(0.0, hard_upper[i]->value());
 }
+
+TEST_F(QPControllerTest, Fork)
+{
+   giskard_core::QPController c;
+   ASSERT_TRUE(c.init(controllable_lower, controllable_upper, controllable_weights, 
+         controllable_names, soft_expressions, soft_lower, soft_upper, soft_weights, 
+         soft_names, hard_expressions, hard_lower, hard_upper));
+   ASSERT_TRUE(c.start(initial_state, nWSR));
+
+   giskard_core::QPController fork = c.fork();
+   EXPECT_TRUE(fork.shares_structure_with(c));
+   EXPECT_EQ(&(c.get_controllable_names()), &(fork.get_controllable_names()));
+   EXPECT_EQ(c.get_structure_hash(), fork.get_structure_hash());
+
+   // the fork evaluates clones of the expressions with a solver of its own
+   EXPECT_NE(&(c.get_scope()), &(fork.get_scope()));
+   EXPECT_NE(c.get_qp_builder().get_soft_expressions()[0], fork.get_qp_builder().get_soft_expressions()[0]);
+   EXPECT_EQ(c.get_qp_builder().num_constraints(), fork.get_qp_builder().num_constraints());
+   EXPECT_EQ(0, fork.get_observables().rows());
+   ASSERT_TRUE(fork.start(initial_state, nWSR));
+
+   // what-if: the fork moves away from the original state
+   Eigen::VectorXd state = initial_state;
+   for(size_t i=0; i<10; ++i)
+   {
+     ASSERT_TRUE(fork.update(state, nWSR));
+     state += fork.get_command();
+   }
+
+   // the original is left untouched, and behaves as if nothing happened
+   ASSERT_TRUE(c.update(initial_state, nWSR));
+   giskard_core::QPController reference;
+   ASSERT_TRUE(reference.init(controllable_lower, controllable_upper, controllable_weights, 
+         controllable_names, soft_expressions, soft_lower, soft_upper, soft_weights, 
+         soft_names, hard_expressions, hard_lower, hard_upper));
+   ASSERT_TRUE(reference.start(initial_state, nWSR));
+   ASSERT_TRUE(reference.update(initial_state, nWSR));
+   EXPECT_TRUE(c.get_command().isApprox(reference.get_command()));
+
+   // changing the scope of the fork does not affect the original
+   giskard_core::Scope scope;
+   scope.add_double_expression("a", KDL::Constant(1.0));
+   fork.set_scope(scope);
+   EXPECT_TRUE(fork.get_scope().has_double_expression("a"));
+   EXPECT_FALSE(c.get_scope().has_double_expression("a"));
+}
+
+TEST_F(QPControllerTest, ConcurrentFork)
+{
+   Eigen::VectorXd other_state(2);
+   other_state << 0.5, -1.0;
+   size_t num_steps = 50;
+
+   // references, one after the other
+   giskard_core::QPController c;
+   ASSERT_TRUE(c.init(controllable_lower, controllable_upper, controllable_weights, 
+         controllable_names, soft_expressions, soft_lower, soft_upper, soft_weights, 
+         soft_names, hard_expressions, hard_lower, hard_upper));
+   std::vector<Eigen::VectorXd> reference = simulate(c, initial_state, num_steps);
+   std::vector<Eigen::VectorXd> other_reference = simulate(c, other_state, num_steps);
+   ASSERT_EQ(num_steps, reference.size());
+   ASSERT_EQ(num_steps, other_reference.size());
+   ASSERT_FALSE(reference[0].isApprox(other_reference[0]));
+
+   // the original and its fork on two threads at the same time
+   for (size_t i=0; i<10; ++i)
+   {
+     giskard_core::QPController fork = c.fork();
+     std::vector<Eigen::VectorXd> commands, other_commands;
+     std::thread other_thread([this, &fork, &other_state, &other_commands, num_steps] ()
+         {
+           other_commands = simulate(fork, other_state, num_steps);
+         });
+     commands = simulate(c, initial_state, num_steps);
+     other_thread.join();
+
+     ASSERT_EQ(num_steps, commands.size());
+     ASSERT_EQ(num_steps, other_commands.size());
+     for (size_t j=0; j<num_steps; ++j)
+     {
+       EXPECT_TRUE(commands[j].isApprox(reference[j]));
+       EXPECT_TRUE(other_commands[j].isApprox(other_reference[j]));
+     }
+   }
+}
+
+TEST_F(QPControllerTest, WarmStart)
+{
+   giskard_core::QPController c;
+   ASSERT_TRUE(c.init(controllable_lower, controllable_upper, controllable_weights, 
+         controllable_names, soft_expressions, soft_lower, soft_upper, soft_weights, 
+         soft_names, hard_expressions, hard_lower, hard_upper));
+   EXPECT_THROW(c.export_warm_start(), std::runtime_error);
+   ASSERT_TRUE(c.start(initial_state, nWSR));
+
+   // both controllables still move at their velocity limits, i.e. at active bounds
+   Eigen::VectorXd state = initial_state;
+   for(size_t i=0; i<5; ++i)
+   {
+     ASSERT_TRUE(c.update(state, nWSR));
+     state += c.get_command();
+   }
+   EXPECT_TRUE((state - c.get_command()).isApprox(c.get_observables()));
+
+   giskard_core::QPControllerWarmStart warm_start =
+     giskard_core::QPControllerWarmStart::from_binary(c.export_warm_start().to_binary());
+   EXPECT_EQ(c.get_structure_hash(), warm_start.structure_hash_);
+   EXPECT_EQ(c.get_spec_fingerprint(), warm_start.spec_fingerprint_);
+   EXPECT_TRUE(warm_start.observables_.isApprox(c.get_observables()));
+   EXPECT_EQ(c.get_qp_builder().num_weights(), warm_start.num_variables());
+   EXPECT_EQ(c.get_qp_builder().num_constraints(), warm_start.num_constraints());
+
+   // a controller with the same structure restarts from the working set
+   giskard_core::QPController restarted;
+   ASSERT_TRUE(restarted.init(controllable_lower, controllable_upper, controllable_weights, 
+         controllable_names, soft_expressions, soft_lower, soft_upper, soft_weights, 
+         soft_names, hard_expressions, hard_lower, hard_upper));
+   EXPECT_EQ(c.get_structure_hash(), restarted.get_structure_hash());
+   ASSERT_TRUE(restarted.start(warm_start.observables_, nWSR, warm_start));
+   ASSERT_TRUE(c.update(warm_start.observables_, nWSR));
+   EXPECT_TRUE(c.get_command().isApprox(restarted.get_command(), 1e-6));
+
+   // which saves working set recalculations compared to a cold start
+   giskard_core::QPController cold;
+   ASSERT_TRUE(cold.init(controllable_lower, controllable_upper, controllable_weights, 
+         controllable_names, soft_expressions, soft_lower, soft_upper, soft_weights, 
+         soft_names, hard_expressions, hard_lower, hard_upper));
+   ASSERT_TRUE(cold.start(warm_start.observables_, nWSR));
+   EXPECT_TRUE(cold.get_command().isApprox(restarted.get_command(), 1e-6));
+   EXPECT_LT(restarted.num_working_set_recalculations(), cold.num_working_set_recalculations());
+
+   // statuses that are no working set are rejected before they reach qpOASES
+   giskard_core::QPControllerWarmStart invalid_status = warm_start;
+   invalid_status.bound_status_[0] = qpOASES::ST_UNDEFINED;
+   EXPECT_THROW(restarted.start(warm_start.observables_, nWSR, invalid_status), std::invalid_argument);
+
+   // a controller with the same names, but generated from another spec, refuses it
+   restarted.set_spec_fingerprint(c.get_spec_fingerprint() + 1);
+   EXPECT_FALSE(restarted.is_compatible(warm_start));
+   EXPECT_THROW(restarted.start(warm_start.observables_, nWSR, warm_start), std::invalid_argument);
+
+   // a controller with a different structure refuses it
+   soft_names[0] = "renamed goal";
+   giskard_core::QPController other;
+   ASSERT_TRUE(other.init(controllable_lower, controllable_upper, controllable_weights, 
+         controllable_names, soft_expressions, soft_lower, soft_upper, soft_weights, 
+         soft_names, hard_expressions, hard_lower, hard_upper));
+   EXPECT_NE(c.get_structure_hash(), other.get_structure_hash());
+   EXPECT_THROW(other.start(initial_state, nWSR, warm_start), std::invalid_argument);
+
+   EXPECT_THROW(giskard_core::QPControllerWarmStart::from_binary("GSKX"), std::runtime_error);
+   std::string truncated = warm_start.to_binary();
+   truncated.resize(truncated.size() - 1);
+   EXPECT_THROW(giskard_core::QPControllerWarmStart::from_binary(truncated), std::runtime_error);
+   std::string corrupted = warm_start.to_binary();
+   corrupted[corrupted.size() - 1] = 7;
+   EXPECT_THROW(giskard_core::QPControllerWarmStart::from_binary(corrupted), std::runtime_error);
+}
+
+TEST_F(QPControllerTest, EventTriggeredUpdate)
+{
+   giskard_core::QPController c;
+   ASSERT_TRUE(c.init(controllable_lower, controllable_upper, controllable_weights, 
+         controllable_names, soft_expressions, soft_lower, soft_upper, soft_weights, 
+         soft_names, hard_expressions, hard_lower, hard_upper));
+
+   EXPECT_THROW(c.set_event_trigger(giskard_core::EventTriggerParams(-1.0, 3)), std::invalid_argument);
+   c.set_event_trigger(giskard_core::EventTriggerParams(0.01, 3));
+   ASSERT_TRUE(c.start(initial_state, nWSR));
+
+   // small changes are absorbed, until the maximum hold time is over
+   Eigen::VectorXd noisy_state = initial_state + Eigen::VectorXd::Constant(2, 0.005);
+   for(size_t i=0; i<3; ++i)
+   {
+     ASSERT_TRUE(c.update(noisy_state, nWSR));
+     EXPECT_EQ(i + 1, c.num_skipped_updates());
+     EXPECT_TRUE(c.get_observables().isApprox(initial_state));
+   }
+   ASSERT_TRUE(c.update(noisy_state, nWSR));
+   EXPECT_EQ(3, c.num_skipped_updates());
+   EXPECT_TRUE(c.get_observables().isApprox(noisy_state));
+
+   // large changes always trigger a solve
+   Eigen::VectorXd state = noisy_state + c.get_command();
+   ASSERT_TRUE(c.update(state, nWSR));
+   EXPECT_EQ(3, c.num_skipped_updates());
+   EXPECT_TRUE(c.get_observables().isApprox(state));
+
+   // per-observable thresholds
+   c.set_event_trigger(giskard_core::EventTriggerParams(Eigen::Vector2d(0.01, 0.0), 10));
+   Eigen::VectorXd first_changed = state + Eigen::Vector2d(0.005, 0.0);
+   ASSERT_TRUE(c.update(first_changed, nWSR));
+   EXPECT_EQ(4, c.num_skipped_updates());
+   Eigen::VectorXd second_changed = state + Eigen::Vector2d(0.0, 0.005);
+   ASSERT_TRUE(c.update(second_changed, nWSR));
+   EXPECT_EQ(4, c.num_skipped_updates());
+
+   // deactivated trigger
+   c.set_event_trigger(giskard_core::EventTriggerParams());
+   ASSERT_TRUE(c.update(second_changed, nWSR));
+   EXPECT_EQ(4, c.num_skipped_updates());
+}
+
+TEST_F(QPControllerTest, FeedbackScope)
+{
+   std::string sc = "scope: [a: {input-var: 0}, b: {double-mul: [2, a]}, \
+                             feedback: {double-add: [b, {input-var: 1}]}, debug: {double-mul: [3, feedback]}]";
+   std::string co = "controllable-constraints: [{controllable-constraint: [-0.1, 0.1, 1.0, 0, joint]}]";
+   std::string so = "soft-constraints: [{soft-constraint: [{double-sub: [1, b]}, {double-sub: [1, b]}, 1.0, b, goal]}]";
+   std::string ha = "hard-constraints: []";
+   YAML::Node node = YAML::Load(sc + "\n" + co + "\n" + so + "\n" + ha);
+   giskard_core::QPControllerSpec spec = node.as<giskard_core::QPControllerSpec>();
+
+   std::set<giskard_core::ScopeEntryKey> hot = giskard_core::find_reachable_scope_entries(
+       giskard_core::get_constraint_specs(spec), spec.scope_);
+   EXPECT_EQ(std::set<giskard_core::ScopeEntryKey>({{"a", giskard_core::Scope::DoubleType},
+       {"b", giskard_core::Scope::DoubleType}}), hot);
+   EXPECT_EQ(std::vector<giskard_core::ScopeEntryKey>({{"feedback", giskard_core::Scope::DoubleType},
+       {"debug", giskard_core::Scope::DoubleType}}), giskard_core::find_feedback_scope_entries(spec));
+
+   giskard_core::QPController c = giskard_core::generate(spec);
+   EXPECT_EQ(std::vector<std::string>({"feedback", "debug"}), c.get_feedback_scope_names());
+   EXPECT_EQ(1, c.num_observables());
+
+   // feedback entries are evaluated with the observables of the last solve
+   ASSERT_TRUE(c.start(Eigen::Vector2d(0.5, 0.25), nWSR));
+   EXPECT_DOUBLE_EQ(3.75, c.get_scope().find_double_expression("debug")->value());
+   ASSERT_TRUE(c.update(Eigen::Vector2d(0.6, 0.5), nWSR));
+   EXPECT_DOUBLE_EQ(5.1, c.get_scope().find_double_expression("debug")->value());
+
+   giskard_core::ScopeSnapshot snapshot(c.get_scope(), {"feedback"});
+   ASSERT_TRUE(c.update(Eigen::Vector2d(0.5, 0.0), nWSR));
+   c.capture(snapshot);
+   EXPECT_DOUBLE_EQ(1.0, snapshot.get_double(0, snapshot.get_buffer()));
+
+   // observables of the QP alone are not enough for the feedback
+   ASSERT_TRUE(c.update(Eigen::VectorXd::Constant(1, 0.5), nWSR));
+   EXPECT_THROW(c.get_scope(), std::length_error);
+}
+
+TEST_F(QPControllerTest, ScopeEntriesOfSeveralTypes)
+{
+   std::string sc = "scope: [x: {input-var: 0}, a: {double-mul: [2, x]}, y: {input-var: 1}, \
+                             a: {vector3: [y, 0, 0]}, c: a, b: {double-mul: [2, c]}, n: {vector-norm: a}]";
+   std::string co = "controllable-constraints: [{controllable-constraint: [-0.1, 0.1, 1.0, 0, joint]}]";
+   std::string so = "soft-constraints: [{soft-constraint: [{double-sub: [1, b]}, {double-sub: [1, b]}, 1.0, b, goal]}]";
+   std::string ha = "hard-constraints: []";
+   YAML::Node node = YAML::Load(sc + "\n" + co + "\n" + so + "\n" + ha);
+   giskard_core::QPControllerSpec spec = node.as<giskard_core::QPControllerSpec>();
+
+   // the alias c refers to the double a, which depends on x, not on y
+   using giskard_core::Scope;
+   std::set<giskard_core::ScopeEntryKey> hot = giskard_core::find_reachable_scope_entries(
+       giskard_core::get_constraint_specs(spec), spec.scope_);
+   EXPECT_EQ(std::set<giskard_core::ScopeEntryKey>({{"x", Scope::DoubleType}, {"a", Scope::DoubleType},
+       {"c", Scope::DoubleType}, {"b", Scope::DoubleType}}), hot);
+
+   // only the vector a is feedback
+   EXPECT_EQ(std::vector<giskard_core::ScopeEntryKey>({{"y", Scope::DoubleType}, {"a", Scope::VectorType},
+       {"n", Scope::DoubleType}}), giskard_core::find_feedback_scope_entries(spec));
+
+   giskard_core::QPControllerSpec pruned_spec = spec;
+   EXPECT_EQ(std::vector<std::string>({"y", "a", "n"}), giskard_core::prune_scope(pruned_spec));
+   ASSERT_EQ(4, pruned_spec.scope_.size());
+   EXPECT_EQ(spec.scope_[1].spec, pruned_spec.scope_[1].spec);
+
+   // keeping a name keeps its entries of every type
+   pruned_spec = spec;
+   EXPECT_EQ(std::vector<std::string>({"n"}), giskard_core::prune_scope(pruned_spec, {"a"}));
+   pruned_spec = spec;
+   EXPECT_TRUE(giskard_core::prune_scope(pruned_spec, {"n"}).empty());
+
+   giskard_core::QPController c = giskard_core::generate(spec);
+   EXPECT_EQ(std::vector<std::string>({"y", "a", "n"}), c.get_feedback_scope_names());
+   ASSERT_EQ(3, c.get_feedback_scope_handles().size());
+   EXPECT_EQ(Scope::VectorType, c.get_feedback_scope_handles()[1].get_type());
+}
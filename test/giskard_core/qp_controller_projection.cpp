@@ -32,13 +32,29 @@ protected:
       root_link = "base_footprint";
       weights = {{Robot::default_joint_weight_key(), 0.001}, {"torso_lift_joint", 0.01}};
       thresholds = {{Robot::default_joint_velocity_key(), 0.5}, {"torso_lift_joint", 0.01}};
+      joint_name = "torso_lift_joint";
+      goal_name = create_input_name("torso_controller", joint_name);
     }
 
     virtual void TearDown(){}
 
+    // joint control of the torso, with the goal as second observable
+    QPControllerSpecGenerator make_generator() const
+    {
+      ControlParams single_joint_params;
+      single_joint_params.root_link = "base_link";
+      single_joint_params.tip_link = "torso_lift_link";
+      single_joint_params.p_gain = 10;
+      single_joint_params.max_speed = 0.2;
+      single_joint_params.weight = 1.0;
+      single_joint_params.type = ControlParams::ControlType::Joint;
+      QPControllerParams params(urdf, root_link, weights, thresholds, {{"torso_controller", single_joint_params}});
+      return QPControllerSpecGenerator(params);
+    }
+
     urdf::Model urdf;
     std::map<std::string, double> weights, thresholds;
-    std::string root_link;
+    std::string root_link, joint_name, goal_name;
 
 };
 
@@ -82,8 +98,8 @@ TEST_F(QPControllerProjectionTest, TorsoLiftJointControl)
   QPControllerProjection projection(controller, projection_params);
 
   // checking sane initial state
-  EXPECT_EQ(0, projection.get_position_trajectories().size());
-  EXPECT_EQ(0, projection.get_velocity_trajectories().size());
+  EXPECT_EQ(0, projection.get_position_trajectories().rows());
+  EXPECT_EQ(0, projection.get_velocity_trajectories().rows());
   ASSERT_EQ(controller.get_controllable_names().size(), projection.get_controllable_names().size());
   for (size_t i=0; i<controller.get_controllable_names().size(); ++i)
     EXPECT_STREQ(controller.get_controllable_names()[i].c_str(), projection.get_controllable_names()[i].c_str());
@@ -105,25 +121,277 @@ TEST_F(QPControllerProjectionTest, TorsoLiftJointControl)
           {{joint_name, start_config}, {create_input_name(control_name, joint_name), goal_config}};
   ASSERT_NO_THROW(projection.run(initial_state));
   // check trajectory
-  EXPECT_EQ(projection.get_position_trajectories().size(), projection.get_velocity_trajectories().size());
+  size_t num_points = projection.num_trajectory_points();
+  EXPECT_EQ(num_points, projection.get_position_trajectories().rows());
+  EXPECT_EQ(num_points, projection.get_velocity_trajectories().rows());
+  EXPECT_EQ(1, projection.get_position_trajectories().cols());
+  EXPECT_EQ(1, projection.get_velocity_trajectories().cols());
   // minimum length OK
-  EXPECT_LE(projection_params.min_num_trajectory_points_, projection.get_position_trajectories().size());
-  EXPECT_LE(projection_params.min_num_trajectory_points_, projection.get_velocity_trajectories().size());
+  EXPECT_LE(projection_params.min_num_trajectory_points_, num_points);
   // maximum length OK
-  EXPECT_GE(projection_params.max_num_trajectory_points_, projection.get_position_trajectories().size());
-  EXPECT_GE(projection_params.max_num_trajectory_points_, projection.get_velocity_trajectories().size());
+  EXPECT_GE(projection_params.max_num_trajectory_points_, num_points);
   // initial state OK
-  EXPECT_DOUBLE_EQ(0.2, projection.get_position_trajectories()[0](0));
-  EXPECT_DOUBLE_EQ(0.0, projection.get_velocity_trajectories()[0](0));
+  EXPECT_DOUBLE_EQ(0.2, projection.get_position_trajectories()(0, 0));
+  EXPECT_DOUBLE_EQ(0.0, projection.get_velocity_trajectories()(0, 0));
   // end state OK
-  EXPECT_LT(std::abs(goal_config - projection.get_position_trajectories().back()(0)), convergence_threshold);
-  EXPECT_LT(projection.get_velocity_trajectories().back()(0), convergence_threshold);
+  EXPECT_LT(std::abs(goal_config - projection.get_position_trajectories()(num_points - 1, 0)), convergence_threshold);
+  EXPECT_LT(projection.get_velocity_trajectories()(num_points - 1, 0), convergence_threshold);
   // intermediate states OK
-  for (auto const & vel: projection.get_velocity_trajectories())
-    EXPECT_LE(std::abs(vel(0)), 0.01);
-  for (size_t i=0; i<projection.get_position_trajectories().size() -1; ++i)
-    EXPECT_NEAR((projection.get_position_trajectories()[i+1](0) - projection.get_position_trajectories()[i](0))/period,
-                projection.get_velocity_trajectories()[i+1](0), KDL::epsilon);
+  for (size_t i=0; i<num_points; ++i)
+    EXPECT_LE(std::abs(projection.get_velocity_trajectories()(i, 0)), 0.01);
+  for (size_t i=0; i<num_points -1; ++i)
+    EXPECT_NEAR((projection.get_position_trajectories()(i+1, 0) - projection.get_position_trajectories()(i, 0))/period,
+                projection.get_velocity_trajectories()(i+1, 0), KDL::epsilon);
+
+  // re-running reuses the trajectory storage
+  const double* positions = projection.get_position_trajectories().data();
+  const double* velocities = projection.get_velocity_trajectories().data();
+  initial_state[joint_name] = 0.1;
+  ASSERT_NO_THROW(projection.run(initial_state));
+  EXPECT_EQ(positions, projection.get_position_trajectories().data());
+  EXPECT_EQ(velocities, projection.get_velocity_trajectories().data());
+  EXPECT_DOUBLE_EQ(0.1, projection.get_position_trajectories()(0, 0));
+  EXPECT_LT(std::abs(goal_config - projection.get_position_trajectories()(projection.num_trajectory_points() - 1, 0)),
+      convergence_threshold);
+}
+
+TEST_F(QPControllerProjectionTest, StreamingProjection)
+{
+  QPControllerSpecGenerator gen = make_generator();
+
+  double period = 0.01;
+  QPControllerProjectionParams projection_params(period, gen.get_observable_names(),
+      {{joint_name, 0.0001}}, 50, 2000, 100);
+  QPControllerProjection projection(generate(gen.get_spec()), projection_params);
+  std::map< std::string, double > initial_state = {{joint_name, 0.2}, {goal_name, 0.05}};
+
+  // streaming the complete projection
+  size_t num_steps = 0;
+  ASSERT_TRUE(projection.run(initial_state, [&num_steps, period] (const QPControllerProjectionStep& step)
+      {
+        EXPECT_EQ(num_steps, step.get_index());
+        EXPECT_DOUBLE_EQ(num_steps * period, step.get_time());
+        EXPECT_EQ(1, step.get_positions().cols());
+        EXPECT_EQ(1, step.get_velocities().cols());
+        EXPECT_EQ(1, step.get_slacks().rows());
+        EXPECT_DOUBLE_EQ(step.get_positions()(0), step.get_observables()(0));
+        ++num_steps;
+        return true;
+      }));
+  EXPECT_EQ(projection.num_trajectory_points(), num_steps);
+  EXPECT_TRUE(projection.converged());
+
+  // stopping early
+  num_steps = 0;
+  EXPECT_FALSE(projection.run(initial_state, [&num_steps] (const QPControllerProjectionStep& step)
+      {
+        ++num_steps;
+        return step.get_positions()(0) > 0.15;
+      }));
+  EXPECT_EQ(projection.num_trajectory_points(), num_steps);
+  EXPECT_GE(0.15, projection.get_position_trajectories()(num_steps - 1, 0));
+  EXPECT_LT(0.15, projection.get_position_trajectories()(num_steps - 2, 0));
+  EXPECT_FALSE(projection.converged());
+}
+
+TEST_F(QPControllerProjectionTest, AdaptiveIntegration)
+{
+  QPControllerSpecGenerator gen = make_generator();
+  QPController controller = generate(gen.get_spec());
+
+  double goal_config = 0.05;
+  std::map< std::string, double > initial_state = {{joint_name, 0.2}, {goal_name, goal_config}};
+  QPControllerProjectionParams fixed_params(0.01, gen.get_observable_names(),
+      {{joint_name, 0.0001}}, 50, 2000, 100);
+
+  QPControllerProjection fixed(controller, fixed_params);
+  fixed.run(initial_state);
+  ASSERT_TRUE(fixed.converged());
+
+  QPControllerProjectionParams invalid_params = fixed_params;
+  invalid_params.set_adaptive(0.0, 0.001, 1.0);
+  EXPECT_THROW(QPControllerProjection(controller, invalid_params), std::runtime_error);
+  invalid_params.set_adaptive(0.0001, 0.1, 1.0);
+  EXPECT_THROW(QPControllerProjection(controller, invalid_params), std::runtime_error);
+
+  std::vector<QPControllerProjectionParams::Integrator> integrators =
+      {QPControllerProjectionParams::Euler, QPControllerProjectionParams::Heun, QPControllerProjectionParams::RK4};
+  for (auto const & integrator: integrators)
+  {
+    QPControllerProjectionParams adaptive_params = fixed_params;
+    adaptive_params.integrator_ = integrator;
+    adaptive_params.set_adaptive(0.0001, 0.001, 1.0);
+    QPControllerProjection adaptive(controller, adaptive_params);
+    ASSERT_NO_THROW(adaptive.run(initial_state));
+
+    size_t num_points = adaptive.num_trajectory_points();
+    EXPECT_TRUE(adaptive.converged());
+    EXPECT_GT(fixed.num_trajectory_points(), 2 * num_points);
+    EXPECT_NEAR(goal_config, adaptive.get_position_trajectories()(num_points - 1, 0), 0.001);
+    EXPECT_DOUBLE_EQ(0.0, adaptive.get_time_trajectory()(0));
+    for (size_t i=1; i<num_points; ++i)
+    {
+      double step_size = adaptive.get_time_trajectory()(i) - adaptive.get_time_trajectory()(i-1);
+      EXPECT_LE(adaptive_params.min_period_ - KDL::epsilon, step_size);
+      EXPECT_GE(adaptive_params.max_period_ + KDL::epsilon, step_size);
+      EXPECT_NEAR((adaptive.get_position_trajectories()(i, 0) - adaptive.get_position_trajectories()(i-1, 0)) / step_size,
+                  adaptive.get_velocity_trajectories()(i, 0), 1e-9);
+      EXPECT_LE(std::abs(adaptive.get_velocity_trajectories()(i, 0)), 0.01 + 1e-9);
+    }
+  }
+}
+
+TEST_F(QPControllerProjectionTest, EventTrigger)
+{
+  QPControllerSpecGenerator gen = make_generator();
+  QPController controller = generate(gen.get_spec());
+  QPControllerProjectionParams projection_params(0.01, gen.get_observable_names(),
+      {{joint_name, 0.0001}}, 50, 2000, 100);
+  std::map< std::string, double > initial_state = {{joint_name, 0.2}, {goal_name, 0.05}};
+
+  QPControllerProjection reference(controller, projection_params);
+  reference.run(initial_state);
+  ASSERT_TRUE(reference.converged());
+
+  // a trigger that would skip every update of the projection
+  controller.set_event_trigger(EventTriggerParams(1.0, 100));
+  QPControllerProjection projection(controller, projection_params);
+  EXPECT_TRUE(controller.get_event_trigger().is_active());
+  projection.run(initial_state);
+  ASSERT_TRUE(projection.converged());
+  ASSERT_EQ(reference.num_trajectory_points(), projection.num_trajectory_points());
+  EXPECT_TRUE(reference.get_position_trajectories().isApprox(projection.get_position_trajectories()));
+}
+
+TEST_F(QPControllerProjectionTest, TerminationCriteria)
+{
+  QPControllerSpecGenerator gen = make_generator();
+  QPController controller = generate(gen.get_spec());
+
+  QPControllerProjectionParams joint_params(0.01, gen.get_observable_names(),
+      {{joint_name, 0.0001}}, 50, 3000, 100);
+  QPControllerProjection joint_projection(controller, joint_params);
+  EXPECT_EQ(QPControllerProjection::NotRun, joint_projection.get_termination_reason());
+  joint_projection.run({{joint_name, 0.2}, {goal_name, 0.05}});
+  EXPECT_EQ(QPControllerProjection::JointsConverged, joint_projection.get_termination_reason());
+
+  // joint velocities never drop below a threshold of 0
+  QPControllerProjectionParams task_params(0.01, gen.get_observable_names(), {{joint_name, 0.0}}, 50, 3000, 100);
+  task_params.slack_thresholds_ = {{goal_name, 0.005}};
+  QPControllerProjection task_projection(controller, task_params);
+  task_projection.run({{joint_name, 0.2}, {goal_name, 0.05}});
+  EXPECT_EQ(QPControllerProjection::TaskConverged, task_projection.get_termination_reason());
+  EXPECT_TRUE(task_projection.converged());
+  EXPECT_GE(0.005, task_projection.get_task_error());
+  EXPECT_GT(joint_projection.num_trajectory_points(), task_projection.num_trajectory_points());
+
+  QPControllerProjectionParams invalid_params = task_params;
+  invalid_params.slack_thresholds_ = {{"unknown", 0.005}};
+  EXPECT_THROW(QPControllerProjection(controller, invalid_params), std::runtime_error);
+  invalid_params.slack_thresholds_ = {{goal_name, -0.005}};
+  EXPECT_THROW(QPControllerProjection(controller, invalid_params), std::runtime_error);
+  invalid_params.slack_thresholds_.clear();
+  invalid_params.scope_thresholds_ = {{"unknown", 0.005}};
+  EXPECT_THROW(QPControllerProjection(controller, invalid_params), std::runtime_error);
+
+  // the goal lies beyond the upper joint limit of 0.33
+  QPControllerProjectionParams stall_params(0.01, gen.get_observable_names(), {{joint_name, 0.0}}, 50, 3000, 100);
+  QPControllerProjection unlimited_projection(controller, stall_params);
+  unlimited_projection.run({{joint_name, 0.2}, {goal_name, 0.5}});
+  EXPECT_EQ(QPControllerProjection::MaxLengthReached, unlimited_projection.get_termination_reason());
+  EXPECT_FALSE(unlimited_projection.converged());
+
+  stall_params.stall_window_ = 50;
+  stall_params.stall_threshold_ = 0.0001;
+  QPControllerProjection stall_projection(controller, stall_params);
+  stall_projection.run({{joint_name, 0.2}, {goal_name, 0.5}});
+  EXPECT_EQ(QPControllerProjection::Stalled, stall_projection.get_termination_reason());
+  EXPECT_FALSE(stall_projection.converged());
+  EXPECT_GT(stall_params.max_num_trajectory_points_, stall_projection.num_trajectory_points());
+  EXPECT_NEAR(0.33, stall_projection.get_position_trajectories()(stall_projection.num_trajectory_points() - 1, 0), 0.001);
+}
+
+TEST_F(QPControllerProjectionTest, SlackTerminationWithRK4)
+{
+  QPControllerSpecGenerator gen = make_generator();
+  QPController controller = generate(gen.get_spec());
+  QPController reference = generate(gen.get_spec());
+
+  QPControllerProjectionParams params(0.01, gen.get_observable_names(), {{joint_name, 0.0}}, 5, 3000, 100);
+  params.integrator_ = QPControllerProjectionParams::RK4;
+  params.slack_thresholds_ = {{goal_name, 0.005}};
+  for (bool adaptive: {false, true})
+  {
+    if (adaptive)
+      params.set_adaptive(0.0001, 0.001, 1.0);
+    QPControllerProjection projection(controller, params);
+
+    // the slacks of every point belong to a solve at that point, not at a stage in between
+    size_t num_steps = 0;
+    double last_slack = 0.0;
+    ASSERT_TRUE(projection.run({{joint_name, 0.2}, {goal_name, 0.05}},
+        [&reference, &num_steps, &last_slack] (const QPControllerProjectionStep& step)
+        {
+          EXPECT_TRUE(reference.start(step.get_observables(), 100));
+          EXPECT_NEAR(reference.get_slack()(0), step.get_slacks()(0), 1e-6);
+          last_slack = step.get_slacks()(0);
+          ++num_steps;
+          return true;
+        }));
+
+    EXPECT_EQ(QPControllerProjection::TaskConverged, projection.get_termination_reason());
+    EXPECT_EQ(projection.num_trajectory_points(), num_steps);
+    EXPECT_DOUBLE_EQ(std::abs(last_slack), projection.get_task_error());
+    EXPECT_GE(0.005, projection.get_task_error());
+  }
+}
+
+TEST_F(QPControllerProjectionTest, BatchProjection)
+{
+  QPControllerSpecGenerator gen = make_generator();
+
+  double convergence_threshold = 0.0001;
+  QPControllerProjectionParams projection_params(0.01, gen.get_observable_names(),
+      {{joint_name, convergence_threshold}}, 50, 2000, 100);
+
+  std::vector<BatchProjection::Job> jobs;
+  for (size_t i=0; i<8; ++i)
+    jobs.push_back({{joint_name, 0.2}, {goal_name, 0.02 * i + 0.05}});
+
+  QPController controller = generate(gen.get_spec());
+  ASSERT_NO_THROW(BatchProjection(controller, projection_params, 2));
+  BatchProjection batch(controller, projection_params, 2);
+  EXPECT_EQ(2, batch.num_threads());
+
+  std::vector<BatchProjectionResult> results = batch.run(jobs);
+  ASSERT_EQ(jobs.size(), results.size());
+  for (size_t i=0; i<results.size(); ++i)
+  {
+    ASSERT_TRUE(results[i].completed_);
+    EXPECT_TRUE(results[i].converged_);
+    EXPECT_TRUE(results[i].error_.empty());
+    ASSERT_EQ(results[i].position_trajectories_.rows(), results[i].velocity_trajectories_.rows());
+    size_t last = results[i].position_trajectories_.rows() - 1;
+    EXPECT_DOUBLE_EQ(0.2, results[i].position_trajectories_(0, 0));
+    EXPECT_LT(std::abs(jobs[i][goal_name] - results[i].position_trajectories_(last, 0)), convergence_threshold);
+  }
+
+  // the workers run forks, the controller itself is left alone
+  EXPECT_EQ(0, controller.get_observables().rows());
+
+  // missing observables are reported per job
+  jobs[3].erase(goal_name);
+  results = batch.run(jobs);
+  EXPECT_FALSE(results[3].completed_);
+  EXPECT_FALSE(results[3].error_.empty());
+  EXPECT_TRUE(results[4].completed_);
+
+  // sequential batches stop right after the first success
+  BatchProjection sequential(controller, projection_params, 0);
+  results = sequential.run(jobs, 1);
+  EXPECT_TRUE(results[0].converged_);
+  for (size_t i=1; i<results.size(); ++i)
+    EXPECT_FALSE(results[i].completed_);
 }
 
 // N-DOF Control
@@ -248,6 +248,25 @@ TEST_F(RotationGenerationTest, Slerp)
   EXPECT_TRUE(KDL::Equal(r, KDL::Rotation::Quaternion(0.845, 0.262, 0.363, 0.293), eps));
 }
 
+TEST_F(RotationGenerationTest, Cached)
+{
+  std::string s = "cached-rotation: {axis-angle: [{vector3: [1,0,0]}, 0.5]}";
+  YAML::Node node = YAML::Load(s);
+
+  ASSERT_NO_THROW(node.as<giskard_core::RotationSpecPtr>());
+  giskard_core::RotationSpecPtr spec = node.as<giskard_core::RotationSpecPtr>();
+  EXPECT_EQ(giskard_core::RotationCachedKind, spec->get_kind());
+
+  ASSERT_NO_THROW(spec->get_expression(giskard_core::Scope()));
+  KDL::Expression<KDL::Rotation>::Ptr exp = spec->get_expression(giskard_core::Scope());
+
+  EXPECT_TRUE(KDL::Equal(KDL::Rotation::RotX(0.5), exp->value()));
+
+  YAML::Node encoded;
+  encoded = spec;
+  EXPECT_TRUE(spec->equals(*(encoded.as<giskard_core::RotationSpecPtr>())));
+}
+
 TEST_F(RotationGenerationTest, NearZeroTest)
 {
   using namespace KDL;
@@ -241,3 +241,102 @@ TEST_F(ScopeTest, FindRotation)
   EXPECT_EQ(rot_1, scope.find_rotation_expression("rot_1"));
   EXPECT_EQ(rot_2, scope.find_rotation_expression("rot_2"));
 }
+
+TEST_F(ScopeTest, Handles)
+{
+  giskard_core::Scope scope;
+
+  scope.add_double_expression("b", double_b);
+  scope.add_double_expression("a", double_a);
+  scope.add_frame_expression("1", frame_1);
+  scope.add_vector_expression("a", vec_I);
+
+  EXPECT_FALSE(giskard_core::Scope::Handle().is_valid());
+  EXPECT_THROW(scope.resolve("c"), std::invalid_argument);
+  EXPECT_THROW(scope.resolve("1", giskard_core::Scope::DoubleType), std::invalid_argument);
+  EXPECT_THROW(scope.add_vector_expression("a", vec_II), std::invalid_argument);
+
+  giskard_core::Scope::Handle a = scope.resolve("a");
+  ASSERT_TRUE(a.is_valid());
+  EXPECT_EQ(giskard_core::Scope::DoubleType, a.get_type());
+  EXPECT_EQ(1, a.get_index());
+  EXPECT_EQ(double_a, scope.get_double(a));
+  EXPECT_EQ(double_a, scope.get(a));
+  EXPECT_STREQ("a", scope.get_name(a).c_str());
+  EXPECT_THROW(scope.get_vector(a), std::invalid_argument);
+
+  giskard_core::Scope::Handle vec_a = scope.resolve("a", giskard_core::Scope::VectorType);
+  EXPECT_NE(a, vec_a);
+  EXPECT_EQ(vec_I, scope.get_vector(vec_a));
+  EXPECT_EQ(vec_I, scope.find_vector_expression("a"));
+
+  giskard_core::Scope::Handle frame = scope.resolve("1");
+  EXPECT_EQ(giskard_core::Scope::FrameType, frame.get_type());
+  EXPECT_EQ(frame_1, scope.get_frame(frame));
+  EXPECT_THROW(scope.get_frame(giskard_core::Scope::Handle(giskard_core::Scope::FrameType, 1)), std::out_of_range);
+
+  // handles stay valid when adding expressions, and in copies
+  scope.add_frame_expression("2", frame_2);
+  giskard_core::Scope copy = scope;
+  EXPECT_EQ(double_a, copy.get_double(a));
+  EXPECT_EQ(frame_1, copy.get_frame(frame));
+
+  // names are sorted, independent of insertion order
+  ASSERT_EQ(2, scope.get_double_names().size());
+  EXPECT_STREQ("a", scope.get_double_names()[0].c_str());
+  EXPECT_STREQ("b", scope.get_double_names()[1].c_str());
+
+  // clones keep names and handles, but not the expressions
+  giskard_core::Scope clone = scope.clone();
+  EXPECT_EQ(5, clone.get_expressions().size());
+  EXPECT_EQ(a, clone.resolve("a"));
+  EXPECT_NE(double_a, clone.get_double(a));
+  EXPECT_NE(frame_1, clone.get_frame(frame));
+  EXPECT_TRUE(KDL::Equal(frame_1->value(), clone.get_frame(frame)->value()));
+}
+
+TEST_F(ScopeTest, Snapshot)
+{
+  giskard_core::Scope scope;
+  scope.add_double_expression("a", double_a);
+  scope.add_double_expression("b", double_b);
+  scope.add_frame_expression("1", frame_2);
+  scope.add_rotation_expression("rot", rot_1);
+  scope.add_vector_expression("I", vec_I);
+
+  giskard_core::ScopeSnapshot snapshot(scope, {"1", "a", "I", "rot", "b"});
+  EXPECT_THROW(snapshot.add(scope, "c"), std::invalid_argument);
+  ASSERT_EQ(5, snapshot.num_entries());
+  EXPECT_EQ(12 + 1 + 3 + 9 + 1, snapshot.size());
+  EXPECT_EQ(0, snapshot.get_layout()[0].offset_);
+  EXPECT_EQ(12, snapshot.get_layout()[1].offset_);
+  EXPECT_EQ(13, snapshot.get_layout()[2].offset_);
+  EXPECT_EQ(16, snapshot.get_layout()[3].offset_);
+  EXPECT_EQ(25, snapshot.get_layout()[4].offset_);
+  EXPECT_EQ(giskard_core::Scope::RotationType, snapshot.get_layout()[3].type_);
+  EXPECT_STREQ("rot", snapshot.get_layout()[3].name_.c_str());
+
+  double_a->setInputValue(0, 2.0);
+  frame_2->setInputValue(0, 2.0);
+  rot_1->setInputValue(0, 2.0);
+  vec_I->setInputValue(0, 2.0);
+  snapshot.capture();
+  const Eigen::VectorXd& buffer = snapshot.get_buffer();
+  EXPECT_DOUBLE_EQ(2.0, snapshot.get_double(1, buffer));
+  EXPECT_DOUBLE_EQ(1.0, snapshot.get_double(4, buffer));
+  EXPECT_TRUE(KDL::Equal(vec_I->value(), snapshot.get_vector(2, buffer)));
+  EXPECT_TRUE(KDL::Equal(rot_1->value(), snapshot.get_rotation(3, buffer)));
+  EXPECT_TRUE(KDL::Equal(frame_2->value(), snapshot.get_frame(0, buffer)));
+  EXPECT_DOUBLE_EQ(1.0, buffer(9));
+  EXPECT_DOUBLE_EQ(2.0, buffer(10));
+  EXPECT_DOUBLE_EQ(3.0, buffer(11));
+  EXPECT_THROW(snapshot.get_double(0, buffer), std::invalid_argument);
+  EXPECT_THROW(snapshot.get_double(5, buffer), std::out_of_range);
+
+  giskard_core::ConcurrentScopeSnapshot concurrent(scope, {"a", "1"});
+  EXPECT_FALSE(concurrent.fetch());
+  concurrent.capture();
+  ASSERT_TRUE(concurrent.fetch());
+  EXPECT_EQ(13, concurrent.get_buffer().rows());
+  EXPECT_DOUBLE_EQ(2.0, concurrent.get_snapshot().get_double(0, concurrent.get_buffer()));
+}
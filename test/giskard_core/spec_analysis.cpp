@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <gtest/gtest.h>
+#include <giskard_core/giskard_core.hpp>
+#include <sstream>
+
+using namespace giskard_core;
+
+class SpecAnalysisTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      // (q0 + q1)^2 with a shared sum, plus one unused scope entry
+      DoubleSpecPtr q0 = input(0);
+      DoubleSpecPtr sum = double_add_spec({q0, input(1)});
+      DoubleSpecPtr weight = double_const_spec(1.0);
+      DoubleSpecPtr lower = double_const_spec(-0.1);
+      DoubleSpecPtr upper = double_const_spec(0.1);
+
+      spec.scope_.push_back(ScopeEntry("unused", double_mul_spec({q0, double_const_spec(2.0)})));
+
+      for (size_t i=0; i<2; ++i)
+      {
+        ControllableConstraintSpec controllable;
+        controllable.lower_ = lower;
+        controllable.upper_ = upper;
+        controllable.weight_ = weight;
+        controllable.input_number_ = i;
+        controllable.name_ = "joint" + std::to_string(i);
+        spec.controllable_constraints_.push_back(controllable);
+      }
+
+      SoftConstraintSpec soft;
+      soft.expression_ = double_mul_spec({sum, sum});
+      soft.lower_ = double_const_spec(-1.0);
+      soft.upper_ = double_const_spec(1.0);
+      soft.weight_ = weight;
+      soft.name_ = "goal";
+      spec.soft_constraints_.push_back(soft);
+    }
+
+    virtual void TearDown(){}
+
+    QPControllerSpec spec;
+};
+
+TEST_F(SpecAnalysisTest, SpecStatistics)
+{
+  SpecStatistics statistics = analyze(spec);
+
+  EXPECT_EQ(1, statistics.num_scope_entries_);
+  EXPECT_EQ(2, statistics.num_controllables_);
+  EXPECT_EQ(1, statistics.num_soft_constraints_);
+  EXPECT_EQ(0, statistics.num_hard_constraints_);
+
+  EXPECT_EQ(11, statistics.num_nodes_);
+  EXPECT_DOUBLE_EQ(19.0, statistics.num_tree_nodes_);
+  EXPECT_DOUBLE_EQ(19.0 / 11.0, statistics.sharing_ratio());
+  EXPECT_EQ(3, statistics.depth_);
+  EXPECT_EQ(9, statistics.num_hot_nodes_);
+
+  EXPECT_EQ(2, statistics.num_nodes_per_kind_["DoubleInputSpec"]);
+  EXPECT_EQ(6, statistics.num_nodes_per_kind_["DoubleConstSpec"]);
+  EXPECT_EQ(1, statistics.num_nodes_per_kind_["DoubleAdditionSpec"]);
+  EXPECT_EQ(2, statistics.num_nodes_per_kind_["DoubleMultiplicationSpec"]);
+  EXPECT_EQ(11, statistics.num_nodes_per_type_["double"]);
+
+  // one addition and one multiplication, both depending on both joints
+  EXPECT_DOUBLE_EQ(2.0, statistics.value_flops_);
+  EXPECT_DOUBLE_EQ(2.0 * 1.0 + 2.0 * 3.0, statistics.derivative_flops_);
+
+  std::stringstream report;
+  report << statistics;
+  EXPECT_NE(std::string::npos, report.str().find("DoubleMultiplicationSpec"));
+}
+
+TEST_F(SpecAnalysisTest, QPDimensions)
+{
+  QPController controller = generate(spec);
+  ASSERT_TRUE(controller.start(Eigen::Vector2d(0.5, 0.25), 100));
+
+  QPStatistics statistics = analyze(controller);
+  EXPECT_EQ(2, statistics.num_controllables_);
+  EXPECT_EQ(1, statistics.num_soft_constraints_);
+  EXPECT_EQ(0, statistics.num_hard_constraints_);
+  EXPECT_EQ(2, statistics.num_observables_);
+  EXPECT_EQ(3, statistics.num_variables_);
+  EXPECT_EQ(1, statistics.num_constraints_);
+  EXPECT_EQ(3, statistics.num_nonzeros_A_);
+  EXPECT_DOUBLE_EQ(1.0, statistics.density_A());
+}
+
+TEST_F(SpecAnalysisTest, LargeSpec)
+{
+  YAML::Node node = YAML::LoadFile("pr2_cart_cart_control.yaml");
+  QPControllerSpec pr2_spec = node.as<QPControllerSpec>();
+
+  SpecStatistics statistics = analyze(pr2_spec);
+  EXPECT_LT(0, statistics.num_nodes_);
+  EXPECT_LE(statistics.num_hot_nodes_, statistics.num_nodes_);
+  EXPECT_LE(1.0, statistics.sharing_ratio());
+  EXPECT_LT(0.0, statistics.value_flops_);
+  EXPECT_LT(0.0, statistics.derivative_flops_);
+
+  // simplification never makes a spec more expensive
+  SpecStatistics simplified = analyze(simplify(pr2_spec));
+  EXPECT_GE(statistics.flops(), simplified.flops());
+}
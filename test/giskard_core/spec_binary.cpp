@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <gtest/gtest.h>
+#include <giskard_core/giskard_core.hpp>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+using namespace giskard_core;
+
+class SpecBinaryTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      for (auto const & filename: {"broken_flying_cup.yaml", "flying_cup_approach_motion.yaml",
+          "pr2_cart_cart_control.yaml", "pr2_qp_position_control.yaml",
+          "pr2_qp_position_control_with_deactivated_controllables.yaml",
+          "pr2_qp_position_control_with_excess_observables.yaml"})
+        specs.push_back(YAML::LoadFile(filename).as<QPControllerSpec>());
+
+      for (auto const & filename: {"pr2_left_arm_scope.yaml", "project_point_into_plane.yaml"})
+      {
+        QPControllerSpec spec;
+        spec.scope_ = YAML::LoadFile(filename).as<ScopeSpec>();
+        specs.push_back(spec);
+      }
+
+      QPControllerSpec spec;
+      spec.scope_.push_back(ScopeEntry("fk",
+            YAML::LoadFile("pr2_left_arm_single_expression.yaml").as<FrameSpecPtr>()));
+      specs.push_back(spec);
+    }
+
+    virtual void TearDown(){}
+
+    std::vector<QPControllerSpec> specs;
+
+    static std::string to_yaml(const QPControllerSpec& spec)
+    {
+      YAML::Node node;
+      node = spec;
+      return YAML::Dump(node);
+    }
+};
+
+TEST_F(SpecBinaryTest, RoundTrip)
+{
+  for (auto const & spec: specs)
+  {
+    std::string data = write_binary_spec(spec);
+    ASSERT_TRUE(is_binary_spec(data.data(), data.size()));
+    QPControllerSpec result = read_binary_spec(data.data(), data.size());
+
+    EXPECT_EQ(to_yaml(spec), to_yaml(result));
+    EXPECT_EQ(fingerprint(spec), fingerprint(result));
+    EXPECT_EQ(analyze(spec).num_nodes_, analyze(result).num_nodes_);
+    EXPECT_EQ(data, write_binary_spec(result));
+  }
+}
+
+TEST_F(SpecBinaryTest, SharedNodes)
+{
+  DoubleSpecPtr shared = double_add_spec({input(0), double_const_spec(1.0)});
+  QPControllerSpec spec;
+  spec.scope_.push_back(ScopeEntry("a", double_mul_spec({shared, shared})));
+  spec.scope_.push_back(ScopeEntry("b", shared));
+
+  std::string data = write_binary_spec(spec);
+  QPControllerSpec result = read_binary_spec(data.data(), data.size());
+
+  ASSERT_EQ(2, result.scope_.size());
+  std::vector<SpecPtr> children = result.scope_[0].spec->get_children();
+  ASSERT_EQ(2, children.size());
+  EXPECT_EQ(children[0], children[1]);
+  EXPECT_EQ(children[0], result.scope_[1].spec);
+  EXPECT_TRUE(shared->equals(*(result.scope_[1].spec)));
+}
+
+TEST_F(SpecBinaryTest, MappedFile)
+{
+  std::string filename = "spec_binary_test.bin";
+  ASSERT_NO_THROW(save_binary_spec(specs[2], filename));
+
+  QPControllerSpec result;
+  {
+    SpecArena arena;
+    SpecArenaGuard guard(arena);
+    ASSERT_NO_THROW(result = load_binary_spec(filename));
+    EXPECT_LT(0, arena.get_memory().num_allocations());
+  }
+  std::remove(filename.c_str());
+
+  EXPECT_EQ(to_yaml(specs[2]), to_yaml(result));
+  ASSERT_NO_THROW(generate(result));
+  EXPECT_THROW(load_binary_spec(filename), std::runtime_error);
+}
+
+TEST_F(SpecBinaryTest, InvalidData)
+{
+  std::string data = write_binary_spec(specs[2]);
+  BinarySpecHeader header;
+  std::memcpy(&header, data.data(), sizeof(header));
+
+  std::string yaml = to_yaml(specs[2]);
+  EXPECT_FALSE(is_binary_spec(yaml.data(), yaml.size()));
+  EXPECT_THROW(read_binary_spec(yaml.data(), yaml.size()), std::runtime_error);
+  EXPECT_THROW(read_binary_spec(data.data(), data.size() - 1), std::runtime_error);
+
+  std::string wrong_version = data;
+  wrong_version[offsetof(BinarySpecHeader, version_)] = 2;
+  EXPECT_THROW(read_binary_spec(wrong_version.data(), wrong_version.size()), std::runtime_error);
+
+  // node with unknown tag
+  size_t first_node = sizeof(BinarySpecHeader) + header.num_values_ * sizeof(double);
+  std::string wrong_kind = data;
+  std::uint32_t kind = 1000;
+  std::memcpy(&wrong_kind[first_node], &kind, sizeof(kind));
+  EXPECT_THROW(read_binary_spec(wrong_kind.data(), wrong_kind.size()), std::runtime_error);
+
+  // missing child, and missing expression of a soft constraint
+  std::uint32_t none = BinarySpecHeader::none();
+  size_t first_child = first_node + header.num_nodes_ * BinarySpecHeader::node_size * sizeof(std::uint32_t);
+  ASSERT_LT(0, header.num_children_);
+  std::string missing_child = data;
+  std::memcpy(&missing_child[first_child], &none, sizeof(none));
+  EXPECT_THROW(read_binary_spec(missing_child.data(), missing_child.size()), std::runtime_error);
+
+  size_t first_soft_constraint = first_child + (header.num_children_ + header.num_strings_ + 1 +
+      2 * header.num_scope_entries_ + BinarySpecHeader::controllable_size * header.num_controllables_) *
+      sizeof(std::uint32_t);
+  ASSERT_LT(0, header.num_soft_constraints_);
+  std::string missing_expression = data;
+  std::memcpy(&missing_expression[first_soft_constraint], &none, sizeof(none));
+  EXPECT_THROW(read_binary_spec(missing_expression.data(), missing_expression.size()), std::runtime_error);
+
+  // which cannot be written either
+  QPControllerSpec missing_spec = specs[2];
+  missing_spec.soft_constraints_[0].expression_.reset();
+  EXPECT_THROW(write_binary_spec(missing_spec), std::invalid_argument);
+}
+
+TEST_F(SpecBinaryTest, FrozenTags)
+{
+  // changing any of these breaks existing files
+  EXPECT_EQ(0, get_binary_tag(AliasReferenceKind));
+  EXPECT_EQ(1, get_binary_tag(DoubleConstKind));
+  EXPECT_EQ(25, get_binary_tag(DoubleCachedKind));
+  EXPECT_EQ(37, get_binary_tag(RotationQuaternionConstructorKind));
+  EXPECT_EQ(49, get_binary_tag(InverseFrameKind));
+
+  for (std::uint32_t tag=0; tag<=get_binary_tag(InverseFrameKind); ++tag)
+    EXPECT_EQ(tag, get_binary_tag(get_binary_kind(tag)));
+  EXPECT_THROW(get_binary_kind(50), std::runtime_error);
+}
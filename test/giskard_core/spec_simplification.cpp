@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2017 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ *
+ * This file is part of giskard.
+ *
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <gtest/gtest.h>
+#include <giskard_core/giskard_core.hpp>
+
+using namespace giskard_core;
+
+class SpecSimplificationTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      x = input(0);
+      y = input(1);
+    }
+
+    virtual void TearDown(){}
+
+    DoubleSpecPtr x, y;
+};
+
+TEST_F(SpecSimplificationTest, FoldDoubles)
+{
+  SpecSimplifier simplifier;
+
+  EXPECT_TRUE(simplifier.simplify(double_add_spec({x, double_const_spec(0.0)}))->equals(*x));
+  EXPECT_TRUE(simplifier.simplify(double_mul_spec({double_const_spec(1.0), x}))->equals(*x));
+  EXPECT_TRUE(simplifier.simplify(double_mul_spec({x, double_const_spec(0.0)}))->equals(*double_const_spec(0.0)));
+  EXPECT_TRUE(simplifier.simplify(double_div({x, double_const_spec(1.0)}))->equals(*x));
+  EXPECT_TRUE(simplifier.simplify(double_sub_spec({x, double_const_spec(0.0)}))->equals(*x));
+  EXPECT_TRUE(simplifier.simplify(double_add_spec({x, double_const_spec(1.0), y, double_const_spec(2.0)}))->
+      equals(*double_add_spec({x, y, double_const_spec(3.0)})));
+
+  EXPECT_TRUE(simplifier.simplify(double_sub_spec({double_const_spec(3.0), double_const_spec(1.0)}))->
+      equals(*double_const_spec(2.0)));
+  EXPECT_TRUE(simplifier.simplify(fmod(double_const_spec(2.1), double_const_spec(1.5)))->
+      equals(*double_const_spec(std::fmod(2.1, 1.5))));
+  EXPECT_TRUE(simplifier.simplify(double_if(double_const_spec(0.0), x, y))->equals(*x));
+  EXPECT_TRUE(simplifier.simplify(double_if(double_const_spec(-1.0), x, y))->equals(*y));
+  EXPECT_TRUE(simplifier.simplify(x_coord(vector_constructor_spec(double_const_spec(4.0))))->
+      equals(*double_const_spec(4.0)));
+
+  // divisions by zero stay as they are
+  DoubleSpecPtr division = double_div({x, double_const_spec(0.0)});
+  EXPECT_EQ(division, simplifier.simplify(division));
+
+  // nothing to simplify
+  DoubleSpecPtr sum = double_add_spec({x, y});
+  EXPECT_EQ(sum, simplifier.simplify(sum));
+  EXPECT_EQ(x, simplifier.simplify(x));
+}
+
+TEST_F(SpecSimplificationTest, FuseFrames)
+{
+  KDL::Frame a(KDL::Rotation::RPY(0.1, 0.2, 0.3), KDL::Vector(1, 2, 3));
+  KDL::Frame b(KDL::Rotation::RPY(-0.3, 0.5, 0.0), KDL::Vector(0, -1, 0.5));
+  double qx, qy, qz, qw;
+  a.M.GetQuaternion(qx, qy, qz, qw);
+  FrameSpecPtr a_spec = frame_constructor_spec(vector_constructor_spec(double_const_spec(1),
+      double_const_spec(2), double_const_spec(3)), quaternion_spec(qx, qy, qz, qw));
+  b.M.GetQuaternion(qx, qy, qz, qw);
+  FrameSpecPtr b_spec = frame_constructor_spec(vector_constructor_spec(double_const_spec(0),
+      double_const_spec(-1), double_const_spec(0.5)), quaternion_spec(qx, qy, qz, qw));
+  FrameSpecPtr joint = frame_constructor_spec(vector_constructor_spec(),
+      axis_angle_spec(vector_constructor_spec(double_const_spec(0), double_const_spec(0), double_const_spec(1)), x));
+
+  FrameMultiplicationSpecPtr chain = frame_multiplication_spec({frame_constructor_spec(), a_spec, b_spec, joint,
+      frame_constructor_spec()});
+  SpecSimplifier simplifier;
+  FrameSpecPtr simplified = simplifier.simplify<FrameSpec>(chain);
+
+  FrameMultiplicationSpecPtr fused = boost::dynamic_pointer_cast<FrameMultiplicationSpec>(simplified);
+  ASSERT_TRUE(fused.get());
+  ASSERT_EQ(2, fused->get_inputs().size());
+  EXPECT_EQ(joint, fused->get_inputs()[1]);
+  EXPECT_LT(0, simplifier.num_simplifications());
+
+  // the given spec stays as it is
+  EXPECT_EQ(5, chain->get_inputs().size());
+
+  Scope scope;
+  KDL::Expression<KDL::Frame>::Ptr expected = chain->get_expression(scope);
+  KDL::Expression<KDL::Frame>::Ptr actual = simplified->get_expression(scope);
+  std::vector<double> inputs = {0.7};
+  expected->setInputValues(inputs);
+  actual->setInputValues(inputs);
+  EXPECT_TRUE(KDL::Equal(expected->value(), actual->value()));
+  EXPECT_TRUE(KDL::Equal(expected->derivative(0), actual->derivative(0)));
+
+  EXPECT_TRUE(simplifier.simplify(frame_multiplication_spec({frame_constructor_spec(), joint}))->equals(*joint));
+}
+
+TEST_F(SpecSimplificationTest, KeepNearIdentities)
+{
+  SpecSimplifier simplifier;
+  VectorSpecPtr vector = vector_constructor_spec(x, y, x);
+  FrameSpecPtr joint = frame_constructor_spec(vector, quaternion_spec());
+
+  // only exact identities get dropped, anything else would change values
+  VectorAdditionSpecPtr sum(new VectorAdditionSpec());
+  sum->set_inputs({vector, vector_constructor_spec(double_const_spec(1e-9))});
+  EXPECT_EQ(sum, simplifier.simplify(sum));
+
+  RotationMultiplicationSpecPtr rotations = rotation_multiplication_spec(
+      {quaternion_spec(0, 0, std::sin(1e-8), std::cos(1e-8)), axis_angle_spec(vector, x)});
+  EXPECT_EQ(rotations, simplifier.simplify(rotations));
+
+  FrameMultiplicationSpecPtr frames = frame_multiplication_spec({frame_constructor_spec(
+      vector_constructor_spec(double_const_spec(), double_const_spec(-1e-9))), joint});
+  EXPECT_EQ(frames, simplifier.simplify(frames));
+
+  EXPECT_TRUE(simplifier.simplify(frame_multiplication_spec({joint, frame_constructor_spec(
+      vector_constructor_spec(), quaternion_spec(0, 0, 0, 1))}))->equals(*joint));
+}
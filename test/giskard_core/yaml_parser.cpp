@@ -22,6 +22,7 @@
 #include <giskard_core/giskard_core.hpp>
 #include <boost/assign/list_of.hpp>
 #include <boost/lexical_cast.hpp>
+#include <set>
 
 class YamlParserTest : public ::testing::Test
 {
@@ -954,3 +955,118 @@ TEST_F(YamlParserTest, AliasTest)
   EXPECT_EQ(scope.find_rotation_expression("c").get(), scope.find_rotation_expression("aliasCC").get());
   EXPECT_EQ(scope.find_frame_expression("d").get(), scope.find_frame_expression("aliasDD").get());
 }
+
+TEST_F(YamlParserTest, ArenaAllocation)
+{
+  YAML::Node node = YAML::LoadFile("pr2_cart_cart_control.yaml");
+  giskard_core::QPControllerSpec heap_spec = node.as<giskard_core::QPControllerSpec>();
+
+  giskard_core::QPControllerSpec arena_spec;
+  {
+    giskard_core::SpecArena arena;
+    giskard_core::SpecArenaGuard guard(arena);
+    arena_spec = node.as<giskard_core::QPControllerSpec>();
+    EXPECT_LT(0, arena.get_memory().num_allocations());
+  }
+
+  // specs outlive their arena, and new specs go to the heap again
+  EXPECT_FALSE(giskard_core::SpecArena::current());
+  ASSERT_EQ(heap_spec.scope_.size(), arena_spec.scope_.size());
+  for (size_t i=0; i<heap_spec.scope_.size(); ++i)
+    EXPECT_TRUE(heap_spec.scope_[i].spec->equals(*(arena_spec.scope_[i].spec)));
+
+  ASSERT_NO_THROW(giskard_core::generate(arena_spec));
+}
+
+TEST_F(YamlParserTest, KeywordDispatch)
+{
+  std::vector<std::string> specs = {"{double-add: [1.0, {input-var: 0}]}",
+      "{vector-cross: [{vector3: [1, 0, 0]}, {vector3: [0, 1, 0]}]}", "{orientation-of: a}",
+      "{cached-frame: b}"};
+  std::vector<giskard_core::SpecKind> kinds = {giskard_core::DoubleAdditionKind,
+      giskard_core::VectorCrossKind, giskard_core::OrientationOfKind, giskard_core::FrameCachedKind};
+
+  for (size_t i=0; i<specs.size(); ++i)
+  {
+    YAML::Node node = YAML::Load(specs[i]);
+    const YAML::SpecKeyword* keyword = YAML::find_spec_keyword(node);
+    ASSERT_TRUE(keyword);
+    EXPECT_EQ(kinds[i], keyword->kind_);
+    EXPECT_EQ(kinds[i], node.as<giskard_core::SpecPtr>()->get_kind());
+  }
+
+  // every spec apart from constants and references has a keyword
+  std::set<giskard_core::SpecKind> keyword_kinds;
+  for (auto const & keyword: YAML::get_spec_keywords())
+    EXPECT_TRUE(keyword_kinds.insert(keyword.second.kind_).second);
+  EXPECT_EQ(size_t(giskard_core::InverseFrameKind) + 1 - 6, keyword_kinds.size());
+
+  // keywords of other types, malformed specs, and unknown keywords
+  YAML::Node node = YAML::Load("{vector3: [1, 2, 3]}");
+  EXPECT_TRUE(YAML::is_vector_spec(node));
+  EXPECT_FALSE(YAML::is_double_spec(node));
+  EXPECT_ANY_THROW(node.as<giskard_core::DoubleSpecPtr>());
+  EXPECT_FALSE(YAML::find_spec_keyword(YAML::Load("{vector3: [1, 2]}")));
+  EXPECT_FALSE(YAML::find_spec_keyword(YAML::Load("{vector4: [1, 2, 3, 4]}")));
+  EXPECT_FALSE(YAML::find_spec_keyword(YAML::Load("{vector3: [1, 2, 3], frame: a}")));
+  EXPECT_EQ(giskard_core::AliasReferenceKind, YAML::Load("c").as<giskard_core::SpecPtr>()->get_kind());
+  EXPECT_EQ(giskard_core::DoubleConstKind, YAML::Load("1.5").as<giskard_core::SpecPtr>()->get_kind());
+}
+
+TEST_F(YamlParserTest, SharedSubtrees)
+{
+  giskard_core::DoubleSpecPtr shared =
+      giskard_core::double_add_spec({giskard_core::input(0), giskard_core::double_const_spec(1.0)});
+  giskard_core::QPControllerSpec spec;
+  spec.scope_.push_back(giskard_core::ScopeEntry("a", giskard_core::double_mul_spec({shared, shared})));
+  spec.scope_.push_back(giskard_core::ScopeEntry("b", shared));
+
+  std::string s = YAML::dump_shared(spec);
+  EXPECT_NE(std::string::npos, s.find("&s1"));
+  EXPECT_NE(std::string::npos, s.find("*s1"));
+  EXPECT_EQ(std::string::npos, s.find("giskard-shared"));
+
+  giskard_core::QPControllerSpec result = YAML::Load(s).as<giskard_core::QPControllerSpec>();
+  ASSERT_EQ(2, result.scope_.size());
+  EXPECT_TRUE(spec.scope_[0].spec->equals(*(result.scope_[0].spec)));
+  EXPECT_TRUE(spec.scope_[1].spec->equals(*(result.scope_[1].spec)));
+
+  // aliases decode to the spec of their anchor
+  giskard_core::DoubleMultiplicationSpecPtr product =
+      boost::dynamic_pointer_cast<giskard_core::DoubleMultiplicationSpec>(result.scope_[0].spec);
+  ASSERT_TRUE(product.get());
+  ASSERT_EQ(2, product->get_inputs().size());
+  EXPECT_EQ(product->get_inputs()[0], product->get_inputs()[1]);
+  EXPECT_EQ(result.scope_[1].spec, product->get_inputs()[0]);
+
+  // plain encoding is not affected
+  YAML::Node node;
+  node = spec;
+  YAML::Emitter out;
+  out << node;
+  EXPECT_EQ(std::string::npos, std::string(out.c_str()).find("&"));
+
+  // equal subtrees of a parsed spec are shared after interning
+  giskard_core::QPControllerSpec pr2_spec =
+      YAML::LoadFile("pr2_cart_cart_control.yaml").as<giskard_core::QPControllerSpec>();
+  giskard_core::SpecInterner().intern(pr2_spec);
+  node = pr2_spec;
+  YAML::Emitter pr2_out;
+  pr2_out << node;
+  s = YAML::dump_shared(pr2_spec);
+  EXPECT_LT(s.size(), std::string(pr2_out.c_str()).size());
+
+  result = YAML::Load(s).as<giskard_core::QPControllerSpec>();
+  ASSERT_EQ(pr2_spec.scope_.size(), result.scope_.size());
+  for (size_t i=0; i<pr2_spec.scope_.size(); ++i)
+  {
+    EXPECT_EQ(pr2_spec.scope_[i].name, result.scope_[i].name);
+    EXPECT_TRUE(pr2_spec.scope_[i].spec->equals(*(result.scope_[i].spec)));
+  }
+  ASSERT_EQ(pr2_spec.soft_constraints_.size(), result.soft_constraints_.size());
+  for (size_t i=0; i<pr2_spec.soft_constraints_.size(); ++i)
+    EXPECT_TRUE(pr2_spec.soft_constraints_[i].expression_->equals(*(result.soft_constraints_[i].expression_)));
+
+  // parsing keeps the sharing, so the result is written the same way again
+  EXPECT_EQ(s, YAML::dump_shared(result));
+}